@@ -0,0 +1,337 @@
+#ifndef PAR_OPT_BENCHMARK_H
+#define PAR_OPT_BENCHMARK_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include "ParOptInteriorPoint.h"
+
+#ifdef PAROPT_USE_OPENMP
+#include <omp.h>
+#endif // PAROPT_USE_OPENMP
+
+/*
+  Common utilities for the ParOpt benchmarks.
+
+  Each benchmark result is written by the root processor to stdout as
+  a single JSON object on its own line, so that the output of several
+  runs can be concatenated and loaded with any JSON-lines reader. The
+  times reported are the maximum over all processors.
+*/
+
+/*
+  A kernel that is timed by repeatedly calling run()
+*/
+class ParOptBenchKernel {
+ public:
+  virtual ~ParOptBenchKernel(){}
+  virtual void run() = 0;
+};
+
+/**
+  Time the kernel. The kernel is run once as a warm-up, then repeated
+  until at least min_reps calls have been made and min_time seconds
+  have elapsed. The number of repetitions is decided on the root
+  processor so that all processors make the same number of calls.
+
+  @param comm the communicator
+  @param kernel the kernel to time
+  @param min_time the minimum total time in seconds
+  @param min_reps the minimum number of repetitions
+  @param reps the number of timed repetitions
+  @param tmin the minimum time per call (max over the processors)
+  @param tavg the average time per call (max over the processors)
+*/
+static inline void ParOptBenchTime( MPI_Comm comm,
+                                    ParOptBenchKernel *kernel,
+                                    double min_time, int min_reps,
+                                    int *reps, double *tmin,
+                                    double *tavg ){
+  kernel->run();
+
+  int count = 0;
+  double total = 0.0, fastest = 1e20;
+  int done = 0;
+  while (!done){
+    MPI_Barrier(comm);
+    double t0 = MPI_Wtime();
+    kernel->run();
+    double t = MPI_Wtime() - t0;
+    MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, comm);
+
+    count++;
+    total += t;
+    if (t < fastest){
+      fastest = t;
+    }
+
+    done = (count >= min_reps && total >= min_time);
+    MPI_Bcast(&done, 1, MPI_INT, 0, comm);
+  }
+
+  *reps = count;
+  *tmin = fastest;
+  *tavg = total/count;
+}
+
+/**
+  Write one benchmark record as a line of JSON from the root processor.
+
+  The fields are given as a printf-style format string for the body of
+  the object, for instance: "\"n\": %d, \"time\": %e".
+
+  @param comm the communicator
+  @param name the name of the benchmark
+  @param fmt the format of the remaining fields
+*/
+static inline void ParOptBenchRecord( MPI_Comm comm, const char *name,
+                                      const char *fmt, ... ){
+  int rank, size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+  if (rank == 0){
+    int nthreads = 1;
+#ifdef PAROPT_USE_OPENMP
+    nthreads = omp_get_max_threads();
+#endif // PAROPT_USE_OPENMP
+    fprintf(stdout, "{\"benchmark\": \"%s\", \"nprocs\": %d, "
+            "\"nthreads\": %d, ", name, size, nthreads);
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stdout, fmt, args);
+    va_end(args);
+    fprintf(stdout, "}\n");
+    fflush(stdout);
+  }
+}
+
+/*
+  A scalable Rosenbrock function with two dense constraints and no
+  sparse constraints. This is the same objective as the parallel
+  example in examples/rosenbrock: the coupling between variables is
+  local to each processor.
+*/
+class ParOptBenchRosenbrock : public ParOptProblem {
+ public:
+  ParOptBenchRosenbrock( MPI_Comm comm, int _nvars ):
+    ParOptProblem(comm, _nvars, 2, 0, 1){}
+
+  void getVarsAndBounds( ParOptVec *xvec,
+                         ParOptVec *lbvec,
+                         ParOptVec *ubvec ){
+    ParOptScalar *x, *lb, *ub;
+    xvec->getArray(&x);
+    lbvec->getArray(&lb);
+    ubvec->getArray(&ub);
+
+    for ( int i = 0; i < nvars; i++ ){
+      x[i] = -1.0;
+      lb[i] = -2.0;
+      ub[i] = 1.0;
+    }
+  }
+
+  int evalObjCon( ParOptVec *xvec,
+                  ParOptScalar *fobj, ParOptScalar *cons ){
+    ParOptScalar *x;
+    xvec->getArray(&x);
+
+    // Compute the objective and constraints with a single reduction
+    ParOptScalar vals[3];
+    vals[0] = vals[1] = vals[2] = 0.0;
+    for ( int i = 0; i < nvars-1; i++ ){
+      vals[0] += ((1.0 - x[i])*(1.0 - x[i]) +
+                  100.0*(x[i+1] - x[i]*x[i])*(x[i+1] - x[i]*x[i]));
+    }
+    for ( int i = 0; i < nvars; i++ ){
+      vals[1] -= x[i]*x[i];
+    }
+    for ( int i = 0; i < nvars; i += 2 ){
+      vals[2] += x[i];
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, vals, 3, PAROPT_MPI_TYPE, MPI_SUM, comm);
+
+    *fobj = vals[0];
+    cons[0] = vals[1] + 0.25;
+    cons[1] = vals[2] + 10.0;
+
+    return 0;
+  }
+
+  int evalObjConGradient( ParOptVec *xvec,
+                          ParOptVec *gvec, ParOptVec **Ac ){
+    ParOptScalar *x, *g, *c;
+    xvec->getArray(&x);
+    gvec->getArray(&g);
+    gvec->zeroEntries();
+
+    for ( int i = 0; i < nvars-1; i++ ){
+      g[i] += (-2.0*(1.0 - x[i]) +
+               200.0*(x[i+1] - x[i]*x[i])*(-2.0*x[i]));
+      g[i+1] += 200.0*(x[i+1] - x[i]*x[i]);
+    }
+
+    Ac[0]->getArray(&c);
+    for ( int i = 0; i < nvars; i++ ){
+      c[i] = -2.0*x[i];
+    }
+
+    Ac[1]->zeroEntries();
+    Ac[1]->getArray(&c);
+    for ( int i = 0; i < nvars; i += 2 ){
+      c[i] = 1.0;
+    }
+
+    return 0;
+  }
+};
+
+/*
+  A synthetic problem with block sparse constraints.
+
+  The design variables are split into nblocks groups of nw variables.
+  Each group is coupled by a block of nwblock sparse constraints so
+  that the block diagonal matrices factored within the interior point
+  method are dense nwblock x nwblock matrices. The objective is a
+  separable convex function with a single dense constraint.
+*/
+class ParOptBenchSparseProblem : public ParOptProblem {
+ public:
+  ParOptBenchSparseProblem( MPI_Comm comm, int _nblocks,
+                            int _nwblock, int _nw ):
+    ParOptProblem(comm, _nblocks*_nw, 1, _nblocks*_nwblock, _nwblock){
+    nblocks = _nblocks;
+    nw = _nw;
+  }
+
+  void getVarsAndBounds( ParOptVec *xvec,
+                         ParOptVec *lbvec,
+                         ParOptVec *ubvec ){
+    ParOptScalar *x, *lb, *ub;
+    xvec->getArray(&x);
+    lbvec->getArray(&lb);
+    ubvec->getArray(&ub);
+
+    for ( int i = 0; i < nvars; i++ ){
+      x[i] = 0.25;
+      lb[i] = 0.0;
+      ub[i] = 10.0;
+    }
+  }
+
+  int evalObjCon( ParOptVec *xvec,
+                  ParOptScalar *fobj, ParOptScalar *cons ){
+    ParOptScalar *x;
+    xvec->getArray(&x);
+
+    ParOptScalar vals[3];
+    vals[0] = vals[1] = 0.0;
+    vals[2] = nvars;
+    for ( int i = 0; i < nvars; i++ ){
+      ParOptScalar d = x[i] - target(i);
+      vals[0] += d*d + 0.1*x[i]*x[i]*x[i]*x[i];
+      vals[1] += x[i];
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, vals, 3, PAROPT_MPI_TYPE, MPI_SUM, comm);
+
+    *fobj = vals[0];
+    cons[0] = 0.6*vals[2] - vals[1];
+
+    return 0;
+  }
+
+  int evalObjConGradient( ParOptVec *xvec,
+                          ParOptVec *gvec, ParOptVec **Ac ){
+    ParOptScalar *x, *g, *c;
+    xvec->getArray(&x);
+    gvec->getArray(&g);
+    Ac[0]->getArray(&c);
+
+    for ( int i = 0; i < nvars; i++ ){
+      g[i] = 2.0*(x[i] - target(i)) + 0.4*x[i]*x[i]*x[i];
+      c[i] = -1.0;
+    }
+
+    return 0;
+  }
+
+  void evalSparseCon( ParOptVec *xvec, ParOptVec *out ){
+    ParOptScalar *x, *c;
+    xvec->getArray(&x);
+    out->getArray(&c);
+
+    for ( int b = 0; b < nblocks; b++ ){
+      for ( int r = 0; r < nwblock; r++ ){
+        c[b*nwblock + r] = 1.0;
+        for ( int k = 0; k < nw; k++ ){
+          c[b*nwblock + r] -= weight(r, k)*x[b*nw + k];
+        }
+      }
+    }
+  }
+
+  void addSparseJacobian( ParOptScalar alpha, ParOptVec *xvec,
+                          ParOptVec *pxvec, ParOptVec *out ){
+    ParOptScalar *px, *c;
+    pxvec->getArray(&px);
+    out->getArray(&c);
+
+    for ( int b = 0; b < nblocks; b++ ){
+      for ( int r = 0; r < nwblock; r++ ){
+        for ( int k = 0; k < nw; k++ ){
+          c[b*nwblock + r] -= alpha*weight(r, k)*px[b*nw + k];
+        }
+      }
+    }
+  }
+
+  void addSparseJacobianTranspose( ParOptScalar alpha, ParOptVec *xvec,
+                                   ParOptVec *pzw, ParOptVec *out ){
+    ParOptScalar *pz, *y;
+    pzw->getArray(&pz);
+    out->getArray(&y);
+
+    for ( int b = 0; b < nblocks; b++ ){
+      for ( int r = 0; r < nwblock; r++ ){
+        for ( int k = 0; k < nw; k++ ){
+          y[b*nw + k] -= alpha*weight(r, k)*pz[b*nwblock + r];
+        }
+      }
+    }
+  }
+
+  void addSparseInnerProduct( ParOptScalar alpha, ParOptVec *xvec,
+                              ParOptVec *cvec, ParOptScalar *A ){
+    ParOptScalar *c;
+    cvec->getArray(&c);
+
+    // Each block is stored in packed upper-triangular format
+    int incr = nwblock*(nwblock+1)/2;
+    for ( int b = 0; b < nblocks; b++ ){
+      ParOptScalar *Ab = &A[b*incr];
+      for ( int s = 0; s < nwblock; s++ ){
+        for ( int r = 0; r <= s; r++ ){
+          for ( int k = 0; k < nw; k++ ){
+            Ab[r + s*(s+1)/2] += alpha*weight(r, k)*weight(s, k)*c[b*nw + k];
+          }
+        }
+      }
+    }
+  }
+
+ private:
+  // The target value for the objective
+  double target( int i ){
+    return 1.0 + 0.3*(i % 7);
+  }
+
+  // The constraint weight for row r and variable k within a block
+  double weight( int r, int k ){
+    return 1.0 + ((k % nwblock) == r ? 2.0 : 0.0) + 0.1*r*k/(nw*nwblock);
+  }
+
+  int nblocks, nw;
+};
+
+#endif // PAR_OPT_BENCHMARK_H
@@ -0,0 +1,424 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ParOptBenchmark.h"
+
+/*
+  Micro-benchmarks of the kernels used within ParOpt.
+
+  The following groups of benchmarks are run:
+
+  vec: the ParOptBasicVec operations at several local sizes
+  multivec: the contiguous ParOptMultiVec block operations
+  lbfgs: ParOptLBFGS::mult and ParOptLBFGS::update at several
+  subspace sizes
+  kkt: the set-up and solution of the block diagonal KKT system at
+  several sparse constraint block sizes (nwblock)
+
+  The factorization of the block diagonal matrices and
+  solveKKTDiagSystem are internal to ParOptInteriorPoint, so the kkt
+  benchmarks run a fixed number of iterations of the optimizer on a
+  synthetic block sparse-constraint problem and report the per-call
+  times recorded by the profiler in the kkt_setup and kkt_solve
+  phases.
+
+  Usage: kernels [group=vec|multivec|lbfgs|kkt]
+                 [n=local size] [min_time=seconds]
+*/
+
+/*
+  The vector operations
+*/
+enum ParOptBenchVecOp { VEC_COPY, VEC_AXPY, VEC_AXPBY, VEC_SCALE,
+                        VEC_DOT, VEC_NORM, VEC_MDOT, VEC_NUM_OPS };
+
+static const char *vec_op_names[] = {
+  "copy", "axpy", "axpby", "scale", "dot", "norm", "mdot"};
+
+/*
+  The number of vectors used in the mdot operations
+*/
+static const int BENCH_MDOT_SIZE = 10;
+
+/*
+  Time a single operation on ParOptBasicVec objects
+*/
+class ParOptBenchVecKernel : public ParOptBenchKernel {
+ public:
+  ParOptBenchVecKernel( ParOptBenchVecOp _op, ParOptVec *_x,
+                        ParOptVec *_y, ParOptVec **_vecs ){
+    op = _op;
+    x = _x;
+    y = _y;
+    vecs = _vecs;
+    result = 0.0;
+  }
+  void run(){
+    if (op == VEC_COPY){
+      y->copyValues(x);
+    }
+    else if (op == VEC_AXPY){
+      y->axpy(1e-3, x);
+    }
+    else if (op == VEC_AXPBY){
+      y->axpby(1e-3, 0.999, x);
+    }
+    else if (op == VEC_SCALE){
+      y->scale(0.999);
+    }
+    else if (op == VEC_DOT){
+      result += x->dot(y);
+    }
+    else if (op == VEC_NORM){
+      result += x->norm();
+    }
+    else if (op == VEC_MDOT){
+      ParOptScalar out[BENCH_MDOT_SIZE];
+      x->mdot(vecs, BENCH_MDOT_SIZE, out);
+      result += out[0];
+    }
+  }
+
+  ParOptBenchVecOp op;
+  ParOptVec *x, *y, **vecs;
+  ParOptScalar result;
+};
+
+/*
+  Time the block operations on a contiguous ParOptMultiVec
+*/
+class ParOptBenchMultiVecKernel : public ParOptBenchKernel {
+ public:
+  ParOptBenchMultiVecKernel( int _use_mdot, ParOptMultiVec *_mvec,
+                             ParOptVec *_x ){
+    use_mdot = _use_mdot;
+    mvec = _mvec;
+    x = _x;
+    for ( int j = 0; j < BENCH_MDOT_SIZE; j++ ){
+      alpha[j] = 1e-3/(j + 1);
+    }
+  }
+  void run(){
+    if (use_mdot){
+      ParOptScalar out[BENCH_MDOT_SIZE];
+      mvec->mdot(x, BENCH_MDOT_SIZE, out);
+    }
+    else {
+      mvec->maxpy(BENCH_MDOT_SIZE, alpha, x);
+    }
+  }
+
+  int use_mdot;
+  ParOptMultiVec *mvec;
+  ParOptVec *x;
+  ParOptScalar alpha[BENCH_MDOT_SIZE];
+};
+
+/*
+  Time the L-BFGS matrix-vector product or the update
+*/
+class ParOptBenchLBFGSKernel : public ParOptBenchKernel {
+ public:
+  ParOptBenchLBFGSKernel( ParOptLBFGS *_qn, int _use_update,
+                          int _npairs, ParOptVec **_s, ParOptVec **_y,
+                          ParOptVec *_x, ParOptVec *_out ){
+    qn = _qn;
+    use_update = _use_update;
+    npairs = _npairs;
+    s = _s;
+    y = _y;
+    x = _x;
+    out = _out;
+    index = 0;
+  }
+  void run(){
+    if (use_update){
+      qn->update(x, NULL, NULL, s[index], y[index]);
+      index = (index + 1) % npairs;
+    }
+    else {
+      qn->mult(x, out);
+    }
+  }
+
+  ParOptLBFGS *qn;
+  int use_update, npairs, index;
+  ParOptVec **s, **y, *x, *out;
+};
+
+/*
+  Get the number of bytes read and written by a vector operation
+*/
+static double vecOpBytes( ParOptBenchVecOp op, int n ){
+  double size = 1.0*n*sizeof(ParOptScalar);
+  if (op == VEC_COPY || op == VEC_SCALE || op == VEC_DOT){
+    return 2.0*size;
+  }
+  else if (op == VEC_AXPY || op == VEC_AXPBY){
+    return 3.0*size;
+  }
+  else if (op == VEC_NORM){
+    return size;
+  }
+  return (BENCH_MDOT_SIZE + 1.0)*size;
+}
+
+/*
+  Set the vector values to a smooth, non-trivial distribution
+*/
+static void setVecValues( ParOptVec *vec, double freq, double shift ){
+  ParOptScalar *x;
+  int n = vec->getArray(&x);
+  for ( int i = 0; i < n; i++ ){
+    x[i] = 1.0 + 0.5*sin(freq*i + shift);
+  }
+}
+
+static void benchVecs( MPI_Comm comm, int nsizes, const int *sizes,
+                       double min_time ){
+  int mpi_size;
+  MPI_Comm_size(comm, &mpi_size);
+
+  for ( int k = 0; k < nsizes; k++ ){
+    int n = sizes[k];
+    ParOptVec *x = new ParOptBasicVec(comm, n);
+    ParOptVec *y = new ParOptBasicVec(comm, n);
+    x->incref();
+    y->incref();
+    setVecValues(x, 0.01, 0.0);
+    setVecValues(y, 0.02, 1.0);
+
+    ParOptVec *vecs[BENCH_MDOT_SIZE];
+    for ( int j = 0; j < BENCH_MDOT_SIZE; j++ ){
+      vecs[j] = new ParOptBasicVec(comm, n);
+      vecs[j]->incref();
+      setVecValues(vecs[j], 0.01*(j + 1), 0.1*j);
+    }
+
+    for ( int i = 0; i < VEC_NUM_OPS; i++ ){
+      ParOptBenchVecOp op = (ParOptBenchVecOp)i;
+      ParOptBenchVecKernel kernel(op, x, y, vecs);
+
+      int reps;
+      double tmin, tavg;
+      ParOptBenchTime(comm, &kernel, min_time, 10, &reps, &tmin, &tavg);
+
+      double bytes = mpi_size*vecOpBytes(op, n);
+      ParOptBenchRecord(comm, "vec",
+                        "\"op\": \"%s\", \"n\": %d, \"reps\": %d, "
+                        "\"time_min\": %.6e, \"time_avg\": %.6e, "
+                        "\"gbytes_per_sec\": %.4f",
+                        vec_op_names[i], n, reps, tmin, tavg,
+                        1e-9*bytes/tmin);
+    }
+
+    for ( int j = 0; j < BENCH_MDOT_SIZE; j++ ){
+      vecs[j]->decref();
+    }
+    x->decref();
+    y->decref();
+  }
+}
+
+static void benchMultiVecs( MPI_Comm comm, int nsizes, const int *sizes,
+                            double min_time ){
+  int mpi_size;
+  MPI_Comm_size(comm, &mpi_size);
+
+  for ( int k = 0; k < nsizes; k++ ){
+    int n = sizes[k];
+    ParOptMultiVec *mvec = new ParOptMultiVec(comm, n, BENCH_MDOT_SIZE);
+    mvec->incref();
+    for ( int j = 0; j < BENCH_MDOT_SIZE; j++ ){
+      setVecValues(mvec->getVec(j), 0.01*(j + 1), 0.1*j);
+    }
+
+    ParOptVec *x = new ParOptBasicVec(comm, n);
+    x->incref();
+    setVecValues(x, 0.01, 0.0);
+
+    for ( int use_mdot = 1; use_mdot >= 0; use_mdot-- ){
+      ParOptBenchMultiVecKernel kernel(use_mdot, mvec, x);
+
+      int reps;
+      double tmin, tavg;
+      ParOptBenchTime(comm, &kernel, min_time, 10, &reps, &tmin, &tavg);
+
+      // mdot reads each column and x once, maxpy also writes x
+      double bytes = mpi_size*(BENCH_MDOT_SIZE + 1.0 + (use_mdot ? 0 : 1))*
+        n*sizeof(ParOptScalar);
+      ParOptBenchRecord(comm, "multivec",
+                        "\"op\": \"%s\", \"n\": %d, \"nvecs\": %d, "
+                        "\"reps\": %d, \"time_min\": %.6e, "
+                        "\"time_avg\": %.6e, \"gbytes_per_sec\": %.4f",
+                        (use_mdot ? "mdot" : "maxpy"), n, BENCH_MDOT_SIZE,
+                        reps, tmin, tavg, 1e-9*bytes/tmin);
+    }
+
+    x->decref();
+    mvec->decref();
+  }
+}
+
+static void benchLBFGS( MPI_Comm comm, int n, double min_time ){
+  const int nsub = 5;
+  const int msub_sizes[] = {2, 5, 10, 20, 40};
+
+  ParOptProblem *prob = new ParOptBenchRosenbrock(comm, n);
+  prob->incref();
+
+  // Create a set of step and gradient-difference pairs that satisfy
+  // the curvature condition: y = H*s with a positive diagonal H
+  const int npairs = 8;
+  ParOptVec *s[npairs], *y[npairs];
+  for ( int k = 0; k < npairs; k++ ){
+    s[k] = prob->createDesignVec();
+    y[k] = prob->createDesignVec();
+    s[k]->incref();
+    y[k]->incref();
+
+    setVecValues(s[k], 0.01*(k + 1), 0.3*k);
+    ParOptScalar *sv, *yv;
+    s[k]->getArray(&sv);
+    y[k]->getArray(&yv);
+    for ( int i = 0; i < n; i++ ){
+      yv[i] = (1.0 + (i % 5))*sv[i];
+    }
+  }
+
+  ParOptVec *x = prob->createDesignVec();
+  ParOptVec *out = prob->createDesignVec();
+  x->incref();
+  out->incref();
+  setVecValues(x, 0.05, 0.5);
+
+  for ( int k = 0; k < nsub; k++ ){
+    int msub = msub_sizes[k];
+    ParOptLBFGS *qn = new ParOptLBFGS(prob, msub);
+    qn->incref();
+
+    // Fill the subspace so that the full-size matrices are used
+    for ( int i = 0; i < msub; i++ ){
+      qn->update(x, NULL, NULL, s[i % npairs], y[i % npairs]);
+    }
+
+    for ( int use_update = 0; use_update < 2; use_update++ ){
+      ParOptBenchLBFGSKernel kernel(qn, use_update, npairs, s, y, x, out);
+
+      int reps;
+      double tmin, tavg;
+      ParOptBenchTime(comm, &kernel, min_time, 10, &reps, &tmin, &tavg);
+
+      ParOptBenchRecord(comm, "lbfgs",
+                        "\"op\": \"%s\", \"n\": %d, \"msub\": %d, "
+                        "\"reps\": %d, \"time_min\": %.6e, "
+                        "\"time_avg\": %.6e",
+                        (use_update ? "update" : "mult"), n, msub,
+                        reps, tmin, tavg);
+    }
+
+    qn->decref();
+  }
+
+  for ( int k = 0; k < npairs; k++ ){
+    s[k]->decref();
+    y[k]->decref();
+  }
+  x->decref();
+  out->decref();
+  prob->decref();
+}
+
+static void benchKKT( MPI_Comm comm, int n, int max_iters ){
+  const int nblock_sizes = 9;
+  const int block_sizes[] = {1, 2, 3, 4, 5, 6, 8, 10, 12};
+
+  for ( int k = 0; k < nblock_sizes; k++ ){
+    int nwblock = block_sizes[k];
+    int nw = nwblock + 3;
+    int nblocks = n/nw;
+    if (nblocks < 1){
+      nblocks = 1;
+    }
+
+    ParOptProblem *prob =
+      new ParOptBenchSparseProblem(comm, nblocks, nwblock, nw);
+    prob->incref();
+
+    ParOptInteriorPoint *opt = new ParOptInteriorPoint(prob, 10);
+    opt->incref();
+    opt->setOutputFile(NULL);
+    opt->setMaxMajorIterations(max_iters);
+    opt->setAbsOptimalityTol(1e-12);
+    opt->optimize();
+
+    ParOptProfiler *profiler = opt->getProfiler();
+    double t[2];
+    t[0] = profiler->getTime(PAROPT_PROFILE_KKT_SETUP);
+    t[1] = profiler->getTime(PAROPT_PROFILE_KKT_SOLVE);
+    int setup_calls = profiler->getCalls(PAROPT_PROFILE_KKT_SETUP);
+    int solve_calls = profiler->getCalls(PAROPT_PROFILE_KKT_SOLVE);
+    MPI_Allreduce(MPI_IN_PLACE, t, 2, MPI_DOUBLE, MPI_MAX, comm);
+
+    if (setup_calls < 1){ setup_calls = 1; }
+    if (solve_calls < 1){ solve_calls = 1; }
+
+    ParOptBenchRecord(comm, "kkt",
+                      "\"nwblock\": %d, \"nwcon\": %d, \"n\": %d, "
+                      "\"setup_calls\": %d, \"setup_time\": %.6e, "
+                      "\"solve_calls\": %d, \"solve_time\": %.6e",
+                      nwblock, nblocks*nwblock, nblocks*nw,
+                      setup_calls, t[0]/setup_calls,
+                      solve_calls, t[1]/solve_calls);
+
+    opt->decref();
+    prob->decref();
+  }
+}
+
+int main( int argc, char *argv[] ){
+  MPI_Init(&argc, &argv);
+
+  MPI_Comm comm = MPI_COMM_WORLD;
+
+  // The benchmark group and the parameters
+  char group[64];
+  strcpy(group, "all");
+  int n = 0;
+  double min_time = 0.1;
+  int max_iters = 25;
+  for ( int k = 1; k < argc; k++ ){
+    if (sscanf(argv[k], "group=%63s", group) == 1){}
+    else if (sscanf(argv[k], "n=%d", &n) == 1){}
+    else if (sscanf(argv[k], "min_time=%lf", &min_time) == 1){}
+    else if (sscanf(argv[k], "iters=%d", &max_iters) == 1){}
+  }
+
+  // Use the default set of local sizes unless one is specified
+  int nsizes = 4;
+  int sizes[] = {1000, 10000, 100000, 1000000};
+  if (n > 0){
+    nsizes = 1;
+    sizes[0] = n;
+  }
+  else {
+    n = 100000;
+  }
+
+  int all = (strcmp(group, "all") == 0);
+  if (all || strcmp(group, "vec") == 0){
+    benchVecs(comm, nsizes, sizes, min_time);
+  }
+  if (all || strcmp(group, "multivec") == 0){
+    benchMultiVecs(comm, nsizes, sizes, min_time);
+  }
+  if (all || strcmp(group, "lbfgs") == 0){
+    benchLBFGS(comm, n, min_time);
+  }
+  if (all || strcmp(group, "kkt") == 0){
+    benchKKT(comm, n, max_iters);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,48 @@
+#!/bin/sh
+# Run the ParOpt benchmark suite and collect the JSON-lines records
+#
+# Usage: ./run_benchmarks.sh [output file] [processor counts...]
+#
+# The kernel benchmarks are run on a single processor and on the
+# largest processor count. The end-to-end runs of the Rosenbrock and
+# sparse-constraint problems are run in both strong- and weak-scaling
+# mode on each processor count. Set MPIRUN to change the MPI launcher.
+
+OUTPUT=${1:-benchmarks.jsonl}
+if [ $# -gt 0 ]; then
+  shift
+fi
+NPROCS=${*:-"1 2 4"}
+MPIRUN=${MPIRUN:-mpirun}
+
+# The global size for the strong-scaling runs and the local size for
+# the weak-scaling runs
+STRONG_SIZE=400000
+WEAK_SIZE=100000
+
+: > ${OUTPUT}
+
+MAXPROCS=1
+for np in ${NPROCS}; do
+  if [ ${np} -gt ${MAXPROCS} ]; then
+    MAXPROCS=${np}
+  fi
+done
+
+for np in 1 ${MAXPROCS}; do
+  ${MPIRUN} -np ${np} ./kernels >> ${OUTPUT} || exit 1
+  if [ ${MAXPROCS} -eq 1 ]; then
+    break
+  fi
+done
+
+for np in ${NPROCS}; do
+  for problem in rosenbrock sparse; do
+    ${MPIRUN} -np ${np} ./scaling problem=${problem} mode=strong \
+      n=${STRONG_SIZE} >> ${OUTPUT} || exit 1
+    ${MPIRUN} -np ${np} ./scaling problem=${problem} mode=weak \
+      n=${WEAK_SIZE} >> ${OUTPUT} || exit 1
+  done
+done
+
+echo "Benchmark results written to ${OUTPUT}"
@@ -0,0 +1,136 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ParOptBenchmark.h"
+
+/*
+  End-to-end scaling runs of ParOptInteriorPoint.
+
+  The problem is either the parallel Rosenbrock function or the
+  synthetic block sparse-constraint problem. For a strong-scaling run
+  the global number of design variables is fixed and divided between
+  the processors, while for a weak-scaling run the number of local
+  design variables is fixed. Run the same command with an increasing
+  number of processors to generate the scaling data.
+
+  The record for each run contains the total time, the iteration
+  counts and the time spent in each phase of the optimization from the
+  profiler along with the number of reductions.
+
+  Usage: scaling [problem=rosenbrock|sparse] [mode=strong|weak]
+                 [n=size] [nwblock=block size] [iters=max iterations]
+*/
+int main( int argc, char *argv[] ){
+  MPI_Init(&argc, &argv);
+
+  MPI_Comm comm = MPI_COMM_WORLD;
+  int mpi_size;
+  MPI_Comm_size(comm, &mpi_size);
+
+  char problem[64], mode[64];
+  strcpy(problem, "rosenbrock");
+  strcpy(mode, "weak");
+  int n = 100000;
+  int nwblock = 4;
+  int max_iters = 100;
+  for ( int k = 1; k < argc; k++ ){
+    if (sscanf(argv[k], "problem=%63s", problem) == 1){}
+    else if (sscanf(argv[k], "mode=%63s", mode) == 1){}
+    else if (sscanf(argv[k], "n=%d", &n) == 1){}
+    else if (sscanf(argv[k], "nwblock=%d", &nwblock) == 1){}
+    else if (sscanf(argv[k], "iters=%d", &max_iters) == 1){}
+  }
+
+  // Determine the local number of design variables
+  int strong = (strcmp(mode, "strong") == 0);
+  int nlocal = n;
+  if (strong){
+    int mpi_rank;
+    MPI_Comm_rank(comm, &mpi_rank);
+    nlocal = n/mpi_size;
+    if (mpi_rank < n % mpi_size){
+      nlocal++;
+    }
+  }
+
+  ParOptProblem *prob = NULL;
+  if (strcmp(problem, "sparse") == 0){
+    if (nwblock < 1){
+      nwblock = 1;
+    }
+    int nw = nwblock + 3;
+    int nblocks = nlocal/nw;
+    if (nblocks < 1){
+      nblocks = 1;
+    }
+    prob = new ParOptBenchSparseProblem(comm, nblocks, nwblock, nw);
+  }
+  else {
+    if (nlocal < 2){
+      nlocal = 2;
+    }
+    prob = new ParOptBenchRosenbrock(comm, nlocal);
+    strcpy(problem, "rosenbrock");
+    nwblock = 0;
+  }
+  prob->incref();
+
+  int nvars, nwcon;
+  prob->getProblemSizes(&nvars, NULL, &nwcon, NULL);
+  int sizes[2];
+  sizes[0] = nvars;
+  sizes[1] = nwcon;
+  MPI_Allreduce(MPI_IN_PLACE, sizes, 2, MPI_INT, MPI_SUM, comm);
+
+  ParOptInteriorPoint *opt = new ParOptInteriorPoint(prob, 10);
+  opt->incref();
+  opt->setOutputFile(NULL);
+  opt->setMaxMajorIterations(max_iters);
+
+  MPI_Barrier(comm);
+  opt->optimize();
+
+  // Collect the maximum time spent in each phase
+  ParOptProfiler *profiler = opt->getProfiler();
+  double times[PAROPT_PROFILE_NUM_PHASES];
+  for ( int i = 0; i < PAROPT_PROFILE_NUM_PHASES; i++ ){
+    times[i] = profiler->getTime((ParOptProfilePhase)i);
+  }
+  MPI_Allreduce(MPI_IN_PLACE, times, PAROPT_PROFILE_NUM_PHASES,
+                MPI_DOUBLE, MPI_MAX, comm);
+
+  int reduce_count;
+  double reduce_bytes, reduce_time;
+  profiler->getReductionStats(&reduce_count, &reduce_bytes, &reduce_time);
+  MPI_Allreduce(MPI_IN_PLACE, &reduce_time, 1, MPI_DOUBLE, MPI_MAX, comm);
+
+  int niter, neval, ngeval, nhvec;
+  opt->getIterationCounters(&niter, &neval, &ngeval, &nhvec);
+
+  // Format the phase times as a nested object
+  char phases[1024];
+  int len = 0;
+  for ( int i = 0; i < PAROPT_PROFILE_NUM_PHASES; i++ ){
+    len += snprintf(&phases[len], sizeof(phases) - len, "%s\"%s\": %.6e",
+                    (i > 0 ? ", " : ""),
+                    ParOptProfiler::getPhaseName((ParOptProfilePhase)i),
+                    times[i]);
+  }
+
+  ParOptBenchRecord(comm, "scaling",
+                    "\"problem\": \"%s\", \"mode\": \"%s\", "
+                    "\"nvars\": %d, \"nwcon\": %d, \"nwblock\": %d, "
+                    "\"niter\": %d, \"neval\": %d, \"ngeval\": %d, "
+                    "\"time\": %.6e, \"phases\": {%s}, "
+                    "\"reduce_count\": %d, \"reduce_bytes\": %.6e, "
+                    "\"reduce_time\": %.6e",
+                    problem, (strong ? "strong" : "weak"),
+                    sizes[0], sizes[1], nwblock, niter, neval, ngeval,
+                    times[PAROPT_PROFILE_TOTAL], phases,
+                    reduce_count, reduce_bytes, reduce_time);
+
+  opt->decref();
+  prob->decref();
+
+  MPI_Finalize();
+  return 0;
+}
@@ -39,16 +39,29 @@ class Rosenbrock : public ParOptProblem {
   //! Evaluate the objective and constraints
   int evalObjCon( ParOptVec *xvec,
                   ParOptScalar *fobj, ParOptScalar *cons ){
-    ParOptScalar obj = 0.0;
     ParOptScalar *x;
     xvec->getArray(&x);
+    return evalObjConT(x, fobj, cons);
+  }
+
+  //! Evaluate the objective and constraints with complex values so
+  //! that the gradients can be verified with a complex step
+  int useComplexStep(){ return 1; }
+  int evalObjConComplex( const ParOptComplex *x,
+                         ParOptComplex *fobj, ParOptComplex *cons ){
+    return evalObjConT(x, fobj, cons);
+  }
 
+  //! Evaluate the objective and constraints for any scalar type
+  template <typename T>
+  int evalObjConT( const T *x, T *fobj, T *cons ){
+    T obj = 0.0;
     for ( int i = 0; i < nvars-1; i++ ){
       obj += ((1.0 - x[i])*(1.0 - x[i]) +
               100.0*(x[i+1] - x[i]*x[i])*(x[i+1] - x[i]*x[i]));
     }
 
-    ParOptScalar con[2];
+    T con[2];
     con[0] = con[1] = 0.0;
     for ( int i = 0; i < nvars; i++ ){
       con[0] -= x[i]*x[i];
@@ -58,8 +71,8 @@ class Rosenbrock : public ParOptProblem {
       con[1] += x[i];
     }
 
-    MPI_Allreduce(&obj, fobj, 1, PAROPT_MPI_TYPE, MPI_SUM, comm);
-    MPI_Allreduce(con, cons, 2, PAROPT_MPI_TYPE, MPI_SUM, comm);
+    MPI_Allreduce(&obj, fobj, 1, ParOptMPIType<T>(), MPI_SUM, comm);
+    MPI_Allreduce(con, cons, 2, ParOptMPIType<T>(), MPI_SUM, comm);
 
     cons[0] += 0.25;
     cons[1] += 10.0;
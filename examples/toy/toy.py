@@ -83,6 +83,7 @@ p.add_argument('--opt_barrier_power', type=float, default=1.0)
 p.add_argument('--output_freq', type=int, default=1)
 p.add_argument('--max_lbfgs', type=int, default=10)
 p.add_argument('--hessian_reset', type=int, default=10)
+p.add_argument('--use_dual', action='store_true', default=False)
 args = p.parse_args()
 
 max_mma_iters = 10
@@ -124,15 +125,27 @@ opt.setOutputFile(filename)
 # Enter the optimization loop
 for i in range (max_mma_iters):
     print('Iteration number: ', i)
-    opt.setInitBarrierParameter(0.1)
-    opt.optimize()
-        
-    # Get the optimized point
-    x, z, zw, zl, zu = opt.getOptimizedPoint()
-    
-    mma.setMultipliers(z, zw, zl, zu)
-    mma.initializeSubProblem(x)
-    opt.resetDesignAndBounds()
+    if args.use_dual:
+        # Solve the subproblem with the dual method. The multipliers
+        # are stored within the MMA object.
+        if i == 0:
+            xdual = mma.createDesignVec()
+        mma.solveDualSubProblem(xdual)
+        mma.initializeSubProblem(xdual)
+        z = None
+    else:
+        opt.setInitBarrierParameter(0.1)
+        opt.optimize()
+
+        # Get the optimized point
+        x, z, zw, zl, zu = opt.getOptimizedPoint()
+
+        mma.setMultipliers(z, zw, zl, zu)
+        mma.initializeSubProblem(x)
+        opt.resetDesignAndBounds()
+
+        # Start the next subproblem from this solution
+        opt.setUseWarmStart(1)
     
     # Compute the KKT error
     l1_norm, linfty_norm, infeas = mma.computeKKTError()
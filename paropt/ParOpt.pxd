@@ -30,6 +30,33 @@ cdef extern from "ParOptVec.h":
 cdef class PVec:
     cdef ParOptVec *ptr
 
+cdef extern from "ParOptVec.h":
+    ctypedef double complex ParOptComplex
+    void ParOptGetVecMemoryStats(double*, double*)
+
+cdef extern from "ParOptProfiler.h":
+    enum ParOptProfilePhase:
+        PAROPT_PROFILE_TOTAL
+        PAROPT_PROFILE_EVAL_OBJ_CON
+        PAROPT_PROFILE_EVAL_GRADIENT
+        PAROPT_PROFILE_EVAL_HVEC
+        PAROPT_PROFILE_KKT_SETUP
+        PAROPT_PROFILE_KKT_SOLVE
+        PAROPT_PROFILE_KRYLOV
+        PAROPT_PROFILE_QN_UPDATE
+        PAROPT_PROFILE_LINE_SEARCH
+        PAROPT_PROFILE_SUBPROBLEM
+        PAROPT_PROFILE_OUTPUT
+        PAROPT_PROFILE_NUM_PHASES
+
+    cppclass ParOptProfiler(ParOptBase):
+        void reset()
+        double getTime(ParOptProfilePhase)
+        int getCalls(ParOptProfilePhase)
+        void getReductionStats(int*, double*, double*)
+        void getCacheStats(int*, int*)
+        const char *getPhaseName(ParOptProfilePhase)
+
 cdef inline _init_PVec(ParOptVec *ptr):
     vec = PVec()
     vec.ptr = ptr
@@ -43,7 +70,18 @@ cdef extern from "ParOptProblem.h":
         ParOptProblem(MPI_Comm, int, int, int, int)
         ParOptVec *createDesignVec()
         ParOptVec *createConstraintVec()
-        void checkGradients(double, ParOptVec*, int)
+        void checkGradients(double, ParOptVec*, int) nogil
+
+cdef extern from "ParOptBatchProblem.h":
+    cdef cppclass ParOptBatchProblem(ParOptBase):
+        ParOptBatchProblem(MPI_Comm, int, int, int)
+        void getProblemSizes(int*, int*, int*)
+
+cdef extern from "ParOptCachedProblem.h":
+    cdef cppclass ParOptCachedProblem(ParOptProblem):
+        ParOptCachedProblem(ParOptProblem*, int)
+        void clearCache()
+        void getCacheStats(int*, int*, int*, int*)
 
 cdef extern from "ParOptQuasiNewton.h":
     enum ParOptBFGSUpdateType:
@@ -68,6 +106,15 @@ cdef extern from "ParOptQuasiNewton.h":
 cdef class CompactQuasiNewton:
     cdef ParOptCompactQuasiNewton *ptr
 
+cdef extern from "ParOptSparseJacobian.h":
+    cdef cppclass ParOptSparseJacobian(ParOptBase):
+        ParOptSparseJacobian(int, int, int, int, const int*, const int*,
+                             const ParOptScalar*)
+        void getSize(int*, int*)
+        void getBlockSize(int*, int*)
+        void setValues(const ParOptScalar*)
+        int getValues(ParOptScalar**)
+
 cdef extern from "CyParOptProblem.h":
     # Define the callback types
     ctypedef void (*getvarsandbounds)(void *_self, int nvars, ParOptVec *x,
@@ -103,6 +150,22 @@ cdef extern from "CyParOptProblem.h":
                                            ParOptScalar alpha,
                                            ParOptVec *x, ParOptVec *c,
                                            ParOptScalar *out)
+    ctypedef int (*evalobjconbatch)(void *_self, int nvars, int ncon,
+                                    int npts, ParOptScalar **x,
+                                    ParOptScalar *fobj, ParOptScalar *cons,
+                                    int *fail)
+    ctypedef int (*evalobjcongradientbatch)(void *_self, int nvars, int ncon,
+                                            ParOptScalar *x, ParOptScalar *g,
+                                            ParOptScalar *A)
+    ctypedef int (*evalhvecproductblock)(void *_self, int nvars, int ncon,
+                                         int nwcon, ParOptVec *x,
+                                         ParOptScalar *z, ParOptVec *zw,
+                                         int nvecs, ParOptVec **px,
+                                         ParOptVec **hvec)
+    ctypedef int (*evalobjconcomplex)(void *_self, int nvars, int ncon,
+                                      const ParOptComplex *x,
+                                      ParOptComplex *fobj,
+                                      ParOptComplex *cons)
 
     cdef cppclass CyParOptProblem(ParOptProblem):
         CyParOptProblem(MPI_Comm _comm, int _nvars, int _ncon,
@@ -124,6 +187,37 @@ cdef extern from "CyParOptProblem.h":
         void setAddSparseJacobian(addsparsejacobian usr_func)
         void setAddSparseJacobianTranspose(addsparsejacobiantranspose usr_func)
         void setAddSparseInnerProduct(addsparseinnerproduct usr_func)
+        void setEvalObjConBatch(evalobjconbatch usr_func)
+        void setEvalObjConGradientBatch(evalobjcongradientbatch usr_func)
+        void setEvalHvecProductBlock(evalhvecproductblock usr_func)
+        void setEvalObjConComplex(evalobjconcomplex usr_func)
+        void setSparseJacobian(ParOptSparseJacobian *jac)
+
+    ctypedef void (*batchgetvarsandbounds)(void *_self, int nprob,
+                                           int nvars, int ld,
+                                           ParOptScalar *x,
+                                           ParOptScalar *lb,
+                                           ParOptScalar *ub)
+    ctypedef void (*batchevalobjcon)(void *_self, int nvars, int ncon,
+                                     int npts, const int *index, int ld,
+                                     const ParOptScalar *x,
+                                     ParOptScalar *fobj,
+                                     ParOptScalar *cons, int *fail)
+    ctypedef void (*batchevalobjcongradient)(void *_self, int nvars,
+                                             int ncon, int npts,
+                                             const int *index, int ld,
+                                             const ParOptScalar *x,
+                                             ParOptScalar *g,
+                                             ParOptScalar *A, int *fail)
+
+    cdef cppclass CyParOptBatchProblem(ParOptBatchProblem):
+        CyParOptBatchProblem(MPI_Comm _comm, int _nprob, int _nvars,
+                             int _ncon)
+        void setBoundOptions(int _useLower, int _useUpper)
+        void setSelfPointer(void *_self)
+        void setGetVarsAndBounds(batchgetvarsandbounds usr_func)
+        void setEvalObjCon(batchevalobjcon usr_func)
+        void setEvalObjConGradient(batchevalobjcongradient usr_func)
 
 cdef extern from "ParOptInteriorPoint.h":
     # Set the quasi-Newton type to use
@@ -147,12 +241,16 @@ cdef extern from "ParOptInteriorPoint.h":
         PAROPT_LEAST_SQUARES_MULTIPLIERS
         PAROPT_AFFINE_STEP
 
+    enum ParOptGMRESType:
+        PAROPT_MGS_GMRES
+        PAROPT_PIPELINED_GMRES
+
     cppclass ParOptInteriorPoint(ParOptBase):
         ParOptInteriorPoint(ParOptProblem*, int,
                             ParOptQuasiNewtonType qn_type) except +
 
         # Perform the optimiztion
-        int optimize(const char*)
+        int optimize(const char*) nogil
 
         # Get the problem dimensions
         void getProblemSizes(int*, int*, int*, int*)
@@ -164,12 +262,13 @@ cdef extern from "ParOptInteriorPoint.h":
         void getOptimizedSlacks(ParOptScalar**, ParOptScalar**, ParOptVec**)
 
         # Check objective and constraint gradients
-        void checkGradients(double)
+        void checkGradients(double) nogil
 
         # Set optimizer parameters
         void setNormType(ParOptNormType)
         void setBarrierStrategy(ParOptBarrierStrategy)
         void setStartingPointStrategy(ParOptStartingPointStrategy)
+        void setUseWarmStart(int)
         void setMaxMajorIterations(int)
         void setAbsOptimalityTol(double)
         void setRelFunctionTol(double)
@@ -203,18 +302,26 @@ cdef extern from "ParOptInteriorPoint.h":
         void setUseLineSearch(int)
         void setMaxLineSearchIters(int)
         void setBacktrackingLineSearch(int)
+        void setLineSearchBatchSize(int)
         void setArmijoParam(double)
         void setPenaltyDescentFraction(double)
         void setMinPenaltyParameter(double)
 
         # Set parameters for the internal GMRES algorithm
         void setUseDiagHessian(int)
+        void setUseActiveSet(int)
+        void setActiveSetTolerance(double)
+        void setActiveSetExpandFrequency(int)
         void setUseHvecProduct(int)
         void setUseQNGMRESPreCon(int)
         void setNKSwitchTolerance(double)
         void setEisenstatWalkerParameters(double, double)
         void setGMRESTolerances(double, double)
         void setGMRESSubspaceSize(int)
+        void setGMRESType(ParOptGMRESType)
+        void setGMRESMixedPrecision(int)
+        void setGMRESBlockSize(int)
+        void setGMRESRecycleSize(int)
 
         # Set other parameters
         void setOutputFrequency(int)
@@ -224,23 +331,61 @@ cdef extern from "ParOptInteriorPoint.h":
         # Set the output file/print level
         void setOutputFile(const char*)
         void setOutputLevel(int)
+        void setHistoryFile(const char*)
+        void setDesignHistoryFile(const char*, int)
+        ParOptProfiler *getProfiler()
+        void setProfileOutput(int)
 
         # Write out the design variables to binary format (fast MPI/IO)
         int writeSolutionFile(const char*)
         int readSolutionFile(const char*)
+        void setUseAsyncCheckpoint(int)
+        int completeCheckpoint()
+
+cdef extern from "ParOptBatchInteriorPoint.h":
+    enum ParOptBatchStatus:
+        PAROPT_BATCH_ACTIVE
+        PAROPT_BATCH_CONVERGED
+        PAROPT_BATCH_MAX_ITERATIONS
+        PAROPT_BATCH_EVAL_FAILURE
+        PAROPT_BATCH_FACTOR_FAILURE
+
+    cppclass ParOptBatchInteriorPoint(ParOptBase):
+        ParOptBatchInteriorPoint(ParOptBatchProblem*, double)
+        int optimize() nogil
+        void getProblemSizes(int*, int*, int*)
+        void getOptimizedPoint(ParOptScalar**, ParOptScalar**,
+                               ParOptScalar**, ParOptScalar**)
+        void getProblemStatus(const ParOptScalar**, const int**,
+                              const int**)
+        void setMaxMajorIterations(int)
+        void setAbsOptimalityTol(double)
+        void setInitBarrierParameter(double)
+        void setBarrierFraction(double)
+        void setBarrierPower(double)
+        void setMaxLineSearchIters(int)
+        void setArmijoParam(double)
+        void setPenaltyDescentFraction(double)
+        void setOutputFile(const char*)
+        void setOutputLevel(int)
 
 cdef extern from "ParOptMMA.h":
     cdef cppclass ParOptMMA(ParOptProblem):
         ParOptMMA(ParOptProblem*, int)
         void setIteration(int)
         void setMultipliers(ParOptScalar*, ParOptVec*, ParOptVec*, ParOptVec*)
-        int initializeSubProblem(ParOptVec*)
+        int initializeSubProblem(ParOptVec*) nogil
+        int solveDualSubProblem(ParOptVec*) nogil
         void computeKKTError(double*, double*, double*)
         void getOptimizedPoint(ParOptVec**)
         void getAsymptotes(ParOptVec**, ParOptVec**)
         void getDesignHistory(ParOptVec**, ParOptVec**)
         void setPrintLevel(int)
         void setOutputFile(const char*)
+        void setHistoryFile(const char*)
+        void setDesignHistoryFile(const char*, int)
+        ParOptProfiler *getProfiler()
+        void setProfileOutput(int)
         void setAsymptoteContract(double)
         void setAsymptoteRelax(double)
         void setInitAsymptoteOffset(double)
@@ -248,6 +393,12 @@ cdef extern from "ParOptMMA.h":
         void setMaxAsymptoteOffset(double)
         void setBoundRelax(double)
         void setRegularization(double, double)
+        void setPenaltyGamma(double)
+        void setMaxDualIterations(int)
+        void setDualTolerance(double)
+        void setUseActiveSet(int)
+        void setActiveSetTolerance(double)
+        void setActiveSetExpandFrequency(int)
 
 cdef extern from "ParOptTrustRegion.h":
     cdef cppclass ParOptTrustRegionSubproblem(ParOptProblem):
@@ -264,6 +415,8 @@ cdef extern from "ParOptTrustRegion.h":
         void update(ParOptVec*, const ParOptScalar*, ParOptVec*,
                     double*, double*, double*)
         void setOutputFile(const char*)
+        void setHistoryFile(const char*)
+        void setDesignHistoryFile(const char*, int)
         void setPrintLevel(int)
         void setAdaptiveGammaUpdate(int)
         void setMaxTrustRegionIterations(int)
@@ -273,11 +426,20 @@ cdef extern from "ParOptTrustRegion.h":
         int getPenaltyGamma(double**)
         void setPenaltyGammaMax(double)
         void setOutputFrequency(int)
-        void optimize(ParOptInteriorPoint*)
+        void setNumTrialSteps(int)
+        void setWarmStartSubproblem(int)
+        void optimize(ParOptInteriorPoint*) nogil
         void getOptimizedPoint(ParOptVec**)
+        ParOptProfiler *getProfiler()
+        void setProfileOutput(int)
 
 cdef class ProblemBase:
     cdef ParOptProblem *ptr
 
+cdef class Problem(ProblemBase):
+    cdef CyParOptProblem *me
+    cdef int batched
+    cdef dict views
+
 cdef class TrustRegionSubproblem(ProblemBase):
     cdef ParOptTrustRegionSubproblem *subproblem
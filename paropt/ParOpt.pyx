@@ -12,6 +12,9 @@ from ParOpt cimport *
 # Import tracebacks for callbacks
 import traceback
 
+# Import os for the size of the history files
+import os
+
 # Import numpy
 import numpy as np
 cimport numpy as np
@@ -55,10 +58,113 @@ NO_START_STRATEGY = PAROPT_NO_START_STRATEGY
 LEAST_SQUARES_MULTIPLIERS = PAROPT_LEAST_SQUARES_MULTIPLIERS
 AFFINE_STEP = PAROPT_AFFINE_STEP
 
+# The GMRES methods
+MGS_GMRES = PAROPT_MGS_GMRES
+PIPELINED_GMRES = PAROPT_PIPELINED_GMRES
+
+# The exit status of the problems in a batch
+BATCH_CONVERGED = PAROPT_BATCH_CONVERGED
+BATCH_MAX_ITERATIONS = PAROPT_BATCH_MAX_ITERATIONS
+BATCH_EVAL_FAILURE = PAROPT_BATCH_EVAL_FAILURE
+BATCH_FACTOR_FAILURE = PAROPT_BATCH_FACTOR_FAILURE
+
 # Set the update type
 SKIP_NEGATIVE_CURVATURE = PAROPT_SKIP_NEGATIVE_CURVATURE
 DAMPED_UPDATE = PAROPT_DAMPED_UPDATE
 
+cdef _get_profile(ParOptProfiler *profiler):
+    """
+    Convert the values recorded by the profiler to a dictionary. Each
+    phase name maps to a (time, calls) tuple, while 'reduce' maps to
+    the number of reductions, the bytes reduced and the time,
+    'cache' maps to the function evaluation cache hits and misses and
+    'vec_bytes' maps to the current and peak vector storage in bytes.
+    """
+    cdef int count = 0
+    cdef int hits = 0
+    cdef int misses = 0
+    cdef double vec_bytes = 0.0
+    cdef double vec_peak = 0.0
+    cdef double nbytes = 0.0
+    cdef double t = 0.0
+    cdef ParOptProfilePhase phase
+    profile = {}
+    for i in range(PAROPT_PROFILE_NUM_PHASES):
+        phase = <ParOptProfilePhase>i
+        name = profiler.getPhaseName(phase).decode('utf8')
+        profile[name] = (profiler.getTime(phase), profiler.getCalls(phase))
+    profiler.getReductionStats(&count, &nbytes, &t)
+    profile['reduce'] = (count, nbytes, t)
+    profiler.getCacheStats(&hits, &misses)
+    profile['cache'] = (hits, misses)
+    ParOptGetVecMemoryStats(&vec_bytes, &vec_peak)
+    profile['vec_bytes'] = (vec_bytes, vec_peak)
+    return profile
+
+def _is_history_file(filename, magic=b'PAROPTHS'):
+    """Check whether the file starts with the binary history magic"""
+    with open(filename, 'rb') as fp:
+        return fp.read(8) == magic
+
+def read_history(filename):
+    """
+    Read a binary history file written by setHistoryFile(). The records
+    are memory-mapped so no parsing is required. Each returned array is
+    a view into the mapped records. A partially written record at the
+    end of the file is ignored so that the history can be read while
+    the optimization is still running.
+    """
+
+    with open(filename, 'rb') as fp:
+        if fp.read(8) != b'PAROPTHS':
+            raise ValueError('%s is not a ParOpt history file'%(filename))
+        version, nfields = np.fromfile(fp, dtype=np.int32, count=2)
+        names = np.fromfile(fp, dtype='S16', count=nfields)
+    args = [name.decode() for name in names]
+
+    # Compute the number of complete records in the file
+    offset = 16 + 16*nfields
+    nrecords = (os.path.getsize(filename) - offset)//(8*nfields)
+    if nrecords == 0:
+        return args, [np.zeros(0) for name in args]
+
+    data = np.memmap(filename, dtype=np.float64, mode='r',
+                     offset=offset, shape=(nrecords, nfields))
+    objs = [data[:,i] for i in range(nfields)]
+
+    return args, objs
+
+def read_design_history(filename):
+    """
+    Read a binary design history file written by
+    setDesignHistoryFile(). This returns the iteration numbers and a
+    memory-mapped array with one global design vector per row.
+    """
+
+    with open(filename, 'rb') as fp:
+        if fp.read(8) != b'PAROPTHX':
+            raise ValueError('%s is not a ParOpt design history file'%(
+                filename))
+        version, scalar_size = np.fromfile(fp, dtype=np.int32, count=2)
+        nglobal = int(np.fromfile(fp, dtype=np.int64, count=1)[0])
+
+    dtype = np.float64
+    if scalar_size == 16:
+        dtype = np.complex128
+
+    # Compute the number of complete snapshots in the file
+    offset = 24
+    size = (1 + nglobal)*scalar_size
+    nrecords = (os.path.getsize(filename) - offset)//size
+    if nrecords == 0:
+        return np.zeros(0, dtype=np.int), np.zeros((0, nglobal), dtype=dtype)
+
+    data = np.memmap(filename, dtype=dtype, mode='r',
+                     offset=offset, shape=(nrecords, 1 + nglobal))
+    iters = data[:,0].real.astype(np.int)
+
+    return iters, data[:,1:]
+
 def unpack_output(filename):
     """
     Unpack the parameters from the paropt output file and return them
@@ -73,6 +179,10 @@ def unpack_output(filename):
             'rho']
     fmt = '4d 4d 4d 4d 7e 7e 7e 12e 7e 7e 7e 7e 7e 8e 7e'.split()
 
+    # Read the binary history directly if possible
+    if _is_history_file(filename):
+        return args, read_history(filename)[1]
+
     # Loop over the file until the end
     content = []
     for f in fmt:
@@ -95,6 +205,10 @@ def unpack_output(filename):
                 while counter < 10 and index < len(lines):
                     line = lines[index]
                     index += 1
+
+                    # Skip the profile lines between iterations
+                    if line.split()[:1] == ['profile']:
+                        continue
                     counter += 1
                     if len(line.split()) < len(args):
                         break
@@ -146,6 +260,10 @@ def unpack_tr_output(filename):
             'rho', 'mod red.', 'avg z', 'max z', 'avg pen.', 'max pen.']
     fmt = '5d 12e 9e 9e 9e 9e 9e 9e 9e 9e 9e 9e 9e'.split()
 
+    # Read the binary history directly if possible
+    if _is_history_file(filename):
+        return args, read_history(filename)[1]
+
     # Loop over the file until the end
     content = []
     for f in fmt:
@@ -168,6 +286,10 @@ def unpack_tr_output(filename):
                 while counter < 10 and index < len(lines):
                     line = lines[index]
                     index += 1
+
+                    # Skip the profile lines between iterations
+                    if line.split()[:1] == ['profile']:
+                        continue
                     counter += 1
                     if len(line.split()) < len(args):
                         break
@@ -215,6 +337,10 @@ def unpack_mma_output(filename):
               'linft-opt', 'l1-lambd', 'infeas']
     fmt = ['5d', '8d', '15e', '9e', '9e', '9e', '9e']
 
+    # Read the binary history directly if possible
+    if _is_history_file(filename):
+        return args, read_history(filename)[1]
+
     # Loop over the file until the end
     content = []
     for f in fmt:
@@ -237,6 +363,10 @@ def unpack_mma_output(filename):
                 while counter < 10 and index < len(lines):
                     line = lines[index]
                     index += 1
+
+                    # Skip the profile lines between iterations
+                    if line.split()[:1] == ['profile']:
+                        continue
                     counter += 1
                     if len(line.split()) < len(args)-2:
                         break
@@ -337,13 +467,69 @@ cdef inplace_array_1d(int nptype, int dim1, void *data_ptr,
 
     return ndarray
 
+# This wraps a 2-D row-major C++ array with a numpy array
+cdef inplace_array_2d(int nptype, int dim1, int dim2, void *data_ptr):
+    """Return a numpy version of the array"""
+    # Set the shape of the array
+    cdef int size = 2
+    cdef np.npy_intp shape[2]
+    cdef np.ndarray ndarray
+
+    # Set the entries of the shape array
+    shape[0] = <np.npy_intp>dim1
+    shape[1] = <np.npy_intp>dim2
+
+    # Create the array itself - Note that this function will not
+    # delete the data once the ndarray goes out of scope
+    ndarray = np.PyArray_SimpleNewFromData(size, shape,
+                                           nptype, data_ptr)
+
+    return ndarray
+
+# The maximum number of cached array views for each problem
+cdef int PAROPT_MAX_CACHED_VIEWS = 256
+
+cdef _get_view(Problem prob, ParOptScalar *array, int dim1, int dim2=0):
+    """
+    Get a numpy view of the array from the cache of the problem,
+    creating it if necessary. The optimizer allocates its vectors once,
+    so the same views are passed to the callbacks on every call.
+    """
+    key = (<size_t>array, dim1, dim2)
+    view = prob.views.get(key)
+    if view is None:
+        if len(prob.views) >= PAROPT_MAX_CACHED_VIEWS:
+            prob.views.clear()
+        if dim2 > 0:
+            view = inplace_array_2d(PAROPT_NPY_SCALAR, dim1, dim2,
+                                    <void*>array)
+        else:
+            view = inplace_array_1d(PAROPT_NPY_SCALAR, dim1, <void*>array)
+        prob.views[key] = view
+    return view
+
+cdef _wrap_vec(void *_self, ParOptVec *vec):
+    """
+    Wrap the vector for the callback: a PVec for the standard
+    interface or a cached numpy view for the batched interface
+    """
+    cdef Problem prob = <Problem>_self
+    cdef ParOptScalar *array = NULL
+    cdef int size = 0
+    if vec == NULL:
+        return None
+    if prob.batched:
+        size = vec.getArray(&array)
+        return _get_view(prob, array, size)
+    return _init_PVec(vec)
+
 cdef void _getvarsandbounds(void *_self, int nvars,
                             ParOptVec *_x, ParOptVec *_lb,
-                            ParOptVec *_ub):
+                            ParOptVec *_ub) with gil:
     try:
-        x = _init_PVec(_x)
-        lb = _init_PVec(_lb)
-        ub = _init_PVec(_ub)
+        x = _wrap_vec(_self, _x)
+        lb = _wrap_vec(_self, _lb)
+        ub = _wrap_vec(_self, _ub)
         (<object>_self).getVarsAndBounds(x, lb, ub)
     except:
         tb = traceback.format_exc()
@@ -354,12 +540,12 @@ cdef void _getvarsandbounds(void *_self, int nvars,
 
 cdef int _evalobjcon(void *_self, int nvars, int ncon,
                      ParOptVec *_x, ParOptScalar *fobj,
-                     ParOptScalar *cons):
+                     ParOptScalar *cons) with gil:
     fail = 0
 
     try:
         # Call the objective function
-        x = _init_PVec(_x)
+        x = _wrap_vec(_self, _x)
         fail, _fobj, _cons = (<object>_self).evalObjCon(x)
 
         # Copy over the objective value
@@ -375,9 +561,59 @@ cdef int _evalobjcon(void *_self, int nvars, int ncon,
 
     return fail
 
+cdef int _evalobjconbatch(void *_self, int nvars, int ncon, int npts,
+                          ParOptScalar **_x, ParOptScalar *fobj,
+                          ParOptScalar *cons, int *fail) with gil:
+    try:
+        # Wrap the design points and the output arrays
+        x = []
+        for i in range(npts):
+            x.append(_get_view(<Problem>_self, _x[i], nvars))
+
+        # Call the batched objective function
+        _fail, _fobj, _cons = (<object>_self).evalObjConBatch(x)
+
+        # Copy the values from the numpy arrays
+        _fail = np.asarray(_fail).ravel()
+        _fobj = np.asarray(_fobj).ravel()
+        _cons = np.asarray(_cons).ravel()
+        for i in range(npts):
+            fail[i] = _fail[i]
+            fobj[i] = _fobj[i]
+        for i in range(npts*ncon):
+            cons[i] = _cons[i]
+    except:
+        tb = traceback.format_exc()
+        print(tb)
+        exit(0)
+
+    return 0
+
+cdef int _evalobjconcomplex(void *_self, int nvars, int ncon,
+                            const ParOptComplex *_x, ParOptComplex *fobj,
+                            ParOptComplex *cons) with gil:
+    fail = 0
+    try:
+        # Wrap the complex design variables
+        x = inplace_array_1d(np.NPY_CDOUBLE, nvars, <void*>_x)
+
+        # Call the complex objective function
+        fail, _fobj, _cons = (<object>_self).evalObjConComplex(x)
+
+        # Copy over the objective and constraint values
+        fobj[0] = _fobj
+        for i in range(ncon):
+            cons[i] = _cons[i]
+    except:
+        tb = traceback.format_exc()
+        print(tb)
+        exit(0)
+
+    return fail
+
 cdef int _evalobjcongradient(void *_self, int nvars, int ncon,
                              ParOptVec *_x, ParOptVec *_g,
-                             ParOptVec **A):
+                             ParOptVec **A) with gil:
     fail = 0
     try:
         # The numpy arrays that will be used for x
@@ -396,17 +632,37 @@ cdef int _evalobjcongradient(void *_self, int nvars, int ncon,
 
     return fail
 
+cdef int _evalobjcongradientbatch(void *_self, int nvars, int ncon,
+                                  ParOptScalar *_x, ParOptScalar *_g,
+                                  ParOptScalar *_A) with gil:
+    fail = 0
+    try:
+        # Wrap the arrays, including the constraint gradients as a
+        # single ncon x nvars array
+        x = _get_view(<Problem>_self, _x, nvars)
+        g = _get_view(<Problem>_self, _g, nvars)
+        A = None
+        if ncon > 0:
+            A = _get_view(<Problem>_self, _A, ncon, nvars)
+
+        # Call the objective function
+        fail = (<object>_self).evalObjConGradient(x, g, A)
+    except:
+        tb = traceback.format_exc()
+        print(tb)
+        exit(0)
+
+    return fail
+
 cdef int _evalhvecproduct(void *_self, int nvars, int ncon, int nwcon,
                           ParOptVec *_x, ParOptScalar *_z, ParOptVec *_zw,
-                          ParOptVec *_px, ParOptVec *_hvec):
+                          ParOptVec *_px, ParOptVec *_hvec) with gil:
     fail = 0
     try:
-        x = _init_PVec(_x)
-        zw = None
-        if _zw != NULL:
-            zw = _init_PVec(_zw)
-        px = _init_PVec(_px)
-        hvec = _init_PVec(_hvec)
+        x = _wrap_vec(_self, _x)
+        zw = _wrap_vec(_self, _zw)
+        px = _wrap_vec(_self, _px)
+        hvec = _wrap_vec(_self, _hvec)
 
         z = inplace_array_1d(PAROPT_NPY_SCALAR, ncon, <void*>_z)
 
@@ -419,16 +675,39 @@ cdef int _evalhvecproduct(void *_self, int nvars, int ncon, int nwcon,
 
     return fail
 
+cdef int _evalhvecproductblock(void *_self, int nvars, int ncon, int nwcon,
+                               ParOptVec *_x, ParOptScalar *_z,
+                               ParOptVec *_zw, int nvecs, ParOptVec **_px,
+                               ParOptVec **_hvec) with gil:
+    fail = 0
+    try:
+        x = _wrap_vec(_self, _x)
+        zw = _wrap_vec(_self, _zw)
+        px = []
+        hvec = []
+        for i in range(nvecs):
+            px.append(_wrap_vec(_self, _px[i]))
+            hvec.append(_wrap_vec(_self, _hvec[i]))
+
+        z = inplace_array_1d(PAROPT_NPY_SCALAR, ncon, <void*>_z)
+
+        # Call the block Hessian-vector product
+        fail = (<object>_self).evalHvecProductBlock(x, z, zw, px, hvec)
+    except:
+        tb = traceback.format_exc()
+        print(tb)
+        exit(0)
+
+    return fail
+
 cdef int _evalhessiandiag(void *_self, int nvars, int ncon, int nwcon,
                           ParOptVec *_x, ParOptScalar *_z, ParOptVec *_zw,
-                          ParOptVec *_hdiag):
+                          ParOptVec *_hdiag) with gil:
     fail = 0
     try:
-        x = _init_PVec(_x)
-        zw = None
-        if _zw != NULL:
-            zw = _init_PVec(_zw)
-        hdiag = _init_PVec(_hdiag)
+        x = _wrap_vec(_self, _x)
+        zw = _wrap_vec(_self, _zw)
+        hdiag = _wrap_vec(_self, _hdiag)
 
         z = inplace_array_1d(PAROPT_NPY_SCALAR, ncon, <void*>_z)
 
@@ -442,12 +721,13 @@ cdef int _evalhessiandiag(void *_self, int nvars, int ncon, int nwcon,
     return fail
 
 cdef void _computequasinewtonupdatecorrection(void *_self, int nvars,
-                                              ParOptVec *_s, ParOptVec *_y):
+                                              ParOptVec *_s,
+                                              ParOptVec *_y) with gil:
     try:
         # Call the objective function
         if hasattr(<object>_self, 'computeQuasiNewtonUpdateCorrection'):
-            s = _init_PVec(_s)
-            y = _init_PVec(_y)
+            s = _wrap_vec(_self, _s)
+            y = _wrap_vec(_self, _y)
             (<object>_self).computeQuasiNewtonUpdateCorrection(s, y)
     except:
         tb = traceback.format_exc()
@@ -457,10 +737,10 @@ cdef void _computequasinewtonupdatecorrection(void *_self, int nvars,
     return
 
 cdef void _evalsparsecon(void *_self, int nvars, int nwcon,
-                         ParOptVec *_x, ParOptVec *_con):
+                         ParOptVec *_x, ParOptVec *_con) with gil:
     try:
-        x = _init_PVec(_x)
-        con = _init_PVec(_con)
+        x = _wrap_vec(_self, _x)
+        con = _wrap_vec(_self, _con)
 
         (<object>_self).evalSparseCon(x, con)
     except:
@@ -473,11 +753,11 @@ cdef void _evalsparsecon(void *_self, int nvars, int nwcon,
 cdef void _addsparsejacobian(void *_self, int nvars,
                              int nwcon, ParOptScalar alpha,
                              ParOptVec *_x, ParOptVec *_px,
-                             ParOptVec *_con):
+                             ParOptVec *_con) with gil:
     try:
-        x = _init_PVec(_x)
-        px = _init_PVec(_px)
-        con = _init_PVec(_con)
+        x = _wrap_vec(_self, _x)
+        px = _wrap_vec(_self, _px)
+        con = _wrap_vec(_self, _con)
 
         (<object>_self).addSparseJacobian(alpha, x, px, con)
     except:
@@ -490,11 +770,11 @@ cdef void _addsparsejacobian(void *_self, int nvars,
 cdef void _addsparsejacobiantranspose(void *_self, int nvars,
                                       int nwcon, ParOptScalar alpha,
                                       ParOptVec *_x, ParOptVec *_pzw,
-                                      ParOptVec *_out):
+                                      ParOptVec *_out) with gil:
     try:
-        x = _init_PVec(_x)
-        pzw = _init_PVec(_pzw)
-        out = _init_PVec(_out)
+        x = _wrap_vec(_self, _x)
+        pzw = _wrap_vec(_self, _pzw)
+        out = _wrap_vec(_self, _out)
         (<object>_self).addSparseJacobianTranspose(alpha, x, pzw, out)
     except:
         tb = traceback.format_exc()
@@ -506,10 +786,10 @@ cdef void _addsparsejacobiantranspose(void *_self, int nvars,
 cdef void _addsparseinnerproduct(void *_self, int nvars,
                                  int nwcon, int nwblock, ParOptScalar alpha,
                                  ParOptVec *_x, ParOptVec *_c,
-                                 ParOptScalar *_A):
+                                 ParOptScalar *_A) with gil:
     try:
-        x = _init_PVec(_x)
-        c = _init_PVec(_c)
+        x = _wrap_vec(_self, _x)
+        c = _wrap_vec(_self, _c)
         A = inplace_array_1d(PAROPT_NPY_SCALAR, nwcon*nwblock*nwblock,
                              <void*>_A)
 
@@ -544,16 +824,61 @@ cdef class ProblemBase:
         if check_hvec_product:
             check_hvec = 1
         if self.ptr != NULL:
-            self.ptr.checkGradients(dh, vec, check_hvec)
+            with nogil:
+                self.ptr.checkGradients(dh, vec, check_hvec)
         return
 
 cdef class Problem(ProblemBase):
-    cdef CyParOptProblem *me
+    """
+    Optimization problem defined through Python callbacks.
+
+    By default, the callbacks are passed PVec objects and the
+    constraint gradients are passed as a list of PVec objects. When
+    batched=True, the vector arguments are instead passed as numpy
+    views of the underlying storage which are cached between calls,
+    and the constraint gradients are passed as a single 2-D array of
+    shape (ncon, nvars) so that they can be filled in with a single
+    vectorized operation:
+
+    evalObjConGradient(x, g, A)
+
+    Batched problems may also define the method
+
+    fail, fobj, cons = evalObjConBatch(xlist)
+
+    that evaluates the objective and constraints at the list of points
+    and returns arrays of size npts, npts and (npts, ncon). This is
+    used by the optimizer when evaluating several trial points at
+    once.
+
+    Problems may also define the method
+
+    fail = evalHvecProductBlock(x, z, zw, pxlist, hveclist)
+
+    that computes the Hessian-vector products with all of the
+    directions in pxlist at once. This is used by the block Krylov
+    method in place of repeated calls to evalHvecProduct.
+
+    Problems may also define the method
+
+    fail, fobj, cons = evalObjConComplex(x)
+
+    that evaluates the objective and constraints at a complex-valued
+    numpy array of the local design variables. When defined, the
+    gradients are verified with a complex step in checkGradients(),
+    even though the optimizer uses real arithmetic.
+    """
     def __init__(self, MPI.Comm comm, int nvars, int ncon,
-                 int nwcon=0, int nwblock=0):
+                 int nwcon=0, int nwblock=0, batched=False):
         # Convert the communicator
         cdef MPI_Comm c_comm = comm.ob_mpi
 
+        # Set the cache of numpy views of the vectors
+        self.views = {}
+        self.batched = 0
+        if batched:
+            self.batched = 1
+
         # Create the pointer to the underlying C++ object
         self.me = new CyParOptProblem(c_comm, nvars, ncon, nwcon, nwblock)
         self.me.setSelfPointer(<void*>self)
@@ -567,6 +892,14 @@ cdef class Problem(ProblemBase):
         self.me.setAddSparseJacobian(_addsparsejacobian)
         self.me.setAddSparseJacobianTranspose(_addsparsejacobiantranspose)
         self.me.setAddSparseInnerProduct(_addsparseinnerproduct)
+        if self.batched:
+            self.me.setEvalObjConGradientBatch(_evalobjcongradientbatch)
+            if hasattr(self, 'evalObjConBatch'):
+                self.me.setEvalObjConBatch(_evalobjconbatch)
+        if hasattr(self, 'evalHvecProductBlock'):
+            self.me.setEvalHvecProductBlock(_evalhvecproductblock)
+        if hasattr(self, 'evalObjConComplex'):
+            self.me.setEvalObjConComplex(_evalobjconcomplex)
         self.ptr = self.me
         self.ptr.incref()
         return
@@ -595,6 +928,72 @@ cdef class Problem(ProblemBase):
 
         return
 
+    def setSparseJacobian(self, SparseJacobian jac):
+        """
+        Set the native sparse Jacobian of the sparse constraints. The
+        Jacobian products are then computed in C++ and the
+        addSparseJacobian, addSparseJacobianTranspose and
+        addSparseInnerProduct methods are not called.
+        """
+        if jac is None:
+            self.me.setSparseJacobian(NULL)
+        else:
+            self.me.setSparseJacobian(jac.ptr)
+        return
+
+cdef class SparseJacobian:
+    """
+    Block CSR representation of the Jacobian of the sparse constraints.
+
+    The non-zero pattern is given by rowp and cols in block CSR format
+    with blocks of size row_block x col_block (a scalar CSR matrix has
+    row_block = col_block = 1). The row block size must be either 1
+    or the sparse constraint block size nwblock. The values of the
+    blocks, of shape (nnz, row_block, col_block), can be updated each
+    iteration with setValues(), typically from evalSparseCon().
+    """
+    cdef ParOptSparseJacobian *ptr
+    def __cinit__(self, int nrows, int ncols, rowp, cols, vals=None,
+                  int row_block=1, int col_block=1):
+        cdef np.ndarray _rowp = np.ascontiguousarray(rowp, dtype=np.intc)
+        cdef np.ndarray _cols = np.ascontiguousarray(cols, dtype=np.intc)
+        cdef np.ndarray _vals = None
+        cdef ParOptScalar *v = NULL
+        if row_block < 1 or col_block < 1 or nrows % row_block != 0:
+            raise ValueError('Inconsistent block sizes')
+        if _rowp.shape[0] != nrows//row_block + 1:
+            raise ValueError('rowp must be of length nrows/row_block + 1')
+        if _cols.shape[0] < _rowp[-1]:
+            raise ValueError('cols must be of length rowp[-1]')
+        if vals is not None:
+            _vals = np.ascontiguousarray(vals, dtype=dtype).ravel()
+            if _vals.shape[0] != _rowp[-1]*row_block*col_block:
+                raise ValueError('Incorrect number of values')
+            v = <ParOptScalar*>_vals.data
+        self.ptr = new ParOptSparseJacobian(nrows, ncols, row_block,
+                                            col_block, <int*>_rowp.data,
+                                            <int*>_cols.data, v)
+        self.ptr.incref()
+        return
+
+    def __dealloc__(self):
+        if self.ptr:
+            self.ptr.decref()
+
+    def setValues(self, vals):
+        """Set the block values in the ordering of the original pattern"""
+        cdef np.ndarray _vals = np.ascontiguousarray(vals, dtype=dtype).ravel()
+        if _vals.shape[0] != self.ptr.getValues(NULL):
+            raise ValueError('Incorrect number of values')
+        self.ptr.setValues(<ParOptScalar*>_vals.data)
+        return
+
+    def getValues(self):
+        """Get the block values in the sorted ordering (in place)"""
+        cdef ParOptScalar *v = NULL
+        cdef int size = self.ptr.getValues(&v)
+        return inplace_array_1d(PAROPT_NPY_SCALAR, size, <void*>v, self)
+
 # Constants that define what Quasi-Newton method to use
 BFGS = PAROPT_BFGS
 SR1 = PAROPT_SR1
@@ -899,10 +1298,15 @@ cdef class InteriorPoint:
 
     # Perform the optimization
     def optimize(self, bytes checkpoint=None):
-        if checkpoint is None:
-            return self.ptr.optimize(NULL)
-        else:
-            return self.ptr.optimize(checkpoint)
+        cdef const char *fname = NULL
+        cdef int fail = 0
+        if checkpoint is not None:
+            fname = checkpoint
+
+        # Release the GIL so that it is only held within the callbacks
+        with nogil:
+            fail = self.ptr.optimize(fname)
+        return fail
 
     def getOptimizedPoint(self):
         """
@@ -975,7 +1379,8 @@ cdef class InteriorPoint:
 
     # Check objective and constraint gradients
     def checkGradients(self, double dh):
-        self.ptr.checkGradients(dh)
+        with nogil:
+            self.ptr.checkGradients(dh)
 
     # Set optimizer parameters
     def setNormType(self, ParOptNormType norm_typ):
@@ -987,6 +1392,9 @@ cdef class InteriorPoint:
     def setStartingPointStrategy(self, ParOptStartingPointStrategy strategy):
         self.ptr.setStartingPointStrategy(strategy)
 
+    def setUseWarmStart(self, int truth):
+        self.ptr.setUseWarmStart(truth)
+
     def setMaxMajorIterations(self, int iters):
         self.ptr.setMaxMajorIterations(iters)
 
@@ -1083,6 +1491,9 @@ cdef class InteriorPoint:
     def setBacktrackingLineSearch(self, int truth):
         self.ptr.setBacktrackingLineSearch(truth)
 
+    def setLineSearchBatchSize(self, int size):
+        self.ptr.setLineSearchBatchSize(size)
+
     def setArmijoParam(self, double c1):
         self.ptr.setArmijoParam(c1)
 
@@ -1100,6 +1511,16 @@ cdef class InteriorPoint:
     def setUseDiagHessian(self, int truth):
         self.ptr.setUseDiagHessian(truth)
 
+    # Set the parameters for the reduced-space (active set) mode
+    def setUseActiveSet(self, int truth):
+        self.ptr.setUseActiveSet(truth)
+
+    def setActiveSetTolerance(self, double tol):
+        self.ptr.setActiveSetTolerance(tol)
+
+    def setActiveSetExpandFrequency(self, int freq):
+        self.ptr.setActiveSetExpandFrequency(freq)
+
     def setUseQNGMRESPreCon(self, int truth):
         self.ptr.setUseQNGMRESPreCon(truth)
 
@@ -1115,6 +1536,18 @@ cdef class InteriorPoint:
     def setGMRESSubspaceSize(self, int _gmres_subspace_size):
         self.ptr.setGMRESSubspaceSize(_gmres_subspace_size)
 
+    def setGMRESType(self, ParOptGMRESType gmres_type):
+        self.ptr.setGMRESType(gmres_type)
+
+    def setGMRESMixedPrecision(self, int truth):
+        self.ptr.setGMRESMixedPrecision(truth)
+
+    def setGMRESBlockSize(self, int size):
+        self.ptr.setGMRESBlockSize(size)
+
+    def setGMRESRecycleSize(self, int size):
+        self.ptr.setGMRESRecycleSize(size)
+
     # Set other parameters
     def setOutputFrequency(self, int freq):
         self.ptr.setOutputFrequency(freq)
@@ -1130,6 +1563,25 @@ cdef class InteriorPoint:
     def setOutputLevel(self, int level):
         self.ptr.setOutputLevel(level)
 
+    def setHistoryFile(self, fname):
+        cdef char *filename = convert_to_chars(fname)
+        if filename is not None:
+            self.ptr.setHistoryFile(filename)
+
+    def setDesignHistoryFile(self, fname, int freq):
+        cdef char *filename = convert_to_chars(fname)
+        if filename is not None:
+            self.ptr.setDesignHistoryFile(filename, freq)
+
+    def setProfileOutput(self, truth):
+        if truth:
+            self.ptr.setProfileOutput(1)
+        else:
+            self.ptr.setProfileOutput(0)
+
+    def getProfile(self):
+        return _get_profile(self.ptr.getProfiler())
+
     def setGradientCheckFrequency(self, int freq, double step_size):
          self.ptr.setGradientCheckFrequency(freq, step_size)
 
@@ -1144,6 +1596,239 @@ cdef class InteriorPoint:
         if filename is not None:
             return self.ptr.readSolutionFile(filename)
 
+    def setUseAsyncCheckpoint(self, truth):
+        if truth:
+            self.ptr.setUseAsyncCheckpoint(1)
+        else:
+            self.ptr.setUseAsyncCheckpoint(0)
+
+    def completeCheckpoint(self):
+        return self.ptr.completeCheckpoint()
+
+cdef void _batchgetvarsandbounds(void *_self, int nprob, int nvars, int ld,
+                                 ParOptScalar *_x, ParOptScalar *_lb,
+                                 ParOptScalar *_ub) with gil:
+    try:
+        # Wrap the arrays as (nvars, nprob) numpy arrays
+        x = inplace_array_2d(PAROPT_NPY_SCALAR, nvars, ld, <void*>_x)
+        lb = inplace_array_2d(PAROPT_NPY_SCALAR, nvars, ld, <void*>_lb)
+        ub = inplace_array_2d(PAROPT_NPY_SCALAR, nvars, ld, <void*>_ub)
+
+        # Call the user-defined function for the starting point and bounds
+        (<object>_self).getVarsAndBounds(x[:, :nprob], lb[:, :nprob],
+                                         ub[:, :nprob])
+    except:
+        tb = traceback.format_exc()
+        print(tb)
+        exit(0)
+
+cdef void _batchevalobjcon(void *_self, int nvars, int ncon, int npts,
+                           const int *_index, int ld,
+                           const ParOptScalar *_x, ParOptScalar *_fobj,
+                           ParOptScalar *_cons, int *fail) with gil:
+    try:
+        # Wrap the packed problems as numpy views
+        index = np.array([_index[k] for k in range(npts)], dtype=np.intc)
+        x = inplace_array_2d(PAROPT_NPY_SCALAR, nvars, ld, <void*>_x)
+        fobj = inplace_array_1d(PAROPT_NPY_SCALAR, npts, <void*>_fobj)
+        cons = inplace_array_2d(PAROPT_NPY_SCALAR, ncon, ld, <void*>_cons)
+
+        # Call the objective function
+        _fail = (<object>_self).evalObjCon(index, x[:, :npts], fobj,
+                                           cons[:, :npts])
+
+        # Copy the fail flags
+        if _fail is not None:
+            _fail = np.broadcast_to(np.asarray(_fail, dtype=np.intc),
+                                    (npts,))
+            for k in range(npts):
+                fail[k] = _fail[k]
+    except:
+        tb = traceback.format_exc()
+        print(tb)
+        exit(0)
+
+cdef void _batchevalobjcongradient(void *_self, int nvars, int ncon,
+                                   int npts, const int *_index, int ld,
+                                   const ParOptScalar *_x, ParOptScalar *_g,
+                                   ParOptScalar *_A, int *fail) with gil:
+    try:
+        # Wrap the packed problems as numpy views
+        index = np.array([_index[k] for k in range(npts)], dtype=np.intc)
+        x = inplace_array_2d(PAROPT_NPY_SCALAR, nvars, ld, <void*>_x)
+        g = inplace_array_2d(PAROPT_NPY_SCALAR, nvars, ld, <void*>_g)
+        A = inplace_array_1d(PAROPT_NPY_SCALAR, ncon*nvars*ld, <void*>_A)
+        A = A.reshape(ncon, nvars, ld)
+
+        # Call the objective and constraint gradient function
+        _fail = (<object>_self).evalObjConGradient(index, x[:, :npts],
+                                                   g[:, :npts],
+                                                   A[:, :, :npts])
+
+        # Copy the fail flags
+        if _fail is not None:
+            _fail = np.broadcast_to(np.asarray(_fail, dtype=np.intc),
+                                    (npts,))
+            for k in range(npts):
+                fail[k] = _fail[k]
+    except:
+        tb = traceback.format_exc()
+        print(tb)
+        exit(0)
+
+cdef class BatchProblem:
+    """
+    An ensemble of independent, same-shaped problems that are solved
+    together by the BatchInteriorPoint optimizer.
+
+    All the arrays passed to the callbacks are numpy views in the
+    structure-of-arrays layout: entry i of problem k is stored in
+    column k, so x has shape (nvars, np), the constraints have shape
+    (ncon, np) and the constraint gradients have shape (ncon, nvars,
+    np). The callbacks are:
+
+    getVarsAndBounds(x, lb, ub)
+
+    fail = evalObjCon(index, x, fobj, cons)
+
+    fail = evalObjConGradient(index, x, g, A)
+
+    where column k of the arrays corresponds to problem index[k]. The
+    outputs are filled in place. The fail flag may be None, a single
+    value or an array with a flag for each column.
+    """
+    cdef CyParOptBatchProblem *ptr
+    def __init__(self, MPI.Comm comm, int nprob, int nvars, int ncon):
+        # Convert the communicator
+        cdef MPI_Comm c_comm = comm.ob_mpi
+
+        # Create the pointer to the underlying C++ object
+        self.ptr = new CyParOptBatchProblem(c_comm, nprob, nvars, ncon)
+        self.ptr.setSelfPointer(<void*>self)
+        self.ptr.setGetVarsAndBounds(_batchgetvarsandbounds)
+        self.ptr.setEvalObjCon(_batchevalobjcon)
+        self.ptr.setEvalObjConGradient(_batchevalobjcongradient)
+        self.ptr.incref()
+        return
+
+    def __dealloc__(self):
+        if self.ptr:
+            self.ptr.decref()
+        return
+
+    def setBoundOptions(self, use_lower=True, use_upper=True):
+        cdef int lower = 0
+        cdef int upper = 0
+        if use_lower: lower = 1
+        if use_upper: upper = 1
+        self.ptr.setBoundOptions(lower, upper)
+        return
+
+cdef class BatchInteriorPoint:
+    cdef ParOptBatchInteriorPoint *ptr
+    def __cinit__(self, BatchProblem _prob, double max_bound_val=1e20):
+        self.ptr = new ParOptBatchInteriorPoint(_prob.ptr, max_bound_val)
+        self.ptr.incref()
+        return
+
+    def __dealloc__(self):
+        if self.ptr:
+            self.ptr.decref()
+
+    # Perform the optimization
+    def optimize(self):
+        cdef int fail = 0
+
+        # Release the GIL so that it is only held within the callbacks
+        with nogil:
+            fail = self.ptr.optimize()
+        return fail
+
+    def getOptimizedPoint(self):
+        """
+        Get the design variables and multipliers for all the problems.
+        The arrays are views of the optimizer storage with shapes
+        (nvars, nprob), (ncon, nprob), (nvars, nprob) and (nvars, nprob).
+        """
+        cdef int nprob = 0
+        cdef int nvars = 0
+        cdef int ncon = 0
+        cdef ParOptScalar *_x = NULL
+        cdef ParOptScalar *_z = NULL
+        cdef ParOptScalar *_zl = NULL
+        cdef ParOptScalar *_zu = NULL
+
+        self.ptr.getProblemSizes(&nprob, &nvars, &ncon)
+        self.ptr.getOptimizedPoint(&_x, &_z, &_zl, &_zu)
+
+        x = inplace_array_1d(PAROPT_NPY_SCALAR, nvars*nprob,
+                             <void*>_x, self).reshape(nvars, nprob)
+        z = inplace_array_1d(PAROPT_NPY_SCALAR, ncon*nprob,
+                             <void*>_z, self).reshape(ncon, nprob)
+        zl = inplace_array_1d(PAROPT_NPY_SCALAR, nvars*nprob,
+                              <void*>_zl, self).reshape(nvars, nprob)
+        zu = inplace_array_1d(PAROPT_NPY_SCALAR, nvars*nprob,
+                              <void*>_zu, self).reshape(nvars, nprob)
+
+        return x, z, zl, zu
+
+    def getProblemStatus(self):
+        """
+        Get the objective value, the exit status and the number of
+        iterations of each problem. The status is one of
+        BATCH_CONVERGED, BATCH_MAX_ITERATIONS or BATCH_EVAL_FAILURE.
+        """
+        cdef int nprob = 0
+        cdef const ParOptScalar *_fobj = NULL
+        cdef const int *_status = NULL
+        cdef const int *_iters = NULL
+
+        self.ptr.getProblemSizes(&nprob, NULL, NULL)
+        self.ptr.getProblemStatus(&_fobj, &_status, &_iters)
+
+        fobj = np.zeros(nprob, dtype=dtype)
+        status = np.zeros(nprob, dtype=np.intc)
+        iters = np.zeros(nprob, dtype=np.intc)
+        for k in range(nprob):
+            fobj[k] = _fobj[k]
+            status[k] = _status[k]
+            iters[k] = _iters[k]
+
+        return fobj, status, iters
+
+    # Set optimizer parameters
+    def setMaxMajorIterations(self, int iters):
+        self.ptr.setMaxMajorIterations(iters)
+
+    def setAbsOptimalityTol(self, double tol):
+        self.ptr.setAbsOptimalityTol(tol)
+
+    def setInitBarrierParameter(self, double mu):
+        self.ptr.setInitBarrierParameter(mu)
+
+    def setBarrierFraction(self, double frac):
+        self.ptr.setBarrierFraction(frac)
+
+    def setBarrierPower(self, double power):
+        self.ptr.setBarrierPower(power)
+
+    def setMaxLineSearchIters(self, int iters):
+        self.ptr.setMaxLineSearchIters(iters)
+
+    def setArmijoParam(self, double c1):
+        self.ptr.setArmijoParam(c1)
+
+    def setPenaltyDescentFraction(self, double frac):
+        self.ptr.setPenaltyDescentFraction(frac)
+
+    def setOutputFile(self, fname):
+        cdef char *filename = convert_to_chars(fname)
+        if filename is not None:
+            self.ptr.setOutputFile(filename)
+
+    def setOutputLevel(self, int level):
+        self.ptr.setOutputLevel(level)
+
 cdef class MMA(ProblemBase):
     cdef ParOptMMA *mma
     def __cinit__(self, ProblemBase _prob, use_mma=True):
@@ -1176,7 +1861,15 @@ cdef class MMA(ProblemBase):
         cdef ParOptVec *v = NULL
         if vec is not None:
             v = vec.ptr
-        self.mma.initializeSubProblem(v)
+        with nogil:
+            self.mma.initializeSubProblem(v)
+
+    def solveDualSubProblem(self, PVec vec):
+        cdef ParOptVec *v = vec.ptr
+        cdef int fail = 0
+        with nogil:
+            fail = self.mma.solveDualSubProblem(v)
+        return fail
 
     def computeKKTError(self):
         cdef double l1 = 0.0
@@ -1205,10 +1898,27 @@ cdef class MMA(ProblemBase):
     def setPrintLevel(self, int level):
         self.mma.setPrintLevel(level)
 
+    def setProfileOutput(self, truth):
+        if truth:
+            self.mma.setProfileOutput(1)
+        else:
+            self.mma.setProfileOutput(0)
+
+    def getProfile(self):
+        return _get_profile(self.mma.getProfiler())
+
     def setOutputFile(self, fname):
         cdef char *filename = convert_to_chars(fname)
         self.mma.setOutputFile(filename)
 
+    def setHistoryFile(self, fname):
+        cdef char *filename = convert_to_chars(fname)
+        self.mma.setHistoryFile(filename)
+
+    def setDesignHistoryFile(self, fname, int freq):
+        cdef char *filename = convert_to_chars(fname)
+        self.mma.setDesignHistoryFile(filename, freq)
+
     def setAsymptoteContract(self, double val):
         self.mma.setAsymptoteContract(val)
 
@@ -1230,6 +1940,51 @@ cdef class MMA(ProblemBase):
     def setRegularization(self, double eps, double delta):
         self.mma.setRegularization(eps, delta)
 
+    def setPenaltyGamma(self, double val):
+        self.mma.setPenaltyGamma(val)
+
+    def setMaxDualIterations(self, int val):
+        self.mma.setMaxDualIterations(val)
+
+    def setDualTolerance(self, double val):
+        self.mma.setDualTolerance(val)
+
+    def setUseActiveSet(self, int truth):
+        self.mma.setUseActiveSet(truth)
+
+    def setActiveSetTolerance(self, double val):
+        self.mma.setActiveSetTolerance(val)
+
+    def setActiveSetExpandFrequency(self, int val):
+        self.mma.setActiveSetExpandFrequency(val)
+
+cdef class CachedProblem(ProblemBase):
+    """
+    Wrap a problem so that the objective, constraint and gradient
+    values at the most recently evaluated points are stored and
+    returned without calling the problem again.
+    """
+    cdef ParOptCachedProblem *cache
+    def __cinit__(self, ProblemBase problem, int max_entries=4):
+        self.cache = new ParOptCachedProblem(problem.ptr, max_entries)
+        self.cache.incref()
+        self.ptr = self.cache
+
+    def __dealloc__(self):
+        if self.cache != NULL:
+            self.cache.decref()
+
+    def clearCache(self):
+        self.cache.clearCache()
+
+    def getCacheStats(self):
+        """Return the objcon hits/misses and gradient hits/misses"""
+        cdef int objcon_hits = 0, objcon_misses = 0
+        cdef int grad_hits = 0, grad_misses = 0
+        self.cache.getCacheStats(&objcon_hits, &objcon_misses,
+                                 &grad_hits, &grad_misses)
+        return objcon_hits, objcon_misses, grad_hits, grad_misses
+
 cdef class TrustRegionSubproblem:
     def __cinit__(self):
         self.ptr = NULL
@@ -1247,7 +2002,8 @@ cdef class TrustRegionSubproblem:
         if check_hvec_product:
             check_hvec = 1
         if self.ptr != NULL:
-            self.ptr.checkGradients(dh, vec, check_hvec)
+            with nogil:
+                self.ptr.checkGradients(dh, vec, check_hvec)
         return
 
 cdef class QuadraticSubproblem(TrustRegionSubproblem):
@@ -1310,9 +2066,26 @@ cdef class TrustRegion:
         cdef char *filename = convert_to_chars(fname)
         self.tr.setOutputFile(filename)
 
+    def setHistoryFile(self, fname):
+        cdef char *filename = convert_to_chars(fname)
+        self.tr.setHistoryFile(filename)
+
+    def setDesignHistoryFile(self, fname, int freq):
+        cdef char *filename = convert_to_chars(fname)
+        self.tr.setDesignHistoryFile(filename, freq)
+
     def setPrintLevel(self, int lev):
         self.tr.setPrintLevel(lev)
 
+    def setProfileOutput(self, truth):
+        if truth:
+            self.tr.setProfileOutput(1)
+        else:
+            self.tr.setProfileOutput(0)
+
+    def getProfile(self):
+        return _get_profile(self.tr.getProfiler())
+
     def setAdaptiveGammaUpdate(self, truth):
         if truth:
             self.tr.setAdaptiveGammaUpdate(1)
@@ -1356,8 +2129,16 @@ cdef class TrustRegion:
     def setOutputFrequency(self, int output_frequency):
         self.tr.setOutputFrequency(output_frequency)
 
+    def setNumTrialSteps(self, int ntrial):
+        self.tr.setNumTrialSteps(ntrial)
+
+    def setWarmStartSubproblem(self, int truth):
+        self.tr.setWarmStartSubproblem(truth)
+
     def optimize(self, InteriorPoint optimizer):
-        self.tr.optimize(optimizer.ptr)
+        cdef ParOptInteriorPoint *opt = optimizer.ptr
+        with nogil:
+            self.tr.optimize(opt)
 
     def getOptimizedPoint(self):
         """
@@ -0,0 +1,2 @@
+PAROPT_NPY_SCALAR = np.NPY_DOUBLE
+dtype = np.double
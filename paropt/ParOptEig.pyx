@@ -106,7 +106,7 @@ cdef class EigenQuasiNewton(CompactQuasiNewton):
         return
 
 cdef void _updateeigenmodel(void *_self, ParOptVec *_x,
-                            ParOptCompactEigenApprox *_approx):
+                            ParOptCompactEigenApprox *_approx) with gil:
     fail = 0
     try:
         obj = <object>_self
@@ -0,0 +1 @@
+ctypedef double ParOptScalar
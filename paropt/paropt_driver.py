@@ -21,6 +21,7 @@ _norm_types = ['Infinity', 'L1', 'L2']
 _barrier_types = ['Monotone', 'Mehrotra', 'Complementarity fraction']
 _start_types = ['None', 'Least squares multipliers', 'Affine step']
 _bfgs_updates = ['Skip negative', 'Damped']
+_gmres_types = ['MGS', 'Pipelined']
 
 class ParOptDriver(Driver):
     """
@@ -116,6 +117,8 @@ class ParOptDriver(Driver):
                              desc='Max number of line search iterations')
         self.options.declare('backtrack_ls', None, allow_none=True, types=bool,
                              desc='Use backtracking line search')
+        self.options.declare('ls_batch_size', None, allow_none=True, types=int,
+                             desc='Number of step lengths evaluated together')
         self.options.declare('armijo_param', None, allow_none=True,
                              desc='Armijo parameter for line search')
         self.options.declare('penalty_descent_frac', None, allow_none=True,
@@ -128,6 +131,12 @@ class ParOptDriver(Driver):
                              desc='Use Hvec product with GMRES')
         self.options.declare('use_diag_hessian', None, allow_none=True, types=bool,
                              desc='Use a diagonal Hessian')
+        self.options.declare('use_active_set', None, allow_none=True, types=bool,
+                             desc='Compress the design vectors to the free variables')
+        self.options.declare('active_set_tol', None, allow_none=True, types=float,
+                             desc='Tolerance for detecting firmly active variables')
+        self.options.declare('active_set_expand_freq', None, allow_none=True, types=int,
+                             desc='Frequency at which the active set is recomputed')
         self.options.declare('use_qn_gmres_precon', None, allow_none=True, types=bool,
                              desc='Use QN GMRES preconditioner')
         self.options.declare('set_nk_switch_tol', None, allow_none=True,
@@ -138,18 +147,39 @@ class ParOptDriver(Driver):
                              desc='GMRES tolerances: array([rtol, atol])')
         self.options.declare('gmres_subspace_size', None, allow_none=True, types=int,
                              desc='GMRES subspace size')
+        self.options.declare('gmres_type', None, values=_gmres_types,
+                             desc='GMRES method', allow_none=True)
+        self.options.declare('gmres_mixed_precision', None, allow_none=True,
+                             types=bool,
+                             desc='Store the GMRES subspace in single precision')
+        self.options.declare('gmres_block_size', None, allow_none=True, types=int,
+                             desc='Number of directions per block GMRES iteration')
+        self.options.declare('gmres_recycle_size', None, allow_none=True, types=int,
+                             desc='Number of harmonic Ritz vectors recycled between GMRES solves')
 
         # Output options
         self.options.declare('output_freq', None, allow_none=True, types=int,
                              desc='Output frequency')
         self.options.declare('output_file', None, allow_none=True,
                              desc='Output file name')
+        self.options.declare('history_file', None, allow_none=True,
+                             desc='Binary iteration history file name')
+        self.options.declare('design_history_file', None, allow_none=True,
+                             desc='Binary design variable history file name')
+        self.options.declare('design_history_freq', default=10, lower=1, types=int,
+                             desc='Iterations between design history snapshots')
         self.options.declare('major_iter_step_check', None, allow_none=True, types=int,
                              desc='Major iter step check')
         self.options.declare('output_level', None, allow_none=True, types=int,
                              desc='Output level')
+        self.options.declare('profile_output', default=False, types=bool,
+                             desc='Print the time spent in each phase')
         self.options.declare('grad_check_freq', None, allow_none=True,
                              desc='Gradient check frequency: array([freq, step_size])')
+        self.options.declare('cache_size', default=0, lower=0, types=int,
+                             desc='Number of evaluated points to cache (0 for no cache)')
+        self.options.declare('distributed', default=False, types=bool,
+                             desc='Distribute the design variables across the processors')
 
         # Set options for the trust region method
         self.options.declare('tr_adaptive_gamma_update', default=True, types=bool,
@@ -180,8 +210,14 @@ class ParOptDriver(Driver):
         # Trust region output file name
         self.options.declare('tr_output_file', None, allow_none=True,
                              desc='Trust region output file name')
+        self.options.declare('tr_history_file', None, allow_none=True,
+                             desc='Trust region binary iteration history file name')
         self.options.declare('tr_write_output_freq', default=10, types=int,
                              desc='Trust region output frequency')
+        self.options.declare('tr_num_trial_steps', default=1, types=int,
+                             desc='Number of trust region radii evaluated together')
+        self.options.declare('tr_warm_start', default=True, types=bool,
+                             desc='Warm-start the trust region subproblems')
 
         return
 
@@ -220,7 +256,14 @@ class ParOptDriver(Driver):
             qn_type = ParOpt.BFGS
 
         # Create the ParOptProblem from the OpenMDAO problem
-        self.paropt_problem = ParOptProblem(problem)
+        self.paropt_problem = ParOptProblem(problem,
+                                            distributed=self.options['distributed'])
+
+        # Optionally cache the function and gradient evaluations
+        opt_problem = self.paropt_problem
+        if self.options['cache_size'] > 0:
+            opt_problem = ParOpt.CachedProblem(self.paropt_problem,
+                                               self.options['cache_size'])
 
         # Create the problem
         if opt_type == 'Trust Region':
@@ -232,7 +275,7 @@ class ParOptDriver(Driver):
                 max_qn_subspace = 1
 
             # Create the quasi-Newton method
-            qn = ParOpt.LBFGS(self.paropt_problem, subspace=max_qn_subspace)
+            qn = ParOpt.LBFGS(opt_problem, subspace=max_qn_subspace)
 
             # Retrieve the options for the trust region problem
             tr_min_size = self.options['tr_min_size']
@@ -242,7 +285,7 @@ class ParOptDriver(Driver):
             tr_init_size = self.options['tr_init_size']
 
             # Create the trust region sub-problem
-            subproblem = ParOpt.QuadraticSubproblem(self.paropt_problem, qn)
+            subproblem = ParOpt.QuadraticSubproblem(opt_problem, qn)
             tr_init_size = min(tr_max_size, max(tr_init_size, tr_min_size))
             tr = ParOpt.TrustRegion(subproblem, tr_init_size,
                                     tr_min_size, tr_max_size,
@@ -262,13 +305,19 @@ class ParOptDriver(Driver):
             if self.options['tr_output_file'] is not None:
                 tr.setOutputFile(self.options['tr_output_file'])
                 tr.setOutputFrequency(self.options['tr_write_output_freq'])
+            if self.options['tr_history_file'] is not None:
+                tr.setHistoryFile(self.options['tr_history_file'])
+
+            if self.options['tr_num_trial_steps'] > 1:
+                tr.setNumTrialSteps(self.options['tr_num_trial_steps'])
+            tr.setWarmStartSubproblem(self.options['tr_warm_start'])
 
             # Create the interior-point optimizer for the trust region sub-problem
             opt = ParOpt.InteriorPoint(subproblem, 0, ParOpt.NO_HESSIAN_APPROX)
             self.tr = tr
         else:
             # Create the ParOpt object with the interior point method
-            opt = ParOpt.InteriorPoint(self.paropt_problem, max_qn_subspace,
+            opt = ParOpt.InteriorPoint(opt_problem, max_qn_subspace,
                                        qn_type)
 
         # Apply the options to ParOpt
@@ -358,6 +407,9 @@ class ParOptDriver(Driver):
         if self.options['backtrack_ls']:
             opt.setBacktrackingLineSearch(self.options['backtrack_ls'])
 
+        if self.options['ls_batch_size']:
+            opt.setLineSearchBatchSize(self.options['ls_batch_size'])
+
         if self.options['armijo_param']:
             opt.setArmijoParam(self.options['armijo_param'])
 
@@ -373,6 +425,15 @@ class ParOptDriver(Driver):
         if self.options['use_diag_hessian']:
             opt.setUseDiagHessian(self.options['use_diag_hessian'])
 
+        if self.options['use_active_set']:
+            opt.setUseActiveSet(self.options['use_active_set'])
+
+        if self.options['active_set_tol']:
+            opt.setActiveSetTolerance(self.options['active_set_tol'])
+
+        if self.options['active_set_expand_freq']:
+            opt.setActiveSetExpandFrequency(self.options['active_set_expand_freq'])
+
         if self.options['use_qn_gmres_precon']:
             opt.setUseQNGMRESPreCon(self.options['use_qn_gmres_precon'])
 
@@ -390,18 +451,47 @@ class ParOptDriver(Driver):
         if self.options['gmres_subspace_size']:
             opt.setGMRESSubspaceSize(self.options['gmres_subspace_size'])
 
+        if self.options['gmres_type']:
+            if self.options['gmres_type'] == 'MGS':
+                gmres_type = ParOpt.MGS_GMRES
+            elif self.options['gmres_type'] == 'Pipelined':
+                gmres_type = ParOpt.PIPELINED_GMRES
+            opt.setGMRESType(gmres_type)
+
+        if self.options['gmres_mixed_precision']:
+            opt.setGMRESMixedPrecision(self.options['gmres_mixed_precision'])
+
+        if self.options['gmres_block_size']:
+            opt.setGMRESBlockSize(self.options['gmres_block_size'])
+
+        if self.options['gmres_recycle_size']:
+            opt.setGMRESRecycleSize(self.options['gmres_recycle_size'])
+
         if self.options['output_freq']:
             opt.setOutputFrequency(self.options['output_freq'])
 
         if self.options['output_file']:
             opt.setOutputFile(self.options['output_file'])
 
+        if self.options['history_file']:
+            opt.setHistoryFile(self.options['history_file'])
+
+        if self.options['design_history_file']:
+            opt.setDesignHistoryFile(self.options['design_history_file'],
+                                     self.options['design_history_freq'])
+
         if self.options['major_iter_step_check']:
             opt.setMajorIterStepCheck(self.options['major_iter_step_check'])
 
         if self.options['output_level']:
             opt.setOutputLevel(self.options['output_level'])
 
+        if self.options['profile_output']:
+            if self.options['optimizer'] == 'Trust Region':
+                self.tr.setProfileOutput(True)
+            else:
+                opt.setProfileOutput(True)
+
         if self.options['grad_check_freq']:
             opt.setGradCheckFrequency(self.options['grad_check_freq'])
 
@@ -432,12 +522,21 @@ class ParOptDriver(Driver):
 
 class ParOptProblem(ParOpt.Problem):
 
-    def __init__(self, problem):
+    def __init__(self, problem, distributed=False):
         """
         ParOptProblem class to pass to the ParOptDriver. Takes
         in an instance of the OpenMDAO problem class and creates
         a ParOpt problem to be passed into ParOpt through the
         ParOptDriver.
+
+        When distributed is True, each processor owns only its local
+        part of the design variables. The local slice of each
+        distributed design variable is mapped directly onto the local
+        part of the ParOpt design vector, while the non-distributed
+        design variables are owned by the root processor. The
+        callbacks then receive numpy views of the ParOpt vectors and
+        the constraint gradients as a single (ncon, nvars) array that
+        is filled in place from the total derivatives.
         """
 
         self.problem = problem
@@ -445,6 +544,7 @@ class ParOptProblem(ParOpt.Problem):
         self.comm = self.problem.comm
         self.nvars = None
         self.ncon = None
+        self.distributed = distributed
 
         # Get the design variable names
         self.dvs = [name for name, meta in iteritems(self.problem.model.get_design_vars())]
@@ -460,10 +560,85 @@ class ParOptProblem(ParOpt.Problem):
             self.ncon += meta['size']
 
         # Initialize the base class
-        super(ParOptProblem, self).__init__(self.comm, self.nvars, self.ncon)
+        if self.distributed:
+            self._setup_distributed()
+            super(ParOptProblem, self).__init__(self.comm, self.nvars, self.ncon,
+                                                batched=True)
+        else:
+            super(ParOptProblem, self).__init__(self.comm, self.nvars, self.ncon)
 
         return
 
+    def _setup_distributed(self):
+        """
+        Set up the map between the local design vector and the
+        OpenMDAO design variables for the distributed mode.
+
+        For each design variable this stores the local offset and size
+        within the ParOpt vector, the offset of the local slice within
+        the OpenMDAO variable, and whether the variable is distributed.
+        """
+        rank = self.comm.rank
+
+        self.dv_map = []
+        local_offset = 0
+        for name, meta in iteritems(self.problem.model.get_design_vars()):
+            if meta.get('distributed', False):
+                # Find the part of the variable owned by each processor
+                local_size = np.size(self.problem[name])
+                sizes = self.comm.allgather(local_size)
+                var_offset = sum(sizes[:rank])
+                distributed = True
+            else:
+                # The root processor owns the non-distributed variables
+                local_size = 0
+                if rank == 0:
+                    local_size = meta['size']
+                var_offset = 0
+                distributed = False
+
+            self.dv_map.append((name, local_offset, local_size,
+                                var_offset, distributed))
+            local_offset += local_size
+
+        self.nvars = local_offset
+
+        # The objective and constraints are evaluated together
+        self.of = []
+        for name, meta in iteritems(self.problem.model.get_objectives()):
+            self.of.append(name)
+            break
+        for name, meta in iteritems(self.problem.model.get_constraints()):
+            self.of.append(name)
+
+        return
+
+    def _set_design_vars(self, x):
+        """
+        Set the design variables in the distributed mode. The local
+        slices are set directly from views of the ParOpt vector and
+        the non-distributed variables are broadcast from the root.
+        """
+        for name, offset, size, var_offset, distributed in self.dv_map:
+            if distributed:
+                self.problem[name] = x[offset:offset + size]
+            else:
+                values = None
+                if self.comm.rank == 0:
+                    values = x[offset:offset + size]
+                self.problem[name] = self.comm.bcast(values, root=0)
+
+        return
+
+    def _get_bound(self, value, size, var_offset, distributed, default):
+        """Get the local part of a design variable bound"""
+        if value is None:
+            return default
+        value = np.asarray(value).ravel()
+        if value.size == 1 or (distributed and value.size == size):
+            return value
+        return value[var_offset:var_offset + size]
+
     def getVarsAndBounds(self, x, lb, ub):
         """ Set the values of the bounds """
         # Todo:
@@ -474,6 +649,20 @@ class ParOptProblem(ParOpt.Problem):
         # Get design vars from openmdao as a dictionary
         desvars = self.problem.model.get_design_vars()
 
+        if self.distributed:
+            for name, offset, size, var_offset, distributed in self.dv_map:
+                if size == 0:
+                    continue
+                meta = desvars[name]
+                x[offset:offset + size] = np.asarray(self.problem[name]).ravel()
+                lb[offset:offset + size] = self._get_bound(meta['lower'], size,
+                                                           var_offset, distributed,
+                                                           -1e20)
+                ub[offset:offset + size] = self._get_bound(meta['upper'], size,
+                                                           var_offset, distributed,
+                                                           1e20)
+            return
+
         i = 0
         for name, meta in iteritems(desvars):
             size = meta['size']
@@ -490,11 +679,14 @@ class ParOptProblem(ParOpt.Problem):
         # - add check that # of constraints are consistent
 
         # Set the design variable values
-        i = 0
-        for name, meta in iteritems(self.problem.model.get_design_vars()):
-            size = meta['size']
-            self.problem[name] = x[i:i + size]
-            i += size
+        if self.distributed:
+            self._set_design_vars(x)
+        else:
+            i = 0
+            for name, meta in iteritems(self.problem.model.get_design_vars()):
+                size = meta['size']
+                self.problem[name] = x[i:i + size]
+                i += size
 
         # Solve the problem
         self.problem.model._solve_nonlinear()
@@ -520,6 +712,26 @@ class ParOptProblem(ParOpt.Problem):
     def evalObjConGradient(self, x, g, A):
         """Evaluate the objective and constraint gradient"""
 
+        if self.distributed:
+            # Compute the objective and constraint totals in a single
+            # call. The totals are returned for each pair of output and
+            # design variable, so only the local slice of each design
+            # variable is copied into g and A.
+            J = self.problem.compute_totals(of=self.of, wrt=self.dvs,
+                                            return_format='dict')
+            for name, offset, size, var_offset, distributed in self.dv_map:
+                if size == 0:
+                    continue
+                cols = slice(var_offset, var_offset + size)
+                g[offset:offset + size] = J[self.of[0]][name][0, cols]
+                i = 0
+                for con in self.of[1:]:
+                    block = J[con][name]
+                    A[i:i + block.shape[0], offset:offset + size] = block[:, cols]
+                    i += block.shape[0]
+
+            return 0
+
         # The objective gradient
         for name, meta in iteritems(self.problem.model.get_objectives()):
             grad = self.problem.compute_totals(of=[name], wrt=self.dvs,
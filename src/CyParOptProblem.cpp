@@ -31,13 +31,36 @@ ParOptProblem(_comm, _nvars, _ncon, _nwcon, _nwblock){
   evalobjcongradient = NULL;
   evalhvecproduct = NULL;
   evalhessiandiag = NULL;
+  computequasinewtonupdatecorrection = NULL;
   evalsparsecon = NULL;
   addsparsejacobian = NULL;
   addsparsejacobiantranspose = NULL;
   addsparseinnerproduct = NULL;
+  evalobjconbatch = NULL;
+  evalobjcongradientbatch = NULL;
+  evalhvecproductblock = NULL;
+  evalobjconcomplex = NULL;
+
+  // The storage for the batched callbacks is allocated when needed
+  max_batch_size = 0;
+  batch_x = NULL;
+  Abuffer = NULL;
+
+  // No native sparse Jacobian by default
+  jac = NULL;
 }
 
-CyParOptProblem::~CyParOptProblem(){}
+CyParOptProblem::~CyParOptProblem(){
+  if (batch_x){
+    delete [] batch_x;
+  }
+  if (Abuffer){
+    delete [] Abuffer;
+  }
+  if (jac){
+    jac->decref();
+  }
+}
 
 /**
   Set options associated with the inequality constraints
@@ -156,6 +179,107 @@ void CyParOptProblem::setAddSparseInnerProduct( void (*func)(void *,
   addsparseinnerproduct = func;
 }
 
+/**
+  Set the batched objective and constraint callback.
+
+  The callback is passed the arrays for all of the design points at
+  once. The constraint values are stored in cons[ncon*i + j].
+
+  @param func the callback function
+*/
+void CyParOptProblem::setEvalObjConBatch( int (*func)(void*, int, int, int,
+                                                      ParOptScalar**,
+                                                      ParOptScalar*,
+                                                      ParOptScalar*,
+                                                      int*) ){
+  evalobjconbatch = func;
+}
+
+/**
+  Set the batched objective and constraint gradient callback.
+
+  The callback is passed the design variable and objective gradient
+  arrays along with a single ncon x nvars row-major array for the
+  constraint gradients. This is used in place of the
+  evalobjcongradient callback when it is set.
+
+  @param func the callback function
+*/
+void CyParOptProblem::setEvalObjConGradientBatch( int (*func)(void*, int, int,
+                                                              ParOptScalar*,
+                                                              ParOptScalar*,
+                                                              ParOptScalar*) ){
+  evalobjcongradientbatch = func;
+}
+
+/**
+  Set the block Hessian-vector product callback.
+
+  The callback is passed all of the direction vectors at once. When it
+  is not set, the products are computed one at a time through the
+  evalhvecproduct callback.
+
+  @param func the callback function
+*/
+void CyParOptProblem::setEvalHvecProductBlock( int (*func)(void*, int, int,
+                                                           int, ParOptVec*,
+                                                           ParOptScalar*,
+                                                           ParOptVec*, int,
+                                                           ParOptVec**,
+                                                           ParOptVec**) ){
+  evalhvecproductblock = func;
+}
+
+/**
+  Set the complex-step evaluation callback.
+
+  When set, the gradients are verified with a complex step in
+  checkGradients().
+
+  @param func the callback function
+*/
+void CyParOptProblem::setEvalObjConComplex( int (*func)(void*, int, int,
+                                                        const ParOptComplex*,
+                                                        ParOptComplex*,
+                                                        ParOptComplex*) ){
+  evalobjconcomplex = func;
+}
+
+/**
+  Set a native sparse Jacobian for the sparse constraints.
+
+  When set, the products with the sparse constraint Jacobian are
+  computed directly from the matrix and the addsparsejacobian,
+  addsparsejacobiantranspose and addsparseinnerproduct callbacks are
+  not used. The constraint values are still computed by the
+  evalsparsecon callback, which may also update the matrix values.
+
+  @param _jac the sparse Jacobian (or NULL to use the callbacks)
+*/
+void CyParOptProblem::setSparseJacobian( ParOptSparseJacobian *_jac ){
+  if (_jac){
+    int nrows, ncols, rbsize, cbsize;
+    _jac->getSize(&nrows, &ncols);
+    _jac->getBlockSize(&rbsize, &cbsize);
+    if (nrows != nwcon || ncols != nvars){
+      fprintf(stderr, "CyParOptProblem: Sparse Jacobian dimensions "
+              "%d x %d do not match the problem %d x %d\n",
+              nrows, ncols, nwcon, nvars);
+      return;
+    }
+    if (rbsize != 1 && rbsize != nwblock){
+      fprintf(stderr, "CyParOptProblem: Sparse Jacobian row block size "
+              "%d must be 1 or %d\n", rbsize, nwblock);
+      return;
+    }
+    _jac->incref();
+  }
+  if (jac){
+    jac->decref();
+  }
+  jac = _jac;
+}
+
 /*
   Get the variables and bounds from the problem
 */
@@ -186,12 +310,98 @@ int CyParOptProblem::evalObjCon( ParOptVec *x,
   return fail;
 }
 
+/*
+  Evaluate the objective and constraints at several points
+
+  If the batched callback is not defined, the points are evaluated
+  one at a time.
+*/
+int CyParOptProblem::evalObjConBatch( int npts, ParOptVec **x,
+                                      ParOptScalar *fobj,
+                                      ParOptScalar *cons,
+                                      int *fail ){
+  if (!evalobjconbatch){
+    return ParOptProblem::evalObjConBatch(npts, x, fobj, cons, fail);
+  }
+
+  if (npts > max_batch_size){
+    if (batch_x){
+      delete [] batch_x;
+    }
+    max_batch_size = npts;
+    batch_x = new ParOptScalar*[ max_batch_size ];
+  }
+  for ( int i = 0; i < npts; i++ ){
+    x[i]->getArray(&batch_x[i]);
+  }
+
+  return evalobjconbatch(self, nvars, ncon, npts, batch_x,
+                         fobj, cons, fail);
+}
+
+/*
+  Use the complex step to check the gradients if the callback is set
+*/
+int CyParOptProblem::useComplexStep(){
+  return (evalobjconcomplex != NULL);
+}
+
+/*
+  Evaluate the objective and constraints with complex values
+*/
+int CyParOptProblem::evalObjConComplex( const ParOptComplex *x,
+                                        ParOptComplex *fobj,
+                                        ParOptComplex *cons ){
+  if (!evalobjconcomplex){
+    return ParOptProblem::evalObjConComplex(x, fobj, cons);
+  }
+
+  return evalobjconcomplex(self, nvars, ncon, x, fobj, cons);
+}
+
 /*
   Evaluate the objective and constraint gradients
 */
 int CyParOptProblem::evalObjConGradient( ParOptVec *x,
                                          ParOptVec *g,
                                          ParOptVec **Ac ){
+  if (evalobjcongradientbatch){
+    ParOptScalar *xa, *ga;
+    x->getArray(&xa);
+    g->getArray(&ga);
+
+    // Pass the storage of the gradient vectors directly if they are
+    // contiguous, otherwise use a temporary array
+    ParOptScalar *A = NULL;
+    if (ncon > 0){
+      Ac[0]->getArray(&A);
+      for ( int i = 1; i < ncon; i++ ){
+        ParOptScalar *Ai;
+        Ac[i]->getArray(&Ai);
+        if (Ai != &A[i*nvars]){
+          if (!Abuffer){
+            Abuffer = new ParOptScalar[ ncon*nvars ];
+          }
+          A = Abuffer;
+          break;
+        }
+      }
+    }
+
+    int fail = evalobjcongradientbatch(self, nvars, ncon, xa, ga, A);
+
+    // Copy the values back from the temporary array
+    if (ncon > 0 && A == Abuffer){
+      for ( int i = 0; i < ncon; i++ ){
+        ParOptScalar *Ai;
+        Ac[i]->getArray(&Ai);
+        memcpy(Ai, &A[i*nvars], nvars*sizeof(ParOptScalar));
+      }
+    }
+
+    return fail;
+  }
+
   if (!evalobjcongradient){
     fprintf(stderr, "evalobjcongradient callback not defined\n");
     return 1;
@@ -222,6 +432,27 @@ int CyParOptProblem::evalHvecProduct( ParOptVec *x,
   return fail;
 }
 
+/*
+  Evaluate the product of the Hessian with several vectors
+
+  If the block callback is not defined, the products are evaluated
+  one at a time.
+*/
+int CyParOptProblem::evalHvecProductBlock( ParOptVec *x,
+                                           ParOptScalar *z,
+                                           ParOptVec *zw,
+                                           int nvecs, ParOptVec **px,
+                                           ParOptVec **hvec ){
+  if (!evalhvecproductblock){
+    return ParOptProblem::evalHvecProductBlock(x, z, zw, nvecs, px, hvec);
+  }
+
+  // Evaluate the block Hessian-vector callback
+  int fail = evalhvecproductblock(self, nvars, ncon, nwcon,
+                                  x, z, zw, nvecs, px, hvec);
+  return fail;
+}
+
 /*
   Evaluate the diagonal of the Hessian
 */
@@ -246,6 +477,7 @@ void CyParOptProblem::computeQuasiNewtonUpdateCorrection( ParOptVec *s,
                                                           ParOptVec *y ){
   if (!computequasinewtonupdatecorrection){
     fprintf(stderr, "computequasinewtonupdatecorrection callback not defined\n");
+    return;
   }
 
   // Evaluate the Hessian-vector callback
@@ -273,6 +505,13 @@ void CyParOptProblem::addSparseJacobian( ParOptScalar alpha,
                                          ParOptVec *x,
                                          ParOptVec *px,
                                          ParOptVec *out ){
+  if (jac){
+    ParOptScalar *p, *y;
+    px->getArray(&p);
+    out->getArray(&y);
+    jac->multAdd(alpha, p, y);
+    return;
+  }
   if (!addsparsejacobian){
     fprintf(stderr, "addsparsejacobian callback not defined\n");
     return;
@@ -289,6 +528,13 @@ void CyParOptProblem::addSparseJacobianTranspose( ParOptScalar alpha,
                                                   ParOptVec *x,
                                                   ParOptVec *pzw,
                                                   ParOptVec *out ){
+  if (jac){
+    ParOptScalar *p, *y;
+    pzw->getArray(&p);
+    out->getArray(&y);
+    jac->multTransposeAdd(alpha, p, y);
+    return;
+  }
   if (!addsparsejacobiantranspose){
     fprintf(stderr, "addsparsejacobiantranspose callback not defined\n");
     return;
@@ -306,6 +552,12 @@ void CyParOptProblem::addSparseInnerProduct( ParOptScalar alpha,
                                              ParOptVec *x,
                                              ParOptVec *cvec,
                                              ParOptScalar *A ){
+  if (jac){
+    ParOptScalar *c;
+    cvec->getArray(&c);
+    jac->addInnerProduct(nwblock, alpha, c, A);
+    return;
+  }
   if (!addsparseinnerproduct){
     fprintf(stderr, "addsparseinnerproduct callback not defined\n");
     return;
@@ -314,3 +566,129 @@ void CyParOptProblem::addSparseInnerProduct( ParOptScalar alpha,
   // Evaluate the sparse Jacobian output
   addsparseinnerproduct(self, nvars, nwcon, nwblock, alpha, x, cvec, A);
 }
+
+/**
+  The constructor for the ParOptBatchProblem wrapper
+
+  @param _comm the MPI communicator
+  @param _nprob the number of local problems
+  @param _nvars the number of variables in each problem
+  @param _ncon the number of constraints in each problem
+*/
+CyParOptBatchProblem::CyParOptBatchProblem( MPI_Comm _comm, int _nprob,
+                                            int _nvars, int _ncon ):
+ParOptBatchProblem(_comm, _nprob, _nvars, _ncon){
+  useLower = 1;
+  useUpper = 1;
+
+  self = NULL;
+  getvarsandbounds = NULL;
+  evalobjcon = NULL;
+  evalobjcongradient = NULL;
+}
+
+CyParOptBatchProblem::~CyParOptBatchProblem(){}
+
+/**
+  Set options associated with the bounds
+
+  @param _useLower indicates whether to use the lower bounds
+  @param _useUpper indicates whether to use the upper bounds
+*/
+void CyParOptBatchProblem::setBoundOptions( int _useLower, int _useUpper ){
+  useLower = _useLower;
+  useUpper = _useUpper;
+}
+
+int CyParOptBatchProblem::useLowerBounds(){
+  return useLower;
+}
+
+int CyParOptBatchProblem::useUpperBounds(){
+  return useUpper;
+}
+
+/*
+  Set the member callback functions that are required
+*/
+void CyParOptBatchProblem::setSelfPointer( void *_self ){
+  self = _self;
+}
+
+void CyParOptBatchProblem::setGetVarsAndBounds( void (*func)(void*, int, int,
+                                                             int,
+                                                             ParOptScalar*,
+                                                             ParOptScalar*,
+                                                             ParOptScalar*) ){
+  getvarsandbounds = func;
+}
+
+void CyParOptBatchProblem::setEvalObjCon( void (*func)(void*, int, int, int,
+                                                       const int*, int,
+                                                       const ParOptScalar*,
+                                                       ParOptScalar*,
+                                                       ParOptScalar*,
+                                                       int*) ){
+  evalobjcon = func;
+}
+
+void CyParOptBatchProblem::setEvalObjConGradient( void (*func)(void*, int,
+                                                               int, int,
+                                                               const int*,
+                                                               int,
+                                                               const ParOptScalar*,
+                                                               ParOptScalar*,
+                                                               ParOptScalar*,
+                                                               int*) ){
+  evalobjcongradient = func;
+}
+
+/*
+  Get the variables and bounds for all the problems
+*/
+void CyParOptBatchProblem::getVarsAndBounds( int ld, ParOptScalar *x,
+                                             ParOptScalar *lb,
+                                             ParOptScalar *ub ){
+  if (!getvarsandbounds){
+    fprintf(stderr, "getvarsandbounds callback not defined\n");
+    return;
+  }
+  getvarsandbounds(self, nprob, nvars, ld, x, lb, ub);
+}
+
+/*
+  Evaluate the objectives and constraints of a packed set of problems
+*/
+void CyParOptBatchProblem::evalObjCon( int np, const int *index, int ld,
+                                       const ParOptScalar *x,
+                                       ParOptScalar *fobj,
+                                       ParOptScalar *cons, int *fail ){
+  if (!evalobjcon){
+    fprintf(stderr, "evalobjcon callback not defined\n");
+    for ( int k = 0; k < np; k++ ){
+      fail[k] = 1;
+    }
+    return;
+  }
+  evalobjcon(self, nvars, ncon, np, index, ld, x, fobj, cons, fail);
+}
+
+/*
+  Evaluate the objective and constraint gradients of a packed set of
+  problems
+*/
+void CyParOptBatchProblem::evalObjConGradient( int np, const int *index,
+                                               int ld,
+                                               const ParOptScalar *x,
+                                               ParOptScalar *g,
+                                               ParOptScalar *Ac,
+                                               int *fail ){
+  if (!evalobjcongradient){
+    fprintf(stderr, "evalobjcongradient callback not defined\n");
+    for ( int k = 0; k < np; k++ ){
+      fail[k] = 1;
+    }
+    return;
+  }
+  evalobjcongradient(self, nvars, ncon, np, index, ld, x, g, Ac, fail);
+}
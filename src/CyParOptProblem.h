@@ -2,6 +2,8 @@
 #define PAR_OPT_CYTHON_PROBLEM_H
 
 #include "ParOptProblem.h"
+#include "ParOptBatchProblem.h"
+#include "ParOptSparseJacobian.h"
 
 /**
   This code implements a simplifed interface for the ParOptProblem
@@ -10,10 +12,11 @@
   python layer. These callback functions can then be wrapped and set
   from python.
 
-  Note: The class is currently restricted to utilize only the
-  objective and gradient calculations and not the Hessian code. In
-  addition, the sparse constraints are not implemented. This class
-  then solves the (distributed) optimization problem:
+  The products with the sparse constraint Jacobian are either
+  computed through the callbacks or, when a ParOptSparseJacobian is
+  set, directly from the stored matrix without calling back into
+  python. This class then solves the (distributed) optimization
+  problem:
 
   min    f(x)
   w.r.t. lb <= x <= ub
@@ -75,6 +78,31 @@ class CyParOptProblem : public ParOptProblem {
                                               ParOptVec*,
                                               ParOptScalar*) );
 
+  // Set the optional batched callbacks that operate on arrays
+  // ---------------------------------------------------------
+  void setEvalObjConBatch( int (*func)(void*, int, int, int,
+                                       ParOptScalar**, ParOptScalar*,
+                                       ParOptScalar*, int*) );
+  void setEvalObjConGradientBatch( int (*func)(void*, int, int,
+                                               ParOptScalar*,
+                                               ParOptScalar*,
+                                               ParOptScalar*) );
+  void setEvalHvecProductBlock( int (*func)(void*, int, int, int,
+                                            ParOptVec*, ParOptScalar*,
+                                            ParOptVec*, int,
+                                            ParOptVec**, ParOptVec**) );
+
+  // Set the optional complex-step evaluation callback
+  // -------------------------------------------------
+  void setEvalObjConComplex( int (*func)(void*, int, int,
+                                         const ParOptComplex*,
+                                         ParOptComplex*,
+                                         ParOptComplex*) );
+
+  // Set the native sparse constraint Jacobian
+  // -----------------------------------------
+  void setSparseJacobian( ParOptSparseJacobian *_jac );
+
   // Get the variables and bounds from the problem
   // ---------------------------------------------
   void getVarsAndBounds( ParOptVec *x, ParOptVec *lb,
@@ -85,6 +113,18 @@ class CyParOptProblem : public ParOptProblem {
   int evalObjCon( ParOptVec *x, ParOptScalar *fobj,
                   ParOptScalar *cons );
 
+  // Evaluate the objective and constraints with complex values
+  // -----------------------------------------------------------
+  int useComplexStep();
+  int evalObjConComplex( const ParOptComplex *x, ParOptComplex *fobj,
+                         ParOptComplex *cons );
+
+  // Evaluate the objective and constraints at several points
+  // --------------------------------------------------------
+  int evalObjConBatch( int npts, ParOptVec **x,
+                       ParOptScalar *fobj, ParOptScalar *cons,
+                       int *fail );
+
   // Evaluate the objective and constraint gradients
   // -----------------------------------------------
   int evalObjConGradient( ParOptVec *x,
@@ -96,6 +136,13 @@ class CyParOptProblem : public ParOptProblem {
                        ParOptScalar *z, ParOptVec *zw,
                        ParOptVec *px, ParOptVec *hvec );
 
+  // Evaluate the product of the Hessian with several vectors
+  // --------------------------------------------------------
+  int evalHvecProductBlock( ParOptVec *x,
+                            ParOptScalar *z, ParOptVec *zw,
+                            int nvecs, ParOptVec **px,
+                            ParOptVec **hvec );
+
   // Evaluate the diagonal of the Hessian
   // ------------------------------------
   int evalHessianDiag( ParOptVec *x,
@@ -162,6 +209,37 @@ class CyParOptProblem : public ParOptProblem {
                                  ParOptScalar alpha, ParOptVec *x,
                                  ParOptVec *c, ParOptScalar *A );
 
+  // The batched callbacks: the design points are passed as arrays and
+  // the constraint gradients as a single ncon x nvars array
+  int (*evalobjconbatch)( void *self, int nvars, int ncon, int npts,
+                          ParOptScalar **x, ParOptScalar *fobj,
+                          ParOptScalar *cons, int *fail );
+  int (*evalobjcongradientbatch)( void *self, int nvars, int ncon,
+                                  ParOptScalar *x, ParOptScalar *g,
+                                  ParOptScalar *A );
+
+  // The block Hessian-vector product callback
+  int (*evalhvecproductblock)( void *self, int nvars, int ncon, int nwcon,
+                               ParOptVec *x, ParOptScalar *z,
+                               ParOptVec *zw, int nvecs,
+                               ParOptVec **px, ParOptVec **hvec );
+
+  // The complex-step evaluation callback
+  int (*evalobjconcomplex)( void *self, int nvars, int ncon,
+                            const ParOptComplex *x, ParOptComplex *fobj,
+                            ParOptComplex *cons );
+
+  // The array of design point pointers for the batched evaluation
+  int max_batch_size;
+  ParOptScalar **batch_x;
+
+  // Contiguous storage for the constraint gradients, used only when
+  // the gradient vectors passed in are not stored contiguously
+  ParOptScalar *Abuffer;
+
+  // The native sparse constraint Jacobian (may be NULL)
+  ParOptSparseJacobian *jac;
+
   // Store information about the type of problem to solve
   int isDenseInequal;
   int isSparseInequal;
@@ -169,4 +247,74 @@ class CyParOptProblem : public ParOptProblem {
   int useUpper;
 };
 
+/**
+  The callback interface for the ParOptBatchProblem that is wrapped
+  using Cython. The arrays are passed directly to the callbacks in the
+  structure-of-arrays layout used by the batch optimizer.
+*/
+class CyParOptBatchProblem : public ParOptBatchProblem {
+ public:
+  CyParOptBatchProblem( MPI_Comm _comm, int _nprob,
+                        int _nvars, int _ncon );
+  ~CyParOptBatchProblem();
+
+  // Set the options associated with the bounds
+  // ------------------------------------------
+  void setBoundOptions( int _useLower, int _useUpper );
+  int useLowerBounds();
+  int useUpperBounds();
+
+  // Set the member callback functions that are required
+  // ---------------------------------------------------
+  void setSelfPointer( void *_self );
+  void setGetVarsAndBounds( void (*func)(void*, int, int, int,
+                                         ParOptScalar*, ParOptScalar*,
+                                         ParOptScalar*) );
+  void setEvalObjCon( void (*func)(void*, int, int, int, const int*,
+                                   int, const ParOptScalar*,
+                                   ParOptScalar*, ParOptScalar*,
+                                   int*) );
+  void setEvalObjConGradient( void (*func)(void*, int, int, int,
+                                           const int*, int,
+                                           const ParOptScalar*,
+                                           ParOptScalar*, ParOptScalar*,
+                                           int*) );
+
+  // Get the variables and bounds for all the problems
+  // -------------------------------------------------
+  void getVarsAndBounds( int ld, ParOptScalar *x,
+                         ParOptScalar *lb, ParOptScalar *ub );
+
+  // Evaluate the objectives and constraints
+  // ---------------------------------------
+  void evalObjCon( int np, const int *index, int ld,
+                   const ParOptScalar *x, ParOptScalar *fobj,
+                   ParOptScalar *cons, int *fail );
+
+  // Evaluate the objective and constraint gradients
+  // -----------------------------------------------
+  void evalObjConGradient( int np, const int *index, int ld,
+                           const ParOptScalar *x, ParOptScalar *g,
+                           ParOptScalar *Ac, int *fail );
+
+ private:
+  // The callback functions
+  void *self;
+  void (*getvarsandbounds)( void *self, int nprob, int nvars, int ld,
+                            ParOptScalar *x, ParOptScalar *lb,
+                            ParOptScalar *ub );
+  void (*evalobjcon)( void *self, int nvars, int ncon, int np,
+                      const int *index, int ld, const ParOptScalar *x,
+                      ParOptScalar *fobj, ParOptScalar *cons,
+                      int *fail );
+  void (*evalobjcongradient)( void *self, int nvars, int ncon, int np,
+                              const int *index, int ld,
+                              const ParOptScalar *x, ParOptScalar *g,
+                              ParOptScalar *Ac, int *fail );
+
+  // Store information about the bounds
+  int useLower;
+  int useUpper;
+};
+
 #endif // PAR_OPT_CYTHON_PROBLEM_H
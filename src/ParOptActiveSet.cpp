@@ -0,0 +1,94 @@
+#include <string.h>
+#include "ParOptActiveSet.h"
+
+/**
+  Create the index map with all of the variables free
+
+  @param comm the communicator for the design variables
+  @param nvars the number of local design variables
+*/
+ParOptActiveSet::ParOptActiveSet( MPI_Comm _comm, int _nvars ){
+  comm = _comm;
+  nvars = _nvars;
+  nfree = nvars;
+
+  free_index = new int[ nvars ];
+  for ( int i = 0; i < nvars; i++ ){
+    free_index[i] = i;
+  }
+  work = new ParOptScalar[ nvars ];
+
+  MPI_Allreduce(&nvars, &nvars_global, 1, MPI_INT, MPI_SUM, comm);
+  nfree_global = nvars_global;
+}
+
+/**
+  Free the index map
+*/
+ParOptActiveSet::~ParOptActiveSet(){
+  delete [] free_index;
+  delete [] work;
+}
+
+/**
+  Set the fixed variables. The free and fixed indices are each stored
+  in increasing order. This is a collective call.
+
+  @param fixed flags for each local variable (non-zero = fixed)
+*/
+void ParOptActiveSet::setFixedVars( const int *fixed ){
+  nfree = 0;
+  for ( int i = 0; i < nvars; i++ ){
+    if (!fixed[i]){
+      free_index[nfree] = i;
+      nfree++;
+    }
+  }
+
+  int nfixed = nfree;
+  for ( int i = 0; i < nvars; i++ ){
+    if (fixed[i]){
+      free_index[nfixed] = i;
+      nfixed++;
+    }
+  }
+
+  MPI_Allreduce(&nfree, &nfree_global, 1, MPI_INT, MPI_SUM, comm);
+}
+
+/**
+  Compress the array in place so that the free entries occupy the
+  first nfree entries and the fixed entries occupy the remainder
+
+  @param array the array of length nvars
+*/
+void ParOptActiveSet::compress( ParOptScalar *array ){
+  for ( int i = 0; i < nvars; i++ ){
+    work[i] = array[free_index[i]];
+  }
+  memcpy(array, work, nvars*sizeof(ParOptScalar));
+}
+
+/**
+  Expand the compressed array in place. If the fixed values are
+  provided, they replace the entries in the tail of the compressed
+  array, otherwise the entries in the tail are retained.
+
+  @param array the compressed array of length nvars
+  @param fixed_values the values of the nvars - nfree fixed variables
+*/
+void ParOptActiveSet::expand( ParOptScalar *array,
+                              const ParOptScalar *fixed_values ){
+  memcpy(work, array, nfree*sizeof(ParOptScalar));
+  if (fixed_values){
+    memcpy(&work[nfree], fixed_values, (nvars - nfree)*sizeof(ParOptScalar));
+  }
+  else {
+    memcpy(&work[nfree], &array[nfree],
+           (nvars - nfree)*sizeof(ParOptScalar));
+  }
+
+  for ( int i = 0; i < nvars; i++ ){
+    array[free_index[i]] = work[i];
+  }
+}
@@ -0,0 +1,62 @@
+#ifndef PAR_OPT_ACTIVE_SET_H
+#define PAR_OPT_ACTIVE_SET_H
+
+#include "ParOptVec.h"
+
+/*
+  A distributed index map that partitions the locally owned design
+  variables into free and fixed sets.
+
+  The map is used to compress vectors to the free variables so that
+  the linear algebra in the optimizer only runs over the variables
+  that are not firmly held at a bound. A vector is compressed in place
+  with a stable partition: the free entries are moved to the front of
+  the array, in their original order, and the fixed entries are moved
+  to the back. Operations on the compressed vector only touch the
+  leading nfree entries, so the fixed entries are retained in the tail
+  of the array until the vector is expanded again.
+
+  Each processor owns the map for its local variables. The only
+  communication is the single reduction in setFixedVars() that
+  computes the global number of free variables.
+*/
+class ParOptActiveSet : public ParOptBase {
+ public:
+  ParOptActiveSet( MPI_Comm _comm, int _nvars );
+  ~ParOptActiveSet();
+
+  // Set the fixed variables from the flags (non-zero = fixed)
+  void setFixedVars( const int *fixed );
+
+  // Get the local and global sizes of the free set
+  int getNumVars(){ return nvars; }
+  int getNumFree(){ return nfree; }
+  int getGlobalNumVars(){ return nvars_global; }
+  int getGlobalNumFree(){ return nfree_global; }
+
+  // Get the local indices of the free and fixed variables
+  const int *getFreeIndices(){ return free_index; }
+  const int *getFixedIndices(){ return &free_index[nfree]; }
+
+  // Compress an array of length nvars in place
+  void compress( ParOptScalar *array );
+
+  // Expand a compressed array in place, optionally setting the fixed
+  // entries from the given values
+  void expand( ParOptScalar *array, const ParOptScalar *fixed_values=NULL );
+
+ private:
+  MPI_Comm comm;
+
+  // The local and global number of variables and free variables
+  int nvars, nfree;
+  int nvars_global, nfree_global;
+
+  // The free indices followed by the fixed indices
+  int *free_index;
+
+  // Temporary storage for the permutation
+  ParOptScalar *work;
+};
+
+#endif // PAR_OPT_ACTIVE_SET_H
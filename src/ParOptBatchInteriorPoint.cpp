@@ -0,0 +1,1534 @@
+#include <math.h>
+#include <string.h>
+#include "ParOptComplexStep.h"
+#include "ParOptBatchInteriorPoint.h"
+
+/*
+  The relative distance used to move the starting point inside the
+  bounds
+*/
+static const double PAROPT_BATCH_BOUND_RELAX = 1e-2;
+
+/*
+  The initial value of the slack variables and multipliers
+*/
+static const double PAROPT_BATCH_INIT_MULTIPLIER = 1.0;
+
+/*
+  The smallest pivot permitted in the Cholesky factorization of the
+  condensed matrix
+*/
+static const double PAROPT_BATCH_MIN_PIVOT = 1e-14;
+
+/*
+  The relative tolerance on the merit function used to accept steps
+  when the change in the merit function is dominated by round-off
+*/
+static const double PAROPT_BATCH_MERIT_EPS = 1e-12;
+
+/**
+  Create the batch interior point optimizer
+
+  All the storage for the problems is allocated here so that no
+  allocation takes place during the optimization.
+
+  @param _prob the batch problem
+  @param _max_bound_val the bound magnitude above which a bound is ignored
+*/
+ParOptBatchInteriorPoint::ParOptBatchInteriorPoint( ParOptBatchProblem *_prob,
+                                                    double _max_bound_val ){
+  prob = _prob;
+  prob->incref();
+  comm = prob->getMPIComm();
+  MPI_Comm_rank(comm, &mpi_rank);
+  prob->getProblemSizes(&nprob, &nvars, &ncon);
+
+  // Set the default parameters
+  max_bound_val = _max_bound_val;
+  max_major_iters = 1000;
+  abs_res_tol = 1e-6;
+  init_barrier_param = 0.1;
+  monotone_barrier_fraction = 0.25;
+  monotone_barrier_power = 1.5;
+  max_line_iters = 10;
+  armijo_constant = 1e-5;
+  penalty_descent_fraction = 0.3;
+  min_fraction_to_boundary = 0.95;
+
+  outfp = stdout;
+  output_level = 0;
+
+  neval = ngeval = 0;
+
+  // Set the initial ordering of the problems
+  nactive = nprob;
+  perm = new int[ nprob ];
+  for ( int k = 0; k < nprob; k++ ){
+    perm[k] = k;
+  }
+
+  // Allocate the structure-of-arrays storage
+  int nx = nvars*nprob;
+  int nc = ncon*nprob;
+  x = new ParOptScalar[ nx ];
+  lb = new ParOptScalar[ nx ];
+  ub = new ParOptScalar[ nx ];
+  zl = new ParOptScalar[ nx ];
+  zu = new ParOptScalar[ nx ];
+  lmask = new ParOptScalar[ nx ];
+  umask = new ParOptScalar[ nx ];
+  g = new ParOptScalar[ nx ];
+  Ac = new ParOptScalar[ ncon*nx ];
+  c = new ParOptScalar[ nc ];
+  s = new ParOptScalar[ nc ];
+  z = new ParOptScalar[ nc ];
+  rx = new ParOptScalar[ nx ];
+  rc = new ParOptScalar[ nc ];
+  rs = new ParOptScalar[ nc ];
+  rzl = new ParOptScalar[ nx ];
+  rzu = new ParOptScalar[ nx ];
+  px = new ParOptScalar[ nx ];
+  ps = new ParOptScalar[ nc ];
+  pz = new ParOptScalar[ nc ];
+  pzl = new ParOptScalar[ nx ];
+  pzu = new ParOptScalar[ nx ];
+  B = new ParOptScalar[ nvars*nx ];
+  K = new ParOptScalar[ nvars*nx ];
+  xtemp = new ParOptScalar[ nx ];
+  ytemp = new ParOptScalar[ nx ];
+  wtemp = new ParOptScalar[ nx ];
+  ctemp = new ParOptScalar[ nc ];
+  dtemp = new ParOptScalar[ nc ];
+  etemp = new ParOptScalar[ nc ];
+  xpack = new ParOptScalar[ nx ];
+  cpack = new ParOptScalar[ nc ];
+  fpack = new ParOptScalar[ nprob ];
+  sub = new int[ nprob ];
+  index = new int[ nprob ];
+  fail = new int[ nprob ];
+  pfail = new int[ nprob ];
+
+  fobj = new ParOptScalar[ nprob ];
+  ftemp = new ParOptScalar[ nprob ];
+  barrier_param = new double[ nprob ];
+  rho_penalty_search = new double[ nprob ];
+  max_prime = new double[ nprob ];
+  max_infeas = new double[ nprob ];
+  max_comp = new double[ nprob ];
+  max_mu_res = new double[ nprob ];
+  alpha = new double[ nprob ];
+  alpha_x = new double[ nprob ];
+  alpha_z = new double[ nprob ];
+  merit = new ParOptScalar[ nprob ];
+  dmerit = new ParOptScalar[ nprob ];
+  status = new int[ nprob ];
+  iters = new int[ nprob ];
+
+  memset(status, 0, nprob*sizeof(int));
+  memset(iters, 0, nprob*sizeof(int));
+}
+
+/**
+  Free the data allocated by the batch optimizer
+*/
+ParOptBatchInteriorPoint::~ParOptBatchInteriorPoint(){
+  prob->decref();
+  delete [] perm;
+
+  delete [] x;
+  delete [] lb;
+  delete [] ub;
+  delete [] zl;
+  delete [] zu;
+  delete [] lmask;
+  delete [] umask;
+  delete [] g;
+  delete [] Ac;
+  delete [] c;
+  delete [] s;
+  delete [] z;
+  delete [] rx;
+  delete [] rc;
+  delete [] rs;
+  delete [] rzl;
+  delete [] rzu;
+  delete [] px;
+  delete [] ps;
+  delete [] pz;
+  delete [] pzl;
+  delete [] pzu;
+  delete [] B;
+  delete [] K;
+  delete [] xtemp;
+  delete [] ytemp;
+  delete [] wtemp;
+  delete [] ctemp;
+  delete [] dtemp;
+  delete [] etemp;
+  delete [] xpack;
+  delete [] cpack;
+  delete [] fpack;
+  delete [] sub;
+  delete [] index;
+  delete [] fail;
+  delete [] pfail;
+
+  delete [] fobj;
+  delete [] ftemp;
+  delete [] barrier_param;
+  delete [] rho_penalty_search;
+  delete [] max_prime;
+  delete [] max_infeas;
+  delete [] max_comp;
+  delete [] max_mu_res;
+  delete [] alpha;
+  delete [] alpha_x;
+  delete [] alpha_z;
+  delete [] merit;
+  delete [] dmerit;
+  delete [] status;
+  delete [] iters;
+
+  // Close the output file if it's not stdout
+  if (outfp && outfp != stdout){
+    fclose(outfp);
+  }
+}
+
+/**
+  Get the problem sizes from the underlying problem class
+
+  @param _nprob the number of problems on this processor
+  @param _nvars the number of design variables in each problem
+  @param _ncon the number of dense constraints in each problem
+*/
+void ParOptBatchInteriorPoint::getProblemSizes( int *_nprob, int *_nvars,
+                                                int *_ncon ){
+  prob->getProblemSizes(_nprob, _nvars, _ncon);
+}
+
+/**
+  Retrieve the design variables and multipliers. The arrays are stored
+  in the structure-of-arrays layout with leading dimension nprob, so
+  that entry i of problem k is stored at x[i*nprob + k].
+
+  @param _x the design variables
+  @param _z the dense constraint multipliers
+  @param _zl the lower bound multipliers
+  @param _zu the upper bound multipliers
+*/
+void ParOptBatchInteriorPoint::getOptimizedPoint( ParOptScalar **_x,
+                                                  ParOptScalar **_z,
+                                                  ParOptScalar **_zl,
+                                                  ParOptScalar **_zu ){
+  if (_x){ *_x = x; }
+  if (_z){ *_z = z; }
+  if (_zl){ *_zl = zl; }
+  if (_zu){ *_zu = zu; }
+}
+
+/**
+  Retrieve the objective values, the exit status and the number of
+  iterations for each problem
+
+  @param _fobj the objective values
+  @param _status the exit status of each problem
+  @param _iters the number of iterations for each problem
+*/
+void ParOptBatchInteriorPoint::getProblemStatus( const ParOptScalar **_fobj,
+                                                 const int **_status,
+                                                 const int **_iters ){
+  if (_fobj){ *_fobj = fobj; }
+  if (_status){ *_status = status; }
+  if (_iters){ *_iters = iters; }
+}
+
+/**
+  Set the maximum number of major iterations
+
+  @param max_iters the maximum number of iterations for each problem
+*/
+void ParOptBatchInteriorPoint::setMaxMajorIterations( int max_iters ){
+  if (max_iters >= 1){
+    max_major_iters = max_iters;
+  }
+}
+
+/**
+  Set the absolute KKT tolerance
+
+  @param tol the tolerance on the KKT residual of each problem
+*/
+void ParOptBatchInteriorPoint::setAbsOptimalityTol( double tol ){
+  if (tol < 1e-2 && tol >= 0.0){
+    abs_res_tol = tol;
+  }
+}
+
+/**
+  Set the initial barrier parameter
+
+  @param mu the initial barrier parameter for each problem
+*/
+void ParOptBatchInteriorPoint::setInitBarrierParameter( double mu ){
+  if (mu > 0.0){
+    init_barrier_param = mu;
+  }
+}
+
+/**
+  Set the factor used to reduce the barrier parameter
+
+  @param frac the barrier fraction
+*/
+void ParOptBatchInteriorPoint::setBarrierFraction( double frac ){
+  if (frac > 0.0 && frac < 1.0){
+    monotone_barrier_fraction = frac;
+  }
+}
+
+/**
+  Set the power used to reduce the barrier parameter
+
+  @param power the barrier power
+*/
+void ParOptBatchInteriorPoint::setBarrierPower( double power ){
+  if (power >= 1.0 && power < 10.0){
+    monotone_barrier_power = power;
+  }
+}
+
+/**
+  Set the maximum number of line search iterations
+
+  @param max_iters the maximum number of line search iterations
+*/
+void ParOptBatchInteriorPoint::setMaxLineSearchIters( int max_iters ){
+  if (max_iters > 0){
+    max_line_iters = max_iters;
+  }
+}
+
+/**
+  Set the Armijo parameter for the sufficient decrease condition
+
+  @param c1 the Armijo parameter
+*/
+void ParOptBatchInteriorPoint::setArmijoParam( double c1 ){
+  if (c1 >= 0.0){
+    armijo_constant = c1;
+  }
+}
+
+/**
+  Set the fraction of the infeasibility used to update the penalty
+  parameter
+
+  @param frac the penalty descent fraction
+*/
+void ParOptBatchInteriorPoint::setPenaltyDescentFraction( double frac ){
+  if (frac > 0.0 && frac < 1.0){
+    penalty_descent_fraction = frac;
+  }
+}
+
+/**
+  Set the output file. The summary for all the problems on all the
+  processors is written by the root processor.
+
+  @param filename the output file name
+*/
+void ParOptBatchInteriorPoint::setOutputFile( const char *filename ){
+  if (outfp && outfp != stdout){
+    fclose(outfp);
+  }
+  outfp = NULL;
+
+  if (filename && mpi_rank == 0){
+    outfp = fopen(filename, "w");
+  }
+}
+
+/**
+  Set the output level
+
+  At level 0, the iteration history for the batch is written. At
+  level 1, a line is also written when each problem finishes.
+
+  @param level the output level
+*/
+void ParOptBatchInteriorPoint::setOutputLevel( int level ){
+  output_level = level;
+}
+
+/**
+  Write out all of the options that have been set to a output stream.
+
+  @param fp the output file pointer
+*/
+void ParOptBatchInteriorPoint::printOptionSummary( FILE *fp ){
+  if (fp && mpi_rank == 0){
+    fprintf(fp, "ParOptBatch: Parameter values\n");
+    fprintf(fp, "%-30s %15d\n", "local problems", nprob);
+    fprintf(fp, "%-30s %15d\n", "variables per problem", nvars);
+    fprintf(fp, "%-30s %15d\n", "constraints per problem", ncon);
+    fprintf(fp, "%-30s %15d\n", "max_major_iters", max_major_iters);
+    fprintf(fp, "%-30s %15g\n", "abs_res_tol", abs_res_tol);
+    fprintf(fp, "%-30s %15g\n", "init_barrier_param", init_barrier_param);
+    fprintf(fp, "%-30s %15g\n", "monotone_barrier_fraction",
+            monotone_barrier_fraction);
+    fprintf(fp, "%-30s %15g\n", "monotone_barrier_power",
+            monotone_barrier_power);
+    fprintf(fp, "%-30s %15d\n", "max_line_iters", max_line_iters);
+    fprintf(fp, "%-30s %15g\n", "armijo_constant", armijo_constant);
+    fprintf(fp, "%-30s %15g\n", "penalty_descent_fraction",
+            penalty_descent_fraction);
+    fprintf(fp, "%-30s %15g\n", "min_fraction_to_boundary",
+            min_fraction_to_boundary);
+  }
+}
+
+/*
+  Evaluate the objectives and constraints for a subset of the active
+  columns.
+
+  The design variables for the columns in sub are packed into a
+  contiguous block, evaluated together, and the results are scattered
+  back into the columns of ft and ct. The fail flag for each column is
+  stored in the fail array.
+
+  input:
+  nsub:  the number of columns to evaluate
+  sub:   the column indices
+  xt:    the design variables for all the columns
+
+  output:
+  ft:    the objective values in the evaluated columns
+  ct:    the constraint values in the evaluated columns
+
+  returns: the number of failed evaluations
+*/
+int ParOptBatchInteriorPoint::evalObjCon( int nsub, const int *sub,
+                                          const ParOptScalar *xt,
+                                          ParOptScalar *ft,
+                                          ParOptScalar *ct ){
+  if (nsub <= 0){
+    return 0;
+  }
+
+  for ( int q = 0; q < nsub; q++ ){
+    index[q] = perm[sub[q]];
+  }
+  for ( int i = 0; i < nvars; i++ ){
+    const ParOptScalar *xi = &xt[i*nprob];
+    ParOptScalar *xp = &xpack[i*nprob];
+    for ( int q = 0; q < nsub; q++ ){
+      xp[q] = xi[sub[q]];
+    }
+  }
+
+  memset(pfail, 0, nsub*sizeof(int));
+  prob->evalObjCon(nsub, index, nprob, xpack, fpack, cpack, pfail);
+  neval += nsub;
+
+  int nfail = 0;
+  for ( int q = 0; q < nsub; q++ ){
+    ft[sub[q]] = fpack[q];
+    fail[sub[q]] = pfail[q];
+    if (pfail[q]){
+      nfail++;
+    }
+  }
+  for ( int j = 0; j < ncon; j++ ){
+    const ParOptScalar *cp = &cpack[j*nprob];
+    ParOptScalar *cj = &ct[j*nprob];
+    for ( int q = 0; q < nsub; q++ ){
+      cj[sub[q]] = cp[q];
+    }
+  }
+
+  return nfail;
+}
+
+/*
+  Evaluate the objective and constraint gradients for all the active
+  columns. The active columns are contiguous so the data is passed
+  directly without packing. Problems that have failed must be retired
+  before this call so that they are not evaluated.
+
+  returns: the number of failed evaluations
+*/
+int ParOptBatchInteriorPoint::evalObjConGradient(){
+  if (nactive <= 0){
+    return 0;
+  }
+
+  memset(fail, 0, nactive*sizeof(int));
+  prob->evalObjConGradient(nactive, perm, nprob, x, g, Ac, fail);
+  ngeval += nactive;
+
+  int nfail = 0;
+  for ( int k = 0; k < nactive; k++ ){
+    if (fail[k]){
+      nfail++;
+    }
+  }
+
+  return nfail;
+}
+
+/*
+  Initialize the starting point, slack variables and multipliers
+
+  The starting point is moved inside the bounds, and the bounds with a
+  magnitude larger than max_bound_val are ignored. The problems that
+  cannot be evaluated at the starting point are retired immediately.
+
+  returns: the number of failed evaluations
+*/
+int ParOptBatchInteriorPoint::initStartingPoint(){
+  prob->getVarsAndBounds(nprob, x, lb, ub);
+
+  int use_lower = prob->useLowerBounds();
+  int use_upper = prob->useUpperBounds();
+
+  for ( int i = 0; i < nvars*nprob; i++ ){
+    lmask[i] = umask[i] = 0.0;
+    if (use_lower && ParOptRealPart(lb[i]) > -max_bound_val){
+      lmask[i] = 1.0;
+    }
+    else {
+      lb[i] = -max_bound_val;
+    }
+    if (use_upper && ParOptRealPart(ub[i]) < max_bound_val){
+      umask[i] = 1.0;
+    }
+    else {
+      ub[i] = max_bound_val;
+    }
+
+    // Move the starting point inside the bounds
+    double lrelax = PAROPT_BATCH_BOUND_RELAX*(1.0 + fabs(ParOptRealPart(lb[i])));
+    double urelax = PAROPT_BATCH_BOUND_RELAX*(1.0 + fabs(ParOptRealPart(ub[i])));
+    if (lmask[i] != 0.0 && umask[i] != 0.0){
+      double width = ParOptRealPart(ub[i] - lb[i]);
+      if (lrelax > 0.25*width){ lrelax = 0.25*width; }
+      if (urelax > 0.25*width){ urelax = 0.25*width; }
+    }
+    if (lmask[i] != 0.0 && ParOptRealPart(x[i] - lb[i]) < lrelax){
+      x[i] = lb[i] + lrelax;
+    }
+    if (umask[i] != 0.0 && ParOptRealPart(ub[i] - x[i]) < urelax){
+      x[i] = ub[i] - urelax;
+    }
+
+    zl[i] = PAROPT_BATCH_INIT_MULTIPLIER*lmask[i];
+    zu[i] = PAROPT_BATCH_INIT_MULTIPLIER*umask[i];
+  }
+
+  // Set the initial Hessian approximations to the identity
+  memset(B, 0, nvars*nvars*nprob*sizeof(ParOptScalar));
+  for ( int i = 0; i < nvars; i++ ){
+    ParOptScalar *Bii = &B[(i*nvars + i)*nprob];
+    for ( int k = 0; k < nprob; k++ ){
+      Bii[k] = 1.0;
+    }
+  }
+
+  for ( int k = 0; k < nprob; k++ ){
+    barrier_param[k] = init_barrier_param;
+    rho_penalty_search[k] = 0.0;
+    alpha[k] = alpha_x[k] = alpha_z[k] = 0.0;
+    status[k] = PAROPT_BATCH_ACTIVE;
+    iters[k] = 0;
+    sub[k] = k;
+  }
+
+  // Evaluate the objective and constraints at the starting point
+  int nfail = evalObjCon(nactive, sub, x, fobj, c);
+  for ( int k = 0; k < nactive; k++ ){
+    if (fail[k]){
+      status[k] = PAROPT_BATCH_EVAL_FAILURE;
+    }
+  }
+  retireProblems();
+
+  // Evaluate the gradients of the remaining problems
+  nfail += evalObjConGradient();
+  for ( int k = 0; k < nactive; k++ ){
+    if (fail[k]){
+      status[k] = PAROPT_BATCH_EVAL_FAILURE;
+    }
+  }
+  retireProblems();
+
+  // Initialize the slack variables and the multipliers
+  for ( int j = 0; j < ncon; j++ ){
+    const ParOptScalar *cj = &c[j*nprob];
+    ParOptScalar *sj = &s[j*nprob];
+    ParOptScalar *zj = &z[j*nprob];
+    for ( int k = 0; k < nactive; k++ ){
+      sj[k] = PAROPT_BATCH_INIT_MULTIPLIER;
+      if (ParOptRealPart(cj[k]) > PAROPT_BATCH_INIT_MULTIPLIER){
+        sj[k] = cj[k];
+      }
+      zj[k] = PAROPT_BATCH_INIT_MULTIPLIER;
+    }
+  }
+
+  return nfail;
+}
+
+/*
+  Compute the residuals of the perturbed KKT conditions for the active
+  problems along with the norms of the residuals:
+
+  max_prime:  the infinity norm of the gradient of the Lagrangian
+  max_infeas: the infinity norm of the constraint infeasibility
+  max_comp:   the largest complementarity product
+  max_mu_res: the infinity norm of the perturbed complementarity
+*/
+void ParOptBatchInteriorPoint::computeKKTRes(){
+  for ( int k = 0; k < nactive; k++ ){
+    max_prime[k] = max_infeas[k] = max_comp[k] = max_mu_res[k] = 0.0;
+  }
+
+  for ( int i = 0; i < nvars; i++ ){
+    const ParOptScalar *gi = &g[i*nprob];
+    const ParOptScalar *xi = &x[i*nprob];
+    const ParOptScalar *lbi = &lb[i*nprob];
+    const ParOptScalar *ubi = &ub[i*nprob];
+    const ParOptScalar *zli = &zl[i*nprob];
+    const ParOptScalar *zui = &zu[i*nprob];
+    const ParOptScalar *lmi = &lmask[i*nprob];
+    const ParOptScalar *umi = &umask[i*nprob];
+    ParOptScalar *rxi = &rx[i*nprob];
+    ParOptScalar *rzli = &rzl[i*nprob];
+    ParOptScalar *rzui = &rzu[i*nprob];
+
+    for ( int k = 0; k < nactive; k++ ){
+      rxi[k] = -(gi[k] - zli[k] + zui[k]);
+    }
+    for ( int j = 0; j < ncon; j++ ){
+      const ParOptScalar *aji = &Ac[(j*nvars + i)*nprob];
+      const ParOptScalar *zj = &z[j*nprob];
+      for ( int k = 0; k < nactive; k++ ){
+        rxi[k] += aji[k]*zj[k];
+      }
+    }
+
+    for ( int k = 0; k < nactive; k++ ){
+      double mu = barrier_param[k];
+      ParOptScalar cl = lmi[k]*(xi[k] - lbi[k])*zli[k];
+      ParOptScalar cu = umi[k]*(ubi[k] - xi[k])*zui[k];
+      rzli[k] = lmi[k]*mu - cl;
+      rzui[k] = umi[k]*mu - cu;
+
+      double rp = fabs(ParOptRealPart(rxi[k]));
+      double rl = fabs(ParOptRealPart(rzli[k]));
+      double ru = fabs(ParOptRealPart(rzui[k]));
+      double pl = ParOptRealPart(cl);
+      double pu = ParOptRealPart(cu);
+      max_prime[k] = (rp > max_prime[k] ? rp : max_prime[k]);
+      max_mu_res[k] = (rl > max_mu_res[k] ? rl : max_mu_res[k]);
+      max_mu_res[k] = (ru > max_mu_res[k] ? ru : max_mu_res[k]);
+      max_comp[k] = (pl > max_comp[k] ? pl : max_comp[k]);
+      max_comp[k] = (pu > max_comp[k] ? pu : max_comp[k]);
+    }
+  }
+
+  for ( int j = 0; j < ncon; j++ ){
+    const ParOptScalar *cj = &c[j*nprob];
+    const ParOptScalar *sj = &s[j*nprob];
+    const ParOptScalar *zj = &z[j*nprob];
+    ParOptScalar *rcj = &rc[j*nprob];
+    ParOptScalar *rsj = &rs[j*nprob];
+
+    for ( int k = 0; k < nactive; k++ ){
+      ParOptScalar cs = sj[k]*zj[k];
+      rcj[k] = -(cj[k] - sj[k]);
+      rsj[k] = barrier_param[k] - cs;
+
+      double ri = fabs(ParOptRealPart(rcj[k]));
+      double rm = fabs(ParOptRealPart(rsj[k]));
+      double pc = ParOptRealPart(cs);
+      max_infeas[k] = (ri > max_infeas[k] ? ri : max_infeas[k]);
+      max_mu_res[k] = (rm > max_mu_res[k] ? rm : max_mu_res[k]);
+      max_comp[k] = (pc > max_comp[k] ? pc : max_comp[k]);
+    }
+  }
+}
+
+/*
+  Update the barrier parameter of each active problem using the
+  monotone strategy. The barrier parameter is reduced once the
+  residuals of the barrier problem are less than ten times the barrier
+  parameter.
+
+  returns: the number of problems with a new barrier parameter
+*/
+int ParOptBatchInteriorPoint::updateBarrierParameter(){
+  int nupdate = 0;
+  for ( int k = 0; k < nactive; k++ ){
+    double mu = barrier_param[k];
+    double res = max_prime[k];
+    if (max_infeas[k] > res){ res = max_infeas[k]; }
+    if (max_mu_res[k] > res){ res = max_mu_res[k]; }
+
+    if (res < 10.0*mu && mu > 0.1*abs_res_tol){
+      double mu_frac = monotone_barrier_fraction*mu;
+      double mu_pow = pow(mu, monotone_barrier_power);
+      double new_mu = (mu_frac < mu_pow ? mu_frac : mu_pow);
+      if (new_mu < 0.09999*abs_res_tol){
+        new_mu = 0.09999*abs_res_tol;
+      }
+      barrier_param[k] = new_mu;
+      nupdate++;
+    }
+  }
+
+  return nupdate;
+}
+
+/*
+  Compute the KKT step for all the active problems.
+
+  The bound multiplier, slack and constraint multiplier steps are
+  eliminated to give the condensed system:
+
+  (B + Dx + A^{T}*D*A)*px = rx + A^{T}*w + (X - Xl)^{-1}*rzl
+                                         - (Xu - X)^{-1}*rzu
+
+  where D = Z*S^{-1} and w = S^{-1}*(Z*rc + rs). The condensed matrix
+  is factored in place with a Cholesky factorization. The remaining
+  components of the step are recovered from:
+
+  pz = w - D*A*px
+  ps = Z^{-1}*(rs - S*pz)
+  pzl = (X - Xl)^{-1}*(rzl - Zl*px)
+  pzu = (Xu - X)^{-1}*(rzu + Zu*px)
+*/
+void ParOptBatchInteriorPoint::computeKKTStep(){
+  // Copy the Hessian approximations into the condensed matrices
+  for ( int ij = 0; ij < nvars*nvars; ij++ ){
+    const ParOptScalar *Bij = &B[ij*nprob];
+    ParOptScalar *Kij = &K[ij*nprob];
+    for ( int k = 0; k < nactive; k++ ){
+      Kij[k] = Bij[k];
+    }
+  }
+
+  // Compute D and w for the constraints
+  for ( int j = 0; j < ncon; j++ ){
+    const ParOptScalar *sj = &s[j*nprob];
+    const ParOptScalar *zj = &z[j*nprob];
+    const ParOptScalar *rcj = &rc[j*nprob];
+    const ParOptScalar *rsj = &rs[j*nprob];
+    ParOptScalar *dj = &dtemp[j*nprob];
+    ParOptScalar *wj = &etemp[j*nprob];
+    for ( int k = 0; k < nactive; k++ ){
+      dj[k] = zj[k]/sj[k];
+      wj[k] = (zj[k]*rcj[k] + rsj[k])/sj[k];
+    }
+  }
+
+  // Add the diagonal contributions and form the right-hand-side
+  for ( int i = 0; i < nvars; i++ ){
+    const ParOptScalar *xi = &x[i*nprob];
+    const ParOptScalar *lbi = &lb[i*nprob];
+    const ParOptScalar *ubi = &ub[i*nprob];
+    const ParOptScalar *zli = &zl[i*nprob];
+    const ParOptScalar *zui = &zu[i*nprob];
+    const ParOptScalar *rxi = &rx[i*nprob];
+    const ParOptScalar *rzli = &rzl[i*nprob];
+    const ParOptScalar *rzui = &rzu[i*nprob];
+    ParOptScalar *Kii = &K[(i*nvars + i)*nprob];
+    ParOptScalar *bi = &px[i*nprob];
+
+    for ( int k = 0; k < nactive; k++ ){
+      ParOptScalar dl = 1.0/(xi[k] - lbi[k]);
+      ParOptScalar du = 1.0/(ubi[k] - xi[k]);
+      Kii[k] += zli[k]*dl + zui[k]*du;
+      bi[k] = rxi[k] + rzli[k]*dl - rzui[k]*du;
+    }
+
+    for ( int j = 0; j < ncon; j++ ){
+      const ParOptScalar *aji = &Ac[(j*nvars + i)*nprob];
+      const ParOptScalar *wj = &etemp[j*nprob];
+      for ( int k = 0; k < nactive; k++ ){
+        bi[k] += aji[k]*wj[k];
+      }
+    }
+  }
+
+  // Add the constraint contributions to the lower triangular part
+  for ( int j = 0; j < ncon; j++ ){
+    const ParOptScalar *dj = &dtemp[j*nprob];
+    for ( int i = 0; i < nvars; i++ ){
+      const ParOptScalar *aji = &Ac[(j*nvars + i)*nprob];
+      ParOptScalar *w = &wtemp[i*nprob];
+      for ( int k = 0; k < nactive; k++ ){
+        w[k] = dj[k]*aji[k];
+      }
+      for ( int l = 0; l <= i; l++ ){
+        const ParOptScalar *ajl = &Ac[(j*nvars + l)*nprob];
+        ParOptScalar *Kil = &K[(i*nvars + l)*nprob];
+        for ( int k = 0; k < nactive; k++ ){
+          Kil[k] += w[k]*ajl[k];
+        }
+      }
+    }
+  }
+
+  // Factor the lower triangular part K = L*L^{T} in place
+  for ( int i = 0; i < nvars; i++ ){
+    ParOptScalar *Kii = &K[(i*nvars + i)*nprob];
+    for ( int l = 0; l < i; l++ ){
+      const ParOptScalar *Lil = &K[(i*nvars + l)*nprob];
+      for ( int k = 0; k < nactive; k++ ){
+        Kii[k] -= Lil[k]*Lil[k];
+      }
+    }
+    for ( int k = 0; k < nactive; k++ ){
+      // The matrix is not numerically positive definite. The problem
+      // is flagged as failed, and the pivot is replaced so that the
+      // arithmetic for the remaining columns stays finite.
+      if (ParOptRealPart(Kii[k]) < PAROPT_BATCH_MIN_PIVOT){
+        Kii[k] = 1.0;
+        status[k] = PAROPT_BATCH_FACTOR_FAILURE;
+      }
+      Kii[k] = sqrt(Kii[k]);
+    }
+
+    for ( int j = i+1; j < nvars; j++ ){
+      ParOptScalar *Lji = &K[(j*nvars + i)*nprob];
+      for ( int l = 0; l < i; l++ ){
+        const ParOptScalar *Ljl = &K[(j*nvars + l)*nprob];
+        const ParOptScalar *Lil = &K[(i*nvars + l)*nprob];
+        for ( int k = 0; k < nactive; k++ ){
+          Lji[k] -= Ljl[k]*Lil[k];
+        }
+      }
+      for ( int k = 0; k < nactive; k++ ){
+        Lji[k] /= Kii[k];
+      }
+    }
+  }
+
+  // Solve L*y = b
+  for ( int i = 0; i < nvars; i++ ){
+    ParOptScalar *yi = &px[i*nprob];
+    for ( int l = 0; l < i; l++ ){
+      const ParOptScalar *Lil = &K[(i*nvars + l)*nprob];
+      const ParOptScalar *yl = &px[l*nprob];
+      for ( int k = 0; k < nactive; k++ ){
+        yi[k] -= Lil[k]*yl[k];
+      }
+    }
+    const ParOptScalar *Lii = &K[(i*nvars + i)*nprob];
+    for ( int k = 0; k < nactive; k++ ){
+      yi[k] /= Lii[k];
+    }
+  }
+
+  // Solve L^{T}*px = y
+  for ( int i = nvars-1; i >= 0; i-- ){
+    ParOptScalar *pi = &px[i*nprob];
+    for ( int l = i+1; l < nvars; l++ ){
+      const ParOptScalar *Lli = &K[(l*nvars + i)*nprob];
+      const ParOptScalar *pl = &px[l*nprob];
+      for ( int k = 0; k < nactive; k++ ){
+        pi[k] -= Lli[k]*pl[k];
+      }
+    }
+    const ParOptScalar *Lii = &K[(i*nvars + i)*nprob];
+    for ( int k = 0; k < nactive; k++ ){
+      pi[k] /= Lii[k];
+    }
+  }
+
+  // Recover the constraint multiplier and slack steps
+  for ( int j = 0; j < ncon; j++ ){
+    const ParOptScalar *sj = &s[j*nprob];
+    const ParOptScalar *zj = &z[j*nprob];
+    const ParOptScalar *rsj = &rs[j*nprob];
+    const ParOptScalar *dj = &dtemp[j*nprob];
+    const ParOptScalar *wj = &etemp[j*nprob];
+    ParOptScalar *pzj = &pz[j*nprob];
+    ParOptScalar *psj = &ps[j*nprob];
+
+    for ( int k = 0; k < nactive; k++ ){
+      pzj[k] = 0.0;
+    }
+    for ( int i = 0; i < nvars; i++ ){
+      const ParOptScalar *aji = &Ac[(j*nvars + i)*nprob];
+      const ParOptScalar *pi = &px[i*nprob];
+      for ( int k = 0; k < nactive; k++ ){
+        pzj[k] += aji[k]*pi[k];
+      }
+    }
+    for ( int k = 0; k < nactive; k++ ){
+      pzj[k] = wj[k] - dj[k]*pzj[k];
+      psj[k] = (rsj[k] - sj[k]*pzj[k])/zj[k];
+    }
+  }
+
+  // Recover the bound multiplier steps
+  for ( int i = 0; i < nvars; i++ ){
+    const ParOptScalar *xi = &x[i*nprob];
+    const ParOptScalar *lbi = &lb[i*nprob];
+    const ParOptScalar *ubi = &ub[i*nprob];
+    const ParOptScalar *zli = &zl[i*nprob];
+    const ParOptScalar *zui = &zu[i*nprob];
+    const ParOptScalar *rzli = &rzl[i*nprob];
+    const ParOptScalar *rzui = &rzu[i*nprob];
+    const ParOptScalar *pi = &px[i*nprob];
+    ParOptScalar *pzli = &pzl[i*nprob];
+    ParOptScalar *pzui = &pzu[i*nprob];
+
+    for ( int k = 0; k < nactive; k++ ){
+      pzli[k] = (rzli[k] - zli[k]*pi[k])/(xi[k] - lbi[k]);
+      pzui[k] = (rzui[k] + zui[k]*pi[k])/(ubi[k] - xi[k]);
+    }
+  }
+}
+
+/*
+  Compute the maximum primal and dual step lengths for each active
+  problem that satisfy the fraction-to-the-boundary rule
+*/
+void ParOptBatchInteriorPoint::computeMaxStep(){
+  for ( int k = 0; k < nactive; k++ ){
+    alpha_x[k] = alpha_z[k] = 1.0;
+  }
+
+  for ( int i = 0; i < nvars; i++ ){
+    const ParOptScalar *xi = &x[i*nprob];
+    const ParOptScalar *lbi = &lb[i*nprob];
+    const ParOptScalar *ubi = &ub[i*nprob];
+    const ParOptScalar *zli = &zl[i*nprob];
+    const ParOptScalar *zui = &zu[i*nprob];
+    const ParOptScalar *lmi = &lmask[i*nprob];
+    const ParOptScalar *umi = &umask[i*nprob];
+    const ParOptScalar *pi = &px[i*nprob];
+    const ParOptScalar *pzli = &pzl[i*nprob];
+    const ParOptScalar *pzui = &pzu[i*nprob];
+
+    for ( int k = 0; k < nactive; k++ ){
+      double tau = 1.0 - barrier_param[k];
+      if (tau < min_fraction_to_boundary){
+        tau = min_fraction_to_boundary;
+      }
+
+      double p = ParOptRealPart(pi[k]);
+      if (p < 0.0 && ParOptRealPart(lmi[k]) != 0.0){
+        double a = -tau*ParOptRealPart(xi[k] - lbi[k])/p;
+        alpha_x[k] = (a < alpha_x[k] ? a : alpha_x[k]);
+      }
+      else if (p > 0.0 && ParOptRealPart(umi[k]) != 0.0){
+        double a = tau*ParOptRealPart(ubi[k] - xi[k])/p;
+        alpha_x[k] = (a < alpha_x[k] ? a : alpha_x[k]);
+      }
+
+      double pl = ParOptRealPart(pzli[k]);
+      if (pl < 0.0){
+        double a = -tau*ParOptRealPart(zli[k])/pl;
+        alpha_z[k] = (a < alpha_z[k] ? a : alpha_z[k]);
+      }
+      double pu = ParOptRealPart(pzui[k]);
+      if (pu < 0.0){
+        double a = -tau*ParOptRealPart(zui[k])/pu;
+        alpha_z[k] = (a < alpha_z[k] ? a : alpha_z[k]);
+      }
+    }
+  }
+
+  for ( int j = 0; j < ncon; j++ ){
+    const ParOptScalar *sj = &s[j*nprob];
+    const ParOptScalar *zj = &z[j*nprob];
+    const ParOptScalar *psj = &ps[j*nprob];
+    const ParOptScalar *pzj = &pz[j*nprob];
+
+    for ( int k = 0; k < nactive; k++ ){
+      double tau = 1.0 - barrier_param[k];
+      if (tau < min_fraction_to_boundary){
+        tau = min_fraction_to_boundary;
+      }
+
+      double p = ParOptRealPart(psj[k]);
+      if (p < 0.0){
+        double a = -tau*ParOptRealPart(sj[k])/p;
+        alpha_x[k] = (a < alpha_x[k] ? a : alpha_x[k]);
+      }
+      double pm = ParOptRealPart(pzj[k]);
+      if (pm < 0.0){
+        double a = -tau*ParOptRealPart(zj[k])/pm;
+        alpha_z[k] = (a < alpha_z[k] ? a : alpha_z[k]);
+      }
+    }
+  }
+}
+
+/*
+  Perform a backtracking line search on the l1 penalty merit function
+  for all the active problems and update the iterates.
+
+  The merit function for each problem is
+
+  phi(x, s) = f(x) - mu*sum(log(s)) - mu*sum(log(x - lb))
+            - mu*sum(log(ub - x)) + rho*||c(x) - s||_{1}
+
+  The penalty parameter is increased so that the step is a descent
+  direction. If the step is still not a descent direction, the
+  backtracking continues until the merit function decreases. All the
+  problems that have not yet satisfied the sufficient decrease
+  condition are evaluated together. When the maximum number of line
+  search iterations is reached, the last step is accepted. Problems
+  that fail to evaluate on the last iteration are flagged as failed.
+*/
+void ParOptBatchInteriorPoint::lineSearch(){
+  // Compute the merit function, the barrier contribution to the
+  // directional derivative and the infeasibility
+  for ( int k = 0; k < nactive; k++ ){
+    merit[k] = fobj[k];
+    dmerit[k] = 0.0;
+    ftemp[k] = 0.0;
+  }
+
+  for ( int i = 0; i < nvars; i++ ){
+    const ParOptScalar *xi = &x[i*nprob];
+    const ParOptScalar *lbi = &lb[i*nprob];
+    const ParOptScalar *ubi = &ub[i*nprob];
+    const ParOptScalar *lmi = &lmask[i*nprob];
+    const ParOptScalar *umi = &umask[i*nprob];
+    const ParOptScalar *gi = &g[i*nprob];
+    const ParOptScalar *pi = &px[i*nprob];
+
+    for ( int k = 0; k < nactive; k++ ){
+      double mu = barrier_param[k];
+      merit[k] -= mu*(lmi[k]*log(xi[k] - lbi[k]) +
+                      umi[k]*log(ubi[k] - xi[k]));
+      dmerit[k] += (gi[k] - mu*lmi[k]/(xi[k] - lbi[k]) +
+                    mu*umi[k]/(ubi[k] - xi[k]))*pi[k];
+    }
+  }
+
+  for ( int j = 0; j < ncon; j++ ){
+    const ParOptScalar *cj = &c[j*nprob];
+    const ParOptScalar *sj = &s[j*nprob];
+    const ParOptScalar *psj = &ps[j*nprob];
+
+    for ( int k = 0; k < nactive; k++ ){
+      double mu = barrier_param[k];
+      merit[k] -= mu*log(sj[k]);
+      dmerit[k] -= mu*psj[k]/sj[k];
+      ftemp[k] += fabs(ParOptRealPart(cj[k] - sj[k]));
+    }
+  }
+
+  // Update the penalty parameter so that the step is a descent
+  // direction and add the penalty contribution
+  for ( int k = 0; k < nactive; k++ ){
+    double infeas = ParOptRealPart(ftemp[k]);
+    double dm = ParOptRealPart(dmerit[k]);
+    if (infeas > 0.0){
+      double rho = dm/((1.0 - penalty_descent_fraction)*infeas);
+      if (rho > rho_penalty_search[k]){
+        rho_penalty_search[k] = rho;
+      }
+    }
+    merit[k] += rho_penalty_search[k]*infeas;
+    dmerit[k] -= rho_penalty_search[k]*infeas;
+    alpha[k] = alpha_x[k];
+  }
+
+  // Search all the active columns
+  int nsub = nactive;
+  for ( int k = 0; k < nactive; k++ ){
+    sub[k] = k;
+  }
+
+  for ( int line_iter = 0; line_iter < max_line_iters && nsub > 0;
+        line_iter++ ){
+    // Compute the trial points for all the active columns
+    for ( int i = 0; i < nvars; i++ ){
+      const ParOptScalar *xi = &x[i*nprob];
+      const ParOptScalar *pi = &px[i*nprob];
+      ParOptScalar *xt = &xtemp[i*nprob];
+      for ( int k = 0; k < nactive; k++ ){
+        xt[k] = xi[k] + alpha[k]*pi[k];
+      }
+    }
+
+    evalObjCon(nsub, sub, xtemp, ftemp, ctemp);
+
+    // Check the sufficient decrease condition for the searched columns
+    int last_iter = (line_iter == max_line_iters-1);
+    int nnext = 0;
+    for ( int q = 0; q < nsub; q++ ){
+      int k = sub[q];
+      double mu = barrier_param[k];
+
+      if (fail[k]){
+        if (!last_iter){
+          alpha[k] *= 0.5;
+          sub[nnext] = k;
+          nnext++;
+        }
+        continue;
+      }
+
+      ParOptScalar m = ftemp[k];
+      for ( int i = 0; i < nvars; i++ ){
+        int ik = i*nprob + k;
+        m -= mu*(lmask[ik]*log(xtemp[ik] - lb[ik]) +
+                 umask[ik]*log(ub[ik] - xtemp[ik]));
+      }
+      for ( int j = 0; j < ncon; j++ ){
+        int jk = j*nprob + k;
+        ParOptScalar st = s[jk] + alpha[k]*ps[jk];
+        m -= mu*log(st);
+        m += rho_penalty_search[k]*fabs(ParOptRealPart(ctemp[jk] - st));
+      }
+
+      // When the step is not a descent direction, only require that
+      // the merit function decreases
+      double m0 = ParOptRealPart(merit[k]);
+      double tol = PAROPT_BATCH_MERIT_EPS*(1.0 + fabs(m0));
+      double slope = ParOptRealPart(dmerit[k]);
+      if (slope >= 0.0){
+        slope = 0.0;
+        tol = 0.0;
+      }
+      if (!last_iter &&
+          ParOptRealPart(m) > m0 + tol + armijo_constant*alpha[k]*slope){
+        alpha[k] *= 0.5;
+        sub[nnext] = k;
+        nnext++;
+      }
+    }
+    nsub = nnext;
+  }
+
+  // Update the iterates of all the active columns
+  for ( int k = 0; k < nactive; k++ ){
+    if (fail[k]){
+      status[k] = PAROPT_BATCH_EVAL_FAILURE;
+      alpha[k] = 0.0;
+      alpha_z[k] = 0.0;
+    }
+    else {
+      fobj[k] = ftemp[k];
+    }
+  }
+
+  for ( int i = 0; i < nvars; i++ ){
+    const ParOptScalar *pi = &px[i*nprob];
+    const ParOptScalar *pzli = &pzl[i*nprob];
+    const ParOptScalar *pzui = &pzu[i*nprob];
+    ParOptScalar *xi = &x[i*nprob];
+    ParOptScalar *zli = &zl[i*nprob];
+    ParOptScalar *zui = &zu[i*nprob];
+    ParOptScalar *si = &xtemp[i*nprob];
+
+    for ( int k = 0; k < nactive; k++ ){
+      si[k] = alpha[k]*pi[k];
+      xi[k] += si[k];
+      zli[k] += alpha_z[k]*pzli[k];
+      zui[k] += alpha_z[k]*pzui[k];
+    }
+  }
+
+  for ( int j = 0; j < ncon; j++ ){
+    const ParOptScalar *psj = &ps[j*nprob];
+    const ParOptScalar *pzj = &pz[j*nprob];
+    const ParOptScalar *ctj = &ctemp[j*nprob];
+    ParOptScalar *cj = &c[j*nprob];
+    ParOptScalar *sj = &s[j*nprob];
+    ParOptScalar *zj = &z[j*nprob];
+
+    for ( int k = 0; k < nactive; k++ ){
+      sj[k] += alpha[k]*psj[k];
+      zj[k] += alpha_z[k]*pzj[k];
+      if (!fail[k]){
+        cj[k] = ctj[k];
+      }
+    }
+  }
+}
+
+/*
+  Evaluate the gradients at the new point and update the dense
+  Hessian approximations with a damped BFGS update.
+
+  The step is stored in xtemp by the line search. The difference in
+  the gradient of the Lagrangian is computed with the new multipliers.
+  The first update of each problem scales the initial identity matrix
+  by y^{T}*y/s^{T}*y.
+*/
+void ParOptBatchInteriorPoint::updateHessian(){
+  // Compute the negative gradient of the Lagrangian at the old point
+  for ( int i = 0; i < nvars; i++ ){
+    const ParOptScalar *gi = &g[i*nprob];
+    ParOptScalar *yi = &ytemp[i*nprob];
+    for ( int k = 0; k < nactive; k++ ){
+      yi[k] = -gi[k];
+    }
+    for ( int j = 0; j < ncon; j++ ){
+      const ParOptScalar *aji = &Ac[(j*nvars + i)*nprob];
+      const ParOptScalar *zj = &z[j*nprob];
+      for ( int k = 0; k < nactive; k++ ){
+        yi[k] += aji[k]*zj[k];
+      }
+    }
+  }
+
+  // Evaluate the gradients at the new point
+  if (evalObjConGradient() > 0){
+    for ( int k = 0; k < nactive; k++ ){
+      if (fail[k]){
+        status[k] = PAROPT_BATCH_EVAL_FAILURE;
+      }
+    }
+  }
+
+  // Complete the difference in the gradient of the Lagrangian
+  for ( int i = 0; i < nvars; i++ ){
+    const ParOptScalar *gi = &g[i*nprob];
+    ParOptScalar *yi = &ytemp[i*nprob];
+    for ( int k = 0; k < nactive; k++ ){
+      yi[k] += gi[k];
+    }
+    for ( int j = 0; j < ncon; j++ ){
+      const ParOptScalar *aji = &Ac[(j*nvars + i)*nprob];
+      const ParOptScalar *zj = &z[j*nprob];
+      for ( int k = 0; k < nactive; k++ ){
+        yi[k] -= aji[k]*zj[k];
+      }
+    }
+  }
+
+  // Compute s^{T}*y, y^{T}*y and s^{T}*s
+  ParOptScalar *sy = ctemp, *yy = dtemp, *ss = etemp;
+  for ( int k = 0; k < nactive; k++ ){
+    sy[k] = yy[k] = ss[k] = 0.0;
+  }
+  for ( int i = 0; i < nvars; i++ ){
+    const ParOptScalar *si = &xtemp[i*nprob];
+    const ParOptScalar *yi = &ytemp[i*nprob];
+    for ( int k = 0; k < nactive; k++ ){
+      sy[k] += si[k]*yi[k];
+      yy[k] += yi[k]*yi[k];
+      ss[k] += si[k]*si[k];
+    }
+  }
+
+  // Scale the initial approximation on the first update
+  for ( int k = 0; k < nactive; k++ ){
+    if (iters[k] == 0 && ParOptRealPart(sy[k]) > 0.0){
+      ftemp[k] = yy[k]/sy[k];
+    }
+    else {
+      ftemp[k] = 1.0;
+    }
+  }
+  for ( int ij = 0; ij < nvars*nvars; ij++ ){
+    ParOptScalar *Bij = &B[ij*nprob];
+    for ( int k = 0; k < nactive; k++ ){
+      Bij[k] *= ftemp[k];
+    }
+  }
+
+  // Compute B*s and s^{T}*B*s
+  ParOptScalar *sBs = merit;
+  for ( int k = 0; k < nactive; k++ ){
+    sBs[k] = 0.0;
+  }
+  for ( int i = 0; i < nvars; i++ ){
+    ParOptScalar *wi = &wtemp[i*nprob];
+    for ( int k = 0; k < nactive; k++ ){
+      wi[k] = 0.0;
+    }
+    for ( int l = 0; l < nvars; l++ ){
+      const ParOptScalar *Bil = &B[(i*nvars + l)*nprob];
+      const ParOptScalar *sl = &xtemp[l*nprob];
+      for ( int k = 0; k < nactive; k++ ){
+        wi[k] += Bil[k]*sl[k];
+      }
+    }
+    const ParOptScalar *si = &xtemp[i*nprob];
+    for ( int k = 0; k < nactive; k++ ){
+      sBs[k] += si[k]*wi[k];
+    }
+  }
+
+  // Compute the damping parameter theta so that r = theta*y +
+  // (1 - theta)*B*s satisfies s^{T}*r >= 0.2*s^{T}*B*s. Skip the
+  // update when the step is zero.
+  ParOptScalar *theta = ftemp, *sr = dmerit;
+  for ( int k = 0; k < nactive; k++ ){
+    theta[k] = 1.0;
+    sr[k] = sy[k];
+    if (ParOptRealPart(ss[k]) <= 0.0 ||
+        ParOptRealPart(sBs[k]) <= 0.0){
+      theta[k] = 0.0;
+      sr[k] = 0.0;
+    }
+    else if (ParOptRealPart(sy[k]) < 0.2*ParOptRealPart(sBs[k])){
+      theta[k] = 0.8*sBs[k]/(sBs[k] - sy[k]);
+      sr[k] = theta[k]*sy[k] + (1.0 - theta[k])*sBs[k];
+    }
+  }
+
+  // Form r in ytemp
+  for ( int i = 0; i < nvars; i++ ){
+    const ParOptScalar *wi = &wtemp[i*nprob];
+    ParOptScalar *yi = &ytemp[i*nprob];
+    for ( int k = 0; k < nactive; k++ ){
+      yi[k] = theta[k]*yi[k] + (1.0 - theta[k])*wi[k];
+    }
+  }
+
+  // Compute the inverse scalar factors, using zero for skipped updates
+  for ( int k = 0; k < nactive; k++ ){
+    if (ParOptRealPart(sr[k]) > 0.0){
+      sr[k] = 1.0/sr[k];
+      sBs[k] = 1.0/sBs[k];
+    }
+    else {
+      sr[k] = 0.0;
+      sBs[k] = 0.0;
+    }
+  }
+
+  // B <- B + r*r^{T}/s^{T}*r - B*s*s^{T}*B/s^{T}*B*s
+  for ( int i = 0; i < nvars; i++ ){
+    const ParOptScalar *ri = &ytemp[i*nprob];
+    const ParOptScalar *wi = &wtemp[i*nprob];
+    for ( int l = 0; l < nvars; l++ ){
+      const ParOptScalar *rl = &ytemp[l*nprob];
+      const ParOptScalar *wl = &wtemp[l*nprob];
+      ParOptScalar *Bil = &B[(i*nvars + l)*nprob];
+      for ( int k = 0; k < nactive; k++ ){
+        Bil[k] += sr[k]*ri[k]*rl[k] - sBs[k]*wi[k]*wl[k];
+      }
+    }
+  }
+}
+
+/*
+  Swap the entries for the columns k1 and k2 in an array stored with
+  leading dimension nprob
+*/
+void ParOptBatchInteriorPoint::swapArray( ParOptScalar *array, int size,
+                                          int k1, int k2 ){
+  for ( int i = 0; i < size; i++ ){
+    ParOptScalar t = array[i*nprob + k1];
+    array[i*nprob + k1] = array[i*nprob + k2];
+    array[i*nprob + k2] = t;
+  }
+}
+
+/*
+  Swap the two columns of all the data that is retained between
+  iterations
+*/
+void ParOptBatchInteriorPoint::swapColumns( int k1, int k2 ){
+  if (k1 == k2){
+    return;
+  }
+
+  swapArray(x, nvars, k1, k2);
+  swapArray(lb, nvars, k1, k2);
+  swapArray(ub, nvars, k1, k2);
+  swapArray(zl, nvars, k1, k2);
+  swapArray(zu, nvars, k1, k2);
+  swapArray(lmask, nvars, k1, k2);
+  swapArray(umask, nvars, k1, k2);
+  swapArray(g, nvars, k1, k2);
+  swapArray(Ac, ncon*nvars, k1, k2);
+  swapArray(c, ncon, k1, k2);
+  swapArray(s, ncon, k1, k2);
+  swapArray(z, ncon, k1, k2);
+  swapArray(B, nvars*nvars, k1, k2);
+  swapArray(fobj, 1, k1, k2);
+
+  // Swap the step and the step taken by the line search so that the
+  // problems can be retired within an iteration
+  swapArray(px, nvars, k1, k2);
+  swapArray(pzl, nvars, k1, k2);
+  swapArray(pzu, nvars, k1, k2);
+  swapArray(ps, ncon, k1, k2);
+  swapArray(pz, ncon, k1, k2);
+  swapArray(xtemp, nvars, k1, k2);
+
+  double t;
+  t = barrier_param[k1];
+  barrier_param[k1] = barrier_param[k2];  barrier_param[k2] = t;
+  t = rho_penalty_search[k1];
+  rho_penalty_search[k1] = rho_penalty_search[k2];  rho_penalty_search[k2] = t;
+  t = max_prime[k1];  max_prime[k1] = max_prime[k2];  max_prime[k2] = t;
+  t = max_infeas[k1];  max_infeas[k1] = max_infeas[k2];  max_infeas[k2] = t;
+  t = max_comp[k1];  max_comp[k1] = max_comp[k2];  max_comp[k2] = t;
+  t = alpha[k1];  alpha[k1] = alpha[k2];  alpha[k2] = t;
+
+  int tmp;
+  tmp = status[k1];  status[k1] = status[k2];  status[k2] = tmp;
+  tmp = iters[k1];  iters[k1] = iters[k2];  iters[k2] = tmp;
+  tmp = perm[k1];  perm[k1] = perm[k2];  perm[k2] = tmp;
+}
+
+/*
+  Move the columns of the problems that are no longer active to the
+  end of the active set
+*/
+void ParOptBatchInteriorPoint::retireProblems(){
+  int k = 0;
+  while (k < nactive){
+    if (status[k] != PAROPT_BATCH_ACTIVE){
+      if (outfp && mpi_rank == 0 && output_level > 0){
+        const char *exit_status = "converged";
+        if (status[k] == PAROPT_BATCH_MAX_ITERATIONS){
+          exit_status = "reached the iteration limit";
+        }
+        else if (status[k] == PAROPT_BATCH_EVAL_FAILURE){
+          exit_status = "failed to evaluate";
+        }
+        else if (status[k] == PAROPT_BATCH_FACTOR_FAILURE){
+          exit_status = "failed to factor the KKT matrix";
+        }
+        fprintf(outfp, "ParOptBatch: Problem %d %s after %d iterations "
+                "fobj = %15.8e\n", perm[k], exit_status, iters[k],
+                ParOptRealPart(fobj[k]));
+      }
+      swapColumns(k, nactive-1);
+      nactive--;
+    }
+    else {
+      k++;
+    }
+  }
+}
+
+/*
+  Restore the original problem order so that column k contains the
+  data for problem k
+*/
+void ParOptBatchInteriorPoint::restoreProblemOrder(){
+  for ( int k = 0; k < nprob; k++ ){
+    while (perm[k] != k){
+      swapColumns(k, perm[k]);
+    }
+  }
+}
+
+/**
+  Optimize all the problems in the batch
+
+  The problems are advanced together until each problem converges,
+  reaches the iteration limit or fails to evaluate. The iteration
+  history is written by the root processor for its local problems.
+  At the end, a summary of the exit status of all the problems on all
+  processors is written.
+
+  @return 0 if all the local problems converged, 1 otherwise
+*/
+int ParOptBatchInteriorPoint::optimize(){
+  FILE *fp = (mpi_rank == 0 ? outfp : NULL);
+
+  double t0 = MPI_Wtime();
+  neval = ngeval = 0;
+  nactive = nprob;
+  for ( int k = 0; k < nprob; k++ ){
+    perm[k] = k;
+  }
+
+  initStartingPoint();
+
+  for ( int iter = 0; nactive > 0; iter++ ){
+    computeKKTRes();
+
+    // Retire the problems that have converged or reached the limit
+    for ( int k = 0; k < nactive; k++ ){
+      double res = max_prime[k];
+      if (max_infeas[k] > res){ res = max_infeas[k]; }
+      if (max_comp[k] > res){ res = max_comp[k]; }
+      if (status[k] != PAROPT_BATCH_ACTIVE){
+        continue;
+      }
+      else if (res < abs_res_tol){
+        status[k] = PAROPT_BATCH_CONVERGED;
+      }
+      else if (iters[k] >= max_major_iters){
+        status[k] = PAROPT_BATCH_MAX_ITERATIONS;
+      }
+    }
+    retireProblems();
+    if (nactive == 0){
+      break;
+    }
+
+    // Write the largest residuals of the remaining problems
+    if (fp){
+      if (iter % 10 == 0){
+        fprintf(fp, "\n%4s %6s %4s %4s %7s %7s %7s %7s %7s %7s\n",
+                "iter", "nact", "nobj", "ngrd", "alpha", "|opt|",
+                "|infes|", "comp", "min mu", "max mu");
+      }
+      double alpha_min = 1.0, res[3] = {0.0, 0.0, 0.0};
+      double mu_min = init_barrier_param, mu_max = 0.0;
+      for ( int k = 0; k < nactive; k++ ){
+        if (alpha[k] < alpha_min){ alpha_min = alpha[k]; }
+        if (max_prime[k] > res[0]){ res[0] = max_prime[k]; }
+        if (max_infeas[k] > res[1]){ res[1] = max_infeas[k]; }
+        if (max_comp[k] > res[2]){ res[2] = max_comp[k]; }
+        if (barrier_param[k] < mu_min){ mu_min = barrier_param[k]; }
+        if (barrier_param[k] > mu_max){ mu_max = barrier_param[k]; }
+      }
+      fprintf(fp, "%4d %6d %4d %4d %7.1e %7.1e %7.1e %7.1e %7.1e %7.1e\n",
+              iter, nactive, neval, ngeval, alpha_min,
+              res[0], res[1], res[2], mu_min, mu_max);
+      fflush(fp);
+    }
+
+    if (updateBarrierParameter() > 0){
+      computeKKTRes();
+    }
+
+    // Retire the problems whose KKT matrix could not be factored
+    computeKKTStep();
+    retireProblems();
+
+    // Retire the problems that failed to evaluate before the gradients
+    // are evaluated at the new point
+    computeMaxStep();
+    lineSearch();
+    retireProblems();
+    updateHessian();
+
+    for ( int k = 0; k < nactive; k++ ){
+      iters[k]++;
+    }
+  }
+
+  restoreProblemOrder();
+
+  // Count the exit status of all the problems
+  int counts[5] = {0, 0, 0, 0, 0}, total[5];
+  for ( int k = 0; k < nprob; k++ ){
+    counts[status[k]]++;
+  }
+  MPI_Reduce(counts, total, 5, MPI_INT, MPI_SUM, 0, comm);
+
+  if (fp){
+    fprintf(fp, "\nParOptBatch: %d problems converged, %d reached the "
+            "iteration limit, %d failed to evaluate, %d failed to factor\n",
+            total[PAROPT_BATCH_CONVERGED], total[PAROPT_BATCH_MAX_ITERATIONS],
+            total[PAROPT_BATCH_EVAL_FAILURE],
+            total[PAROPT_BATCH_FACTOR_FAILURE]);
+    fprintf(fp, "ParOptBatch: Optimization time %15.8e\n", MPI_Wtime() - t0);
+    fflush(fp);
+  }
+
+  return (counts[PAROPT_BATCH_CONVERGED] != nprob);
+}
@@ -0,0 +1,203 @@
+#ifndef PAR_OPT_BATCH_INTERIOR_POINT_H
+#define PAR_OPT_BATCH_INTERIOR_POINT_H
+
+#include <stdio.h>
+#include "ParOptBatchProblem.h"
+
+/*
+  The exit status of each problem in the batch
+*/
+enum ParOptBatchStatus { PAROPT_BATCH_ACTIVE,
+                         PAROPT_BATCH_CONVERGED,
+                         PAROPT_BATCH_MAX_ITERATIONS,
+                         PAROPT_BATCH_EVAL_FAILURE,
+                         PAROPT_BATCH_FACTOR_FAILURE };
+
+/*
+  An interior-point method that advances an ensemble of small,
+  independent problems with the same shape in lockstep.
+
+  Each problem is solved with a primal-dual interior-point method for
+  the perturbed KKT conditions:
+
+  g(x) - A(x)^{T}*z - zl + zu = 0
+  c(x) - s = 0
+  S*z - mu*e = 0
+  (X - Xl)*zl - mu*e = 0
+  (Xu - X)*zu - mu*e = 0
+
+  The problems are small, so each one uses a dense, damped BFGS
+  Hessian approximation B. The step is found from the condensed system
+
+  (B + Dx + A^{T}*Z*S^{-1}*A)*px = bx
+
+  where Dx is the diagonal contribution from the bound multipliers. The
+  condensed matrix is factored with a dense Cholesky factorization. A
+  problem whose condensed matrix is not numerically positive definite
+  is retired with the PAROPT_BATCH_FACTOR_FAILURE status.
+  The barrier parameter is updated separately for each problem using
+  the monotone strategy and the step is globalized with a backtracking
+  line search on an l1 penalty merit function.
+
+  Instead of storing a separate set of vectors for each problem, all
+  the data is stored in a structure-of-arrays layout where entry i of
+  every problem is contiguous in memory. All the per-problem loops run
+  innermost over the problems, so that the arithmetic for the whole
+  batch is vectorized by the compiler. The columns of the active
+  problems are kept at the front of the arrays: when a problem
+  converges, or otherwise finishes, its column is swapped with the last
+  active column so that the remaining iterations only operate on the
+  problems that are still active.
+
+  The problems on each processor are independent, so the iterations
+  do not communicate. The only collective operation is the reduction
+  for the summary at the end of optimize().
+*/
+class ParOptBatchInteriorPoint : public ParOptBase {
+ public:
+  ParOptBatchInteriorPoint( ParOptBatchProblem *_prob,
+                            double _max_bound_val=1e20 );
+  ~ParOptBatchInteriorPoint();
+
+  // Perform the optimization
+  // ------------------------
+  int optimize();
+
+  // Get the problem sizes from the underlying problem class
+  // -------------------------------------------------------
+  void getProblemSizes( int *_nprob, int *_nvars, int *_ncon );
+
+  // Retrieve the design variables and multipliers. The arrays are
+  // stored with leading dimension nprob, in the original problem order
+  // ------------------------------------------------------------------
+  void getOptimizedPoint( ParOptScalar **_x, ParOptScalar **_z,
+                          ParOptScalar **_zl, ParOptScalar **_zu );
+
+  // Retrieve the objective values, the exit status and the number of
+  // iterations of each problem
+  // ----------------------------------------------------------------
+  void getProblemStatus( const ParOptScalar **_fobj, const int **_status,
+                         const int **_iters );
+
+  // Set optimizer parameters
+  // ------------------------
+  void setMaxMajorIterations( int max_iters );
+  void setAbsOptimalityTol( double tol );
+  void setInitBarrierParameter( double mu );
+  void setBarrierFraction( double frac );
+  void setBarrierPower( double power );
+  void setMaxLineSearchIters( int max_iters );
+  void setArmijoParam( double c1 );
+  void setPenaltyDescentFraction( double frac );
+
+  // Set parameters for the output
+  // -----------------------------
+  void setOutputFile( const char *filename );
+  void setOutputLevel( int level );
+
+  // Print the optimizer options to a file
+  // -------------------------------------
+  void printOptionSummary( FILE *fp );
+
+ private:
+  // Initialize the starting point and multipliers
+  int initStartingPoint();
+
+  // Evaluate the objective and constraints for a subset of the active
+  // columns, or the gradients for all the active columns
+  int evalObjCon( int nsub, const int *sub, const ParOptScalar *xt,
+                  ParOptScalar *ft, ParOptScalar *ct );
+  int evalObjConGradient();
+
+  // Compute the residuals, their norms and update the barrier parameter
+  void computeKKTRes();
+  int updateBarrierParameter();
+
+  // Compute the step
+  void computeKKTStep();
+  void computeMaxStep();
+
+  // Perform the line search and update the iterate
+  void lineSearch();
+
+  // Evaluate the gradients at the new point and update the Hessian
+  // approximations
+  void updateHessian();
+
+  // Move the finished problems to the end of the active set
+  void retireProblems();
+  void swapColumns( int k1, int k2 );
+  void swapArray( ParOptScalar *array, int size, int k1, int k2 );
+
+  // Restore the original order of the output data
+  void restoreProblemOrder();
+
+  // The problem and its communicator
+  ParOptBatchProblem *prob;
+  MPI_Comm comm;
+  int mpi_rank;
+
+  // The problem sizes. Each array is stored with leading dimension nprob
+  int nprob, nvars, ncon;
+
+  // The number of active problems and the problem in each column
+  int nactive;
+  int *perm;
+
+  // Optimizer parameters
+  double max_bound_val;
+  int max_major_iters;
+  double abs_res_tol;
+  double init_barrier_param;
+  double monotone_barrier_fraction;
+  double monotone_barrier_power;
+  int max_line_iters;
+  double armijo_constant;
+  double penalty_descent_fraction;
+  double min_fraction_to_boundary;
+
+  // Output parameters
+  FILE *outfp;
+  int output_level;
+
+  // The design variables, bounds and bound multipliers (nvars x nprob)
+  ParOptScalar *x, *lb, *ub, *zl, *zu;
+
+  // Flags for the bounds that are used (nvars x nprob)
+  ParOptScalar *lmask, *umask;
+
+  // The objective and constraint gradients
+  ParOptScalar *g, *Ac;
+
+  // The constraint values, slacks and multipliers (ncon x nprob)
+  ParOptScalar *c, *s, *z;
+
+  // The residuals and steps
+  ParOptScalar *rx, *rc, *rs, *rzl, *rzu;
+  ParOptScalar *px, *ps, *pz, *pzl, *pzu;
+
+  // The dense Hessian approximations and condensed matrices
+  // (nvars x nvars x nprob)
+  ParOptScalar *B, *K;
+
+  // Temporary storage for the step, line search and Hessian update
+  ParOptScalar *xtemp, *ytemp, *wtemp;
+  ParOptScalar *ctemp, *dtemp, *etemp;
+
+  // Storage for the packed evaluations
+  ParOptScalar *xpack, *cpack, *fpack;
+  int *sub, *index, *fail, *pfail;
+
+  // The number of batched evaluations
+  int neval, ngeval;
+
+  // The per-problem scalar data (nprob)
+  ParOptScalar *fobj, *ftemp;
+  double *barrier_param, *rho_penalty_search;
+  double *max_prime, *max_infeas, *max_comp, *max_mu_res;
+  double *alpha, *alpha_x, *alpha_z;
+  ParOptScalar *merit, *dmerit;
+  int *status, *iters;
+};
+
+#endif // PAR_OPT_BATCH_INTERIOR_POINT_H
@@ -0,0 +1,141 @@
+#ifndef PAR_OPT_BATCH_PROBLEM_H
+#define PAR_OPT_BATCH_PROBLEM_H
+
+#include "ParOptVec.h"
+
+/*
+  The problem definition for an ensemble of independent, same-shaped
+  optimization problems that are solved together.
+
+  Each processor owns nprob problems, each with nvars design variables
+  and ncon dense inequality constraints:
+
+  min    f_k(x_k)
+  w.r.t. lb_k <= x_k <= ub_k
+  s.t.   c_k(x_k) >= 0
+
+  The problems are never distributed across processors, so none of the
+  calls below are collective.
+
+  All of the data is passed in a structure-of-arrays layout where the
+  entries for the different problems are contiguous. An array with a
+  leading dimension ld stores entry i of the problem in column k at
+  array[i*ld + k]. The constraint values are stored as cons[j*ld + k]
+  and the constraint gradients are stored as
+  Ac[(j*nvars + i)*ld + k].
+
+  The evaluation functions are called with a packed set of np <= nprob
+  problems. The index array gives the problem number of each column so
+  that column k contains the data for problem index[k]. The fail flag
+  for each column must be set to a non-zero value if the problem cannot
+  be evaluated at the given point.
+
+  input:
+  comm:   the communicator
+  nprob:  the number of local problems
+  nvars:  the number of design variables in each problem
+  ncon:   the number of dense inequality constraints in each problem
+*/
+class ParOptBatchProblem : public ParOptBase {
+ public:
+  /**
+    Create the batch problem
+
+    @param _comm the MPI communicator
+    @param _nprob the number of problems on this processor
+    @param _nvars the number of design variables in each problem
+    @param _ncon the number of dense constraints in each problem
+  */
+  ParOptBatchProblem( MPI_Comm _comm, int _nprob,
+                      int _nvars, int _ncon ){
+    comm = _comm;
+    nprob = _nprob;
+    nvars = _nvars;
+    ncon = _ncon;
+  }
+  virtual ~ParOptBatchProblem(){}
+
+  /**
+    Get the communicator for the problem
+
+    @return the MPI communicator for the problem
+  */
+  MPI_Comm getMPIComm(){
+    return comm;
+  }
+
+  /**
+    Get the problem sizes
+
+    @param _nprob the number of problems on this processor
+    @param _nvars the number of design variables in each problem
+    @param _ncon the number of dense constraints in each problem
+  */
+  void getProblemSizes( int *_nprob, int *_nvars, int *_ncon ){
+    if (_nprob){ *_nprob = nprob; }
+    if (_nvars){ *_nvars = nvars; }
+    if (_ncon){ *_ncon = ncon; }
+  }
+
+  /**
+    Indicate whether to use the lower variable bounds. Default is true.
+
+    @return flag indicating whether to use lower variable bound.
+  */
+  virtual int useLowerBounds(){ return 1; }
+
+  /**
+    Indicate whether to use the upper variable bounds. Default is true.
+
+    @return flag indicating whether to use upper variable bounds.
+  */
+  virtual int useUpperBounds(){ return 1; }
+
+  /**
+    Get the starting point and the bounds for all the problems
+
+    @param ld the leading dimension of the arrays (equal to nprob)
+    @param x the starting point
+    @param lb the lower bounds
+    @param ub the upper bounds
+  */
+  virtual void getVarsAndBounds( int ld, ParOptScalar *x,
+                                 ParOptScalar *lb, ParOptScalar *ub ) = 0;
+
+  /**
+    Evaluate the objectives and constraints of a packed set of problems
+
+    @param np the number of problems to evaluate
+    @param index the problem number of each column
+    @param ld the leading dimension of the arrays
+    @param x the design variables
+    @param fobj the objective values (length np)
+    @param cons the constraint values
+    @param fail the fail flags (length np)
+  */
+  virtual void evalObjCon( int np, const int *index, int ld,
+                           const ParOptScalar *x, ParOptScalar *fobj,
+                           ParOptScalar *cons, int *fail ) = 0;
+
+  /**
+    Evaluate the objective and constraint gradients of a packed set of
+    problems
+
+    @param np the number of problems to evaluate
+    @param index the problem number of each column
+    @param ld the leading dimension of the arrays
+    @param x the design variables
+    @param g the objective gradients
+    @param Ac the constraint gradients
+    @param fail the fail flags (length np)
+  */
+  virtual void evalObjConGradient( int np, const int *index, int ld,
+                                   const ParOptScalar *x, ParOptScalar *g,
+                                   ParOptScalar *Ac, int *fail ) = 0;
+
+ protected:
+  MPI_Comm comm;
+  int nprob, nvars, ncon;
+};
+
+#endif // PAR_OPT_BATCH_PROBLEM_H
@@ -9,19 +9,33 @@
 #define BLASdnrm2    dznrm2_
 #define BLASdaxpy    zaxpy_
 #define BLASdscal    zscal_
+#define BLASdgemm    zgemm_
+#define BLASdsyrk    zsyrk_
 #define LAPACKdgetrf zgetrf_
 #define LAPACKdgetrs zgetrs_
 #define LAPACKdpptrf zpptrf_
 #define LAPACKdpptrs zpptrs_
+#define LAPACKdpotrf zpotrf_
+#define LAPACKdpotrs zpotrs_
+#define LAPACKdsytrf zsytrf_
+#define LAPACKdsytrs zsytrs_
+#define LAPACKdgeev  dgeev_
 #else
 #define BLASddot     ddot_
 #define BLASdnrm2    dnrm2_
 #define BLASdaxpy    daxpy_
 #define BLASdscal    dscal_
+#define BLASdgemm    dgemm_
+#define BLASdsyrk    dsyrk_
 #define LAPACKdgetrf dgetrf_
 #define LAPACKdgetrs dgetrs_
 #define LAPACKdpptrf dpptrf_
 #define LAPACKdpptrs dpptrs_
+#define LAPACKdpotrf dpotrf_
+#define LAPACKdpotrs dpotrs_
+#define LAPACKdsytrf dsytrf_
+#define LAPACKdsytrs dsytrs_
+#define LAPACKdgeev  dgeev_
 #endif // PAROPT_USE_COMPLEX
 
 extern "C" {
@@ -31,6 +45,14 @@ extern "C" {
   extern void BLASdaxpy( int *n, ParOptScalar *a, ParOptScalar *x, int *incx,
                          ParOptScalar *y, int *incy );
   extern void BLASdscal( int *n, ParOptScalar *a, ParOptScalar *x, int *incx );
+  extern void BLASdgemm( const char *ta, const char *tb,
+                         int *m, int *n, int *k,
+                         ParOptScalar *alpha, ParOptScalar *a, int *lda,
+                         ParOptScalar *b, int *ldb,
+                         ParOptScalar *beta, ParOptScalar *c, int *ldc );
+  extern void BLASdsyrk( const char *uplo, const char *ta, int *n, int *k,
+                         ParOptScalar *alpha, ParOptScalar *a, int *lda,
+                         ParOptScalar *beta, ParOptScalar *c, int *ldc );
 
   // General factorization routines
   extern void LAPACKdgetrf( int *m, int *n,
@@ -39,11 +61,31 @@ extern "C" {
                             ParOptScalar *a, int *lda, int *ipiv,
                             ParOptScalar *b, int *ldb, int *info );
 
+  // Symmetric factorization routines
+  extern void LAPACKdpotrf( const char *c, int *n, ParOptScalar *a, int *lda,
+                            int *info );
+  extern void LAPACKdpotrs( const char *c, int *n, int *nrhs,
+                            ParOptScalar *a, int *lda,
+                            ParOptScalar *b, int *ldb, int *info );
+  extern void LAPACKdsytrf( const char *c, int *n, ParOptScalar *a, int *lda,
+                            int *ipiv, ParOptScalar *work, int *lwork,
+                            int *info );
+  extern void LAPACKdsytrs( const char *c, int *n, int *nrhs,
+                            ParOptScalar *a, int *lda, int *ipiv,
+                            ParOptScalar *b, int *ldb, int *info );
+
   // Factorization of packed-storage matrices
   extern void LAPACKdpptrf( const char *c, int *n, ParOptScalar *ap, int *info );
   extern void LAPACKdpptrs( const char *c, int *n, int *nrhs,
                             ParOptScalar *ap, ParOptScalar *rhs,
                             int *ldrhs, int *info );
+
+  // Eigenvalues of a general real matrix. This is always real, even
+  // in the complex build, since it is only used on real parts.
+  extern void LAPACKdgeev( const char *jobvl, const char *jobvr, int *n,
+                           double *a, int *lda, double *wr, double *wi,
+                           double *vl, int *ldvl, double *vr, int *ldvr,
+                           double *work, int *lwork, int *info );
 }
 
 #endif
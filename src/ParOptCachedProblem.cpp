@@ -0,0 +1,516 @@
+#include <string.h>
+#include "ParOptCachedProblem.h"
+#include "ParOptProfiler.h"
+
+/**
+  Create the cache for the given problem
+
+  @param prob the problem to wrap
+  @param max_entries the maximum number of stored points
+*/
+ParOptCachedProblem::ParOptCachedProblem( ParOptProblem *_prob,
+                                          int _max_entries ):
+ParOptProblem(_prob->getMPIComm()){
+  prob = _prob;
+  prob->incref();
+
+  // Copy the problem sizes
+  int _nvars, _ncon, _nwcon, _nwblock;
+  prob->getProblemSizes(&_nvars, &_ncon, &_nwcon, &_nwblock);
+  setProblemSizes(_nvars, _ncon, _nwcon, _nwblock);
+
+  // The entries are tracked with the bits of an unsigned integer mask
+  max_entries = _max_entries;
+  if (max_entries < 1){
+    max_entries = 1;
+  }
+  else if (max_entries > PAROPT_MAX_CACHE_ENTRIES){
+    max_entries = PAROPT_MAX_CACHE_ENTRIES;
+  }
+  num_entries = 0;
+
+  xvals = new ParOptVec*[ max_entries ];
+  hashes = new unsigned long[ max_entries ];
+  fvals = new ParOptScalar[ max_entries ];
+  cvals = new ParOptScalar[ max_entries*ncon ];
+  has_gradient = new int[ max_entries ];
+  gvals = new ParOptVec*[ max_entries ];
+  Avals = new ParOptVec**[ max_entries ];
+  last_used = new int[ max_entries ];
+  for ( int k = 0; k < max_entries; k++ ){
+    xvals[k] = NULL;
+    hashes[k] = 0;
+    has_gradient[k] = 0;
+    gvals[k] = NULL;
+    Avals[k] = NULL;
+    last_used[k] = 0;
+  }
+  counter = 0;
+  last_eval = -1;
+
+  objcon_hits = objcon_misses = 0;
+  grad_hits = grad_misses = 0;
+}
+
+/**
+  Free the stored points and the wrapped problem
+*/
+ParOptCachedProblem::~ParOptCachedProblem(){
+  for ( int k = 0; k < max_entries; k++ ){
+    if (xvals[k]){
+      xvals[k]->decref();
+    }
+    if (gvals[k]){
+      gvals[k]->decref();
+    }
+    if (Avals[k]){
+      for ( int i = 0; i < ncon; i++ ){
+        Avals[k][i]->decref();
+      }
+      delete [] Avals[k];
+    }
+  }
+  delete [] xvals;
+  delete [] hashes;
+  delete [] fvals;
+  delete [] cvals;
+  delete [] has_gradient;
+  delete [] gvals;
+  delete [] Avals;
+  delete [] last_used;
+
+  prob->decref();
+}
+
+/**
+  Clear all of the stored points. The storage is retained.
+*/
+void ParOptCachedProblem::clearCache(){
+  num_entries = 0;
+  last_eval = -1;
+  for ( int k = 0; k < max_entries; k++ ){
+    has_gradient[k] = 0;
+  }
+}
+
+/**
+  Get the number of hits and misses for the function and gradient
+  evaluations
+
+  @param objcon_hits the number of objective/constraint cache hits
+  @param objcon_misses the number of objective/constraint cache misses
+  @param grad_hits the number of gradient cache hits
+  @param grad_misses the number of gradient cache misses
+*/
+void ParOptCachedProblem::getCacheStats( int *_objcon_hits,
+                                         int *_objcon_misses,
+                                         int *_grad_hits,
+                                         int *_grad_misses ){
+  if (_objcon_hits){ *_objcon_hits = objcon_hits; }
+  if (_objcon_misses){ *_objcon_misses = objcon_misses; }
+  if (_grad_hits){ *_grad_hits = grad_hits; }
+  if (_grad_misses){ *_grad_misses = grad_misses; }
+}
+
+/*
+  Compute the hash of the local part of the vector from the bits of
+  the entries
+*/
+unsigned long ParOptCachedProblem::hashVec( ParOptVec *x ){
+  ParOptScalar *xa;
+  int size = x->getArray(&xa);
+
+  // FNV-1a applied to each 64-bit word of the array
+  const unsigned long long prime = 1099511628211ULL;
+  unsigned long long h = 14695981039346656037ULL;
+  const char *bytes = (const char*)xa;
+  int nwords = (size*sizeof(ParOptScalar))/sizeof(unsigned long long);
+  for ( int i = 0; i < nwords; i++ ){
+    unsigned long long w;
+    memcpy(&w, &bytes[i*sizeof(unsigned long long)], sizeof(w));
+    h = (h ^ w)*prime;
+  }
+
+  return (unsigned long)h;
+}
+
+/*
+  Find the stored points that match each of the given points.
+
+  The points that match on this processor are found by comparing the
+  hash and then the entries of the local part of the vector. The
+  masks of the matching entries are combined across all processors
+  with a single reduction.
+
+  @param npts the number of points
+  @param x the points
+  @param index the matching entry for each point (-1 if not found)
+  @return the number of points found in the cache
+*/
+int ParOptCachedProblem::lookup( int npts, ParOptVec **x, int *index ){
+  for ( int p = 0; p < npts; p++ ){
+    index[p] = -1;
+  }
+  if (num_entries == 0){
+    return 0;
+  }
+
+  unsigned int *mask = new unsigned int[ npts ];
+  for ( int p = 0; p < npts; p++ ){
+    mask[p] = 0;
+
+    ParOptScalar *xa;
+    int size = x[p]->getArray(&xa);
+    unsigned long h = hashVec(x[p]);
+    for ( int k = 0; k < num_entries; k++ ){
+      if (hashes[k] == h){
+        ParOptScalar *xk;
+        int sizek = xvals[k]->getArray(&xk);
+        if (size == sizek &&
+            memcmp(xa, xk, size*sizeof(ParOptScalar)) == 0){
+          mask[p] |= (1u << k);
+        }
+      }
+    }
+  }
+
+  ParOptAllreduce(MPI_IN_PLACE, mask, npts, MPI_UNSIGNED, MPI_BAND, comm);
+
+  int nfound = 0;
+  for ( int p = 0; p < npts; p++ ){
+    for ( int k = 0; k < num_entries; k++ ){
+      if (mask[p] & (1u << k)){
+        index[p] = k;
+        last_used[k] = ++counter;
+        nfound++;
+        break;
+      }
+    }
+  }
+
+  delete [] mask;
+  return nfound;
+}
+
+/*
+  Store the function values at the point, replacing the least
+  recently used entry if the cache is full
+
+  @param x the design point
+  @param fobj the objective value
+  @param cons the constraint values
+  @return the entry that was used
+*/
+int ParOptCachedProblem::insert( ParOptVec *x, ParOptScalar fobj,
+                                 const ParOptScalar *cons ){
+  int k = 0;
+  if (num_entries < max_entries){
+    k = num_entries;
+    num_entries++;
+  }
+  else {
+    for ( int j = 1; j < num_entries; j++ ){
+      if (last_used[j] < last_used[k]){
+        k = j;
+      }
+    }
+  }
+  if (k == last_eval){
+    last_eval = -1;
+  }
+
+  if (!xvals[k]){
+    xvals[k] = prob->createDesignVec();
+    xvals[k]->incref();
+  }
+  xvals[k]->copyValues(x);
+  hashes[k] = hashVec(x);
+  fvals[k] = fobj;
+  memcpy(&cvals[ncon*k], cons, ncon*sizeof(ParOptScalar));
+  has_gradient[k] = 0;
+  last_used[k] = ++counter;
+
+  return k;
+}
+
+ParOptVec *ParOptCachedProblem::createDesignVec(){
+  return prob->createDesignVec();
+}
+
+ParOptVec *ParOptCachedProblem::createConstraintVec(){
+  return prob->createConstraintVec();
+}
+
+ParOptMultiVec *ParOptCachedProblem::createDesignMultiVec( int nvecs ){
+  return prob->createDesignMultiVec(nvecs);
+}
+
+ParOptMultiVec *ParOptCachedProblem::createConstraintMultiVec( int nvecs ){
+  return prob->createConstraintMultiVec(nvecs);
+}
+
+int ParOptCachedProblem::isDenseInequality(){
+  return prob->isDenseInequality();
+}
+
+int ParOptCachedProblem::isSparseInequality(){
+  return prob->isSparseInequality();
+}
+
+int ParOptCachedProblem::useLowerBounds(){
+  return prob->useLowerBounds();
+}
+
+int ParOptCachedProblem::useUpperBounds(){
+  return prob->useUpperBounds();
+}
+
+void ParOptCachedProblem::getVarsAndBounds( ParOptVec *x,
+                                            ParOptVec *lb,
+                                            ParOptVec *ub ){
+  prob->getVarsAndBounds(x, lb, ub);
+}
+
+/**
+  Evaluate the objective and constraints, using the stored values if
+  the point is in the cache
+
+  @param x the design point
+  @param fobj the objective value
+  @param cons the constraint values
+  @return the fail flag
+*/
+int ParOptCachedProblem::evalObjCon( ParOptVec *x,
+                                     ParOptScalar *fobj,
+                                     ParOptScalar *cons ){
+  int k;
+  if (lookup(1, &x, &k)){
+    *fobj = fvals[k];
+    memcpy(cons, &cvals[ncon*k], ncon*sizeof(ParOptScalar));
+    objcon_hits++;
+    ParOptRecordCacheAccess(1);
+    return 0;
+  }
+
+  objcon_misses++;
+  ParOptRecordCacheAccess(0);
+  int fail = prob->evalObjCon(x, fobj, cons);
+  if (fail){
+    last_eval = -1;
+  }
+  else {
+    last_eval = insert(x, *fobj, cons);
+  }
+
+  return fail;
+}
+
+/**
+  Evaluate the objective and constraints at several points. The points
+  that are not in the cache are evaluated with a single call to the
+  batch evaluation of the wrapped problem.
+
+  @param npts the number of points
+  @param x the design points
+  @param fobj the objective values
+  @param cons the constraint values: cons[ncon*i + j]
+  @param fail the fail flags for each point
+  @return the fail flag for the batch
+*/
+int ParOptCachedProblem::evalObjConBatch( int npts, ParOptVec **x,
+                                          ParOptScalar *fobj,
+                                          ParOptScalar *cons,
+                                          int *fail ){
+  int *index = new int[ npts ];
+  int nfound = lookup(npts, x, index);
+
+  // Copy the stored values and collect the remaining points
+  int nmiss = npts - nfound;
+  ParOptVec **xmiss = new ParOptVec*[ nmiss+1 ];
+  for ( int p = 0, j = 0; p < npts; p++ ){
+    int k = index[p];
+    if (k >= 0){
+      fobj[p] = fvals[k];
+      memcpy(&cons[ncon*p], &cvals[ncon*k], ncon*sizeof(ParOptScalar));
+      fail[p] = 0;
+      objcon_hits++;
+      ParOptRecordCacheAccess(1);
+    }
+    else {
+      xmiss[j] = x[p];
+      j++;
+      objcon_misses++;
+      ParOptRecordCacheAccess(0);
+    }
+  }
+
+  int flag = 0;
+  if (nmiss > 0){
+    ParOptScalar *f = new ParOptScalar[ nmiss ];
+    ParOptScalar *c = new ParOptScalar[ nmiss*ncon ];
+    int *fl = new int[ nmiss ];
+    flag = prob->evalObjConBatch(nmiss, xmiss, f, c, fl);
+
+    // The user evaluation is left at the last point in the batch
+    last_eval = -1;
+    for ( int p = 0, j = 0; p < npts; p++ ){
+      if (index[p] < 0){
+        fobj[p] = f[j];
+        memcpy(&cons[ncon*p], &c[ncon*j], ncon*sizeof(ParOptScalar));
+        fail[p] = fl[j];
+        if (!flag && !fl[j]){
+          int k = insert(x[p], f[j], &c[ncon*j]);
+          if (j == nmiss-1 && p == npts-1){
+            last_eval = k;
+          }
+        }
+        j++;
+      }
+    }
+
+    delete [] f;
+    delete [] c;
+    delete [] fl;
+  }
+
+  delete [] index;
+  delete [] xmiss;
+
+  return flag;
+}
+
+/**
+  Evaluate the objective and constraint gradients, using the stored
+  values if the point is in the cache
+
+  @param x the design point
+  @param g the objective gradient
+  @param Ac the constraint gradients
+  @return the fail flag
+*/
+int ParOptCachedProblem::evalObjConGradient( ParOptVec *x,
+                                             ParOptVec *g,
+                                             ParOptVec **Ac ){
+  int k;
+  lookup(1, &x, &k);
+  if (k >= 0 && has_gradient[k]){
+    g->copyValues(gvals[k]);
+    for ( int i = 0; i < ncon; i++ ){
+      Ac[i]->copyValues(Avals[k][i]);
+    }
+    grad_hits++;
+    ParOptRecordCacheAccess(1);
+    return 0;
+  }
+
+  grad_misses++;
+  ParOptRecordCacheAccess(0);
+
+  // Evaluate the functions at x first if the last user evaluation
+  // was at a different point
+  if (k < 0 || k != last_eval){
+    ParOptScalar fobj;
+    ParOptScalar *cons = new ParOptScalar[ ncon+1 ];
+    int fail = prob->evalObjCon(x, &fobj, cons);
+    if (fail){
+      last_eval = -1;
+      delete [] cons;
+      return fail;
+    }
+    if (k < 0){
+      k = insert(x, fobj, cons);
+    }
+    last_eval = k;
+    delete [] cons;
+  }
+
+  int fail = prob->evalObjConGradient(x, g, Ac);
+  if (!fail){
+    if (!gvals[k]){
+      gvals[k] = prob->createDesignVec();
+      gvals[k]->incref();
+      Avals[k] = new ParOptVec*[ ncon ];
+      for ( int i = 0; i < ncon; i++ ){
+        Avals[k][i] = prob->createDesignVec();
+        Avals[k][i]->incref();
+      }
+    }
+    gvals[k]->copyValues(g);
+    for ( int i = 0; i < ncon; i++ ){
+      Avals[k][i]->copyValues(Ac[i]);
+    }
+    has_gradient[k] = 1;
+  }
+
+  return fail;
+}
+
+int ParOptCachedProblem::useComplexStep(){
+  return prob->useComplexStep();
+}
+
+/*
+  The complex-step evaluation is not cached. It moves the user
+  evaluation away from the last stored point, so the next gradient
+  evaluation calls the user evalObjCon() first.
+*/
+int ParOptCachedProblem::evalObjConComplex( const ParOptComplex *x,
+                                            ParOptComplex *fobj,
+                                            ParOptComplex *cons ){
+  last_eval = -1;
+  return prob->evalObjConComplex(x, fobj, cons);
+}
+
+int ParOptCachedProblem::evalHvecProduct( ParOptVec *x,
+                                          ParOptScalar *z, ParOptVec *zw,
+                                          ParOptVec *px, ParOptVec *hvec ){
+  return prob->evalHvecProduct(x, z, zw, px, hvec);
+}
+
+int ParOptCachedProblem::evalHvecProductBlock( ParOptVec *x,
+                                               ParOptScalar *z,
+                                               ParOptVec *zw, int nvecs,
+                                               ParOptVec **px,
+                                               ParOptVec **hvec ){
+  return prob->evalHvecProductBlock(x, z, zw, nvecs, px, hvec);
+}
+
+int ParOptCachedProblem::evalHessianDiag( ParOptVec *x,
+                                          ParOptScalar *z, ParOptVec *zw,
+                                          ParOptVec *hdiag ){
+  return prob->evalHessianDiag(x, z, zw, hdiag);
+}
+
+void ParOptCachedProblem::computeQuasiNewtonUpdateCorrection( ParOptVec *s,
+                                                              ParOptVec *y ){
+  prob->computeQuasiNewtonUpdateCorrection(s, y);
+}
+
+void ParOptCachedProblem::evalSparseCon( ParOptVec *x, ParOptVec *out ){
+  prob->evalSparseCon(x, out);
+}
+
+void ParOptCachedProblem::addSparseJacobian( ParOptScalar alpha,
+                                             ParOptVec *x,
+                                             ParOptVec *px,
+                                             ParOptVec *out ){
+  prob->addSparseJacobian(alpha, x, px, out);
+}
+
+void ParOptCachedProblem::addSparseJacobianTranspose( ParOptScalar alpha,
+                                                      ParOptVec *x,
+                                                      ParOptVec *pzw,
+                                                      ParOptVec *out ){
+  prob->addSparseJacobianTranspose(alpha, x, pzw, out);
+}
+
+void ParOptCachedProblem::addSparseInnerProduct( ParOptScalar alpha,
+                                                 ParOptVec *x,
+                                                 ParOptVec *cvec,
+                                                 ParOptScalar *A ){
+  prob->addSparseInnerProduct(alpha, x, cvec, A);
+}
+
+void ParOptCachedProblem::writeOutput( int iter, ParOptVec *x ){
+  prob->writeOutput(iter, x);
+}
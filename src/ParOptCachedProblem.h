@@ -0,0 +1,128 @@
+#ifndef PAR_OPT_CACHED_PROBLEM_H
+#define PAR_OPT_CACHED_PROBLEM_H
+
+#include "ParOptProblem.h"
+
+/*
+  A wrapper around a ParOptProblem that caches the objective,
+  constraint and gradient evaluations.
+
+  The optimizers sometimes request the function values or gradients
+  at a point that was already evaluated, for instance after a rejected
+  step or on a restart. This class stores the results of the most
+  recent evaluations and returns the stored values without calling
+  the user code when the design vector matches a stored point exactly.
+
+  Each lookup computes a hash of the local part of the design vector
+  which is used to skip the exact comparison with most of the stored
+  points. The stored points that match exactly on each processor are
+  combined with a single reduction, so that all processors agree on
+  whether the lookup is a hit.
+
+  The number of stored points is bounded and the least recently used
+  point is replaced when the cache is full. Failed evaluations are not
+  stored. When a gradient is required at a point whose function values
+  were returned from the cache, the user evalObjCon() is called first
+  so that the order of the evaluations seen by the user code is the
+  same as without the cache. The remaining functions are passed
+  directly to the wrapped problem.
+*/
+class ParOptCachedProblem : public ParOptProblem {
+ public:
+  ParOptCachedProblem( ParOptProblem *_prob, int _max_entries=4 );
+  ~ParOptCachedProblem();
+
+  // Get the wrapped problem
+  ParOptProblem *getProblem(){ return prob; }
+
+  // Clear all of the stored evaluations
+  void clearCache();
+
+  // Get the cache statistics for this problem
+  void getCacheStats( int *objcon_hits, int *objcon_misses,
+                      int *grad_hits, int *grad_misses );
+
+  // The maximum number of stored points
+  static const int PAROPT_MAX_CACHE_ENTRIES = 32;
+
+  // Create the design vectors from the wrapped problem
+  ParOptVec *createDesignVec();
+  ParOptVec *createConstraintVec();
+  ParOptMultiVec *createDesignMultiVec( int nvecs );
+  ParOptMultiVec *createConstraintMultiVec( int nvecs );
+
+  // Function to indicate the type of sparse constraints
+  int isDenseInequality();
+  int isSparseInequality();
+  int useLowerBounds();
+  int useUpperBounds();
+
+  // Get the variables and bounds from the problem
+  void getVarsAndBounds( ParOptVec *x, ParOptVec *lb, ParOptVec *ub );
+
+  // Evaluate the objective and constraints (cached)
+  int evalObjCon( ParOptVec *x, ParOptScalar *fobj, ParOptScalar *cons );
+  int evalObjConBatch( int npts, ParOptVec **x,
+                       ParOptScalar *fobj, ParOptScalar *cons,
+                       int *fail );
+
+  // Evaluate the objective and constraint gradients (cached)
+  int evalObjConGradient( ParOptVec *x, ParOptVec *g, ParOptVec **Ac );
+
+  // Functions passed directly to the wrapped problem
+  int useComplexStep();
+  int evalObjConComplex( const ParOptComplex *x, ParOptComplex *fobj,
+                         ParOptComplex *cons );
+  int evalHvecProduct( ParOptVec *x, ParOptScalar *z, ParOptVec *zw,
+                       ParOptVec *px, ParOptVec *hvec );
+  int evalHvecProductBlock( ParOptVec *x, ParOptScalar *z, ParOptVec *zw,
+                            int nvecs, ParOptVec **px, ParOptVec **hvec );
+  int evalHessianDiag( ParOptVec *x, ParOptScalar *z, ParOptVec *zw,
+                       ParOptVec *hdiag );
+  void computeQuasiNewtonUpdateCorrection( ParOptVec *s, ParOptVec *y );
+  void evalSparseCon( ParOptVec *x, ParOptVec *out );
+  void addSparseJacobian( ParOptScalar alpha, ParOptVec *x,
+                          ParOptVec *px, ParOptVec *out );
+  void addSparseJacobianTranspose( ParOptScalar alpha, ParOptVec *x,
+                                   ParOptVec *pzw, ParOptVec *out );
+  void addSparseInnerProduct( ParOptScalar alpha, ParOptVec *x,
+                              ParOptVec *cvec, ParOptScalar *A );
+  void writeOutput( int iter, ParOptVec *x );
+
+ private:
+  // Find the stored point that matches x (or -1)
+  int lookup( int npts, ParOptVec **x, int *index );
+
+  // Store the function values at x and return the entry
+  int insert( ParOptVec *x, ParOptScalar fobj, const ParOptScalar *cons );
+
+  // Compute the hash of the local part of the vector
+  static unsigned long hashVec( ParOptVec *x );
+
+  // The wrapped problem
+  ParOptProblem *prob;
+
+  // The stored points
+  int max_entries, num_entries;
+  ParOptVec **xvals;
+  unsigned long *hashes;
+  ParOptScalar *fvals, *cvals;
+
+  // The stored gradients (allocated when first required)
+  int *has_gradient;
+  ParOptVec **gvals;
+  ParOptVec ***Avals;
+
+  // The time each entry was last used
+  int counter;
+  int *last_used;
+
+  // The entry at which the user evalObjCon() was last called
+  int last_eval;
+
+  // The cache statistics
+  int objcon_hits, objcon_misses;
+  int grad_hits, grad_misses;
+};
+
+#endif // PAR_OPT_CACHED_PROBLEM_H
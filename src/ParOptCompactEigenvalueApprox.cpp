@@ -1,6 +1,7 @@
 #include <cstring>
 #include "ParOptCompactEigenvalueApprox.h"
 #include "ParOptComplexStep.h"
+#include "ParOptBlasLapack.h"
 
 inline ParOptScalar min2( ParOptScalar a, ParOptScalar b ){
   if (ParOptRealPart(a) < ParOptRealPart(b)){
@@ -20,48 +21,58 @@ inline ParOptScalar max2( ParOptScalar a, ParOptScalar b ){
   }
 }
 
-ParOptCompactEigenApprox::ParOptCompactEigenApprox( ParOptProblem *problem,
+ParOptCompactEigenApprox::ParOptCompactEigenApprox( ParOptProblem *_problem,
                                                     int _N ){
-  c0 = 0.0;
-  g0 = problem->createDesignVec();
-  g0->incref();
+  problem = _problem;
+  problem->incref();
 
   N = _N;
-  tmp = new ParOptScalar[ N ];
+  tmp = new ParOptScalar[ N+1 ];
+  coef = new ParOptScalar[ N ];
   M = new ParOptScalar[ N*N ];
   Minv = new ParOptScalar[ N*N ];
   memset(M, 0, N*N*sizeof(ParOptScalar));
   memset(Minv, 0, N*N*sizeof(ParOptScalar));
+
+  // Store the Hessian vectors and the gradient in a single block
+  c0 = 0.0;
+  vecs = problem->createDesignMultiVec(N+1);
+  vecs->incref();
+  g0 = vecs->getVec(N);
   hvecs = new ParOptVec*[ N ];
   for ( int i = 0; i < N; i++ ){
-    hvecs[i] = problem->createDesignVec();
-    hvecs[i]->incref();
+    hvecs[i] = vecs->getVec(i);
   }
 }
 
 ParOptCompactEigenApprox::~ParOptCompactEigenApprox(){
   delete [] tmp;
+  delete [] coef;
   delete [] M;
   delete [] Minv;
-  g0->decref();
-  for ( int i = 0; i < N; i++ ){
-    hvecs[i]->decref();
-  }
+  delete [] hvecs;
+  vecs->decref();
+  problem->decref();
+}
+
+ParOptMultiVec *ParOptCompactEigenApprox::createDesignMultiVec( int nvecs ){
+  return problem->createDesignMultiVec(nvecs);
 }
 
 void ParOptCompactEigenApprox::multAdd( ParOptScalar alpha,
                                         ParOptVec *x,
                                         ParOptVec *y ){
-  x->mdot(hvecs, N, tmp);
+  vecs->mdot(x, N, tmp);
 
   for ( int i = 0; i < N; i++ ){
     ParOptScalar scale = 0.0;
     for ( int j = 0; j < N; j++ ){
       scale += M[i*N + j]*tmp[j];
     }
-
-    y->axpy(alpha*scale, hvecs[i]);
+    coef[i] = alpha*scale;
   }
+
+  vecs->maxpy(N, coef, y);
 }
 
 void ParOptCompactEigenApprox::getApproximation( ParOptScalar **_c0,
@@ -94,9 +105,10 @@ ParOptScalar ParOptCompactEigenApprox::evalApproximation( ParOptVec *s,
                                                           ParOptVec *t ){
   ParOptScalar c = c0;
   if (s && t){
-    c += g0->dot(s);
+    // Compute H^{T}*s and g0^{T}*s together
+    vecs->mdot(s, N+1, tmp);
+    c += tmp[N];
 
-    s->mdot(hvecs, N, tmp);
     for ( int i = 0; i < N; i++ ){
       for ( int j = 0; j < N; j++ ){
         c += 0.5*M[i*N + j]*tmp[i]*tmp[j];
@@ -110,15 +122,7 @@ ParOptScalar ParOptCompactEigenApprox::evalApproximation( ParOptVec *s,
 void ParOptCompactEigenApprox::evalApproximationGradient( ParOptVec *s,
                                                           ParOptVec *grad ){
   grad->copyValues(g0);
-
-  s->mdot(hvecs, N, tmp);
-  for ( int i = 0; i < N; i++ ){
-    ParOptScalar scale = 0.0;
-    for ( int j = 0; j < N; j++ ){
-      scale += M[i*N + j]*tmp[j];
-    }
-    grad->axpy(scale, hvecs[i]);
-  }
+  multAdd(1.0, s, grad);
 }
 
 ParOptEigenQuasiNewton::ParOptEigenQuasiNewton( ParOptCompactQuasiNewton *_qn,
@@ -146,7 +150,24 @@ ParOptEigenQuasiNewton::ParOptEigenQuasiNewton( ParOptCompactQuasiNewton *_qn,
 
   d = new ParOptScalar[ max_vecs ];
   M = new ParOptScalar[ max_vecs*max_vecs ];
+  M0_factor = new ParOptScalar[ max_vecs*max_vecs ];
+  mpiv = new int[ max_vecs ];
+  rz = new ParOptScalar[ max_vecs ];
+  coef = new ParOptScalar[ max_vecs ];
+
+  // Allocate the block that stores the combined compact vectors
+  Zvecs = eigh->createDesignMultiVec(max_vecs);
+  Zvecs->incref();
   Z = new ParOptVec*[ max_vecs ];
+  for ( int i = 0; i < max_vecs; i++ ){
+    Z[i] = Zvecs->getVec(i);
+  }
+
+  // The compact representation is formed when it is first needed
+  compact_valid = 0;
+  mat_size = qn_size = 0;
+  b0 = 0.0;
+  qn_factor_valid = 0;
 }
 
 ParOptEigenQuasiNewton::~ParOptEigenQuasiNewton(){
@@ -155,9 +176,14 @@ ParOptEigenQuasiNewton::~ParOptEigenQuasiNewton(){
   }
   eigh->decref();
 
+  Zvecs->decref();
   delete [] Z;
   delete [] M;
   delete [] d;
+  delete [] M0_factor;
+  delete [] mpiv;
+  delete [] rz;
+  delete [] coef;
 }
 
 // Reset the internal data
@@ -165,6 +191,7 @@ void ParOptEigenQuasiNewton::reset(){
   if (qn){
     qn->reset();
   }
+  compact_valid = 0;
 }
 
 int ParOptEigenQuasiNewton::update( ParOptVec *x,
@@ -176,36 +203,107 @@ int ParOptEigenQuasiNewton::update( ParOptVec *x,
 }
 
 int ParOptEigenQuasiNewton::update( ParOptVec *x, const ParOptScalar *z, ParOptVec *zw ){
-  // Set the multiplier
-  z0 = z[index];
+  // Set the multiplier. The compact matrix depends on its value.
+  if (z[index] != z0){
+    z0 = z[index];
+    compact_valid = 0;
+  }
 
   return 0;
 }
 
+// Mark the cached compact representation as out of date
+void ParOptEigenQuasiNewton::invalidateCompactMat(){
+  compact_valid = 0;
+}
+
 void ParOptEigenQuasiNewton::mult( ParOptVec *x, ParOptVec *y ){
-  if (qn){
-    qn->mult(x, y);
+  if (!compact_valid){
+    buildCompactMat();
   }
-  else {
-    y->zeroEntries();
-  }
-  eigh->multAdd(-z0, x, y);
+  y->axpby(b0, 0.0, x);
+  addCompactProduct(1.0, x, y);
 }
 
 void ParOptEigenQuasiNewton::multAdd( ParOptScalar alpha,
                                       ParOptVec *x,
                                       ParOptVec *y ){
-  if (qn){
+  if (!compact_valid){
+    buildCompactMat();
+  }
+  y->axpy(alpha*b0, x);
+  addCompactProduct(alpha, x, y);
+}
+
+/*
+  Add the contribution from the compact terms
+
+  y <- y - alpha*Z0*diag{d0}*M0^{-1}*diag{d0}*Z0^{T}*x
+         - alpha*z0*H*M1*H^{T}*x
+
+  where the quasi-Newton vectors Z0 and the eigenvalue approximation
+  vectors H are stored in the leading columns of the cached block.
+*/
+void ParOptEigenQuasiNewton::addCompactProduct( ParOptScalar alpha,
+                                                ParOptVec *x,
+                                                ParOptVec *y ){
+  if (mat_size == 0){
+    return;
+  }
+
+  // The quasi-Newton product can only be fused when the factorization
+  // of the compact matrix is available
+  int nfused = mat_size;
+  int start = 0;
+  if (qn_size > 0 && !qn_factor_valid){
     qn->multAdd(alpha, x, y);
+    y->axpy(-alpha*b0, x);
+    start = qn_size;
+  }
+
+  // Compute all the products with the stored vectors at once
+  Zvecs->mdot(x, nfused, rz);
+
+  if (start == 0 && qn_size > 0){
+    // Set coef = -alpha*diag{d0}*M0^{-1}*diag{d0}*Z0^{T}*x
+    for ( int i = 0; i < qn_size; i++ ){
+      coef[i] = d[i]*rz[i];
+    }
+    int one = 1, info = 0;
+    LAPACKdgetrs("N", &qn_size, &one,
+                 M0_factor, &qn_size, mpiv,
+                 coef, &qn_size, &info);
+    for ( int i = 0; i < qn_size; i++ ){
+      coef[i] = -alpha*d[i]*coef[i];
+    }
+  }
+  else {
+    for ( int i = 0; i < qn_size; i++ ){
+      coef[i] = 0.0;
+    }
+  }
+
+  // Set the coefficients for the eigenvalue approximation terms
+  int N;
+  ParOptScalar *M1;
+  eigh->getApproximation(NULL, NULL, &N, &M1, NULL, NULL);
+  for ( int i = 0; i < N; i++ ){
+    ParOptScalar scale = 0.0;
+    for ( int j = 0; j < N; j++ ){
+      scale += M1[i*N + j]*rz[qn_size + j];
+    }
+    coef[qn_size + i] = -alpha*z0*scale;
   }
-  eigh->multAdd(-alpha*z0, x, y);
+
+  // Add the contributions from all the vectors in a single pass
+  Zvecs->maxpy(mat_size, coef, y);
 }
 
-// Get the compact representation of the quasi-Newton method
-int ParOptEigenQuasiNewton::getCompactMat( ParOptScalar *b0,
-                                           const ParOptScalar **_d,
-                                           const ParOptScalar **_M,
-                                           ParOptVec ***_Z ){
+/*
+  Form the compact representation of the combined approximation and
+  copy the vectors into the contiguous block
+*/
+void ParOptEigenQuasiNewton::buildCompactMat(){
   memset(M, 0, max_vecs*max_vecs*sizeof(ParOptScalar));
 
   // Get the size of the eigenvalue hessian approximation
@@ -213,14 +311,16 @@ int ParOptEigenQuasiNewton::getCompactMat( ParOptScalar *b0,
   eigh->getApproximation(NULL, NULL, &N, NULL, NULL, NULL);
 
   // Set the matrix size, neglecting the quasi-Newton Hessian
-  int mat_size = N;
-  int qn_size = 0;
+  mat_size = N;
+  qn_size = 0;
+  b0 = 0.0;
+  qn_factor_valid = 0;
 
   if (qn){
     // Get the compact quasi-Newton approximation
     ParOptVec **Z0;
     const ParOptScalar *d0, *M0;
-    qn_size = qn->getCompactMat(b0, &d0, &M0, &Z0);
+    qn_size = qn->getCompactMat(&b0, &d0, &M0, &Z0);
 
     // Set the matrix size
     mat_size = N + qn_size;
@@ -228,16 +328,19 @@ int ParOptEigenQuasiNewton::getCompactMat( ParOptScalar *b0,
     // Set the values into the matrix
     for ( int i = 0; i < qn_size; i++ ){
       d[i] = d0[i];
-      Z[i] = Z0[i];
+      Z[i]->copyValues(Z0[i]);
 
       for ( int j = 0; j < qn_size; j++ ){
         M[i*mat_size + j] = M0[i*qn_size + j];
+        M0_factor[i*qn_size + j] = M0[i*qn_size + j];
       }
     }
-  }
-  else {
-    if (b0){
-      *b0 = 0.0;
+
+    // Factor the quasi-Newton block for the matrix-vector products
+    if (qn_size > 0){
+      int info = 0;
+      LAPACKdgetrf(&qn_size, &qn_size, M0_factor, &qn_size, mpiv, &info);
+      qn_factor_valid = (info == 0);
     }
   }
 
@@ -253,13 +356,26 @@ int ParOptEigenQuasiNewton::getCompactMat( ParOptScalar *b0,
 
   for ( int i = 0; i < N; i++ ){
     d[qn_size + i] = 1.0;
-    Z[qn_size + i] = Z1[i];
+    Z[qn_size + i]->copyValues(Z1[i]);
 
     for ( int j = 0; j < N; j++ ){
       M[(qn_size + i)*mat_size + qn_size + j] = z0inv*M1inv[i*N + j];
     }
   }
 
+  compact_valid = 1;
+}
+
+// Get the compact representation of the quasi-Newton method
+int ParOptEigenQuasiNewton::getCompactMat( ParOptScalar *_b0,
+                                           const ParOptScalar **_d,
+                                           const ParOptScalar **_M,
+                                           ParOptVec ***_Z ){
+  if (!compact_valid){
+    buildCompactMat();
+  }
+
+  if (_b0){ *_b0 = b0; }
   if (_d){ *_d = d; }
   if (_M){ *_M = M; }
   if (_Z){ *_Z = Z; }
@@ -418,6 +534,9 @@ void ParOptEigenSubproblem::initModelAndBounds( double tr_size ){
       updateEigenModel(data, xk, eigh);
     }
   }
+
+  // The cached compact representation is now out of date
+  approx->invalidateCompactMat();
 }
 
 /*
@@ -517,6 +636,10 @@ int ParOptEigenSubproblem::acceptTrialStep( ParOptVec *step,
     qn->update(xtemp, z, zw, step, t);
   }
 
+  // Either approximation may have changed, so rebuild the compact
+  // representation when it is next needed
+  approx->invalidateCompactMat();
+
   fk = ft;
   xk->copyValues(xtemp);
   gk->copyValues(gt);
@@ -4,6 +4,16 @@
 #include "ParOptTrustRegion.h"
 #include "ParOptQuasiNewton.h"
 
+/*
+  A compact approximation of an eigenvalue constraint
+
+  c(x + s) ~ c0 + g0^{T}*s + 0.5*s^{T}*H*M*H^{T}*s
+
+  The vectors H = [h_0, ..., h_{N-1}] and the gradient g0 are stored
+  together in a single block of vectors so that the products with the
+  approximation require only one pass through memory and one
+  reduction.
+*/
 class ParOptCompactEigenApprox : public ParOptBase {
  public:
   ParOptCompactEigenApprox( ParOptProblem *problem,
@@ -17,7 +27,13 @@ class ParOptCompactEigenApprox : public ParOptBase {
   ParOptScalar evalApproximation( ParOptVec *s, ParOptVec *t );
   void evalApproximationGradient( ParOptVec *s, ParOptVec *grad );
 
+  // Create a block of vectors with the same layout as the approximation
+  ParOptMultiVec *createDesignMultiVec( int nvecs );
+
  private:
+  // The problem used to create the vectors
+  ParOptProblem *problem;
+
   // The constraint value and gradient
   ParOptScalar c0;
   ParOptVec *g0;
@@ -28,8 +44,11 @@ class ParOptCompactEigenApprox : public ParOptBase {
   ParOptScalar *Minv;
   ParOptVec **hvecs;
 
-  // Temporary vector for matrix-vector products
-  ParOptScalar *tmp;
+  // The block of vectors [h_0, ..., h_{N-1}, g0]
+  ParOptMultiVec *vecs;
+
+  // Temporary vectors for matrix-vector products
+  ParOptScalar *tmp, *coef;
 };
 
 class ParOptEigenQuasiNewton : public ParOptCompactQuasiNewton {
@@ -57,6 +76,11 @@ class ParOptEigenQuasiNewton : public ParOptCompactQuasiNewton {
   int getCompactMat( ParOptScalar *_b0, const ParOptScalar **_d,
                      const ParOptScalar **_M, ParOptVec ***Z );
 
+  // Mark the cached compact representation as out of date. This must
+  // be called after the quasi-Newton or eigenvalue approximations are
+  // modified directly.
+  void invalidateCompactMat();
+
   // Get the maximum size of the limited-memory BFGS
   int getMaxLimitedMemorySize();
 
@@ -72,10 +96,30 @@ class ParOptEigenQuasiNewton : public ParOptCompactQuasiNewton {
   ParOptCompactQuasiNewton *qn;
   ParOptCompactEigenApprox *eigh;
 
-  // Objects to store the vectors
-  int max_vecs;
+  // Form the cached compact representation
+  void buildCompactMat();
+
+  // Add the product of the compact terms y <- y + alpha*(B - b0*I)*x
+  void addCompactProduct( ParOptScalar alpha, ParOptVec *x, ParOptVec *y );
+
+  // The cached compact representation. The quasi-Newton vectors and
+  // the eigenvalue approximation vectors are copied into the single
+  // block Zvecs so that products with the combined matrix take one
+  // pass through memory and one reduction.
+  int compact_valid;
+  int max_vecs, mat_size, qn_size;
+  ParOptScalar b0;
+  ParOptMultiVec *Zvecs;
   ParOptScalar *M, *d;
   ParOptVec **Z;
+
+  // The factored quasi-Newton block of M
+  int qn_factor_valid;
+  ParOptScalar *M0_factor;
+  int *mpiv;
+
+  // Temporary storage for the products
+  ParOptScalar *rz, *coef;
 };
 
 class ParOptEigenSubproblem : public ParOptTrustRegionSubproblem {
@@ -0,0 +1,248 @@
+#include <string.h>
+#include "ParOptHistory.h"
+
+/*
+  The length of a field name in the history file, including the
+  terminating null character
+*/
+static const int PAROPT_HISTORY_NAME_LEN = 16;
+
+/*
+  The version of the history file format
+*/
+static const int PAROPT_HISTORY_VERSION = 1;
+
+/**
+  Create the history with the given record schema
+
+  @param _comm the communicator for the optimizer
+  @param _nfields the number of scalar values in each record
+  @param _names the names of the fields
+*/
+ParOptHistory::ParOptHistory( MPI_Comm _comm, int _nfields,
+                              const char **_names ){
+  comm = _comm;
+  MPI_Comm_rank(comm, &rank);
+
+  // Copy the names into fixed-length storage
+  nfields = _nfields;
+  names = new char[ PAROPT_HISTORY_NAME_LEN*nfields ];
+  memset(names, 0, PAROPT_HISTORY_NAME_LEN*nfields);
+  for ( int i = 0; i < nfields; i++ ){
+    strncpy(&names[PAROPT_HISTORY_NAME_LEN*i], _names[i],
+            PAROPT_HISTORY_NAME_LEN-1);
+  }
+
+  fp = NULL;
+  xfp = NULL;
+  nvars = 0;
+  design_freq = 0;
+  nsnapshots = 0;
+  nglobal = 0;
+  var_offset = 0;
+  buffer = NULL;
+}
+
+/**
+  Close the files and free the data
+*/
+ParOptHistory::~ParOptHistory(){
+  close();
+  delete [] names;
+}
+
+/**
+  Open the scalar history file and write the header. Only the root
+  processor opens the file.
+
+  @param filename the name of the history file
+  @return 0 on success, 1 on failure
+*/
+int ParOptHistory::openHistoryFile( const char *filename ){
+  if (fp){
+    fclose(fp);
+    fp = NULL;
+  }
+
+  int fail = 0;
+  if (filename && rank == 0){
+    fp = fopen(filename, "wb");
+    if (fp){
+      char magic[8] = {'P', 'A', 'R', 'O', 'P', 'T', 'H', 'S'};
+      int header[2];
+      header[0] = PAROPT_HISTORY_VERSION;
+      header[1] = nfields;
+      fwrite(magic, sizeof(char), 8, fp);
+      fwrite(header, sizeof(int), 2, fp);
+      fwrite(names, sizeof(char), PAROPT_HISTORY_NAME_LEN*nfields, fp);
+      fflush(fp);
+    }
+    else {
+      fail = 1;
+    }
+  }
+
+  return fail;
+}
+
+/**
+  Open the design history file and write the header. This call is
+  collective on all processors.
+
+  @param filename the name of the design history file
+  @param _nvars the number of local design variables
+  @param _design_freq write a snapshot every design_freq iterations
+  @return 0 on success, 1 on failure
+*/
+int ParOptHistory::openDesignHistoryFile( const char *filename, int _nvars,
+                                          int _design_freq ){
+  if (xfp){
+    MPI_File_close(&xfp);
+    xfp = NULL;
+  }
+  if (buffer){
+    delete [] buffer;
+    buffer = NULL;
+  }
+  if (!filename || _design_freq <= 0){
+    return 0;
+  }
+
+  nvars = _nvars;
+  design_freq = _design_freq;
+  nsnapshots = 0;
+
+  // Compute the offset of the local variables in the global vector
+  long long int local = nvars, offset = 0, total = 0;
+  MPI_Scan(&local, &offset, 1, MPI_LONG_LONG_INT, MPI_SUM, comm);
+  MPI_Allreduce(&local, &total, 1, MPI_LONG_LONG_INT, MPI_SUM, comm);
+  var_offset = offset - local;
+  nglobal = total;
+
+  // The root processor writes the iteration number in front of its
+  // segment, so the staging buffer has room for one extra value
+  buffer = new ParOptScalar[ nvars+1 ];
+
+  char *fname = new char[ strlen(filename)+1 ];
+  strcpy(fname, filename);
+  if (MPI_File_open(comm, fname, MPI_MODE_WRONLY | MPI_MODE_CREATE,
+                    MPI_INFO_NULL, &xfp) != MPI_SUCCESS){
+    xfp = NULL;
+  }
+  delete [] fname;
+
+  int fail = 0;
+  if (xfp){
+    MPI_File_set_size(xfp, 0);
+    if (rank == 0){
+      char magic[8] = {'P', 'A', 'R', 'O', 'P', 'T', 'H', 'X'};
+      int header[2];
+      header[0] = PAROPT_HISTORY_VERSION;
+      header[1] = sizeof(ParOptScalar);
+      long long int size = nglobal;
+      MPI_File_write_at(xfp, 0, magic, 8, MPI_CHAR, MPI_STATUS_IGNORE);
+      MPI_File_write_at(xfp, 8, header, 2, MPI_INT, MPI_STATUS_IGNORE);
+      MPI_File_write_at(xfp, 16, &size, 1, MPI_LONG_LONG_INT,
+                        MPI_STATUS_IGNORE);
+    }
+  }
+  else {
+    fail = 1;
+  }
+
+  return fail;
+}
+
+/**
+  Write a record of scalar values to the history file. Only the root
+  processor writes the record.
+
+  @param values the nfields values in the record
+*/
+void ParOptHistory::writeRecord( const double *values ){
+  if (fp){
+    fwrite(values, sizeof(double), nfields, fp);
+    fflush(fp);
+  }
+}
+
+/**
+  Write a snapshot of the design variables if one is due at this
+  iteration. This call is collective on all processors.
+
+  @param iter the iteration number
+  @param x the design vector
+  @return 0 on success, 1 on failure
+*/
+int ParOptHistory::writeDesign( int iter, ParOptVec *x ){
+  if (!isDesignDue(iter)){
+    return 0;
+  }
+
+  // Check that the vector has the layout given when the file was
+  // opened. The check is reduced across all processors so that the
+  // whole record, including the iteration number written by the root
+  // processor, is skipped if the vector has the wrong size on any
+  // processor.
+  int fail = 0;
+  ParOptScalar *xvals;
+  int size = x->getArray(&xvals);
+  if (size != nvars){
+    fail = 1;
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &fail, 1, MPI_INT, MPI_MAX, comm);
+  if (fail){
+    return fail;
+  }
+
+  // Copy the local values into the staging buffer
+  int count = size;
+  MPI_Offset offset = 1 + var_offset;
+  if (rank == 0){
+    buffer[0] = iter;
+    memcpy(&buffer[1], xvals, size*sizeof(ParOptScalar));
+    count = size+1;
+    offset = 0;
+  }
+  else {
+    memcpy(buffer, xvals, size*sizeof(ParOptScalar));
+  }
+
+  // Set the view at the start of the record and write the segments
+  MPI_Offset disp = 24 + nsnapshots*(1 + nglobal)*sizeof(ParOptScalar);
+  char datarep[] = "native";
+  MPI_File_set_view(xfp, disp, PAROPT_MPI_TYPE, PAROPT_MPI_TYPE,
+                    datarep, MPI_INFO_NULL);
+
+  if (MPI_File_write_at_all(xfp, offset, buffer, count, PAROPT_MPI_TYPE,
+                            MPI_STATUS_IGNORE) != MPI_SUCCESS){
+    fail = 1;
+  }
+
+  // Only keep the record if it was written on all processors,
+  // otherwise it is overwritten by the next snapshot
+  MPI_Allreduce(MPI_IN_PLACE, &fail, 1, MPI_INT, MPI_MAX, comm);
+  if (!fail){
+    nsnapshots++;
+  }
+
+  return fail;
+}
+
+/**
+  Close the history files
+*/
+void ParOptHistory::close(){
+  if (fp){
+    fclose(fp);
+    fp = NULL;
+  }
+  if (xfp){
+    MPI_File_close(&xfp);
+    xfp = NULL;
+  }
+  if (buffer){
+    delete [] buffer;
+    buffer = NULL;
+  }
+}
@@ -0,0 +1,91 @@
+#ifndef PAR_OPT_HISTORY_H
+#define PAR_OPT_HISTORY_H
+
+#include <stdio.h>
+#include "ParOptVec.h"
+
+/*
+  A binary, streamable history of the optimization.
+
+  The history consists of two optional files: a file of scalar
+  per-iteration metrics and a file of design variable snapshots.
+
+  The scalar history is written by the root processor. It begins with
+  a header that defines the fixed record schema:
+
+  char    magic[8] = "PAROPTHS"
+  int32   version
+  int32   nfields
+  char    names[nfields][16]
+
+  followed by one record of nfields float64 values for each iteration.
+  Each record is flushed as it is written so that the file can be read
+  while the optimization is running. Integer fields, such as the
+  iteration count, are stored exactly as float64 values.
+
+  The design history is written with collective MPI-IO, using the same
+  native representation and the same global ordering of the
+  distributed design vector as writeSolutionFile(). It begins with the
+  header:
+
+  char    magic[8] = "PAROPTHX"
+  int32   version
+  int32   the size of ParOptScalar in bytes
+  int64   nglobal
+
+  followed by records of (1 + nglobal) ParOptScalar values: the
+  iteration number and the global design vector. Each processor writes
+  its contiguous segment of the record in a single collective call.
+
+  Both files may be read with memory-mapped numpy arrays since the
+  records have a fixed size.
+*/
+class ParOptHistory : public ParOptBase {
+ public:
+  ParOptHistory( MPI_Comm _comm, int _nfields, const char **_names );
+  ~ParOptHistory();
+
+  // Open the scalar history file on the root processor
+  int openHistoryFile( const char *filename );
+
+  // Open the design history file and set the snapshot frequency
+  int openDesignHistoryFile( const char *filename, int _nvars,
+                             int _design_freq );
+
+  // Check whether the files are open
+  int isOpen(){ return (fp != NULL); }
+  int isDesignOpen(){ return (xfp != NULL); }
+
+  // Check whether a design snapshot is due at this iteration
+  int isDesignDue( int iter ){
+    return (xfp && design_freq > 0 && iter % design_freq == 0);
+  }
+
+  // Write a record of scalar values
+  void writeRecord( const double *values );
+
+  // Write a snapshot of the design variables if one is due
+  int writeDesign( int iter, ParOptVec *x );
+
+  // Close the history files
+  void close();
+
+ private:
+  MPI_Comm comm;
+  int rank;
+
+  // The record schema
+  int nfields;
+  char *names;
+
+  // The scalar history file, only open on the root processor
+  FILE *fp;
+
+  // The design history file
+  MPI_File xfp;
+  int nvars, design_freq, nsnapshots;
+  MPI_Offset nglobal, var_offset;
+  ParOptScalar *buffer;
+};
+
+#endif // PAR_OPT_HISTORY_H
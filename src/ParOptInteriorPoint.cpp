@@ -4,13 +4,48 @@
 #include "ParOptBlasLapack.h"
 #include "ParOptInteriorPoint.h"
 
+/*
+  The number of rows and columns in each block used to assemble the
+  dense Schur complement with matrix products
+*/
+static const int PAROPT_SCHUR_BLOCK_SIZE = 256;
+static const int PAROPT_SCHUR_BLOCK_COLS = 16;
+
+/*
+  The fields in each record of the binary history. These match the
+  columns of the iteration history written to the output file.
+*/
+static const int PAROPT_HISTORY_NUM_FIELDS = 15;
+static const char *paropt_history_fields[] =
+  {"iter", "nobj", "ngrd", "nhvc", "alpha", "alphx", "alphz", "fobj",
+   "|opt|", "|infes|", "|dual|", "mu", "comp", "dmerit", "rho"};
+
+/*
+  The minimum number of dense constraints for which the blocked
+  assembly is used. For fewer constraints, the inner products are
+  computed directly.
+*/
+static const int PAROPT_SCHUR_MIN_CONSTRAINTS = 8;
+
+/*
+  The size of the blocks used to compute the threaded products with
+  the mixed precision GMRES basis
+*/
+static const int PAROPT_GMRES_BLOCK_SIZE = 4096;
+
+/*
+  The minimum fraction of the variables that must be firmly active
+  before the design vectors are compressed in the reduced-space mode
+*/
+static const double PAROPT_ACTIVE_SET_MIN_FRACTION = 0.1;
+
 /*
   The following are the help-strings for each of the parameters
   in the file. These provide some description of the purpose of
   each parameter and how you should set it.
 */
 
-static const int NUM_PAROPT_PARAMETERS = 34;
+static const int NUM_PAROPT_PARAMETERS = 45;
 static const char *paropt_parameter_help[][2] = {
   {"max_qn_size",
    "Integer: The maximum dimension of the quasi-Newton approximation"},
@@ -21,6 +56,9 @@ static const char *paropt_parameter_help[][2] = {
   {"starting_point_strategy",
    "Enum: Initialize the Lagrange multiplier estimates and slack variables"},
 
+  {"use_warm_start",
+   "Boolean: Start from the previous primal-dual point and barrier"},
+
   {"barrier_param",
    "Float: The initial value of the barrier parameter"},
 
@@ -45,6 +83,9 @@ static const char *paropt_parameter_help[][2] = {
   {"max_line_iters",
    "Integer: Maximum number of line search iterations"},
 
+  {"line_search_batch_size",
+   "Integer: Number of step lengths evaluated together in the line search"},
+
   {"penalty_descent_fraction",
    "Float: Fraction of infeasibility used to enforce a descent direction"},
 
@@ -73,10 +114,16 @@ static const char *paropt_parameter_help[][2] = {
    "Integer: Write out the solution file and checkpoint file \
 at this frequency"},
 
+  {"async_checkpoint",
+   "Boolean: Write the checkpoint file without blocking the optimization"},
+
   {"gradient_check_frequency",
    "Integer: Print to screen the output of the gradient check \
 at this frequency"},
 
+  {"profile_output",
+   "Boolean: Print the time spent in each phase of the optimization"},
+
   {"sequential_linear_method",
    "Boolean: Discard the quasi-Newton approximation (but not \
 necessarily the exact Hessian)"},
@@ -97,6 +144,16 @@ iteration frequency"},
   {"use_diag_hessian",
    "Boolean: Use or do not use the diagonal Hessian computation"},
 
+  {"use_active_set",
+   "Boolean: Compress the design vectors to the variables that are not \
+firmly held at a bound"},
+
+  {"active_set_tol",
+   "Float: Bound gap and multiplier ratio tolerance for firmly active variables"},
+
+  {"active_set_expand_freq",
+   "Integer: Expand the compressed design vectors at this iteration frequency"},
+
   {"use_qn_gmres_precon",
    "Boolean: Use or do not use the quasi-Newton method as a preconditioner"},
 
@@ -112,6 +169,18 @@ iteration frequency"},
   {"gmres_subspace_size",
    "Integer: The subspace size for GMRES"},
 
+  {"gmres_type",
+   "Enum: Use modified Gram-Schmidt or pipelined GMRES"},
+
+  {"gmres_mixed_precision",
+   "Boolean: Store the GMRES subspace in single precision"},
+
+  {"gmres_block_size",
+   "Integer: The number of directions per block GMRES iteration"},
+
+  {"gmres_recycle_size",
+   "Integer: The number of harmonic Ritz vectors recycled between GMRES solves"},
+
   {"max_gmres_rtol",
    "Float: The maximum relative tolerance used for GMRES, above this \
 the quasi-Newton approximation is used"},
@@ -278,16 +347,35 @@ ParOptInteriorPoint::ParOptInteriorPoint( ParOptProblem *_prob,
   // Allocate space for the block-diagonal matrix
   Cw = new ParOptScalar[ nwcon*(nwblock+1)/2 ];
 
-  // Allocate space for off-diagonal entries
-  Ew = new ParOptVec*[ ncon ];
-  for ( int i = 0; i < ncon; i++ ){
-    Ew[i] = prob->createConstraintVec();
-    Ew[i]->incref();
-  }
+  // Allocate space for off-diagonal entries with contiguous storage
+  // when possible so that Dw can be assembled with a matrix product
+  Ewvec = prob->createConstraintMultiVec(ncon);
+  Ewvec->incref();
+  Ew = Ewvec->getVecs();
 
-  // Allocate space for the Dmatrix
+  // Allocate space for the Dmatrix and the work array used for its
+  // assembly and factorization
   Dmat = new ParOptScalar[ ncon*ncon ];
   dpiv = new int[ ncon ];
+  dwork_size = PAROPT_SCHUR_BLOCK_SIZE*(ncon+1);
+  if (ncon*ncon > dwork_size){
+    dwork_size = ncon*ncon;
+  }
+  dwork = new ParOptScalar[ dwork_size ];
+  dmat_cholesky = 0;
+
+  // Allocate the block of Cw^{-1}*Ew products used by the blocked
+  // assembly of Dw
+  dwblock = NULL;
+  if (nwcon > 0 && ncon >= PAROPT_SCHUR_MIN_CONSTRAINTS){
+    dwblock = new ParOptScalar[ nwcon*PAROPT_SCHUR_BLOCK_COLS ];
+  }
+
+  // No factorization has been computed yet
+  kkt_diag_valid = kkt_system_valid = 0;
+  kkt_diag_use_hdiag = kkt_system_use_qn = 0;
+  kkt_diag_b0 = 0.0;
+  kkt_diag_sigma = 0.0;
 
   // Get the maximum subspace size
   max_qn_size = 0;
@@ -328,17 +416,20 @@ ParOptInteriorPoint::ParOptInteriorPoint( ParOptProblem *_prob,
   g = prob->createDesignVec();
   g->incref();
 
-  Ac = new ParOptVec*[ ncon ];
-  for ( int i = 0; i < ncon; i++ ){
-    Ac[i] = prob->createDesignVec();
-    Ac[i]->incref();
-  }
+  // Allocate the constraint gradients with contiguous storage when
+  // possible so that products with A are computed in a single pass
+  Acvec = prob->createDesignMultiVec(ncon);
+  Acvec->incref();
+  Ac = Acvec->getVecs();
+  ctemp = new ParOptScalar[ ncon ];
 
   // Zero the number of evals
   neval = ngeval = nhvec = 0;
 
   // Set the default starting point strategy
   starting_point_strategy = PAROPT_LEAST_SQUARES_MULTIPLIERS;
+  use_warm_start = 0;
+  warm_start_ready = 0;
 
   // Set the barrier strategy
   barrier_strategy = PAROPT_MONOTONE;
@@ -386,6 +477,20 @@ ParOptInteriorPoint::ParOptInteriorPoint( ParOptProblem *_prob,
   use_diag_hessian = 0;
   hdiag = NULL;
 
+  // Initialize the reduced-space mode
+  use_active_set = 0;
+  active_set_tol = 1e-3;
+  active_set_expand_freq = 10;
+  nvars_full = nvars;
+  active_set_compressed = 0;
+  active_set = NULL;
+  active_set_flags = NULL;
+  active_set_xfixed = NULL;
+  active_set_zeros = NULL;
+
+  // No binary history by default
+  history = NULL;
+
   // Initialize the Hessian-vector product information
   use_hvec_product = 0;
   use_qn_gmres_precon = 1;
@@ -399,6 +504,29 @@ ParOptInteriorPoint::ParOptInteriorPoint( ParOptProblem *_prob,
   outfp = stdout;
   output_level = 0;
 
+  // Create the profiler, but do not print the profile by default
+  profiler = new ParOptProfiler();
+  profiler->incref();
+  profile_output = 0;
+
+  // Write the checkpoint files with blocking calls by default
+  use_async_checkpoint = 0;
+  checkpoint_pending = 0;
+  checkpoint_fname = NULL;
+  checkpoint_fp = NULL;
+  checkpoint_buffer[0] = checkpoint_buffer[1] = NULL;
+  checkpoint_buffer_size[0] = checkpoint_buffer_size[1] = 0;
+  checkpoint_buffer_index = 0;
+
+  // Evaluate a single step length at a time in the line search
+  line_search_batch_size = 1;
+  line_search_x = NULL;
+  line_search_alpha = NULL;
+  line_search_fobj = NULL;
+  line_search_con = NULL;
+  line_search_best_con = NULL;
+  line_search_fail = NULL;
+
   // Set the default information about GMRES
   gmres_subspace_size = 0;
   gmres_H = NULL;
@@ -409,7 +537,30 @@ ParOptInteriorPoint::ParOptInteriorPoint( ParOptProblem *_prob,
   gmres_aproj = NULL;
   gmres_awproj = NULL;
   gmres_Q = NULL;
+  gmres_num_W = 0;
   gmres_W = NULL;
+  gmres_AW = NULL;
+  gmres_type = PAROPT_MGS_GMRES;
+  gmres_mixed_precision = 0;
+  gmres_Wf = NULL;
+  gmres_Wf_partial = NULL;
+  gmres_block_size = 1;
+  gmres_num_seeds = 0;
+  gmres_seed_ptr = 0;
+  gmres_P = NULL;
+  gmres_seeds = NULL;
+  gmres_recycle_size = 0;
+  gmres_num_recycle = 0;
+  gmres_num_new_recycle = 0;
+  gmres_U = NULL;
+  gmres_C = NULL;
+  gmres_Unew = NULL;
+  gmres_B = NULL;
+  gmres_G = NULL;
+  gmres_ufproj = NULL;
+  gmres_ucproj = NULL;
+  gmres_fproj0 = 0.0;
+  gmres_cproj0 = 0.0;
 
   // Initialize the design variables and bounds
   initAndCheckDesignAndBounds();
@@ -434,10 +585,24 @@ ParOptInteriorPoint::ParOptInteriorPoint( ParOptProblem *_prob,
    Free the data allocated during the creation of the object
 */
 ParOptInteriorPoint::~ParOptInteriorPoint(){
+  // Finish writing any checkpoint file that is still in progress
+  completeCheckpoint();
+  delete [] checkpoint_buffer[0];
+  delete [] checkpoint_buffer[1];
+
+  // Free the speculative line search data (if allocated)
+  setLineSearchBatchSize(1);
+
+  // Close the history files
+  if (history){
+    history->decref();
+  }
+
   prob->decref();
   if (qn){
     qn->decref();
   }
+  profiler->decref();
 
   // Delete the variables and bounds
   x->decref();
@@ -486,14 +651,13 @@ ParOptInteriorPoint::~ParOptInteriorPoint(){
   // Delete the matrix
   delete [] Cw;
 
-  for ( int i = 0; i < ncon; i++ ){
-    Ew[i]->decref();
-  }
-  delete [] Ew;
+  Ewvec->decref();
 
   // Delete the various matrices
   delete [] Dmat;
   delete [] dpiv;
+  delete [] dwork;
+  if (dwblock){ delete [] dwblock; }
   if (Ce){ delete [] Ce; }
   if (cpiv){ delete [] cpiv; }
 
@@ -512,31 +676,22 @@ ParOptInteriorPoint::~ParOptInteriorPoint(){
     hdiag->decref();
   }
 
+  // Free the active set data (if allocated)
+  if (active_set){
+    active_set->decref();
+    delete [] active_set_flags;
+    delete [] active_set_xfixed;
+    delete [] active_set_zeros;
+  }
+
   // Delete the constraint/gradient information
   delete [] c;
   g->decref();
-  for ( int i = 0; i < ncon; i++ ){
-    Ac[i]->decref();
-  }
-  delete [] Ac;
+  Acvec->decref();
+  delete [] ctemp;
 
   // Delete the GMRES information if any
-  if (gmres_subspace_size > 0){
-    delete [] gmres_H;
-    delete [] gmres_alpha;
-    delete [] gmres_res;
-    delete [] gmres_y;
-    delete [] gmres_fproj;
-    delete [] gmres_aproj;
-    delete [] gmres_awproj;
-    delete [] gmres_Q;
-
-    // Delete the subspace
-    for ( int i = 0; i < gmres_subspace_size; i++ ){
-      gmres_W[i]->decref();
-    }
-    delete [] gmres_W;
-  }
+  deleteGMRESSubspace();
 
   // Close the output file if it's not stdout
   if (outfp && outfp != stdout){
@@ -728,6 +883,7 @@ void ParOptInteriorPoint::printOptionSummary( FILE *fp ){
       fprintf(fp, "%-30s %15s\n", "starting_point_strategy",
               "AFFINE_STEP");
     }
+    fprintf(fp, "%-30s %15d\n", "use_warm_start", use_warm_start);
     fprintf(fp, "%-30s %15g\n", "barrier_param", barrier_param);
     fprintf(fp, "%-30s %15g\n", "abs_res_tol", abs_res_tol);
     fprintf(fp, "%-30s %15g\n", "rel_func_tol", rel_func_tol);
@@ -736,6 +892,8 @@ void ParOptInteriorPoint::printOptionSummary( FILE *fp ){
     fprintf(fp, "%-30s %15d\n", "use_backtracking_alpha",
             use_backtracking_alpha);
     fprintf(fp, "%-30s %15d\n", "max_line_iters", max_line_iters);
+    fprintf(fp, "%-30s %15d\n", "line_search_batch_size",
+            line_search_batch_size);
     fprintf(fp, "%-30s %15g\n", "penalty_descent_fraction",
             penalty_descent_fraction);
     fprintf(fp, "%-30s %15g\n", "min_rho_penalty_search",
@@ -753,10 +911,13 @@ void ParOptInteriorPoint::printOptionSummary( FILE *fp ){
             major_iter_step_check);
     fprintf(fp, "%-30s %15d\n", "write_output_frequency",
             write_output_frequency);
+    fprintf(fp, "%-30s %15d\n", "async_checkpoint",
+            use_async_checkpoint);
     fprintf(fp, "%-30s %15d\n", "gradient_check_frequency",
             gradient_check_frequency);
     fprintf(fp, "%-30s %15g\n", "gradient_check_step",
             gradient_check_step);
+    fprintf(fp, "%-30s %15d\n", "profile_output", profile_output);
     fprintf(fp, "%-30s %15d\n", "sequential_linear_method",
             sequential_linear_method);
     fprintf(fp, "%-30s %15d\n", "hessian_reset_freq",
@@ -768,6 +929,10 @@ void ParOptInteriorPoint::printOptionSummary( FILE *fp ){
             use_hvec_product);
     fprintf(fp, "%-30s %15d\n", "use_diag_hessian",
             use_diag_hessian);
+    fprintf(fp, "%-30s %15d\n", "use_active_set", use_active_set);
+    fprintf(fp, "%-30s %15g\n", "active_set_tol", active_set_tol);
+    fprintf(fp, "%-30s %15d\n", "active_set_expand_freq",
+            active_set_expand_freq);
     fprintf(fp, "%-30s %15d\n", "use_qn_gmres_precon",
             use_qn_gmres_precon);
     fprintf(fp, "%-30s %15g\n", "nk_switch_tol", nk_switch_tol);
@@ -777,6 +942,16 @@ void ParOptInteriorPoint::printOptionSummary( FILE *fp ){
             eisenstat_walker_gamma);
     fprintf(fp, "%-30s %15d\n", "gmres_subspace_size",
             gmres_subspace_size);
+    if (gmres_type == PAROPT_PIPELINED_GMRES){
+      fprintf(fp, "%-30s %15s\n", "gmres_type", "PIPELINED");
+    }
+    else {
+      fprintf(fp, "%-30s %15s\n", "gmres_type", "MGS");
+    }
+    fprintf(fp, "%-30s %15d\n", "gmres_mixed_precision",
+            gmres_mixed_precision);
+    fprintf(fp, "%-30s %15d\n", "gmres_block_size", gmres_block_size);
+    fprintf(fp, "%-30s %15d\n", "gmres_recycle_size", gmres_recycle_size);
     fprintf(fp, "%-30s %15g\n", "max_gmres_rtol", max_gmres_rtol);
     fprintf(fp, "%-30s %15g\n", "gmres_atol", gmres_atol);
   }
@@ -786,25 +961,159 @@ void ParOptInteriorPoint::printOptionSummary( FILE *fp ){
    Write out the design variables, Lagrange multipliers and
    slack variables to a binary file in parallel.
 
+   The file also contains the state of the quasi-Newton approximation
+   so that the curvature information is retained on a restart. This
+   call blocks until the file has been written.
+
    @param filename is the name of the file to write
 */
 int ParOptInteriorPoint::writeSolutionFile( const char *filename ){
-  char *fname = new char[ strlen(filename)+1 ];
-  strcpy(fname, filename);
+  return writeCheckpoint(filename, 0);
+}
+
+/*
+  Write the solution and the quasi-Newton state to a file.
+
+  The root processor writes the header that contains the global
+  sizes, the barrier parameter and the dense multipliers and slack
+  variables. The distributed x, zl, zu, zw and sw values follow. The
+  quasi-Newton section consists of the number of state values and
+  vectors (stored as scalars), the state values and the distributed
+  state vectors.
+
+  The distributed values are copied into a staging buffer and written
+  with a single collective call through a file view. When nonblocking
+  is set, the write is started with MPI_File_iwrite_at_all and only
+  completed by the next call to completeCheckpoint(). Two staging
+  buffers are used so that the snapshot is taken before waiting for
+  the previous write.
+
+  The data is written to a temporary file, <filename>.tmp, that only
+  replaces the checkpoint once the write has completed on all
+  processors. An interrupted write therefore never destroys the last
+  complete checkpoint.
+*/
+int ParOptInteriorPoint::writeCheckpoint( const char *filename,
+                                          int nonblocking ){
+  int size, rank;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+
+  // Get the size of the quasi-Newton state
+  int qn_nvals = 0, qn_nvecs = 0;
+  if (qn){
+    qn->getStateSize(&qn_nvals, &qn_nvecs);
+  }
+
+  // Compute the local segments of the file. The displacements are
+  // relative to the end of the header.
+  int nwsize = wcon_range[rank+1] - wcon_range[rank];
+  size_t nglobal = var_range[size];
+  size_t nwglobal = wcon_range[size];
+  size_t qn_offset = 3*nglobal + 2*nwglobal;
+
+  int max_segs = 6 + qn_nvecs;
+  int *lens = new int[ max_segs ];
+  MPI_Aint *disps = new MPI_Aint[ max_segs ];
+  int nsegs = 0;
+  for ( int k = 0; k < 3; k++, nsegs++ ){
+    lens[nsegs] = nvars;
+    disps[nsegs] = (k*nglobal + var_range[rank])*sizeof(ParOptScalar);
+  }
+  if (nwglobal > 0){
+    for ( int k = 0; k < 2; k++, nsegs++ ){
+      lens[nsegs] = nwsize;
+      disps[nsegs] = (3*nglobal + k*nwglobal +
+                      wcon_range[rank])*sizeof(ParOptScalar);
+    }
+  }
+  if (rank == opt_root){
+    lens[nsegs] = 2 + qn_nvals;
+    disps[nsegs] = qn_offset*sizeof(ParOptScalar);
+    nsegs++;
+  }
+  for ( int k = 0; k < qn_nvecs; k++, nsegs++ ){
+    lens[nsegs] = nvars;
+    disps[nsegs] = (qn_offset + 2 + qn_nvals + k*nglobal +
+                    var_range[rank])*sizeof(ParOptScalar);
+  }
+
+  int count = 0;
+  for ( int k = 0; k < nsegs; k++ ){
+    count += lens[k];
+  }
+
+  // Take the snapshot in the staging buffer that is not in use
+  int index = 1 - checkpoint_buffer_index;
+  if (count > checkpoint_buffer_size[index]){
+    delete [] checkpoint_buffer[index];
+    checkpoint_buffer_size[index] = count;
+    checkpoint_buffer[index] = new ParOptScalar[ count ];
+  }
+  ParOptScalar *buffer = checkpoint_buffer[index];
+
+  ParOptScalar *xvals, *zlvals, *zuvals;
+  x->getArray(&xvals);
+  zl->getArray(&zlvals);
+  zu->getArray(&zuvals);
+  ParOptScalar *ptr = buffer;
+  memcpy(ptr, xvals, nvars*sizeof(ParOptScalar));  ptr += nvars;
+  memcpy(ptr, zlvals, nvars*sizeof(ParOptScalar));  ptr += nvars;
+  memcpy(ptr, zuvals, nvars*sizeof(ParOptScalar));  ptr += nvars;
+  if (nwglobal > 0){
+    ParOptScalar *zwvals, *swvals;
+    zw->getArray(&zwvals);
+    sw->getArray(&swvals);
+    memcpy(ptr, zwvals, nwsize*sizeof(ParOptScalar));  ptr += nwsize;
+    memcpy(ptr, swvals, nwsize*sizeof(ParOptScalar));  ptr += nwsize;
+  }
+
+  ParOptVec **qn_vecs = NULL;
+  if (qn_nvals > 0){
+    ParOptScalar *qn_vals = new ParOptScalar[ qn_nvals ];
+    qn_vecs = new ParOptVec*[ qn_nvecs ];
+    qn->getState(qn_vals, qn_vecs);
+    if (rank == opt_root){
+      ptr[0] = qn_nvals;
+      ptr[1] = qn_nvecs;
+      memcpy(&ptr[2], qn_vals, qn_nvals*sizeof(ParOptScalar));
+      ptr += 2 + qn_nvals;
+    }
+    delete [] qn_vals;
+  }
+  else if (rank == opt_root){
+    ptr[0] = ptr[1] = 0.0;
+    ptr += 2;
+  }
+  for ( int k = 0; k < qn_nvecs; k++ ){
+    ParOptScalar *vals;
+    qn_vecs[k]->getArray(&vals);
+    memcpy(ptr, vals, nvars*sizeof(ParOptScalar));
+    ptr += nvars;
+  }
+  if (qn_vecs){
+    delete [] qn_vecs;
+  }
+
+  // Wait for the previous checkpoint to be written
+  int fail = completeCheckpoint();
+
+  char *fname = new char[ strlen(filename)+5 ];
+  sprintf(fname, "%s.tmp", filename);
 
-  int fail = 1;
   MPI_File fp = NULL;
-  MPI_File_open(comm, fname, MPI_MODE_WRONLY | MPI_MODE_CREATE,
-                MPI_INFO_NULL, &fp);
+  if (!fail){
+    MPI_File_open(comm, fname, MPI_MODE_WRONLY | MPI_MODE_CREATE,
+                  MPI_INFO_NULL, &fp);
+  }
+  delete [] fname;
 
   if (fp){
-    // Calculate the total number of variable across all processors
-    int size, rank;
-    MPI_Comm_rank(comm, &rank);
-    MPI_Comm_size(comm, &size);
-
-    // Successfull opened the file
-    fail = 0;
+    // Set the file size, truncating any data from a larger file
+    size_t header = 3*sizeof(int) + (2*ncon+1)*sizeof(ParOptScalar);
+    size_t total = header + (qn_offset + 2 + qn_nvals +
+                             qn_nvecs*nglobal)*sizeof(ParOptScalar);
+    MPI_File_set_size(fp, total);
 
     // Write the problem sizes on the root processor
     if (rank == opt_root){
@@ -813,65 +1122,124 @@ int ParOptInteriorPoint::writeSolutionFile( const char *filename ){
       var_sizes[1] = wcon_range[size];
       var_sizes[2] = ncon;
 
-      MPI_File_write(fp, var_sizes, 3, MPI_INT, MPI_STATUS_IGNORE);
-      MPI_File_write(fp, &barrier_param, 1,
-                     PAROPT_MPI_TYPE, MPI_STATUS_IGNORE);
-      MPI_File_write(fp, z, ncon, PAROPT_MPI_TYPE, MPI_STATUS_IGNORE);
-      MPI_File_write(fp, s, ncon, PAROPT_MPI_TYPE, MPI_STATUS_IGNORE);
-    }
-
-    size_t offset = 3*sizeof(int) + (2*ncon+1)*sizeof(ParOptScalar);
+      MPI_Offset offset = 0;
+      MPI_File_write_at(fp, offset, var_sizes, 3, MPI_INT,
+                        MPI_STATUS_IGNORE);
+      offset += 3*sizeof(int);
+      MPI_File_write_at(fp, offset, &barrier_param, 1,
+                        PAROPT_MPI_TYPE, MPI_STATUS_IGNORE);
+      offset += sizeof(ParOptScalar);
+      MPI_File_write_at(fp, offset, z, ncon,
+                        PAROPT_MPI_TYPE, MPI_STATUS_IGNORE);
+      offset += ncon*sizeof(ParOptScalar);
+      MPI_File_write_at(fp, offset, s, ncon,
+                        PAROPT_MPI_TYPE, MPI_STATUS_IGNORE);
+    }
+
+    // Create the view of the local segments of the file
+    MPI_Datatype filetype;
+    MPI_Type_create_hindexed(nsegs, lens, disps, PAROPT_MPI_TYPE, &filetype);
+    MPI_Type_commit(&filetype);
 
     // Use the native representation for the data
     char datarep[] = "native";
-
-    // Extract the design variables
-    ParOptScalar *xvals;
-    int xsize = x->getArray(&xvals);
-    MPI_File_set_view(fp, offset, PAROPT_MPI_TYPE, PAROPT_MPI_TYPE,
+    MPI_File_set_view(fp, header, PAROPT_MPI_TYPE, filetype,
                       datarep, MPI_INFO_NULL);
-    MPI_File_write_at_all(fp, var_range[rank], xvals, xsize,
-                          PAROPT_MPI_TYPE, MPI_STATUS_IGNORE);
-    offset += var_range[size]*sizeof(ParOptScalar);
 
-    // Extract the lower Lagrange multipliers
-    ParOptScalar *zlvals, *zuvals;
-    zl->getArray(&zlvals);
-    zu->getArray(&zuvals);
-    MPI_File_set_view(fp, offset, PAROPT_MPI_TYPE, PAROPT_MPI_TYPE,
-                      datarep, MPI_INFO_NULL);
-    MPI_File_write_at_all(fp, var_range[rank], zlvals, xsize,
-                          PAROPT_MPI_TYPE, MPI_STATUS_IGNORE);
-    offset += var_range[size]*sizeof(ParOptScalar);
+    if (nonblocking){
+      if (MPI_File_iwrite_at_all(fp, 0, buffer, count, PAROPT_MPI_TYPE,
+                                 &checkpoint_request) != MPI_SUCCESS){
+        fail = 1;
+        MPI_File_close(&fp);
+        MPI_Type_free(&filetype);
+      }
+      else {
+        checkpoint_fp = fp;
+        checkpoint_filetype = filetype;
+        checkpoint_buffer_index = index;
+        checkpoint_pending = 1;
+        checkpoint_fname = new char[ strlen(filename)+1 ];
+        strcpy(checkpoint_fname, filename);
+      }
+    }
+    else {
+      if (MPI_File_write_at_all(fp, 0, buffer, count, PAROPT_MPI_TYPE,
+                                MPI_STATUS_IGNORE) != MPI_SUCCESS){
+        fail = 1;
+      }
+      MPI_File_close(&fp);
+      MPI_Type_free(&filetype);
+    }
+  }
+  else {
+    fail = 1;
+  }
 
-    // Write out the upper Lagrange multipliers
-    MPI_File_set_view(fp, offset, PAROPT_MPI_TYPE, PAROPT_MPI_TYPE,
-                      datarep, MPI_INFO_NULL);
-    MPI_File_write_at_all(fp, var_range[rank], zuvals, xsize,
-                          PAROPT_MPI_TYPE, MPI_STATUS_IGNORE);
-    offset += var_range[size]*sizeof(ParOptScalar);
+  delete [] lens;
+  delete [] disps;
 
-    // Write out the extra constraint bounds
-    if (wcon_range[size] > 0){
-      ParOptScalar *zwvals, *swvals;
-      int nwsize = zw->getArray(&zwvals);
-      sw->getArray(&swvals);
-      MPI_File_set_view(fp, offset, PAROPT_MPI_TYPE, PAROPT_MPI_TYPE,
-                        datarep, MPI_INFO_NULL);
-      MPI_File_write_at_all(fp, wcon_range[rank], zwvals, nwsize,
-                            PAROPT_MPI_TYPE, MPI_STATUS_IGNORE);
-      offset += wcon_range[size]*sizeof(ParOptScalar);
+  // Make the result consistent across all processors
+  ParOptAllreduce(MPI_IN_PLACE, &fail, 1, MPI_INT, MPI_MAX, comm);
 
-      MPI_File_set_view(fp, offset, PAROPT_MPI_TYPE, PAROPT_MPI_TYPE,
-                        datarep, MPI_INFO_NULL);
-      MPI_File_write_at_all(fp, wcon_range[rank], swvals, nwsize,
-                            PAROPT_MPI_TYPE, MPI_STATUS_IGNORE);
+  // The blocking write is complete, so replace the checkpoint
+  if (!nonblocking){
+    fail = commitCheckpoint(filename, fail);
+  }
+
+  return fail;
+}
+
+/*
+  Replace the checkpoint file with the completed temporary file.
+
+  The rename is only performed on the root processor, and only if the
+  write succeeded on all processors. Otherwise the previous checkpoint
+  is left in place.
+*/
+int ParOptInteriorPoint::commitCheckpoint( const char *filename,
+                                           int fail ){
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if (!fail && rank == opt_root){
+    char *fname = new char[ strlen(filename)+5 ];
+    sprintf(fname, "%s.tmp", filename);
+    if (rename(fname, filename) != 0){
+      fail = 1;
     }
-    MPI_File_close(&fp);
+    delete [] fname;
   }
+  MPI_Bcast(&fail, 1, MPI_INT, opt_root, comm);
 
-  delete [] fname;
+  return fail;
+}
+
+/**
+   Complete the checkpoint file write that is in progress, if any, and
+   replace the previous checkpoint with the completed file.
+
+   This call is collective on the optimizer's communicator.
+
+   @return non-zero if the checkpoint file could not be written
+*/
+int ParOptInteriorPoint::completeCheckpoint(){
+  int fail = 0;
+  if (checkpoint_pending){
+    if (MPI_Wait(&checkpoint_request, MPI_STATUS_IGNORE) != MPI_SUCCESS){
+      fail = 1;
+    }
+    MPI_File_close(&checkpoint_fp);
+    MPI_Type_free(&checkpoint_filetype);
+    checkpoint_fp = NULL;
+    checkpoint_pending = 0;
+
+    // Make the result consistent across all processors
+    ParOptAllreduce(MPI_IN_PLACE, &fail, 1, MPI_INT, MPI_MAX, comm);
 
+    // Replace the previous checkpoint with the completed file
+    fail = commitCheckpoint(checkpoint_fname, fail);
+    delete [] checkpoint_fname;
+    checkpoint_fname = NULL;
+  }
   return fail;
 }
 
@@ -880,11 +1248,15 @@ int ParOptInteriorPoint::writeSolutionFile( const char *filename ){
    variables from a binary file.
 
    This function requires that the same problem structure as the
-   original problem.
+   original problem. If the file contains the state of a compatible
+   quasi-Newton approximation, the approximation is also restored.
 
    @param filename is the name of the file input
 */
 int ParOptInteriorPoint::readSolutionFile( const char *filename ){
+  // Make sure that any checkpoint file has been completely written
+  completeCheckpoint();
+
   char *fname = new char[ strlen(filename)+1 ];
   strcpy(fname, filename);
 
@@ -991,9 +1363,74 @@ int ParOptInteriorPoint::readSolutionFile( const char *filename ){
                            PAROPT_MPI_TYPE, MPI_STATUS_IGNORE);
     }
 
+    // Read in the quasi-Newton state if it is contained in the file
+    offset = 3*sizeof(int) + (2*ncon+1)*sizeof(ParOptScalar) +
+      (3*var_range[size] + 2*wcon_range[size])*sizeof(ParOptScalar);
+    MPI_Offset file_size = 0;
+    MPI_File_get_size(fp, &file_size);
+
+    if ((size_t)file_size >= offset + 2*sizeof(ParOptScalar)){
+      MPI_File_set_view(fp, offset, PAROPT_MPI_TYPE, PAROPT_MPI_TYPE,
+                        datarep, MPI_INFO_NULL);
+
+      // Read the number of state values and vectors
+      ParOptScalar qn_sizes[2];
+      qn_sizes[0] = qn_sizes[1] = 0.0;
+      if (rank == opt_root){
+        MPI_File_read_at(fp, 0, qn_sizes, 2, PAROPT_MPI_TYPE,
+                         MPI_STATUS_IGNORE);
+      }
+      MPI_Bcast(qn_sizes, 2, PAROPT_MPI_TYPE, opt_root, comm);
+      int qn_nvals = (int)ParOptRealPart(qn_sizes[0]);
+      int qn_nvecs = (int)ParOptRealPart(qn_sizes[1]);
+
+      if (qn && qn_nvals > 0){
+        ParOptScalar *qn_vals = new ParOptScalar[ qn_nvals ];
+        if (rank == opt_root){
+          MPI_File_read_at(fp, 2, qn_vals, qn_nvals, PAROPT_MPI_TYPE,
+                           MPI_STATUS_IGNORE);
+        }
+        MPI_Bcast(qn_vals, qn_nvals, PAROPT_MPI_TYPE, opt_root, comm);
+
+        // Read in the distributed vectors
+        ParOptVec **qn_vecs = new ParOptVec*[ qn_nvecs ];
+        for ( int k = 0; k < qn_nvecs; k++ ){
+          qn_vecs[k] = prob->createDesignVec();
+          qn_vecs[k]->incref();
+
+          ParOptScalar *vals;
+          int vsize = qn_vecs[k]->getArray(&vals);
+          MPI_Offset pos = 2 + qn_nvals;
+          pos += (MPI_Offset)k*var_range[size] + var_range[rank];
+          MPI_File_read_at_all(fp, pos, vals, vsize,
+                               PAROPT_MPI_TYPE, MPI_STATUS_IGNORE);
+        }
+
+        // Restore the state, skipping an incompatible approximation
+        if (qn->setState(qn_vals, qn_vecs)){
+          if (rank == opt_root){
+            fprintf(stderr, "ParOpt: Quasi-Newton state in solution "
+                    "file is incompatible and was not restored\n");
+          }
+        }
+        invalidateKKTFactorization();
+
+        for ( int k = 0; k < qn_nvecs; k++ ){
+          qn_vecs[k]->decref();
+        }
+        delete [] qn_vecs;
+        delete [] qn_vals;
+      }
+    }
+
     MPI_File_close(&fp);
   }
 
+  // The point read from the file can be used as a warm start
+  if (!fail){
+    warm_start_ready = 1;
+  }
+
   return fail;
 }
 
@@ -1053,6 +1490,25 @@ void ParOptInteriorPoint::setStartingPointStrategy( ParOptStartingPointStrategy
   starting_point_strategy = strategy;
 }
 
+/**
+   Set whether to warm-start the optimization.
+
+   When this is set, each call to optimize() after the first starts
+   from the primal-dual point of the previous call (or the point read
+   from a solution file) rather than the point returned by
+   getVarsAndBounds(). The design variables are shifted into the
+   current bounds, the multipliers and slacks are kept away from zero
+   and the initial barrier parameter is set from the complementarity
+   at the shifted point. The starting point strategy and the initial
+   barrier parameter are not used for a warm start. This is intended
+   for sequences of closely related subproblems.
+
+   @param truth flag indicating whether to use a warm start
+*/
+void ParOptInteriorPoint::setUseWarmStart( int truth ){
+  use_warm_start = truth;
+}
+
 /**
    Set the maximum number of major iterations.
 
@@ -1236,6 +1692,59 @@ void ParOptInteriorPoint::setMaxLineSearchIters( int iters ){
   }
 }
 
+/**
+   Set the number of step lengths evaluated together in the line search.
+
+   When the size is greater than one, each line search iteration
+   evaluates a bracket of step lengths through
+   ParOptProblem::evalObjConBatch() and accepts the point with the
+   lowest merit function value that satisfies the sufficient decrease
+   condition. This pays off when the problem evaluates the batch
+   concurrently. A size of one uses the sequential line search.
+
+   @param size the number of step lengths per line search iteration
+*/
+void ParOptInteriorPoint::setLineSearchBatchSize( int size ){
+  if (size < 1){
+    size = 1;
+  }
+  if (size == line_search_batch_size){
+    return;
+  }
+
+  if (line_search_x){
+    for ( int i = 0; i < line_search_batch_size; i++ ){
+      line_search_x[i]->decref();
+    }
+    delete [] line_search_x;
+    delete [] line_search_alpha;
+    delete [] line_search_fobj;
+    delete [] line_search_con;
+    delete [] line_search_best_con;
+    delete [] line_search_fail;
+    line_search_x = NULL;
+    line_search_alpha = NULL;
+    line_search_fobj = NULL;
+    line_search_con = NULL;
+    line_search_best_con = NULL;
+    line_search_fail = NULL;
+  }
+
+  line_search_batch_size = size;
+  if (size > 1){
+    line_search_x = new ParOptVec*[ size ];
+    for ( int i = 0; i < size; i++ ){
+      line_search_x[i] = prob->createDesignVec();
+      line_search_x[i]->incref();
+    }
+    line_search_alpha = new double[ size ];
+    line_search_fobj = new ParOptScalar[ size ];
+    line_search_con = new ParOptScalar[ size*ncon ];
+    line_search_best_con = new ParOptScalar[ ncon ];
+    line_search_fail = new int[ size ];
+  }
+}
+
 /**
    Set whether to use a backtracking line search.
 
@@ -1349,33 +1858,7 @@ void ParOptInteriorPoint::setGradientCheckFrequency( int freq, double step_size
 */
 void ParOptInteriorPoint::setUseDiagHessian( int truth ){
   if (truth){
-    if (gmres_H){
-      delete [] gmres_H;
-      delete [] gmres_alpha;
-      delete [] gmres_res;
-      delete [] gmres_y;
-      delete [] gmres_fproj;
-      delete [] gmres_aproj;
-      delete [] gmres_awproj;
-      delete [] gmres_Q;
-
-      for ( int i = 0; i < gmres_subspace_size; i++ ){
-        gmres_W[i]->decref();
-      }
-      delete [] gmres_W;
-
-      // Null out the subspace data
-      gmres_subspace_size = 0;
-      gmres_H = NULL;
-      gmres_alpha = NULL;
-      gmres_res = NULL;
-      gmres_y = NULL;
-      gmres_fproj = NULL;
-      gmres_aproj = NULL;
-      gmres_awproj = NULL;
-      gmres_Q = NULL;
-      gmres_W = NULL;
-    }
+    deleteGMRESSubspace();
     if (!hdiag){
       hdiag = prob->createDesignVec();
       hdiag->incref();
@@ -1385,6 +1868,53 @@ void ParOptInteriorPoint::setUseDiagHessian( int truth ){
   use_diag_hessian = truth;
 }
 
+/**
+   Set the flag to use the reduced-space mode.
+
+   In the reduced-space mode, variables that are firmly held at a
+   bound are fixed and the design vectors, the constraint gradients
+   and the quasi-Newton vectors are compressed to the remaining free
+   variables. All of the linear algebra, the quasi-Newton products and
+   the KKT solution then only involve the free variables. The vectors
+   are expanded and the active set is recomputed periodically, and
+   convergence is only declared for the full problem.
+
+   The reduced-space mode requires the ParOptBasicVec vectors, and is
+   not used with sparse constraints, Hessian-vector products, the
+   diagonal Hessian or quasi-Newton methods that do not support
+   compression.
+
+   @param truth flag to use the reduced-space mode
+*/
+void ParOptInteriorPoint::setUseActiveSet( int truth ){
+  use_active_set = truth;
+}
+
+/**
+   Set the tolerance for detecting firmly active variables. A variable
+   is fixed at its lower bound when x - lb < tol and x - lb < tol*zl,
+   and similarly at the upper bound.
+
+   @param tol the active set tolerance
+*/
+void ParOptInteriorPoint::setActiveSetTolerance( double tol ){
+  if (tol > 0.0){
+    active_set_tol = tol;
+  }
+}
+
+/**
+   Set the number of iterations performed with the compressed vectors
+   before they are expanded and the active set is recomputed
+
+   @param freq the expansion frequency
+*/
+void ParOptInteriorPoint::setActiveSetExpandFrequency( int freq ){
+  if (freq >= 1){
+    active_set_expand_freq = freq;
+  }
+}
+
 /**
    Set the flag for whether to use the Hessian-vector products or not
 */
@@ -1428,28 +1958,148 @@ void ParOptInteriorPoint::setGMRESTolerances( double rtol, double atol ){
 }
 
 /**
-   Set the parameters for choosing the forcing term in an inexact
-   Newton method.
-
-   The Newton forcing parameters are used to compute the relative
-   convergence tolerance as:
-
-   eta = gamma*(||r_{k}||/||r_{k-1}||)^{alpha}
-
-   @param gamma the linear factor
-   @param alpha the exponent
+   Set the type of GMRES method used for the Newton-Krylov step.
+
+   The pipelined variant computes all of the orthogonalization inner
+   products for each iteration with a single non-blocking reduction
+   that is overlapped with the next preconditioned Hessian-vector
+   product. This reduces the number of global synchronization points
+   on large numbers of processors. This comes at the expense of
+   additional storage (one extra vector per GMRES iteration), one
+   additional Hessian-vector product per solve and somewhat reduced
+   numerical stability.
+
+   @param type the type of GMRES method
 */
-void ParOptInteriorPoint::setEisenstatWalkerParameters( double gamma, double alpha ){
-  if (gamma > 0.0 && gamma <= 1.0){
-    eisenstat_walker_gamma = gamma;
-  }
-  if (alpha >= 0.0 && gamma <= 2.0){
-    eisenstat_walker_alpha = alpha;
-  }
+void ParOptInteriorPoint::setGMRESType( ParOptGMRESType type ){
+  gmres_type = type;
 }
 
 /**
-   Set the quasi-Newton update object.
+   Set the flag to store the GMRES subspace in single precision.
+
+   The Krylov basis vectors are rounded to single precision when they
+   are stored, halving the memory and bandwidth required by the
+   orthogonalization. The preconditioner, the Hessian-vector products
+   and the inner products are still computed in full precision. The
+   outer Newton iteration is computed from the full precision KKT
+   residual and so acts as an iterative refinement of the inexact step.
+   This option uses the modified Gram-Schmidt method, regardless of
+   the GMRES type.
+
+   @param truth flag to indicate whether to use mixed precision
+*/
+void ParOptInteriorPoint::setGMRESMixedPrecision( int truth ){
+  if ((truth ? 1 : 0) != gmres_mixed_precision){
+    gmres_mixed_precision = (truth ? 1 : 0);
+
+    // Re-allocate the subspace with the new storage
+    if (gmres_subspace_size > 0){
+      setGMRESSubspaceSize(gmres_subspace_size);
+    }
+  }
+}
+
+/**
+   Set the number of directions generated at each block GMRES
+   iteration.
+
+   When the block size is greater than one, the Krylov subspace is
+   generated from a block of starting vectors consisting of the
+   right-hand-side and the solutions of the most recent GMRES
+   solves. Each block iteration applies the preconditioner to all of
+   the directions in the block and evaluates the Hessian-vector
+   products with a single call to evalHvecProductBlock(). Problems
+   that can amortize the cost of the Hessian over several directions
+   can then compute the step with fewer, larger calls. The total
+   number of Hessian-vector products is bounded by the subspace size.
+
+   The block method uses the modified Gram-Schmidt method and is not
+   used with the single precision subspace. Until previous solutions
+   are available, the standard method is used.
+
+   @param size the number of directions in each block
+*/
+void ParOptInteriorPoint::setGMRESBlockSize( int size ){
+  if (size < 1){
+    size = 1;
+  }
+  if (size != gmres_block_size){
+    // Free the subspace before changing the block size, since the
+    // block size sets the number of block vectors
+    int m = gmres_subspace_size;
+    deleteGMRESSubspace();
+    gmres_block_size = size;
+
+    // Re-allocate the subspace with the new block size
+    if (m > 0){
+      setGMRESSubspaceSize(m);
+    }
+  }
+}
+
+/**
+   Set the number of vectors in the recycled Krylov subspace.
+
+   When the recycle size is greater than zero, GMRES keeps a small
+   deflation space of approximate harmonic Ritz vectors between
+   solves, in the style of GCRO-DR. The harmonic Ritz vectors with the
+   smallest harmonic Ritz values approximate the directions that slow
+   the convergence of GMRES. Since the KKT system changes between
+   iterations, the products of the new KKT matrix with the recycled
+   vectors are re-computed at the start of each solve at a cost of one
+   Hessian-vector product per vector. The Krylov subspace is then
+   generated with these directions projected out. The recycled space
+   is retained between calls to optimize(), so that it is also shared
+   between the trust-region subproblem solves.
+
+   Only the design components of the recycled vectors are stored,
+   since the remaining components of the right-hand-side change
+   between solves. Recycling uses the modified Gram-Schmidt method and
+   is not used with the pipelined, single precision or block methods.
+
+   @param size the maximum number of recycled vectors
+*/
+void ParOptInteriorPoint::setGMRESRecycleSize( int size ){
+  if (size < 0){
+    size = 0;
+  }
+  if (size != gmres_recycle_size){
+    // Free the subspace before changing the recycle size
+    int m = gmres_subspace_size;
+    deleteGMRESSubspace();
+    gmres_recycle_size = size;
+
+    // Re-allocate the subspace with the new recycle size
+    if (m > 0){
+      setGMRESSubspaceSize(m);
+    }
+  }
+}
+
+/**
+   Set the parameters for choosing the forcing term in an inexact
+   Newton method.
+
+   The Newton forcing parameters are used to compute the relative
+   convergence tolerance as:
+
+   eta = gamma*(||r_{k}||/||r_{k-1}||)^{alpha}
+
+   @param gamma the linear factor
+   @param alpha the exponent
+*/
+void ParOptInteriorPoint::setEisenstatWalkerParameters( double gamma, double alpha ){
+  if (gamma > 0.0 && gamma <= 1.0){
+    eisenstat_walker_gamma = gamma;
+  }
+  if (alpha >= 0.0 && gamma <= 2.0){
+    eisenstat_walker_alpha = alpha;
+  }
+}
+
+/**
+   Set the quasi-Newton update object.
 
    @param _qn the compact quasi-Newton approximation
 */
@@ -1461,6 +2111,7 @@ void ParOptInteriorPoint::setQuasiNewton( ParOptCompactQuasiNewton *_qn ){
     qn->decref();
   }
   qn = _qn;
+  invalidateKKTFactorization();
 
   // Free the old data
   if (ztemp){ delete [] ztemp; }
@@ -1499,6 +2150,7 @@ void ParOptInteriorPoint::resetQuasiNewtonHessian(){
   if (qn){
     qn->reset();
   }
+  kkt_system_valid = 0;
 }
 
 /**
@@ -1526,6 +2178,93 @@ void ParOptInteriorPoint::resetDesignAndBounds(){
    @param m the GMRES subspace size.
 */
 void ParOptInteriorPoint::setGMRESSubspaceSize( int m ){
+  deleteGMRESSubspace();
+
+  if (m > 0){
+    // The block method stores up to m+bsize basis vectors and a dense
+    // (m+bsize) x m block Hessenberg matrix
+    int bsize = 1;
+    if (gmres_block_size > 1 && !gmres_mixed_precision){
+      bsize = gmres_block_size;
+    }
+    int hsize = (m+1)*(m+2)/2;
+    if (bsize > 1 && (m+bsize)*m > hsize){
+      hsize = (m+bsize)*m;
+    }
+
+    gmres_subspace_size = m;
+    gmres_H = new ParOptScalar[ hsize ];
+    gmres_alpha = new ParOptScalar[ m+bsize ];
+    gmres_res = new ParOptScalar[ m+bsize ];
+    gmres_y = new ParOptScalar[ m+bsize ];
+    gmres_fproj = new ParOptScalar[ m+1 ];
+    gmres_aproj = new ParOptScalar[ m+1 ];
+    gmres_awproj = new ParOptScalar[ m+1 ];
+    gmres_Q = new ParOptScalar[ 2*m*bsize ];
+
+    // In mixed precision, the basis is stored in a single precision
+    // array and only two full precision work vectors are required
+    if (gmres_mixed_precision){
+      gmres_num_W = 2;
+      gmres_Wf = new ParOptLowScalar[ (m+1)*nvars ];
+      int nblocks = (nvars + PAROPT_GMRES_BLOCK_SIZE - 1)/PAROPT_GMRES_BLOCK_SIZE;
+      gmres_Wf_partial = new ParOptScalar[ nblocks+1 ];
+    }
+    else {
+      gmres_num_W = m+bsize;
+    }
+
+    gmres_W = new ParOptVec*[ gmres_num_W ];
+    for ( int i = 0; i < gmres_num_W; i++ ){
+      gmres_W[i] = prob->createDesignVec();
+      gmres_W[i]->incref();
+    }
+
+    // Allocate the preconditioned directions for each block and the
+    // storage for the previous solutions
+    if (bsize > 1){
+      gmres_P = new ParOptVec*[ bsize ];
+      gmres_seeds = new ParOptVec*[ bsize-1 ];
+      for ( int i = 0; i < bsize; i++ ){
+        gmres_P[i] = prob->createDesignVec();
+        gmres_P[i]->incref();
+      }
+      for ( int i = 0; i < bsize-1; i++ ){
+        gmres_seeds[i] = prob->createDesignVec();
+        gmres_seeds[i]->incref();
+      }
+    }
+
+    // Allocate the recycled space, its product with the KKT matrix
+    // and the space computed for the next solve
+    int k = gmres_recycle_size;
+    if (k > m){
+      k = m;
+    }
+    if (k > 0){
+      gmres_U = new ParOptVec*[ k ];
+      gmres_C = new ParOptVec*[ k ];
+      gmres_Unew = new ParOptVec*[ k ];
+      for ( int i = 0; i < k; i++ ){
+        gmres_U[i] = prob->createDesignVec();
+        gmres_U[i]->incref();
+        gmres_C[i] = prob->createDesignVec();
+        gmres_C[i]->incref();
+        gmres_Unew[i] = prob->createDesignVec();
+        gmres_Unew[i]->incref();
+      }
+      gmres_B = new ParOptScalar[ k*(m+1) ];
+      gmres_G = new ParOptScalar[ (m+1)*m ];
+      gmres_ufproj = new ParOptScalar[ k ];
+      gmres_ucproj = new ParOptScalar[ k ];
+    }
+  }
+}
+
+/**
+   Free the GMRES subspace data (if any) and reset the subspace size
+*/
+void ParOptInteriorPoint::deleteGMRESSubspace(){
   if (gmres_H){
     delete [] gmres_H;
     delete [] gmres_alpha;
@@ -1536,32 +2275,81 @@ void ParOptInteriorPoint::setGMRESSubspaceSize( int m ){
     delete [] gmres_awproj;
     delete [] gmres_Q;
 
-    for ( int i = 0; i < m; i++ ){
+    for ( int i = 0; i < gmres_num_W; i++ ){
       gmres_W[i]->decref();
     }
     delete [] gmres_W;
-  }
-
-  if (m > 0){
-    gmres_subspace_size = m;
-    gmres_H = new ParOptScalar[ (m+1)*(m+2)/2 ];
-    gmres_alpha = new ParOptScalar[ m+1 ];
-    gmres_res = new ParOptScalar[ m+1 ];
-    gmres_y = new ParOptScalar[ m+1 ];
-    gmres_fproj = new ParOptScalar[ m+1 ];
-    gmres_aproj = new ParOptScalar[ m+1 ];
-    gmres_awproj = new ParOptScalar[ m+1 ];
-    gmres_Q = new ParOptScalar[ 2*m ];
 
-    gmres_W = new ParOptVec*[ m+1 ];
-    for ( int i = 0; i < m+1; i++ ){
-      gmres_W[i] = prob->createDesignVec();
-      gmres_W[i]->incref();
+    if (gmres_AW){
+      for ( int i = 0; i < gmres_subspace_size; i++ ){
+        gmres_AW[i]->decref();
+      }
+      delete [] gmres_AW;
+    }
+    if (gmres_Wf){
+      delete [] gmres_Wf;
+    }
+    if (gmres_Wf_partial){
+      delete [] gmres_Wf_partial;
+    }
+    if (gmres_P){
+      for ( int i = 0; i < gmres_block_size; i++ ){
+        gmres_P[i]->decref();
+      }
+      for ( int i = 0; i < gmres_block_size-1; i++ ){
+        gmres_seeds[i]->decref();
+      }
+      delete [] gmres_P;
+      delete [] gmres_seeds;
+    }
+    if (gmres_U){
+      int k = gmres_recycle_size;
+      if (k > gmres_subspace_size){
+        k = gmres_subspace_size;
+      }
+      for ( int i = 0; i < k; i++ ){
+        gmres_U[i]->decref();
+        gmres_C[i]->decref();
+        gmres_Unew[i]->decref();
+      }
+      delete [] gmres_U;
+      delete [] gmres_C;
+      delete [] gmres_Unew;
+      delete [] gmres_B;
+      delete [] gmres_G;
+      delete [] gmres_ufproj;
+      delete [] gmres_ucproj;
     }
   }
-  else {
-    gmres_subspace_size = 0;
-  }
+
+  // Null out the subspace data
+  gmres_subspace_size = 0;
+  gmres_num_W = 0;
+  gmres_H = NULL;
+  gmres_alpha = NULL;
+  gmres_res = NULL;
+  gmres_y = NULL;
+  gmres_fproj = NULL;
+  gmres_aproj = NULL;
+  gmres_awproj = NULL;
+  gmres_Q = NULL;
+  gmres_W = NULL;
+  gmres_AW = NULL;
+  gmres_Wf = NULL;
+  gmres_Wf_partial = NULL;
+  gmres_P = NULL;
+  gmres_seeds = NULL;
+  gmres_num_seeds = 0;
+  gmres_seed_ptr = 0;
+  gmres_num_recycle = 0;
+  gmres_num_new_recycle = 0;
+  gmres_U = NULL;
+  gmres_C = NULL;
+  gmres_Unew = NULL;
+  gmres_B = NULL;
+  gmres_G = NULL;
+  gmres_ufproj = NULL;
+  gmres_ucproj = NULL;
 }
 
 /**
@@ -1603,6 +2391,303 @@ void ParOptInteriorPoint::setOutputLevel( int level ){
   output_level = level;
 }
 
+/**
+   Write the binary iteration history to the given file. The file is
+   written by the root processor and contains one fixed-size record
+   for each iteration with the same fields as the output file.
+
+   @param filename the history file name (NULL closes the file)
+*/
+void ParOptInteriorPoint::setHistoryFile( const char *filename ){
+  if (!history){
+    history = new ParOptHistory(comm, PAROPT_HISTORY_NUM_FIELDS,
+                                paropt_history_fields);
+    history->incref();
+  }
+  if (history->openHistoryFile(filename)){
+    fprintf(stderr, "ParOpt: History file %s creation failed\n", filename);
+  }
+}
+
+/**
+   Write a snapshot of the design variables to the given file every
+   freq iterations using collective MPI-IO. The design vectors are
+   stored in the global order used by writeSolutionFile().
+
+   @param filename the design history file name (NULL closes the file)
+   @param freq the number of iterations between snapshots
+*/
+void ParOptInteriorPoint::setDesignHistoryFile( const char *filename,
+                                                int freq ){
+  if (!history){
+    history = new ParOptHistory(comm, PAROPT_HISTORY_NUM_FIELDS,
+                                paropt_history_fields);
+    history->incref();
+  }
+  if (history->openDesignHistoryFile(filename, nvars_full, freq)){
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    if (rank == opt_root){
+      fprintf(stderr, "ParOpt: Design history file %s creation failed\n",
+              filename);
+    }
+  }
+}
+
+/**
+   Print the time spent in each phase of the optimization after each
+   iteration and a summary at the end of the optimization
+
+   @param truth flag to print the profile
+*/
+void ParOptInteriorPoint::setProfileOutput( int truth ){
+  profile_output = truth;
+}
+
+/**
+   Write the checkpoint file within optimize() without blocking.
+
+   The solution is copied into a staging buffer and the write is
+   overlapped with the following iteration. The write is completed
+   before the next checkpoint is written, at the end of the
+   optimization, or by an explicit call to completeCheckpoint().
+
+   @param truth flag to use non-blocking checkpoint writes
+*/
+void ParOptInteriorPoint::setUseAsyncCheckpoint( int truth ){
+  use_async_checkpoint = truth;
+}
+
+/*
+  Detect the variables that are firmly held at their bounds and
+  compress the design vectors to the remaining free variables.
+
+  A variable is firmly active at its lower bound when the bound gap is
+  small both in absolute terms and relative to the bound multiplier,
+  x - lb < tol and x - lb < tol*zl, and similarly at the upper bound.
+  The fixed variables retain their values and bound multipliers until
+  the vectors are expanded. The vectors are only compressed when at
+  least PAROPT_ACTIVE_SET_MIN_FRACTION of the variables are fixed.
+
+  returns: non-zero if the vectors were compressed
+*/
+int ParOptInteriorPoint::compressActiveSet(){
+  if (active_set_compressed || nwcon > 0 ||
+      use_hvec_product || use_diag_hessian){
+    return 0;
+  }
+
+  if (!active_set){
+    active_set = new ParOptActiveSet(comm, nvars);
+    active_set->incref();
+    active_set_flags = new int[ nvars ];
+    active_set_xfixed = new ParOptScalar[ nvars ];
+    active_set_zeros = new ParOptScalar[ nvars ];
+    memset(active_set_zeros, 0, nvars*sizeof(ParOptScalar));
+  }
+
+  ParOptScalar *xvals, *lbvals, *ubvals, *zlvals, *zuvals;
+  x->getArray(&xvals);
+  lb->getArray(&lbvals);
+  ub->getArray(&ubvals);
+  zl->getArray(&zlvals);
+  zu->getArray(&zuvals);
+
+  const double tol = active_set_tol;
+  for ( int i = 0; i < nvars; i++ ){
+    active_set_flags[i] = 0;
+    if (use_lower && ParOptRealPart(lbvals[i]) > -max_bound_val){
+      double gap = ParOptRealPart(xvals[i] - lbvals[i]);
+      if (gap < tol && gap < tol*ParOptRealPart(zlvals[i])){
+        active_set_flags[i] = 1;
+      }
+    }
+    if (use_upper && ParOptRealPart(ubvals[i]) < max_bound_val){
+      double gap = ParOptRealPart(ubvals[i] - xvals[i]);
+      if (gap < tol && gap < tol*ParOptRealPart(zuvals[i])){
+        active_set_flags[i] = 1;
+      }
+    }
+  }
+  active_set->setFixedVars(active_set_flags);
+
+  int nfree_total = active_set->getGlobalNumFree();
+  if (nfree_total > (1.0 - PAROPT_ACTIVE_SET_MIN_FRACTION)*nvars_total){
+    return 0;
+  }
+
+  // Compress the design variables first to check that the vectors
+  // support compression, then the quasi-Newton vectors
+  if (x->compressEntries(active_set)){
+    return 0;
+  }
+  if (qn && qn->compressVectors(active_set)){
+    x->expandEntries(active_set);
+    return 0;
+  }
+
+  ParOptVec *vecs[] = {lb, ub, zl, zu, px, pzl, pzu, rx, rzl, rzu,
+                       y_qn, s_qn, xtemp, Cvec, g};
+  int nvecs = sizeof(vecs)/sizeof(ParOptVec*);
+  for ( int k = 0; k < nvecs; k++ ){
+    vecs[k]->compressEntries(active_set);
+  }
+  Acvec->compressEntries(active_set);
+  if (line_search_x){
+    for ( int k = 0; k < line_search_batch_size; k++ ){
+      line_search_x[k]->compressEntries(active_set);
+    }
+  }
+
+  // Store the values of the fixed variables for the evaluations
+  nvars = active_set->getNumFree();
+  x->getArray(&xvals);
+  memcpy(active_set_xfixed, &xvals[nvars],
+         (nvars_full - nvars)*sizeof(ParOptScalar));
+
+  active_set_compressed = 1;
+  invalidateKKTFactorization();
+
+  return 1;
+}
+
+/*
+  Expand the compressed design vectors to the full set of variables.
+
+  The fixed entries of the constraint gradients are updated at every
+  evaluation and the fixed entries of the variables, bounds and bound
+  multipliers are unchanged, so the full problem can be resumed
+  directly. The fixed entries of the quasi-Newton vectors are zero.
+*/
+void ParOptInteriorPoint::expandActiveSet(){
+  if (!active_set_compressed){
+    return;
+  }
+
+  x->expandEntries(active_set, active_set_xfixed);
+  ParOptVec *vecs[] = {lb, ub, zl, zu, px, pzl, pzu, rx, rzl, rzu,
+                       y_qn, s_qn, xtemp, Cvec, g};
+  int nvecs = sizeof(vecs)/sizeof(ParOptVec*);
+  for ( int k = 0; k < nvecs; k++ ){
+    vecs[k]->expandEntries(active_set);
+  }
+  Acvec->expandEntries(active_set);
+  if (line_search_x){
+    for ( int k = 0; k < line_search_batch_size; k++ ){
+      line_search_x[k]->expandEntries(active_set);
+    }
+  }
+  if (qn){
+    qn->expandVectors(active_set, active_set_zeros);
+  }
+
+  nvars = nvars_full;
+  active_set_compressed = 0;
+  invalidateKKTFactorization();
+}
+
+/*
+  Evaluate the objective and constraints and record the time. When
+  the design vectors are compressed, the point is expanded for the
+  evaluation.
+*/
+int ParOptInteriorPoint::evalObjCon( ParOptVec *xt, ParOptScalar *fobj,
+                                     ParOptScalar *cons ){
+  profiler->start(PAROPT_PROFILE_EVAL_OBJ_CON);
+  if (active_set_compressed){
+    xt->expandEntries(active_set, active_set_xfixed);
+  }
+  int fail = prob->evalObjCon(xt, fobj, cons);
+  if (active_set_compressed){
+    xt->compressEntries(active_set);
+  }
+  profiler->stop(PAROPT_PROFILE_EVAL_OBJ_CON);
+  return fail;
+}
+
+/*
+  Evaluate the objective and constraints at a batch of points and
+  record the time
+*/
+int ParOptInteriorPoint::evalObjConBatch( int npts, ParOptVec **xt,
+                                          ParOptScalar *fobjs,
+                                          ParOptScalar *cons, int *fail ){
+  profiler->start(PAROPT_PROFILE_EVAL_OBJ_CON);
+  for ( int i = 0; i < npts; i++ ){
+    fail[i] = 0;
+    if (active_set_compressed){
+      xt[i]->expandEntries(active_set, active_set_xfixed);
+    }
+  }
+  int batch_fail = prob->evalObjConBatch(npts, xt, fobjs, cons, fail);
+  if (active_set_compressed){
+    for ( int i = 0; i < npts; i++ ){
+      xt[i]->compressEntries(active_set);
+    }
+  }
+  if (batch_fail){
+    for ( int i = 0; i < npts; i++ ){
+      fail[i] = batch_fail;
+    }
+  }
+  profiler->stop(PAROPT_PROFILE_EVAL_OBJ_CON);
+  return batch_fail;
+}
+
+/*
+  Evaluate the objective and constraint gradients and record the
+  time. When the design vectors are compressed, the gradients are
+  evaluated with the full vectors and then compressed, so that the
+  fixed entries are retained for the expansion.
+*/
+int ParOptInteriorPoint::evalObjConGradient( ParOptVec *xt, ParOptVec *gt,
+                                             ParOptVec **At ){
+  profiler->start(PAROPT_PROFILE_EVAL_GRADIENT);
+  if (active_set_compressed){
+    xt->expandEntries(active_set, active_set_xfixed);
+    gt->expandEntries(active_set);
+    for ( int i = 0; i < ncon; i++ ){
+      At[i]->expandEntries(active_set);
+    }
+  }
+  int fail = prob->evalObjConGradient(xt, gt, At);
+  if (active_set_compressed){
+    xt->compressEntries(active_set);
+    gt->compressEntries(active_set);
+    for ( int i = 0; i < ncon; i++ ){
+      At[i]->compressEntries(active_set);
+    }
+  }
+  profiler->stop(PAROPT_PROFILE_EVAL_GRADIENT);
+  return fail;
+}
+
+/*
+  Evaluate the Hessian-vector product and record the time
+*/
+int ParOptInteriorPoint::evalHvecProduct( ParOptVec *xt, ParOptScalar *zt,
+                                          ParOptVec *zwt, ParOptVec *px,
+                                          ParOptVec *hvec ){
+  profiler->start(PAROPT_PROFILE_EVAL_HVEC);
+  int fail = prob->evalHvecProduct(xt, zt, zwt, px, hvec);
+  profiler->stop(PAROPT_PROFILE_EVAL_HVEC);
+  return fail;
+}
+
+/*
+  Evaluate a block of Hessian-vector products and record the time
+*/
+int ParOptInteriorPoint::evalHvecProductBlock( ParOptVec *xt,
+                                               ParOptScalar *zt,
+                                               ParOptVec *zwt, int nvecs,
+                                               ParOptVec **pvecs,
+                                               ParOptVec **hvecs ){
+  profiler->start(PAROPT_PROFILE_EVAL_HVEC);
+  int fail = prob->evalHvecProductBlock(xt, zt, zwt, nvecs, pvecs, hvecs);
+  profiler->stop(PAROPT_PROFILE_EVAL_HVEC);
+  return fail;
+}
+
 /**
    Compute the residual of the KKT system. This code utilizes the data
    stored internally in the ParOpt optimizer.
@@ -1631,19 +2716,16 @@ void ParOptInteriorPoint::computeKKTRes( double barrier,
   // Assemble the negative of the residual of the first KKT equation:
   // -(g(x) - Ac^{T}*z - Aw^{T}*zw - zl + zu)
   if (use_lower){
-    rx->copyValues(zl);
+    rx->waxpy(-1.0, g, zl);
   }
   else {
-    rx->zeroEntries();
+    rx->axpby(-1.0, 0.0, g);
   }
   if (use_upper){
     rx->axpy(-1.0, zu);
   }
-  rx->axpy(-1.0, g);
 
-  for ( int i = 0; i < ncon; i++ ){
-    rx->axpy(z[i], Ac[i]);
-  }
+  Acvec->maxpy(ncon, z, rx);
 
   if (nwcon > 0){
     // Add rx = rx + Aw^{T}*zw
@@ -1657,22 +2739,6 @@ void ParOptInteriorPoint::computeKKTRes( double barrier,
     rcw->scale(-1.0);
   }
 
-  // Compute the error in the first KKT condition
-  if (norm_type == PAROPT_INFTY_NORM){
-    *max_prime = rx->maxabs();
-    *max_infeas = rcw->maxabs();
-  }
-  else if (norm_type == PAROPT_L1_NORM){
-    *max_prime = rx->l1norm();
-    *max_infeas = rcw->l1norm();
-  }
-  else { // norm_type == PAROPT_L2_NORM
-    double prime_rx = rx->norm();
-    double prime_rcw = rcw->norm();
-    *max_prime = prime_rx*prime_rx;
-    *max_infeas = prime_rcw*prime_rcw;
-  }
-
   // Evaluate the residuals differently depending on whether
   // we're using a dense equality or inequality constraint
   if (dense_inequality){
@@ -1692,42 +2758,6 @@ void ParOptInteriorPoint::computeKKTRes( double barrier,
     }
   }
 
-  if (norm_type == PAROPT_INFTY_NORM){
-    for ( int i = 0; i < ncon; i++ ){
-      if (fabs(ParOptRealPart(rt[i])) > *max_prime){
-        *max_prime = fabs(ParOptRealPart(rt[i]));
-      }
-      if (fabs(ParOptRealPart(rc[i])) > *max_infeas){
-        *max_infeas = fabs(ParOptRealPart(rc[i]));
-      }
-      if (fabs(ParOptRealPart(rs[i])) > *max_dual){
-        *max_dual = fabs(ParOptRealPart(rs[i]));
-      }
-      if (fabs(ParOptRealPart(rzt[i])) > *max_dual){
-        *max_dual = fabs(ParOptRealPart(rzt[i]));
-      }
-    }
-  }
-  else if (norm_type == PAROPT_L1_NORM){
-    for ( int i = 0; i < ncon; i++ ){
-      *max_prime += fabs(ParOptRealPart(rt[i]));
-      *max_infeas += fabs(ParOptRealPart(rc[i]));
-      *max_dual += fabs(ParOptRealPart(rs[i]));
-      *max_dual += fabs(ParOptRealPart(rzt[i]));
-    }
-  }
-  else { // norm_type == PAROPT_L2_NORM
-    double prime = 0.0, infeas = 0.0, dual = 0.0;
-    for ( int i = 0; i < ncon; i++ ){
-      prime += ParOptRealPart(rt[i]*rt[i]);
-      infeas += ParOptRealPart(rc[i]*rc[i]);
-      dual += ParOptRealPart(rs[i]*rs[i] + rzt[i]*rzt[i]);
-    }
-    *max_prime += prime;
-    *max_infeas += infeas;
-    *max_dual += dual;
-  }
-
   // Extract the values of the variables and lower/upper bounds
   ParOptScalar *xvals, *lbvals, *ubvals, *zlvals, *zuvals;
   x->getArray(&xvals);
@@ -1750,20 +2780,6 @@ void ParOptInteriorPoint::computeKKTRes( double barrier,
         rzlvals[i] = 0.0;
       }
     }
-
-    if (norm_type == PAROPT_INFTY_NORM){
-      double dual_zl = rzl->maxabs();
-      if (dual_zl > *max_dual){
-        *max_dual = dual_zl;
-      }
-    }
-    else if (norm_type == PAROPT_L1_NORM){
-      *max_dual += rzl->l1norm();
-    }
-    else { // norm_type == PAROPT_L2_NORM
-      double dual_zl = rzl->norm();
-      *max_dual += dual_zl*dual_zl;
-    }
   }
   if (use_upper){
     // Compute the residuals for the upper bounds
@@ -1779,23 +2795,10 @@ void ParOptInteriorPoint::computeKKTRes( double barrier,
         rzuvals[i] = 0.0;
       }
     }
-
-    if (norm_type == PAROPT_INFTY_NORM){
-      double dual_zu = rzu->maxabs();
-      if (ParOptRealPart(dual_zu) > ParOptRealPart(*max_dual)){
-        *max_dual = dual_zu;
-      }
-    }
-    else if (norm_type == PAROPT_L1_NORM){
-      *max_dual += rzu->l1norm();
-    }
-    else { // norm_type == PAROPT_L2_NORM
-      double dual_zu = rzu->norm();
-      *max_dual += dual_zu*dual_zu;
-    }
   }
 
-  if (nwcon > 0 && sparse_inequality){
+  int use_sparse_slacks = (nwcon > 0 && sparse_inequality);
+  if (use_sparse_slacks){
     // Set the values of the perturbed complementarity
     // constraints for the sparse slack variables
     ParOptScalar *zwvals, *swvals, *rswvals;
@@ -1806,18 +2809,106 @@ void ParOptInteriorPoint::computeKKTRes( double barrier,
     for ( int i = 0; i < nwcon; i++ ){
       rswvals[i] = -(swvals[i]*zwvals[i] - barrier);
     }
+  }
 
-    if (norm_type == PAROPT_INFTY_NORM){
-      double dual_zw = rsw->maxabs();
-      if (ParOptRealPart(dual_zw) > ParOptRealPart(*max_dual)){
-        *max_dual = dual_zw;
+  // Queue the norms of the distributed residuals so that they are
+  // all computed with a single reduction
+  ParOptReductionContext ctx(comm);
+  int hrx = -1, hrcw = -1, hrzl = -1, hrzu = -1, hrsw = -1;
+  if (norm_type == PAROPT_INFTY_NORM){
+    hrx = ctx.addMaxAbs(rx);
+    hrcw = ctx.addMaxAbs(rcw);
+    if (use_lower){ hrzl = ctx.addMaxAbs(rzl); }
+    if (use_upper){ hrzu = ctx.addMaxAbs(rzu); }
+    if (use_sparse_slacks){ hrsw = ctx.addMaxAbs(rsw); }
+  }
+  else if (norm_type == PAROPT_L1_NORM){
+    hrx = ctx.addL1Norm(rx);
+    hrcw = ctx.addL1Norm(rcw);
+    if (use_lower){ hrzl = ctx.addL1Norm(rzl); }
+    if (use_upper){ hrzu = ctx.addL1Norm(rzu); }
+    if (use_sparse_slacks){ hrsw = ctx.addL1Norm(rsw); }
+  }
+  else { // norm_type == PAROPT_L2_NORM
+    hrx = ctx.addNorm(rx);
+    hrcw = ctx.addNorm(rcw);
+    if (use_lower){ hrzl = ctx.addNorm(rzl); }
+    if (use_upper){ hrzu = ctx.addNorm(rzu); }
+    if (use_sparse_slacks){ hrsw = ctx.addNorm(rsw); }
+  }
+  ctx.reduce();
+
+  // Combine the distributed contributions with the dense terms
+  if (norm_type == PAROPT_INFTY_NORM){
+    *max_prime = ctx.getValue(hrx);
+    *max_infeas = ctx.getValue(hrcw);
+
+    for ( int i = 0; i < ncon; i++ ){
+      if (fabs(ParOptRealPart(rt[i])) > *max_prime){
+        *max_prime = fabs(ParOptRealPart(rt[i]));
+      }
+      if (fabs(ParOptRealPart(rc[i])) > *max_infeas){
+        *max_infeas = fabs(ParOptRealPart(rc[i]));
+      }
+      if (fabs(ParOptRealPart(rs[i])) > *max_dual){
+        *max_dual = fabs(ParOptRealPart(rs[i]));
+      }
+      if (fabs(ParOptRealPart(rzt[i])) > *max_dual){
+        *max_dual = fabs(ParOptRealPart(rzt[i]));
       }
     }
-    else if (norm_type == PAROPT_L1_NORM){
-      *max_dual += rsw->l1norm();
+
+    if (hrzl >= 0 && ctx.getValue(hrzl) > *max_dual){
+      *max_dual = ctx.getValue(hrzl);
+    }
+    if (hrzu >= 0 && ctx.getValue(hrzu) > *max_dual){
+      *max_dual = ctx.getValue(hrzu);
+    }
+    if (hrsw >= 0 && ctx.getValue(hrsw) > *max_dual){
+      *max_dual = ctx.getValue(hrsw);
+    }
+  }
+  else if (norm_type == PAROPT_L1_NORM){
+    *max_prime = ctx.getValue(hrx);
+    *max_infeas = ctx.getValue(hrcw);
+
+    for ( int i = 0; i < ncon; i++ ){
+      *max_prime += fabs(ParOptRealPart(rt[i]));
+      *max_infeas += fabs(ParOptRealPart(rc[i]));
+      *max_dual += fabs(ParOptRealPart(rs[i]));
+      *max_dual += fabs(ParOptRealPart(rzt[i]));
+    }
+
+    if (hrzl >= 0){ *max_dual += ctx.getValue(hrzl); }
+    if (hrzu >= 0){ *max_dual += ctx.getValue(hrzu); }
+    if (hrsw >= 0){ *max_dual += ctx.getValue(hrsw); }
+  }
+  else { // norm_type == PAROPT_L2_NORM
+    double prime_rx = ctx.getValue(hrx);
+    double prime_rcw = ctx.getValue(hrcw);
+    *max_prime = prime_rx*prime_rx;
+    *max_infeas = prime_rcw*prime_rcw;
+
+    double prime = 0.0, infeas = 0.0, dual = 0.0;
+    for ( int i = 0; i < ncon; i++ ){
+      prime += ParOptRealPart(rt[i]*rt[i]);
+      infeas += ParOptRealPart(rc[i]*rc[i]);
+      dual += ParOptRealPart(rs[i]*rs[i] + rzt[i]*rzt[i]);
+    }
+    *max_prime += prime;
+    *max_infeas += infeas;
+    *max_dual += dual;
+
+    if (hrzl >= 0){
+      double dual_zl = ctx.getValue(hrzl);
+      *max_dual += dual_zl*dual_zl;
     }
-    else { // norm_type == PAROPT_L2_NORM
-      double dual_zw = rsw->norm();
+    if (hrzu >= 0){
+      double dual_zu = ctx.getValue(hrzu);
+      *max_dual += dual_zu*dual_zu;
+    }
+    if (hrsw >= 0){
+      double dual_zw = ctx.getValue(hrsw);
       *max_dual += dual_zw*dual_zw;
     }
   }
@@ -1859,7 +2950,218 @@ double ParOptInteriorPoint::computeStepNorm(){
 }
 
 /*
-  Factor the matrix after assembly
+  The number of blocks in the Cw matrix that are factored and applied
+  together by the batched Cholesky kernels
+*/
+static const int PAROPT_CW_BATCH_SIZE = 8;
+
+/*
+  Factor a group of nb symmetric positive definite n x n matrices
+  with n = N fixed at compile time.
+
+  The matrices are stored in an interleaved upper-triangular packed
+  format such that the k-th packed entry of the l-th matrix is stored
+  in a[k*nb + l]. The innermost loops run across the matrices in the
+  group so that they can be vectorized. On exit, the array contains
+  the upper Cholesky factor U with A = U^{T}*U, where the diagonal
+  entries are replaced by their reciprocals.
+
+  @param nb the number of matrices in the group
+  @param a the interleaved packed matrices
+  @return 0 on success, otherwise 1 + the first failed row in the group
+*/
+template <int N>
+static int factorCwBatch( const int nb, ParOptScalar *a ){
+  int fail = 0;
+
+  for ( int j = 0; j < N; j++ ){
+    const int jj = (j*(j+1))/2;
+
+    // Compute the off-diagonal entries in the j-th column:
+    // U(i,j) = (A(i,j) - sum_{k<i} U(k,i)*U(k,j))/U(i,i)
+    for ( int i = 0; i < j; i++ ){
+      const int ii = (i*(i+1))/2;
+      ParOptScalar *uij = &a[(jj + i)*nb];
+      for ( int k = 0; k < i; k++ ){
+        const ParOptScalar *uki = &a[(ii + k)*nb];
+        const ParOptScalar *ukj = &a[(jj + k)*nb];
+        for ( int l = 0; l < nb; l++ ){
+          uij[l] -= uki[l]*ukj[l];
+        }
+      }
+      const ParOptScalar *dii = &a[(ii + i)*nb];
+      for ( int l = 0; l < nb; l++ ){
+        uij[l] *= dii[l];
+      }
+    }
+
+    // Compute the diagonal entry and store its reciprocal
+    ParOptScalar *djj = &a[(jj + j)*nb];
+    for ( int k = 0; k < j; k++ ){
+      const ParOptScalar *ukj = &a[(jj + k)*nb];
+      for ( int l = 0; l < nb; l++ ){
+        djj[l] -= ukj[l]*ukj[l];
+      }
+    }
+    for ( int l = 0; l < nb; l++ ){
+      if (ParOptRealPart(djj[l]) <= 0.0){
+        if (fail == 0 || l*N + j + 1 < fail){
+          fail = l*N + j + 1;
+        }
+        djj[l] = 1.0;
+      }
+      else {
+        djj[l] = 1.0/sqrt(djj[l]);
+      }
+    }
+  }
+
+  return fail;
+}
+
+/*
+  Solve U^{T}*U*x = b for a group of nb matrices factored by
+  factorCwBatch. The right-hand-sides are interleaved in the same
+  manner, so that the j-th entry for the l-th matrix is x[j*nb + l].
+
+  @param nb the number of matrices in the group
+  @param a the interleaved factored matrices
+  @param x the interleaved right-hand-sides, overwritten by the solution
+*/
+template <int N>
+static void applyCwBatch( const int nb, const ParOptScalar *a,
+                          ParOptScalar *x ){
+  // Solve U^{T}*y = b
+  for ( int j = 0; j < N; j++ ){
+    const int jj = (j*(j+1))/2;
+    ParOptScalar *xj = &x[j*nb];
+    for ( int k = 0; k < j; k++ ){
+      const ParOptScalar *ukj = &a[(jj + k)*nb];
+      const ParOptScalar *xk = &x[k*nb];
+      for ( int l = 0; l < nb; l++ ){
+        xj[l] -= ukj[l]*xk[l];
+      }
+    }
+    const ParOptScalar *djj = &a[(jj + j)*nb];
+    for ( int l = 0; l < nb; l++ ){
+      xj[l] *= djj[l];
+    }
+  }
+
+  // Solve U*x = y
+  for ( int j = N-1; j >= 0; j-- ){
+    ParOptScalar *xj = &x[j*nb];
+    for ( int k = j+1; k < N; k++ ){
+      const ParOptScalar *ujk = &a[((k*(k+1))/2 + j)*nb];
+      const ParOptScalar *xk = &x[k*nb];
+      for ( int l = 0; l < nb; l++ ){
+        xj[l] -= ujk[l]*xk[l];
+      }
+    }
+    const ParOptScalar *djj = &a[((j*(j+1))/2 + j)*nb];
+    for ( int l = 0; l < nb; l++ ){
+      xj[l] *= djj[l];
+    }
+  }
+}
+
+/*
+  Factor the block-diagonal Cw matrix stored in packed format. Each
+  group of PAROPT_CW_BATCH_SIZE blocks is converted in place to the
+  interleaved format used by applyCwBatch and then factored.
+
+  @param nwcon the number of sparse constraints
+  @param Cw the packed block matrices
+  @return 0 on success, otherwise 1 + the first failed row
+*/
+template <int N>
+static int factorCwBlocks( const int nwcon, ParOptScalar *Cw ){
+  const int incr = ((N + 1)*N)/2;
+  const int nblocks = nwcon/N;
+  const int ngroups =
+    (nblocks + PAROPT_CW_BATCH_SIZE - 1)/PAROPT_CW_BATCH_SIZE;
+  int fail = nwcon + 1;
+
+  PAROPT_PRAGMA(omp parallel for schedule(static) reduction(min:fail))
+  for ( int g = 0; g < ngroups; g++ ){
+    const int start = g*PAROPT_CW_BATCH_SIZE;
+    int nb = nblocks - start;
+    if (nb > PAROPT_CW_BATCH_SIZE){
+      nb = PAROPT_CW_BATCH_SIZE;
+    }
+
+    // Interleave the entries of the blocks in this group
+    ParOptScalar *cw = &Cw[start*incr];
+    ParOptScalar a[incr*PAROPT_CW_BATCH_SIZE];
+    for ( int l = 0; l < nb; l++ ){
+      for ( int k = 0; k < incr; k++ ){
+        a[k*nb + l] = cw[l*incr + k];
+      }
+    }
+
+    int info = factorCwBatch<N>(nb, a);
+    if (info && start*N + info < fail){
+      fail = start*N + info;
+    }
+
+    memcpy(cw, a, nb*incr*sizeof(ParOptScalar));
+  }
+
+  if (fail <= nwcon){
+    return fail;
+  }
+  return 0;
+}
+
+/*
+  Apply the factored block-diagonal Cw matrix computed by
+  factorCwBlocks
+
+  @param nwcon the number of sparse constraints
+  @param Cw the factored interleaved block matrices
+  @param rhs the right-hand-side, overwritten with the solution
+*/
+template <int N>
+static void applyCwBlocks( const int nwcon, const ParOptScalar *Cw,
+                           ParOptScalar *rhs ){
+  const int incr = ((N + 1)*N)/2;
+  const int nblocks = nwcon/N;
+  const int ngroups =
+    (nblocks + PAROPT_CW_BATCH_SIZE - 1)/PAROPT_CW_BATCH_SIZE;
+
+  PAROPT_OMP_FOR
+  for ( int g = 0; g < ngroups; g++ ){
+    const int start = g*PAROPT_CW_BATCH_SIZE;
+    int nb = nblocks - start;
+    if (nb > PAROPT_CW_BATCH_SIZE){
+      nb = PAROPT_CW_BATCH_SIZE;
+    }
+
+    // Interleave the right-hand-sides for this group
+    ParOptScalar *r = &rhs[start*N];
+    ParOptScalar x[N*PAROPT_CW_BATCH_SIZE];
+    for ( int l = 0; l < nb; l++ ){
+      for ( int j = 0; j < N; j++ ){
+        x[j*nb + l] = r[l*N + j];
+      }
+    }
+
+    applyCwBatch<N>(nb, &Cw[start*incr], x);
+
+    for ( int l = 0; l < nb; l++ ){
+      for ( int j = 0; j < N; j++ ){
+        r[l*N + j] = x[j*nb + l];
+      }
+    }
+  }
+}
+
+/*
+  Factor the matrix after assembly.
+
+  Common block sizes are factored by the batched kernels, which
+  leave Cw in the interleaved format expected by applyCwFactor. All
+  other block sizes use LAPACK on the packed storage.
 */
 int ParOptInteriorPoint::factorCw(){
   if (nwblock == 1){
@@ -1873,6 +3175,24 @@ int ParOptInteriorPoint::factorCw(){
       }
     }
   }
+  else if (nwblock == 2){
+    return factorCwBlocks<2>(nwcon, Cw);
+  }
+  else if (nwblock == 3){
+    return factorCwBlocks<3>(nwcon, Cw);
+  }
+  else if (nwblock == 4){
+    return factorCwBlocks<4>(nwcon, Cw);
+  }
+  else if (nwblock == 5){
+    return factorCwBlocks<5>(nwcon, Cw);
+  }
+  else if (nwblock == 6){
+    return factorCwBlocks<6>(nwcon, Cw);
+  }
+  else if (nwblock == 8){
+    return factorCwBlocks<8>(nwcon, Cw);
+  }
   else {
     ParOptScalar *cw = Cw;
     const int incr = ((nwblock + 1)*nwblock)/2;
@@ -1905,6 +3225,24 @@ int ParOptInteriorPoint::applyCwFactor( ParOptVec *vec ){
       rhs[i] *= Cw[i];
     }
   }
+  else if (nwblock == 2){
+    applyCwBlocks<2>(nwcon, Cw, rhs);
+  }
+  else if (nwblock == 3){
+    applyCwBlocks<3>(nwcon, Cw, rhs);
+  }
+  else if (nwblock == 4){
+    applyCwBlocks<4>(nwcon, Cw, rhs);
+  }
+  else if (nwblock == 5){
+    applyCwBlocks<5>(nwcon, Cw, rhs);
+  }
+  else if (nwblock == 6){
+    applyCwBlocks<6>(nwcon, Cw, rhs);
+  }
+  else if (nwblock == 8){
+    applyCwBlocks<8>(nwcon, Cw, rhs);
+  }
   else {
     ParOptScalar *cw = Cw;
     const int incr = ((nwblock + 1)*nwblock)/2;
@@ -1927,6 +3265,69 @@ int ParOptInteriorPoint::applyCwFactor( ParOptVec *vec ){
   return 0;
 }
 
+/*
+  Factor the dense Schur complement Dmat.
+
+  The matrix is symmetric and usually positive definite, in which case
+  the Cholesky factorization is used. Otherwise the symmetric
+  indefinite factorization with Bunch-Kaufman pivoting is used.
+
+  In the complex build, the matrix is complex symmetric rather than
+  Hermitian, so the Cholesky factorization (zpotrf) does not apply and
+  the symmetric factorization (zsytrf) is always used.
+*/
+int ParOptInteriorPoint::factorDmat(){
+  int info = 0;
+  if (ncon <= 0){
+    return info;
+  }
+
+#ifndef PAROPT_USE_COMPLEX
+  // Try the Cholesky factorization first, keeping a copy of the
+  // matrix in case it is not positive definite
+  memcpy(dwork, Dmat, ncon*ncon*sizeof(ParOptScalar));
+  LAPACKdpotrf("L", &ncon, Dmat, &ncon, &info);
+  if (info == 0){
+    dmat_cholesky = 1;
+    return info;
+  }
+
+  memcpy(Dmat, dwork, ncon*ncon*sizeof(ParOptScalar));
+#endif // PAROPT_USE_COMPLEX
+  dmat_cholesky = 0;
+  LAPACKdsytrf("L", &ncon, Dmat, &ncon, dpiv, dwork, &dwork_size, &info);
+
+  return info;
+}
+
+/*
+  Apply the factorization of Dmat to the vector in place
+*/
+int ParOptInteriorPoint::applyDmatFactor( ParOptScalar *vec ){
+  int one = 1, info = 0;
+  if (dmat_cholesky){
+    LAPACKdpotrs("L", &ncon, &one, Dmat, &ncon, vec, &ncon, &info);
+  }
+  else {
+    LAPACKdsytrs("L", &ncon, &one, Dmat, &ncon, dpiv, vec, &ncon, &info);
+  }
+
+  return info;
+}
+
+/*
+  Mark the factorizations of the diagonal KKT system and the
+  quasi-Newton Schur complement as out of date. This must be called
+  whenever the design variables, multipliers or slack variables are
+  modified. Changes to the quasi-Newton approximation only require
+  that kkt_system_valid is reset, since the diagonal factorization
+  checks the value of b0 directly.
+*/
+void ParOptInteriorPoint::invalidateKKTFactorization(){
+  kkt_diag_valid = 0;
+  kkt_system_valid = 0;
+}
+
 /*
   This function computes the terms required to solve the KKT system
   using a bordering method.  The initialization process computes the
@@ -1958,6 +3359,8 @@ int ParOptInteriorPoint::applyCwFactor( ParOptVec *vec ){
 void ParOptInteriorPoint::setUpKKTDiagSystem( ParOptVec *xtmp,
                                               ParOptVec *wtmp,
                                               int use_qn ){
+  profiler->start(PAROPT_PROFILE_KKT_SETUP);
+
   // Retrive the diagonal entry for the BFGS update
   ParOptScalar b0 = 0.0;
   ParOptScalar *h = NULL;
@@ -1970,68 +3373,33 @@ void ParOptInteriorPoint::setUpKKTDiagSystem( ParOptVec *xtmp,
     qn->getCompactMat(&b0, &d, &M, &Z);
   }
 
-  // Retrieve the values of the design variables, lower/upper bounds
-  // and the corresponding lagrange multipliers
-  ParOptScalar *xvals, *lbvals, *ubvals, *zlvals, *zuvals;
-  x->getArray(&xvals);
-  lb->getArray(&lbvals);
-  ub->getArray(&ubvals);
-  zl->getArray(&zlvals);
-  zu->getArray(&zuvals);
+  // The factorization depends on the primal and dual variables and
+  // the diagonal Hessian term only. If none of these have changed
+  // since the last factorization, it can be reused.
+  int use_hdiag = (h != NULL);
+  if (kkt_diag_valid &&
+      kkt_diag_use_hdiag == use_hdiag &&
+      kkt_diag_b0 == b0 &&
+      kkt_diag_sigma == qn_sigma){
+    profiler->stop(PAROPT_PROFILE_KKT_SETUP);
+    return;
+  }
 
-  // Set the components of the diagonal matrix
+  // Record the data used to compute the factorization. Any
+  // factorization of the quasi-Newton Schur complement depends on
+  // this factorization and is now out of date.
+  kkt_diag_valid = 1;
+  kkt_diag_use_hdiag = use_hdiag;
+  kkt_diag_b0 = b0;
+  kkt_diag_sigma = qn_sigma;
+  kkt_system_valid = 0;
+
+  // Set the components of the diagonal matrix. Note that the diagonal
+  // Hessian entries are used in place of b0 when they are defined.
+  Cvec->computeBarrierDiag(b0, (h ? hdiag : NULL), qn_sigma, x,
+                           (use_lower ? lb : NULL), zl,
+                           (use_upper ? ub : NULL), zu, max_bound_val);
   ParOptScalar *cvals;
-  Cvec->getArray(&cvals);
-
-  // Set the values of the c matrix
-  if (use_lower && use_upper){
-    for ( int i = 0; i < nvars; i++ ){
-      if (h){ b0 = h[i]; }
-      if (ParOptRealPart(lbvals[i]) > -max_bound_val &&
-          ParOptRealPart(ubvals[i]) < max_bound_val){
-        cvals[i] = 1.0/(b0 + qn_sigma +
-                        zlvals[i]/(xvals[i] - lbvals[i]) +
-                        zuvals[i]/(ubvals[i] - xvals[i]));
-      }
-      else if (ParOptRealPart(lbvals[i]) > -max_bound_val){
-        cvals[i] = 1.0/(b0 + qn_sigma + zlvals[i]/(xvals[i] - lbvals[i]));
-      }
-      else if (ParOptRealPart(ubvals[i]) < max_bound_val){
-        cvals[i] = 1.0/(b0 + qn_sigma + zuvals[i]/(ubvals[i] - xvals[i]));
-      }
-      else {
-        cvals[i] = 1.0/(b0 + qn_sigma);
-      }
-    }
-  }
-  else if (use_lower){
-    for ( int i = 0; i < nvars; i++ ){
-      if (h){ b0 = h[i]; }
-      if (ParOptRealPart(lbvals[i]) > -max_bound_val){
-        cvals[i] = 1.0/(b0 + qn_sigma + zlvals[i]/(xvals[i] - lbvals[i]));
-      }
-      else {
-        cvals[i] = 1.0/(b0 + qn_sigma);
-      }
-    }
-  }
-  else if (use_upper){
-    for ( int i = 0; i < nvars; i++ ){
-      if (h){ b0 = h[i]; }
-      if (ParOptRealPart(ubvals[i]) < max_bound_val){
-        cvals[i] = 1.0/(b0 + qn_sigma + zuvals[i]/(ubvals[i] - xvals[i]));
-      }
-      else {
-        cvals[i] = 1.0/(b0 + qn_sigma);
-      }
-    }
-  }
-  else {
-    for ( int i = 0; i < nvars; i++ ){
-      if (h){ b0 = h[i]; }
-      cvals[i] = 1.0/(b0 + qn_sigma);
-    }
-  }
 
   if (nwcon > 0){
     // Set the values in the Cw diagonal matrix
@@ -2045,6 +3413,7 @@ void ParOptInteriorPoint::setUpKKTDiagSystem( ParOptVec *xtmp,
       sw->getArray(&swvals);
 
       if (nwblock == 1){
+        PAROPT_OMP_FOR
         for ( int i = 0; i < nwcon; i++ ){
           Cw[i] = swvals[i]/zwvals[i];
         }
@@ -2083,6 +3452,7 @@ void ParOptInteriorPoint::setUpKKTDiagSystem( ParOptVec *xtmp,
       xtmp->getArray(&xvals);
       Ac[k]->getArray(&avals);
 
+      PAROPT_OMP_FOR
       for ( int i = 0; i < nvars; i++ ){
         xvals[i] = cvals[i]*avals[i];
       }
@@ -2095,7 +3465,43 @@ void ParOptInteriorPoint::setUpKKTDiagSystem( ParOptVec *xtmp,
   // Set the value of the D matrix
   memset(Dmat, 0, ncon*ncon*sizeof(ParOptScalar));
 
-  if (nwcon > 0){
+  // Get the contiguous storage for A and Ew (if any)
+  ParOptScalar *Adata = NULL, *Edata = NULL;
+  int lda = nvars;
+  if (ncon >= PAROPT_SCHUR_MIN_CONSTRAINTS){
+    Acvec->getArray(&Adata, &lda);
+    Ewvec->getArray(&Edata);
+  }
+
+  if (nwcon > 0 && Edata){
+    // Add the term Dw = - Ew^{T}*Cw^{-1}*Ew. The products Cw^{-1}*Ew
+    // are computed for a block of columns at a time and multiplied by
+    // the Ew vectors at once. Only the lower triangle of Dmat is used,
+    // so the rows above the diagonal block are skipped.
+    for ( int j = 0; j < ncon; j += PAROPT_SCHUR_BLOCK_COLS ){
+      int nb = ncon - j;
+      if (nb > PAROPT_SCHUR_BLOCK_COLS){
+        nb = PAROPT_SCHUR_BLOCK_COLS;
+      }
+
+      // Apply Cw^{-1}*Ew[j] -> wt for each column in the block
+      for ( int jj = 0; jj < nb; jj++ ){
+        ParOptScalar *wvals;
+        wtmp->copyValues(Ew[j + jj]);
+        applyCwFactor(wtmp);
+        wtmp->getArray(&wvals);
+        memcpy(&dwblock[jj*nwcon], wvals, nwcon*sizeof(ParOptScalar));
+      }
+
+      // Dmat[j:, j:j+nb] -= Ew[j:]^{T}*Cw^{-1}*Ew[j:j+nb]
+      int nr = ncon - j;
+      ParOptScalar alpha = -1.0, beta = 1.0;
+      BLASdgemm("T", "N", &nr, &nb, &nwcon, &alpha,
+                &Edata[nwcon*j], &nwcon, dwblock, &nwcon, &beta,
+                &Dmat[j + ncon*j], &ncon);
+    }
+  }
+  else if (nwcon > 0){
     // Add the term Dw = - Ew^{T}*Cw^{-1}*Ew to the Dmat matrix first
     // by computing the product with Cw^{-1}
     for ( int j = 0; j < ncon; j++ ){
@@ -2128,75 +3534,126 @@ void ParOptInteriorPoint::setUpKKTDiagSystem( ParOptVec *xtmp,
     }
   }
 
-  // Compute the lower diagonal portion of the matrix. This
-  // code unrolls the loop to achieve better performance. Note
-  // that this only computes the on-processor components.
-  for ( int j = 0; j < ncon; j++ ){
-    for ( int i = j; i < ncon; i++ ){
-      // Get the vectors required
-      ParOptScalar *aivals, *ajvals;
-      Cvec->getArray(&cvals);
-      Ac[i]->getArray(&aivals);
-      Ac[j]->getArray(&ajvals);
-
-      ParOptScalar dmat = 0.0;
-      int k = 0, remainder = nvars % 4;
-      for ( ; k < remainder; k++ ){
-        dmat += aivals[0]*ajvals[0]*cvals[0];
-        aivals++; ajvals++; cvals++;
+  Cvec->getArray(&cvals);
+  if (Adata){
+    // Compute A*C^{-1}*A^{T} in blocks of rows. When the entries of
+    // C^{-1} in the block are positive, the block W = C^{-1/2}*A is
+    // formed in the work array and the lower triangle of W^{T}*W is
+    // added to Dmat with a symmetric rank-k update. Otherwise, the
+    // block C^{-1}*A is formed and the product with A is added with a
+    // general matrix product.
+    for ( int k = 0; k < nvars; k += PAROPT_SCHUR_BLOCK_SIZE ){
+      int nb = nvars - k;
+      if (nb > PAROPT_SCHUR_BLOCK_SIZE){
+        nb = PAROPT_SCHUR_BLOCK_SIZE;
+      }
+
+      int positive = 1;
+      for ( int i = 0; i < nb; i++ ){
+        if (ParOptRealPart(cvals[k + i]) <= 0.0){
+          positive = 0;
+          break;
+        }
       }
 
-      for ( int k = remainder; k < nvars; k += 4 ){
-        dmat += (aivals[0]*ajvals[0]*cvals[0] +
-                 aivals[1]*ajvals[1]*cvals[1] +
-                 aivals[2]*ajvals[2]*cvals[2] +
-                 aivals[3]*ajvals[3]*cvals[3]);
-        aivals += 4; ajvals += 4; cvals += 4;
+      ParOptScalar alpha = 1.0, beta = 1.0;
+      if (positive){
+        for ( int i = 0; i < nb; i++ ){
+          dwork[ncon*nb + i] = sqrt(cvals[k + i]);
+        }
+        for ( int j = 0; j < ncon; j++ ){
+          const ParOptScalar *aj = &Adata[k + lda*j];
+          const ParOptScalar *ci = &dwork[ncon*nb];
+          ParOptScalar *bj = &dwork[nb*j];
+          for ( int i = 0; i < nb; i++ ){
+            bj[i] = ci[i]*aj[i];
+          }
+        }
+
+        BLASdsyrk("L", "T", &ncon, &nb, &alpha,
+                  dwork, &nb, &beta, Dmat, &ncon);
       }
+      else {
+        for ( int j = 0; j < ncon; j++ ){
+          const ParOptScalar *aj = &Adata[k + lda*j];
+          ParOptScalar *bj = &dwork[nb*j];
+          for ( int i = 0; i < nb; i++ ){
+            bj[i] = cvals[k + i]*aj[i];
+          }
+        }
 
-      Dmat[i + ncon*j] += dmat;
+        BLASdgemm("T", "N", &ncon, &ncon, &nb, &alpha,
+                  &Adata[k], &lda, dwork, &nb, &beta,
+                  Dmat, &ncon);
+      }
     }
   }
+  else {
+    // Compute the lower diagonal portion of the matrix. This
+    // code unrolls the loop to achieve better performance. Note
+    // that this only computes the on-processor components.
+    for ( int j = 0; j < ncon; j++ ){
+      for ( int i = j; i < ncon; i++ ){
+        // Get the vectors required
+        ParOptScalar *aivals, *ajvals;
+        Cvec->getArray(&cvals);
+        Ac[i]->getArray(&aivals);
+        Ac[j]->getArray(&ajvals);
 
-  // Populate the remainder of the matrix because it is
-  // symmetric
-  for ( int j = 0; j < ncon; j++ ){
-    for ( int i = j+1; i < ncon; i++ ){
-      Dmat[j + ncon*i] = Dmat[i + ncon*j];
+        ParOptScalar dmat = 0.0;
+        int k = 0, remainder = nvars % 4;
+        for ( ; k < remainder; k++ ){
+          dmat += aivals[0]*ajvals[0]*cvals[0];
+          aivals++; ajvals++; cvals++;
+        }
+
+        for ( int k = remainder; k < nvars; k += 4 ){
+          dmat += (aivals[0]*ajvals[0]*cvals[0] +
+                   aivals[1]*ajvals[1]*cvals[1] +
+                   aivals[2]*ajvals[2]*cvals[2] +
+                   aivals[3]*ajvals[3]*cvals[3]);
+          aivals += 4; ajvals += 4; cvals += 4;
+        }
+
+        Dmat[i + ncon*j] += dmat;
+      }
     }
   }
 
   if (ncon > 0){
-    int rank;
-    MPI_Comm_rank(comm, &rank);
-
-    // Reduce the result to the root processor
-    if (rank == opt_root){
-      MPI_Reduce(MPI_IN_PLACE, Dmat, ncon*ncon,
-                 PAROPT_MPI_TYPE, MPI_SUM, opt_root, comm);
+    // Sum the lower triangular part of the matrix across all
+    // processors with a single reduction. The reduced values are
+    // identical on all processors, so the factorization is too.
+    int len = 0;
+    for ( int j = 0; j < ncon; j++ ){
+      for ( int i = j; i < ncon; i++, len++ ){
+        dwork[len] = Dmat[i + ncon*j];
+      }
     }
-    else {
-      MPI_Reduce(Dmat, NULL, ncon*ncon, PAROPT_MPI_TYPE, MPI_SUM,
-                 opt_root, comm);
+    ParOptAllreduce(MPI_IN_PLACE, dwork, len, PAROPT_MPI_TYPE,
+                    MPI_SUM, comm);
+
+    // Populate the full matrix because it is symmetric
+    len = 0;
+    for ( int j = 0; j < ncon; j++ ){
+      for ( int i = j; i < ncon; i++, len++ ){
+        Dmat[i + ncon*j] = dwork[len];
+        Dmat[j + ncon*i] = dwork[len];
+      }
     }
 
     // Add the diagonal component to the matrix
-    if (rank == opt_root){
-      if (dense_inequality){
-        for ( int i = 0; i < ncon; i++ ){
-          Dmat[i*(ncon + 1)] += s[i]/z[i] + t[i]/zt[i];
-        }
+    if (dense_inequality){
+      for ( int i = 0; i < ncon; i++ ){
+        Dmat[i*(ncon + 1)] += s[i]/z[i] + t[i]/zt[i];
       }
     }
 
-    // Broadcast the result to all processors. Note that this ensures
-    // that the factorization will be the same on all processors
-    MPI_Bcast(Dmat, ncon*ncon, PAROPT_MPI_TYPE, opt_root, comm);
-
     // Factor the matrix for future use
-    int info = 0;
-    LAPACKdgetrf(&ncon, &ncon, Dmat, &ncon, dpiv, &info);
+    factorDmat();
   }
+
+  profiler->stop(PAROPT_PROFILE_KKT_SETUP);
 }
 
 /*
@@ -2282,6 +3739,8 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx, ParOptScalar *bt,
                                               ParOptScalar *yzt,
                                               ParOptVec *yzl, ParOptVec *yzu,
                                               ParOptVec *xtmp, ParOptVec *wtmp ){
+  profiler->start(PAROPT_PROFILE_KKT_SOLVE);
+
   // Get the arrays for the variables and upper/lower bounds
   ParOptScalar *xvals, *lbvals, *ubvals;
   x->getArray(&xvals);
@@ -2411,9 +3870,7 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx, ParOptScalar *bt,
         }
       }
 
-      int one = 1, info = 0;
-      LAPACKdgetrs("N", &ncon, &one,
-                   Dmat, &ncon, dpiv, yz, &ncon, &info);
+      applyDmatFactor(yz);
     }
 
     MPI_Bcast(yz, ncon, PAROPT_MPI_TYPE, opt_root, comm);
@@ -2474,9 +3931,7 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx, ParOptScalar *bt,
   // Compute yx = C^{-1}*(d + A^{T}*yz + Aw^{T}*yzw)
   // therefore yx = C^{-1}*(A^{T}*yz + Aw^{T}*yzw) + xt
   yx->zeroEntries();
-  for ( int i = 0; i < ncon; i++ ){
-    yx->axpy(yz[i], Ac[i]);
-  }
+  Acvec->maxpy(ncon, yz, yx);
 
   // Add the term yx += Aw^{T}*yzw
   if (nwcon > 0){
@@ -2526,6 +3981,8 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx, ParOptScalar *bt,
       }
     }
   }
+
+  profiler->stop(PAROPT_PROFILE_KKT_SOLVE);
 }
 
 /*
@@ -2548,6 +4005,8 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx,
                                               ParOptScalar *yzt,
                                               ParOptVec *yzl, ParOptVec *yzu,
                                               ParOptVec *xtmp, ParOptVec *wtmp ){
+  profiler->start(PAROPT_PROFILE_KKT_SOLVE);
+
   // Compute the terms from the weighting constraints
   // Compute xt = C^{-1}*bx
   ParOptScalar *bxvals, *dvals, *cvals;
@@ -2626,9 +4085,7 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx,
         yz[i] *= -1.0;
       }
 
-      int one = 1, info = 0;
-      LAPACKdgetrs("N", &ncon, &one,
-                   Dmat, &ncon, dpiv, yz, &ncon, &info);
+      applyDmatFactor(yz);
     }
 
     MPI_Bcast(yz, ncon, PAROPT_MPI_TYPE, opt_root, comm);
@@ -2675,9 +4132,7 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx,
   // Compute yx = C^{-1}*(d + A^{T}*yz + Aw^{T}*yzw)
   // therefore yx = C^{-1}*(A^{T}*yz + Aw^{T}*yzw) + xt
   yx->zeroEntries();
-  for ( int i = 0; i < ncon; i++ ){
-    yx->axpy(yz[i], Ac[i]);
-  }
+  Acvec->maxpy(ncon, yz, yx);
 
   // Add the term yx += Aw^{T}*yzw
   if (nwcon > 0){
@@ -2731,6 +4186,8 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx,
       }
     }
   }
+
+  profiler->stop(PAROPT_PROFILE_KKT_SOLVE);
 }
 
 /*
@@ -2748,6 +4205,8 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx,
 void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx, ParOptVec *yx,
                                               ParOptScalar *ztmp,
                                               ParOptVec *xtmp, ParOptVec *wtmp ){
+  profiler->start(PAROPT_PROFILE_KKT_SOLVE);
+
   // Compute the terms from the weighting constraints
   // Compute xt = C^{-1}*bx
   ParOptScalar *bxvals, *dvals, *cvals;
@@ -2825,9 +4284,7 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx, ParOptVec *yx,
         ztmp[i] *= -1.0;
       }
 
-      int one = 1, info = 0;
-      LAPACKdgetrs("N", &ncon, &one,
-                   Dmat, &ncon, dpiv, ztmp, &ncon, &info);
+      applyDmatFactor(ztmp);
     }
 
     MPI_Bcast(ztmp, ncon, PAROPT_MPI_TYPE, opt_root, comm);
@@ -2849,9 +4306,7 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx, ParOptVec *yx,
   // Compute yx = C^{-1}*(d + A^{T}*yz + Aw^{T}*yzw)
   // therefore yx = C^{-1}*(A^{T}*yz + Aw^{T}*yzw) + xt
   yx->zeroEntries();
-  for ( int i = 0; i < ncon; i++ ){
-    yx->axpy(ztmp[i], Ac[i]);
-  }
+  Acvec->maxpy(ncon, ztmp, yx);
 
   // Add the term yx += Aw^{T}*wt
   if (nwcon > 0){
@@ -2868,6 +4323,8 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx, ParOptVec *yx,
 
   // Complete the result yx = C^{-1}*d + C^{-1}*(A^{T}*yz + Aw^{T}*yzw)
   yx->axpy(1.0, xtmp);
+
+  profiler->stop(PAROPT_PROFILE_KKT_SOLVE);
 }
 
 /*
@@ -2891,6 +4348,8 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx,
                                               ParOptScalar *yz,
                                               ParOptScalar *ys, ParOptVec *ysw,
                                               ParOptVec *xtmp, ParOptVec *wtmp ){
+  profiler->start(PAROPT_PROFILE_KKT_SOLVE);
+
   // Get the arrays for the variables and upper/lower bounds
   ParOptScalar *xvals, *lbvals, *ubvals;
   x->getArray(&xvals);
@@ -3022,9 +4481,7 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx,
         }
       }
 
-      int one = 1, info = 0;
-      LAPACKdgetrs("N", &ncon, &one,
-                   Dmat, &ncon, dpiv, yz, &ncon, &info);
+      applyDmatFactor(yz);
     }
 
     MPI_Bcast(yz, ncon, PAROPT_MPI_TYPE, opt_root, comm);
@@ -3086,9 +4543,7 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx,
   // Compute yx = C^{-1}*(d + A^{T}*yz + Aw^{T}*yzw)
   // therefore yx = C^{-1}*(A^{T}*yz + Aw^{T}*yzw) + xt
   yx->zeroEntries();
-  for ( int i = 0; i < ncon; i++ ){
-    yx->axpy(yz[i], Ac[i]);
-  }
+  Acvec->maxpy(ncon, yz, yx);
 
   // Add the term yx += Aw^{T}*yzw
   if (nwcon > 0){
@@ -3105,6 +4560,8 @@ void ParOptInteriorPoint::solveKKTDiagSystem( ParOptVec *bx,
 
   // Complete the result yx = C^{-1}*d + C^{-1}*(A^{T}*yz + Aw^{T}*yzw)
   yx->axpy(1.0, xtmp);
+
+  profiler->stop(PAROPT_PROFILE_KKT_SOLVE);
 }
 
 /*
@@ -3130,6 +4587,17 @@ void ParOptInteriorPoint::setUpKKTSystem( ParOptScalar *ztmp,
                                           ParOptVec *xtmp2,
                                           ParOptVec *wtmp,
                                           int use_qn ){
+  profiler->start(PAROPT_PROFILE_KKT_SETUP);
+
+  // Reuse the factorization if neither the diagonal KKT system nor
+  // the quasi-Newton approximation have changed
+  if (kkt_system_valid && kkt_system_use_qn == use_qn){
+    profiler->stop(PAROPT_PROFILE_KKT_SETUP);
+    return;
+  }
+  kkt_system_valid = 1;
+  kkt_system_use_qn = use_qn;
+
   if (qn && use_qn){
     // Get the size of the limited-memory BFGS subspace
     ParOptScalar b0;
@@ -3161,6 +4629,8 @@ void ParOptInteriorPoint::setUpKKTSystem( ParOptScalar *ztmp,
       LAPACKdgetrf(&size, &size, Ce, &size, cpiv, &info);
     }
   }
+
+  profiler->stop(PAROPT_PROFILE_KKT_SETUP);
 }
 
 /*
@@ -3253,67 +4723,36 @@ void ParOptInteriorPoint::computeKKTStep( ParOptScalar *ztmp,
   Compute the complementarity at the current solution
 */
 ParOptScalar ParOptInteriorPoint::computeComp(){
-  // Retrieve the values of the design variables, lower/upper bounds
-  // and the corresponding lagrange multipliers
-  ParOptScalar *xvals, *lbvals, *ubvals, *zlvals, *zuvals;
-  x->getArray(&xvals);
-  lb->getArray(&lbvals);
-  ub->getArray(&ubvals);
-  zl->getArray(&zlvals);
-  zu->getArray(&zuvals);
-
   // Sum up the complementarity from each individual processor
   ParOptScalar product = 0.0, sum = 0.0;
-
-  if (use_lower){
-    for ( int i = 0; i < nvars; i++ ){
-      if (ParOptRealPart(lbvals[i]) > -max_bound_val){
-        product += zlvals[i]*(xvals[i] - lbvals[i]);
-        sum += 1.0;
-      }
-    }
-  }
-
-  if (use_upper){
-    for ( int i = 0; i < nvars; i++ ){
-      if (ParOptRealPart(ubvals[i]) < max_bound_val){
-        product += zuvals[i]*(ubvals[i] - xvals[i]);
-        sum += 1.0;
-      }
-    }
-  }
+  x->localBoundComp(0.0, NULL, 0.0,
+                    (use_lower ? lb : NULL), zl, NULL,
+                    (use_upper ? ub : NULL), zu, NULL,
+                    max_bound_val, &product, &sum);
 
   // Modify the complementarity by the bound scalar factor
   product = product/rel_bound_barrier;
 
-  // Add up the contributions from all processors
-  ParOptScalar in[2], out[2];
-  in[0] = product;
-  in[1] = sum;
-  MPI_Reduce(in, out, 2, PAROPT_MPI_TYPE, MPI_SUM, opt_root, comm);
-  product = out[0];
-  sum = out[1];
+  // Add up the contributions from all processors. The dense terms
+  // are stored on all processors, so a single reduction suffices.
+  ParOptReductionContext ctx(comm);
+  int hproduct = ctx.addSum(product);
+  int hsum = ctx.addSum(sum);
+  ctx.reduce();
+  product = ctx.getScalar(hproduct);
+  sum = ctx.getScalar(hsum);
 
-  // Compute the complementarity only on the root processor
-  int rank = 0;
-  MPI_Comm_rank(comm, &rank);
-
-  ParOptScalar comp = 0.0;
-  if (rank == opt_root){
-    if (dense_inequality){
-      for ( int i = 0; i < ncon; i++ ){
-        product += s[i]*z[i] + t[i]*zt[i];
-        sum += 2.0;
-      }
-    }
-
-    if (sum != 0.0){
-      comp = product/sum;
+  if (dense_inequality){
+    for ( int i = 0; i < ncon; i++ ){
+      product += s[i]*z[i] + t[i]*zt[i];
+      sum += 2.0;
     }
   }
 
-  // Broadcast the result to all processors
-  MPI_Bcast(&comp, 1, PAROPT_MPI_TYPE, opt_root, comm);
+  ParOptScalar comp = 0.0;
+  if (sum != 0.0){
+    comp = product/sum;
+  }
 
   return comp;
 }
@@ -3322,75 +4761,37 @@ ParOptScalar ParOptInteriorPoint::computeComp(){
   Compute the complementarity at the given step
 */
 ParOptScalar ParOptInteriorPoint::computeCompStep( double alpha_x, double alpha_z ){
-  // Retrieve the values of the design variables, lower/upper bounds
-  // and the corresponding lagrange multipliers
-  ParOptScalar *xvals, *lbvals, *ubvals, *zlvals, *zuvals;
-  x->getArray(&xvals);
-  lb->getArray(&lbvals);
-  ub->getArray(&ubvals);
-  zl->getArray(&zlvals);
-  zu->getArray(&zuvals);
-
-  // Retrieve the values of the steps
-  ParOptScalar *pxvals, *pzlvals, *pzuvals;
-  px->getArray(&pxvals);
-  pzl->getArray(&pzlvals);
-  pzu->getArray(&pzuvals);
-
   // Sum up the complementarity from each individual processor
   ParOptScalar product = 0.0, sum = 0.0;
-  if (use_lower){
-    for ( int i = 0; i < nvars; i++ ){
-      if (ParOptRealPart(lbvals[i]) > -max_bound_val){
-        ParOptScalar xnew = xvals[i] + alpha_x*pxvals[i];
-        product += (zlvals[i] + alpha_z*pzlvals[i])*(xnew - lbvals[i]);
-        sum += 1.0;
-      }
-    }
-  }
-
-  if (use_upper){
-    for ( int i = 0; i < nvars; i++ ){
-      if (ParOptRealPart(ubvals[i]) < max_bound_val){
-        ParOptScalar xnew = xvals[i] + alpha_x*pxvals[i];
-        product += (zuvals[i] + alpha_z*pzuvals[i])*(ubvals[i] - xnew);
-        sum += 1.0;
-      }
-    }
-  }
+  x->localBoundComp(alpha_x, px, alpha_z,
+                    (use_lower ? lb : NULL), zl, pzl,
+                    (use_upper ? ub : NULL), zu, pzu,
+                    max_bound_val, &product, &sum);
 
   // Modify the complementarity by the bound scalar factor
   product = product/rel_bound_barrier;
 
-  // Add up the contributions from all processors
-  ParOptScalar in[2], out[2];
-  in[0] = product;
-  in[1] = sum;
-  MPI_Reduce(in, out, 2, PAROPT_MPI_TYPE, MPI_SUM, opt_root, comm);
-  product = out[0];
-  sum = out[1];
-
-  // Compute the complementarity only on the root processor
-  int rank = 0;
-  MPI_Comm_rank(comm, &rank);
-
-  ParOptScalar comp = 0.0;
-  if (rank == opt_root){
-    if (dense_inequality){
-      for ( int i = 0; i < ncon; i++ ){
-        product += ((s[i] + alpha_x*ps[i])*(z[i] + alpha_z*pz[i]) +
-                    (t[i] + alpha_x*pt[i])*(zt[i] + alpha_z*pzt[i]));
-        sum += 2.0;
-      }
-    }
+  // Add up the contributions from all processors. The dense terms
+  // are stored on all processors, so a single reduction suffices.
+  ParOptReductionContext ctx(comm);
+  int hproduct = ctx.addSum(product);
+  int hsum = ctx.addSum(sum);
+  ctx.reduce();
+  product = ctx.getScalar(hproduct);
+  sum = ctx.getScalar(hsum);
 
-    if (sum != 0.0){
-      comp = product/sum;
+  if (dense_inequality){
+    for ( int i = 0; i < ncon; i++ ){
+      product += ((s[i] + alpha_x*ps[i])*(z[i] + alpha_z*pz[i]) +
+                  (t[i] + alpha_x*pt[i])*(zt[i] + alpha_z*pzt[i]));
+      sum += 2.0;
     }
   }
 
-  // Broadcast the result to all processors
-  MPI_Bcast(&comp, 1, PAROPT_MPI_TYPE, opt_root, comm);
+  ParOptScalar comp = 0.0;
+  if (sum != 0.0){
+    comp = product/sum;
+  }
 
   return comp;
 }
@@ -3418,38 +4819,9 @@ void ParOptInteriorPoint::computeMaxStep( double tau,
   // directions
   double max_x = 1.0, max_z = 1.0;
 
-  // Retrieve the values of the design variables, the design
-  // variable step, and the lower/upper bounds
-  ParOptScalar *xvals, *pxvals, *lbvals, *ubvals;
-  x->getArray(&xvals);
-  px->getArray(&pxvals);
-  lb->getArray(&lbvals);
-  ub->getArray(&ubvals);
-
   // Check the design variable step
-  if (use_lower){
-    for ( int i = 0; i < nvars; i++ ){
-      if (ParOptRealPart(pxvals[i]) < 0.0){
-        double numer = ParOptRealPart(xvals[i] - lbvals[i]);
-        double alpha = -tau*numer/ParOptRealPart(pxvals[i]);
-        if (alpha < max_x){
-          max_x = alpha;
-        }
-      }
-    }
-  }
-
-  if (use_upper){
-    for ( int i = 0; i < nvars; i++ ){
-      if (ParOptRealPart(pxvals[i]) > 0.0){
-        double numer = ParOptRealPart(ubvals[i] - xvals[i]);
-        double alpha = tau*numer/ParOptRealPart(pxvals[i]);
-        if (alpha < max_x){
-          max_x = alpha;
-        }
-      }
-    }
-  }
+  max_x = x->localMaxBoundStep(tau, px, (use_lower ? lb : NULL),
+                               (use_upper ? ub : NULL), max_x);
 
   if (dense_inequality){
     // Check the slack variable step
@@ -3489,69 +4861,23 @@ void ParOptInteriorPoint::computeMaxStep( double tau,
   // Check the Lagrange and slack variable steps for the
   // sparse inequalities if any
   if (nwcon > 0 && sparse_inequality){
-    ParOptScalar *zwvals, *pzwvals;
-    zw->getArray(&zwvals);
-    pzw->getArray(&pzwvals);
-    for ( int i = 0; i < nwcon; i++ ){
-      if (ParOptRealPart(pzwvals[i]) < 0.0){
-        double numer = ParOptRealPart(zwvals[i]);
-        double alpha = -tau*numer/ParOptRealPart(pzwvals[i]);
-        if (alpha < max_z){
-          max_z = alpha;
-        }
-      }
-    }
-
-    ParOptScalar *swvals, *pswvals;
-    sw->getArray(&swvals);
-    psw->getArray(&pswvals);
-    for ( int i = 0; i < nwcon; i++ ){
-      if (ParOptRealPart(pswvals[i]) < 0.0){
-        double numer = ParOptRealPart(swvals[i]);
-        double alpha = -tau*numer/ParOptRealPart(pswvals[i]);
-        if (alpha < max_x){
-          max_x = alpha;
-        }
-      }
-    }
+    max_z = zw->localMaxStep(tau, pzw, max_z);
+    max_x = sw->localMaxStep(tau, psw, max_x);
   }
 
-  // Retrieve the values of the lower/upper Lagrange multipliers
-  ParOptScalar *zlvals, *zuvals, *pzlvals, *pzuvals;
-  zl->getArray(&zlvals);
-  zu->getArray(&zuvals);
-  pzl->getArray(&pzlvals);
-  pzu->getArray(&pzuvals);
-
   // Check the step for the lower/upper Lagrange multipliers
   if (use_lower){
-    for ( int i = 0; i < nvars; i++ ){
-      if (ParOptRealPart(pzlvals[i]) < 0.0){
-        double numer = ParOptRealPart(zlvals[i]);
-        double alpha = -tau*numer/ParOptRealPart(pzlvals[i]);
-        if (alpha < max_z){
-          max_z = alpha;
-        }
-      }
-    }
+    max_z = zl->localMaxStep(tau, pzl, max_z);
   }
   if (use_upper){
-    for ( int i = 0; i < nvars; i++ ){
-      if (ParOptRealPart(pzuvals[i]) < 0.0){
-        double numer = ParOptRealPart(zuvals[i]);
-        double alpha = -tau*numer/ParOptRealPart(pzuvals[i]);
-        if (alpha < max_z){
-          max_z = alpha;
-        }
-      }
-    }
+    max_z = zu->localMaxStep(tau, pzu, max_z);
   }
 
   // Compute the minimum step sizes from across all processors
   double input[2], output[2];
   input[0] = max_x;
   input[1] = max_z;
-  MPI_Allreduce(input, output, 2, MPI_DOUBLE, MPI_MIN, comm);
+  ParOptAllreduce(input, output, 2, MPI_DOUBLE, MPI_MIN, comm);
 
   // Return the minimum values
   *_max_x = output[0];
@@ -3582,21 +4908,24 @@ void ParOptInteriorPoint::computeStepVec( ParOptVec *xvec, ParOptScalar alpha,
                                           ParOptScalar *lower_value,
                                           ParOptVec *upper,
                                           ParOptScalar *upper_value ){
-  ParOptScalar *xvals = NULL;
-  ParOptScalar *pvals = NULL;
-  ParOptScalar *ubvals = NULL;
-  ParOptScalar *lbvals = NULL;
-  int size = xvec->getArray(&xvals);
-  pvec->getArray(&pvals);
-
-  if (lower){
-    lower->getArray(&lbvals);
-  }
-  if (upper){
-    upper->getArray(&ubvals);
-  }
+  computeStepVec(xvec, xvec, alpha, pvec, lower, lower_value,
+                 upper, upper_value);
+}
 
-  computeStep(size, xvals, alpha, pvals, lbvals, lower_value, ubvals, upper_value);
+/*
+  Set xvec = x0vec + alpha*pvec, adjusted so that the result lies
+  strictly within the bounds. This performs the copy, the step and
+  the bound adjustment in a single pass through the data.
+*/
+void ParOptInteriorPoint::computeStepVec( ParOptVec *xvec, ParOptVec *x0vec,
+                                          ParOptScalar alpha,
+                                          ParOptVec *pvec,
+                                          ParOptVec *lower,
+                                          ParOptScalar *lower_value,
+                                          ParOptVec *upper,
+                                          ParOptScalar *upper_value ){
+  xvec->computeBoundedStep(x0vec, alpha, pvec, lower, lower_value,
+                           upper, upper_value, design_precision);
 }
 
 /*
@@ -3610,42 +4939,27 @@ void ParOptInteriorPoint::computeStep( int nvals,
                                        const ParOptScalar *lower_value,
                                        const ParOptScalar *ubvals,
                                        const ParOptScalar *upper_value ){
-  for ( int i = 0; i < nvals; i++ ){
-    xvals[i] = xvals[i] + alpha*pvals[i];
-  }
-  if (lbvals){
-    for ( int i = 0; i < nvals; i++ ){
-      if (ParOptRealPart(xvals[i]) <=
-          ParOptRealPart(lbvals[i]) + design_precision){
-        xvals[i] = lbvals[i] + design_precision;
-      }
-    }
-  }
-  else if (lower_value){
-    double lbval = ParOptRealPart(*lower_value);
-    for ( int i = 0; i < nvals; i++ ){
-      if (ParOptRealPart(xvals[i]) <= lbval + design_precision){
-        xvals[i] = lbval + design_precision;
-      }
-    }
-  }
+  computeStep(nvals, xvals, xvals, alpha, pvals,
+              lbvals, lower_value, ubvals, upper_value);
+}
 
-  if (ubvals){
-    for ( int i = 0; i < nvals; i++ ){
-      if (ParOptRealPart(xvals[i]) + design_precision >=
-          ParOptRealPart(ubvals[i])){
-        xvals[i] = ubvals[i] - design_precision;
-      }
-    }
-  }
-  else if (upper_value){
-    double ubval = ParOptRealPart(*upper_value);
-    for ( int i = 0; i < nvals; i++ ){
-      if (ParOptRealPart(xvals[i]) + design_precision >= ubval){
-        xvals[i] = ubval - design_precision;
-      }
-    }
-  }
+/*
+  Set xvals = x0vals + alpha*pvals and make sure that the result is
+  within the prescribed bounds. Note that x0vals may be the same as
+  xvals.
+*/
+void ParOptInteriorPoint::computeStep( int nvals,
+                                       ParOptScalar *xvals,
+                                       const ParOptScalar *x0vals,
+                                       ParOptScalar alpha,
+                                       const ParOptScalar *pvals,
+                                       const ParOptScalar *lbvals,
+                                       const ParOptScalar *lower_value,
+                                       const ParOptScalar *ubvals,
+                                       const ParOptScalar *upper_value ){
+  ParOptComputeBoundedStep(nvals, xvals, x0vals, alpha, pvals,
+                           lbvals, lower_value, ubvals, upper_value,
+                           design_precision);
 }
 
 /*
@@ -3744,10 +5058,11 @@ int ParOptInteriorPoint::scaleKKTStep( double tau, ParOptScalar comp,
 void ParOptInteriorPoint::checkMeritFuncGradient( ParOptVec *xpt, double dh ){
   if (xpt){
     x->copyValues(xpt);
+    invalidateKKTFactorization();
   }
 
   // Evaluate the objective and constraints and their gradients
-  int fail_obj = prob->evalObjCon(x, &fobj, c);
+  int fail_obj = evalObjCon(x, &fobj, c);
   neval++;
   if (fail_obj){
     fprintf(stderr,
@@ -3755,7 +5070,7 @@ void ParOptInteriorPoint::checkMeritFuncGradient( ParOptVec *xpt, double dh ){
     return;
   }
 
-  int fail_gobj = prob->evalObjConGradient(x, g, Ac);
+  int fail_gobj = evalObjConGradient(x, g, Ac);
   ngeval++;
   if (fail_gobj){
     fprintf(stderr,
@@ -3793,8 +5108,7 @@ void ParOptInteriorPoint::checkMeritFuncGradient( ParOptVec *xpt, double dh ){
   evalMeritInitDeriv(max_x, &m0, &dm0, rx, wtemp, rcw);
 
 #ifdef PAROPT_USE_COMPLEX
-  rx->copyValues(x);
-  rx->axpy(ParOptScalar(0.0, dh), px);
+  rx->waxpy(ParOptScalar(0.0, dh), px, x);
 
   if (dense_inequality){
     for ( int i = 0; i < ncon; i++ ){
@@ -3804,12 +5118,10 @@ void ParOptInteriorPoint::checkMeritFuncGradient( ParOptVec *xpt, double dh ){
   }
 
   if (nwcon > 0 && sparse_inequality){
-    rsw->copyValues(sw);
-    rsw->axpy(ParOptScalar(0.0, dh), psw);
+    rsw->waxpy(ParOptScalar(0.0, dh), psw, sw);
   }
 #else
-  rx->copyValues(x);
-  rx->axpy(dh, px);
+  rx->waxpy(dh, px, x);
 
   if (dense_inequality){
     for ( int i = 0; i < ncon; i++ ){
@@ -3819,14 +5131,13 @@ void ParOptInteriorPoint::checkMeritFuncGradient( ParOptVec *xpt, double dh ){
   }
 
   if (nwcon > 0 && sparse_inequality){
-    rsw->copyValues(sw);
-    rsw->axpy(dh, psw);
+    rsw->waxpy(dh, psw, sw);
   }
 #endif // PAROPT_USE_COMPLEX
 
   // Evaluate the objective
   ParOptScalar ftemp;
-  fail_obj = prob->evalObjCon(rx, &ftemp, rc);
+  fail_obj = evalObjCon(rx, &ftemp, rc);
   neval++;
   if (fail_obj){
     fprintf(stderr,
@@ -3945,7 +5256,7 @@ ParOptScalar ParOptInteriorPoint::evalMeritFunc( ParOptScalar fk,
       weight_infeas += wvals[i]*wvals[i];
     }
     ParOptScalar weight_infeas_temp = weight_infeas;
-    MPI_Allreduce(&weight_infeas_temp, &weight_infeas, 1,
+    ParOptAllreduce(&weight_infeas_temp, &weight_infeas, 1,
                   PAROPT_MPI_TYPE, MPI_SUM, comm);
     weight_infeas = sqrt(weight_infeas);
 #else
@@ -4234,14 +5545,15 @@ void ParOptInteriorPoint::evalMeritInitDeriv( double max_x,
 
   // Compute the projection depending on whether this is
   // for an exact or inexact step
+  Acvec->mdot(px, ncon, ctemp);
   if (dense_inequality){
     for ( int i = 0; i < ncon; i++ ){
-      dense_proj += (c[i] - s[i] + t[i])*(Ac[i]->dot(px) - ps[i] + pt[i]);
+      dense_proj += (c[i] - s[i] + t[i])*(ctemp[i] - ps[i] + pt[i]);
     }
   }
   else {
     for ( int i = 0; i < ncon; i++ ){
-      dense_proj += c[i]*Ac[i]->dot(px);
+      dense_proj += c[i]*ctemp[i];
     }
   }
 
@@ -4260,7 +5572,7 @@ void ParOptInteriorPoint::evalMeritInitDeriv( double max_x,
     for ( int i = 0; i < nvars; i++ ){
       local += pxvals[i]*pxvals[i]*hvals[i];
     }
-    MPI_Allreduce(&local, &pTBp, 1, PAROPT_MPI_TYPE, MPI_SUM, comm);
+    ParOptAllreduce(&local, &pTBp, 1, PAROPT_MPI_TYPE, MPI_SUM, comm);
   }
   else if (qn){
     qn->mult(px, xtmp);
@@ -4384,26 +5696,22 @@ int ParOptInteriorPoint::lineSearch( double alpha_min, double *_alpha,
   int j = 0;
   for ( ; j < max_line_iters; j++ ){
     // Set rx = x + alpha*px
-    rx->copyValues(x);
-    computeStepVec(rx, alpha, px, lb, NULL, ub, NULL);
+    computeStepVec(rx, x, alpha, px, lb, NULL, ub, NULL);
 
     // Set rcw = sw + alpha*psw
     ParOptScalar zero = 0.0;
     if (nwcon > 0 && sparse_inequality){
-      rsw->copyValues(sw);
-      computeStepVec(rsw, alpha, psw, NULL, &zero, NULL, NULL);
+      computeStepVec(rsw, sw, alpha, psw, NULL, &zero, NULL, NULL);
     }
 
     // Set rs = s + alpha*ps and rt = t + alpha*pt
     if (dense_inequality){
-      memcpy(rs, s, ncon*sizeof(ParOptScalar));
-      computeStep(ncon, rs, alpha, ps, NULL, &zero, NULL, NULL);
-      memcpy(rt, t, ncon*sizeof(ParOptScalar));
-      computeStep(ncon, rt, alpha, pt, NULL, &zero, NULL, NULL);
+      computeStep(ncon, rs, s, alpha, ps, NULL, &zero, NULL, NULL);
+      computeStep(ncon, rt, t, alpha, pt, NULL, &zero, NULL, NULL);
     }
 
     // Evaluate the objective and constraints at the new point
-    int fail_obj = prob->evalObjCon(rx, &fobj, c);
+    int fail_obj = evalObjCon(rx, &fobj, c);
     neval++;
 
     if (fail_obj){
@@ -4516,26 +5824,22 @@ int ParOptInteriorPoint::lineSearch( double alpha_min, double *_alpha,
       alpha = best_alpha;
 
       // Set rx = x + alpha*px
-      rx->copyValues(x);
-      computeStepVec(rx, alpha, px, lb, NULL, ub, NULL);
+      computeStepVec(rx, x, alpha, px, lb, NULL, ub, NULL);
 
       // Set rcw = sw + alpha*psw
       ParOptScalar zero = 0.0;
       if (nwcon > 0 && sparse_inequality){
-        rsw->copyValues(sw);
-        computeStepVec(rsw, alpha, psw, NULL, &zero, NULL, NULL);
+        computeStepVec(rsw, sw, alpha, psw, NULL, &zero, NULL, NULL);
       }
 
       // Set rs = s + alpha*ps and rt = t + alpha*pt
       if (dense_inequality){
-        memcpy(rs, s, ncon*sizeof(ParOptScalar));
-        computeStep(ncon, rs, alpha, ps, NULL, &zero, NULL, NULL);
-        memcpy(rt, t, ncon*sizeof(ParOptScalar));
-        computeStep(ncon, rt, alpha, pt, NULL, &zero, NULL, NULL);
+        computeStep(ncon, rs, s, alpha, ps, NULL, &zero, NULL, NULL);
+        computeStep(ncon, rt, t, alpha, pt, NULL, &zero, NULL, NULL);
       }
 
       // Evaluate the objective and constraints at the new point
-      int fail_obj = prob->evalObjCon(rx, &fobj, c);
+      int fail_obj = evalObjCon(rx, &fobj, c);
       neval++;
 
       // This should not happen, since we've already evaluated
@@ -4559,26 +5863,247 @@ int ParOptInteriorPoint::lineSearch( double alpha_min, double *_alpha,
 }
 
 /**
-  Compute the step, evaluate the objective and constraints and their gradients
-  at the new point and update the quasi-Newton approximation.
+  Perform a speculative line search that evaluates several step
+  lengths at once.
+
+  Each iteration evaluates the bracket alpha, alpha/2, alpha/4, ...
+  (bounded below by alpha_min) with a single call to
+  ParOptProblem::evalObjConBatch(). Of the points that satisfy the
+  sufficient decrease condition, the one with the lowest merit
+  function value is accepted. If no point is acceptable, the next
+  bracket starts below the smallest step length in the current bracket.
+  The acceptance and fall-back rules are otherwise the same as in
+  lineSearch().
+
+  The points are passed to the problem with the largest step length
+  last, so that the objective and constraints do not have to be
+  re-evaluated when the full step is accepted.
 
-  @param alpha The step length to take
-  @param eval_obj_con Flag indicating whether to evaluate the obj/cons
-  @param perform_qn_update Flag indicating whether to update the quasi-Newton method
-  @returns The type of quasi-Newton update performed
+  @param alpha_min Minimum allowable step length
+  @param alpha (in/out) Initial line search step length
+  @param m0 The merit function value at alpha = 0
+  @param dm0 Derivative of the merit function along p at alpha = 0
+  @return Failure flag value
 */
-int ParOptInteriorPoint::computeStepAndUpdate( double alpha,
-                                               int eval_obj_con,
-                                               int perform_qn_update ){
-  // Set the new values of the variables
-  ParOptScalar zero = 0.0;
-  if (nwcon > 0){
-    computeStepVec(zw, alpha, pzw, NULL, &zero, NULL, NULL);
-    if (sparse_inequality){
-      computeStepVec(sw, alpha, psw, NULL, &zero, NULL, NULL);
-    }
-  }
-  if (use_lower){
+int ParOptInteriorPoint::lineSearchBatch( double alpha_min, double *_alpha,
+                                          ParOptScalar m0,
+                                          ParOptScalar dm0 ){
+  const int nbatch = line_search_batch_size;
+  double alpha = *_alpha;
+  int fail = PAROPT_LINE_SEARCH_FAILURE;
+
+  // Keep track of the best alpha value thus far and the best
+  // merit function value
+  ParOptScalar best_merit = 0.0;
+  ParOptScalar best_fobj = 0.0;
+  double best_alpha = -1.0;
+
+  // The index of the accepted point within the last batch, if any
+  int accept_index = -1;
+  int npts = 0;
+
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if (output_level > 0){
+    double pxnorm = px->maxabs();
+    if (outfp && rank == opt_root){
+      fprintf(outfp, "%5s %7s %25s %12s %12s %12s\n",
+              "iter", "alpha", "merit", "dmerit", "||px||", "min(alpha)");
+      fprintf(outfp, "%5d %7s %25.16e %12.5e %12.5e %12.5e\n",
+              0, " ", ParOptRealPart(m0), ParOptRealPart(dm0),
+              pxnorm, alpha_min);
+    }
+  }
+
+  int j = 0;
+  for ( ; j < max_line_iters; j++ ){
+    // Fill in the bracket of step lengths in decreasing order,
+    // stopping at the minimum step length
+    npts = 0;
+    double a = alpha;
+    for ( ; npts < nbatch; npts++ ){
+      if (a <= alpha_min){
+        a = alpha_min;
+        fail |= PAROPT_LINE_SEARCH_MIN_STEP;
+      }
+      line_search_alpha[npts] = a;
+      if (fail & PAROPT_LINE_SEARCH_MIN_STEP){
+        npts++;
+        break;
+      }
+      a *= 0.5;
+    }
+
+    // Reverse the order so that the largest step is evaluated last
+    for ( int i = 0; i < npts/2; i++ ){
+      double tmp = line_search_alpha[i];
+      line_search_alpha[i] = line_search_alpha[npts-1-i];
+      line_search_alpha[npts-1-i] = tmp;
+    }
+
+    // Set the trial points x + alpha*px
+    for ( int i = 0; i < npts; i++ ){
+      computeStepVec(line_search_x[i], x, line_search_alpha[i], px,
+                     lb, NULL, ub, NULL);
+    }
+
+    // Evaluate the objective and constraints at all the points
+    evalObjConBatch(npts, line_search_x, line_search_fobj,
+                    line_search_con, line_search_fail);
+    neval += npts;
+
+    // Find the acceptable point with the lowest merit function value
+    int nfail = 0;
+    ParOptScalar accept_merit = 0.0;
+    for ( int i = npts-1; i >= 0; i-- ){
+      double ai = line_search_alpha[i];
+      if (line_search_fail[i]){
+        nfail++;
+        continue;
+      }
+
+      // Set rcw = sw + alpha*psw
+      ParOptScalar zero = 0.0;
+      if (nwcon > 0 && sparse_inequality){
+        computeStepVec(rsw, sw, ai, psw, NULL, &zero, NULL, NULL);
+      }
+
+      // Set rs = s + alpha*ps and rt = t + alpha*pt
+      if (dense_inequality){
+        computeStep(ncon, rs, s, ai, ps, NULL, &zero, NULL, NULL);
+        computeStep(ncon, rt, t, ai, pt, NULL, &zero, NULL, NULL);
+      }
+
+      ParOptScalar *ci = &line_search_con[ncon*i];
+      ParOptScalar merit = evalMeritFunc(line_search_fobj[i], ci,
+                                         line_search_x[i], rs, rt, rsw);
+
+      if (outfp && rank == opt_root && output_level > 0){
+        fprintf(outfp, "%5d %7.1e %25.16e %12.5e\n", j+1, ai,
+                ParOptRealPart(merit), ParOptRealPart((merit - m0)/ai));
+      }
+
+      if (best_alpha < 0.0 ||
+          ParOptRealPart(merit) < ParOptRealPart(best_merit)){
+        best_alpha = ai;
+        best_merit = merit;
+        best_fobj = line_search_fobj[i];
+        memcpy(line_search_best_con, ci, ncon*sizeof(ParOptScalar));
+      }
+
+      // Check the sufficient decrease condition, relaxed by the
+      // function precision as in the sequential line search
+      if (ParOptRealPart(merit) - armijo_constant*ai*ParOptRealPart(dm0) <
+          (ParOptRealPart(m0) + function_precision)){
+        if (accept_index < 0 ||
+            ParOptRealPart(merit) < ParOptRealPart(accept_merit)){
+          accept_index = i;
+          accept_merit = merit;
+        }
+      }
+    }
+
+    if (nfail > 0){
+      fprintf(stderr, "ParOpt: %d evaluation(s) failed during line search\n",
+              nfail);
+    }
+
+    if (accept_index >= 0){
+      if (fail & PAROPT_LINE_SEARCH_MIN_STEP){
+        fail = PAROPT_LINE_SEARCH_SUCCESS | PAROPT_LINE_SEARCH_MIN_STEP;
+      }
+      else {
+        fail = PAROPT_LINE_SEARCH_SUCCESS;
+      }
+      break;
+    }
+    else if (fail & PAROPT_LINE_SEARCH_MIN_STEP){
+      break;
+    }
+
+    // Start the next bracket below the smallest step length. If all
+    // the evaluations failed, reduce the step further to avoid the
+    // undefined region.
+    if (nfail == npts){
+      alpha = 0.1*line_search_alpha[0];
+    }
+    else {
+      alpha = 0.5*line_search_alpha[0];
+    }
+  }
+
+  // The line search existed with the maximum number of line search
+  // iterations
+  if (j == max_line_iters){
+    fail |= PAROPT_LINE_SEARCH_MAX_ITERS;
+  }
+
+  if (fail & PAROPT_LINE_SEARCH_SUCCESS){
+    alpha = line_search_alpha[accept_index];
+    fobj = line_search_fobj[accept_index];
+    memcpy(c, &line_search_con[ncon*accept_index], ncon*sizeof(ParOptScalar));
+  }
+  else if (best_alpha < 0.0){
+    // All of the evaluations failed
+    fprintf(stderr, "ParOpt: Evaluation failed during line search\n");
+    *_alpha = alpha;
+    return PAROPT_LINE_SEARCH_FAILURE;
+  }
+  else {
+    // Check for a simple decrease within the function precision,
+    // then this is sufficient to accept the step.
+    if (ParOptRealPart(best_merit) <=
+        ParOptRealPart(m0) + function_precision){
+      fail |= PAROPT_LINE_SEARCH_SUCCESS;
+      fail &= ~PAROPT_LINE_SEARCH_FAILURE;
+    }
+    alpha = best_alpha;
+    fobj = best_fobj;
+    memcpy(c, line_search_best_con, ncon*sizeof(ParOptScalar));
+  }
+
+  // The gradient is evaluated at the accepted point next. The problem
+  // may assume that this is the last point in the batch, so
+  // re-evaluate the objective and constraints at any other point.
+  if (!(alpha == line_search_alpha[npts-1] && !line_search_fail[npts-1])){
+    computeStepVec(rx, x, alpha, px, lb, NULL, ub, NULL);
+    int fail_obj = evalObjCon(rx, &fobj, c);
+    neval++;
+    if (fail_obj){
+      fprintf(stderr, "ParOpt: Evaluation failed during line search\n");
+      fail = PAROPT_LINE_SEARCH_FAILURE;
+    }
+  }
+
+  *_alpha = alpha;
+
+  return fail;
+}
+
+/**
+  Compute the step, evaluate the objective and constraints and their gradients
+  at the new point and update the quasi-Newton approximation.
+
+  @param alpha The step length to take
+  @param eval_obj_con Flag indicating whether to evaluate the obj/cons
+  @param perform_qn_update Flag indicating whether to update the quasi-Newton method
+  @returns The type of quasi-Newton update performed
+*/
+int ParOptInteriorPoint::computeStepAndUpdate( double alpha,
+                                               int eval_obj_con,
+                                               int perform_qn_update ){
+  // The point is modified so the KKT factorizations are out of date
+  invalidateKKTFactorization();
+
+  // Set the new values of the variables
+  ParOptScalar zero = 0.0;
+  if (nwcon > 0){
+    computeStepVec(zw, alpha, pzw, NULL, &zero, NULL, NULL);
+    if (sparse_inequality){
+      computeStepVec(sw, alpha, psw, NULL, &zero, NULL, NULL);
+    }
+  }
+  if (use_lower){
     computeStepVec(zl, alpha, pzl, NULL, &zero, NULL, NULL);
   }
   if (use_upper){
@@ -4595,11 +6120,8 @@ int ParOptInteriorPoint::computeStepAndUpdate( double alpha,
   // Compute the negative gradient of the Lagrangian using the
   // old gradient information with the new multiplier estimates
   if (qn && perform_qn_update && use_quasi_newton_update){
-    y_qn->copyValues(g);
-    y_qn->scale(-1.0);
-    for ( int i = 0; i < ncon; i++ ){
-      y_qn->axpy(z[i], Ac[i]);
-    }
+    y_qn->axpby(-1.0, 0.0, g);
+    Acvec->maxpy(ncon, z, y_qn);
 
     // Add the term: Aw^{T}*zw
     if (nwcon > 0){
@@ -4615,7 +6137,7 @@ int ParOptInteriorPoint::computeStepAndUpdate( double alpha,
   // Evaluate the objective if needed. This step is not required
   // if a line search has just been performed.
   if (eval_obj_con){
-    int fail_obj = prob->evalObjCon(x, &fobj, c);
+    int fail_obj = evalObjCon(x, &fobj, c);
     neval++;
     if (fail_obj){
       fprintf(stderr,
@@ -4625,7 +6147,7 @@ int ParOptInteriorPoint::computeStepAndUpdate( double alpha,
   }
 
   // Evaluate the derivative at the new point
-  int fail_gobj = prob->evalObjConGradient(x, g, Ac);
+  int fail_gobj = evalObjConGradient(x, g, Ac);
   ngeval++;
   if (fail_gobj){
     fprintf(stderr,
@@ -4635,30 +6157,44 @@ int ParOptInteriorPoint::computeStepAndUpdate( double alpha,
   // Compute the Quasi-Newton update
   int update_type = 0;
   if (qn && perform_qn_update){
+    profiler->start(PAROPT_PROFILE_QN_UPDATE);
     if (use_quasi_newton_update){
       // Add the new gradient of the Lagrangian with the new
       // multiplier estimates.
       // Compute the step - scale by the step length
-      s_qn->copyValues(px);
-      s_qn->scale(alpha);
+      s_qn->axpby(alpha, 0.0, px);
 
       // Finish computing the difference in gradients
       y_qn->axpy(1.0, g);
       for ( int i = 0; i < ncon; i++ ){
-        y_qn->axpy(-z[i], Ac[i]);
+        ctemp[i] = -z[i];
       }
+      Acvec->maxpy(ncon, ctemp, y_qn);
 
       // Add the term: -Aw^{T}*zw
       if (nwcon > 0){
         prob->addSparseJacobianTranspose(-1.0, x, zw, y_qn);
       }
 
-      prob->computeQuasiNewtonUpdateCorrection(s_qn, y_qn);
+      if (active_set_compressed){
+        // The correction is computed with the full vectors. The fixed
+        // variables do not move, and their entries are dropped again
+        // after the correction.
+        s_qn->expandEntries(active_set, active_set_zeros);
+        y_qn->expandEntries(active_set, active_set_zeros);
+        prob->computeQuasiNewtonUpdateCorrection(s_qn, y_qn);
+        s_qn->compressEntries(active_set);
+        y_qn->compressEntries(active_set);
+      }
+      else {
+        prob->computeQuasiNewtonUpdateCorrection(s_qn, y_qn);
+      }
       update_type = qn->update(x, z, zw, s_qn, y_qn);
     }
     else {
       update_type = qn->update(x, z, zw);
     }
+    profiler->stop(PAROPT_PROFILE_QN_UPDATE);
   }
 
   return update_type;
@@ -4717,7 +6253,7 @@ void ParOptInteriorPoint::initAndCheckDesignAndBounds(){
 
   // Perform a bitwise global OR operation
   int tmp_check_flag = check_flag;
-  MPI_Allreduce(&tmp_check_flag, &check_flag, 1, MPI_INT, MPI_BOR, comm);
+  ParOptAllreduce(&tmp_check_flag, &check_flag, 1, MPI_INT, MPI_BOR, comm);
 
   int rank;
   MPI_Comm_rank(comm, &rank);
@@ -4754,6 +6290,75 @@ void ParOptInteriorPoint::initAndCheckDesignAndBounds(){
   }
 }
 
+/*
+  Initialize the point for a warm start.
+
+  The design variables from the previous optimization, xprev, are
+  shifted into the bounds that have just been retrieved from the
+  problem. The multipliers and slack variables are kept from the
+  previous optimization but bounded away from zero so that the
+  interior-point method can adjust them to the new problem.
+*/
+void ParOptInteriorPoint::initWarmStartPoint( ParOptVec *xprev ){
+  ParOptScalar *xvals, *xpvals, *lbvals, *ubvals;
+  x->getArray(&xvals);
+  xprev->getArray(&xpvals);
+  lb->getArray(&lbvals);
+  ub->getArray(&ubvals);
+
+  // The relative distance from the bounds for the shifted point
+  const double rel_bound = 1e-3;
+
+  ParOptScalar *zlvals, *zuvals;
+  zl->getArray(&zlvals);
+  zu->getArray(&zuvals);
+
+  for ( int i = 0; i < nvars; i++ ){
+    int has_lower = (use_lower &&
+                     ParOptRealPart(lbvals[i]) > -max_bound_val);
+    int has_upper = (use_upper &&
+                     ParOptRealPart(ubvals[i]) < max_bound_val);
+
+    ParOptScalar delta = 1.0;
+    if (has_lower && has_upper){
+      delta = ubvals[i] - lbvals[i];
+    }
+
+    xvals[i] = xpvals[i];
+    if (has_lower){
+      xvals[i] = max2(xvals[i], lbvals[i] + rel_bound*delta);
+      zlvals[i] = max2(start_affine_multiplier_min, zlvals[i]);
+    }
+    if (has_upper){
+      xvals[i] = min2(xvals[i], ubvals[i] - rel_bound*delta);
+      zuvals[i] = max2(start_affine_multiplier_min, zuvals[i]);
+    }
+  }
+
+  // The multiplier for the penalty slack satisfies the dual
+  // feasibility condition gamma - z - zt = 0 at the new penalty
+  // parameter values
+  if (dense_inequality){
+    for ( int i = 0; i < ncon; i++ ){
+      z[i] = max2(start_affine_multiplier_min, z[i]);
+      z[i] = min2(z[i], penalty_gamma[i] - start_affine_multiplier_min);
+      s[i] = max2(start_affine_multiplier_min, s[i]);
+      t[i] = max2(start_affine_multiplier_min, t[i]);
+      zt[i] = max2(start_affine_multiplier_min, penalty_gamma[i] - z[i]);
+    }
+  }
+
+  if (nwcon > 0 && sparse_inequality){
+    ParOptScalar *zwvals, *swvals;
+    zw->getArray(&zwvals);
+    sw->getArray(&swvals);
+    for ( int i = 0; i < nwcon; i++ ){
+      zwvals[i] = max2(start_affine_multiplier_min, zwvals[i]);
+      swvals[i] = max2(start_affine_multiplier_min, swvals[i]);
+    }
+  }
+}
+
 /**
    Perform the optimization.
 
@@ -4784,30 +6389,50 @@ int ParOptInteriorPoint::optimize( const char *checkpoint ){
   // Zero out the number of function/gradient evaluations
   niter = neval = ngeval = nhvec = 0;
 
+  // Reset the timers and counters
+  profiler->reset();
+  profiler->start(PAROPT_PROFILE_TOTAL);
+
   // If no quasi-Newton method is defined, use a sequential linear method instead
   if (!qn){
     sequential_linear_method = 1;
   }
 
+  // Keep the previous design point for a warm start
+  int warm_start = (use_warm_start && warm_start_ready);
+  if (warm_start){
+    xtemp->copyValues(x);
+  }
+
   // Initialize and check the design variables and bounds
   initAndCheckDesignAndBounds();
 
+  // Shift the previous point into the new bounds
+  if (warm_start){
+    initWarmStartPoint(xtemp);
+  }
+
+  // The point may have been modified since the last call
+  invalidateKKTFactorization();
+
   // Print what options we're using to the file
   printOptionSummary(outfp);
 
   // Evaluate the objective, constraint and their gradients at the
   // current values of the design variables
-  int fail_obj = prob->evalObjCon(x, &fobj, c);
+  int fail_obj = evalObjCon(x, &fobj, c);
   neval++;
   if (fail_obj){
     fprintf(stderr,
             "ParOpt: Initial function and constraint evaluation failed\n");
+    profiler->stop(PAROPT_PROFILE_TOTAL);
     return fail_obj;
   }
-  int fail_gobj = prob->evalObjConGradient(x, g, Ac);
+  int fail_gobj = evalObjConGradient(x, g, Ac);
   ngeval++;
   if (fail_gobj){
     fprintf(stderr, "ParOpt: Initial gradient evaluation failed\n");
+    profiler->stop(PAROPT_PROFILE_TOTAL);
     return fail_obj;
   }
 
@@ -4819,7 +6444,15 @@ int ParOptInteriorPoint::optimize( const char *checkpoint ){
   zl->getArray(&zlvals);
   zu->getArray(&zuvals);
 
-  if (starting_point_strategy == PAROPT_AFFINE_STEP){
+  if (warm_start){
+    // Set the barrier parameter from the complementarity at the
+    // shifted point
+    barrier_param = ParOptRealPart(computeComp());
+    if (barrier_param < 0.1*abs_res_tol){
+      barrier_param = 0.1*abs_res_tol;
+    }
+  }
+  else if (starting_point_strategy == PAROPT_AFFINE_STEP){
     // Zero the multipliers for bounds that are out-of-range
     for ( int i = 0; i < nvars; i++ ){
       if (ParOptRealPart(lbvals[i]) <= -max_bound_val){
@@ -4954,25 +6587,20 @@ int ParOptInteriorPoint::optimize( const char *checkpoint ){
     xt->axpy(-1.0, zl);
     xt->axpy(1.0, zu);
 
-    for ( int i = 0; i < ncon; i++ ){
-      z[i] = Ac[i]->dot(xt);
-    }
+    Acvec->mdot(xt, ncon, z);
 
     // Compute Dmat = A*A^{T}
     for ( int i = 0; i < ncon; i++ ){
-      Ac[i]->mdot(Ac, ncon, &Dmat[i*ncon]);
+      Acvec->mdot(Ac[i], ncon, &Dmat[i*ncon]);
     }
 
     if (ncon > 0){
       // Compute the factorization of Dmat
-      int info;
-      LAPACKdgetrf(&ncon, &ncon, Dmat, &ncon, dpiv, &info);
+      int info = factorDmat();
 
       // Solve the linear system
       if (!info){
-        int one = 1;
-        LAPACKdgetrs("N", &ncon, &one, Dmat, &ncon, dpiv,
-                     z, &ncon, &info);
+        applyDmatFactor(z);
 
         // Keep the Lagrange multipliers if they are within a
         // reasonable range and they are positive.
@@ -5004,9 +6632,14 @@ int ParOptInteriorPoint::optimize( const char *checkpoint ){
   // Some quasi-Newton methods can be updated with only the design variable
   // values and the multiplier estimates
   if (qn && !use_quasi_newton_update){
+    profiler->start(PAROPT_PROFILE_QN_UPDATE);
     qn->update(x, z, zw);
+    profiler->stop(PAROPT_PROFILE_QN_UPDATE);
   }
 
+  // The starting point strategy modifies the multipliers and slacks
+  invalidateKKTFactorization();
+
   // Retrieve the rank of the processor
   int rank;
   MPI_Comm_rank(comm, &rank);
@@ -5043,12 +6676,17 @@ int ParOptInteriorPoint::optimize( const char *checkpoint ){
   char info[64];
   info[0] = '\0';
 
+  // The last iteration at which the design vectors were compressed
+  // or expanded in the reduced-space mode
+  int active_set_iter = 0;
+
   for ( int k = 0; k < max_major_iters; k++, niter++ ){
     if (qn && !sequential_linear_method){
       if (k > 0 && k % hessian_reset_freq == 0 &&
           use_quasi_newton_update){
         // Reset the quasi-Newton Hessian approximation
         qn->reset();
+        kkt_system_valid = 0;
 
         // Add a reset flag to the output
         if (rank == opt_root){
@@ -5057,19 +6695,47 @@ int ParOptInteriorPoint::optimize( const char *checkpoint ){
       }
     }
 
+    // Expand the compressed design vectors periodically so that the
+    // active set is recomputed, and whenever the full design vector
+    // is required for the output or the gradient check
+    if (active_set_compressed){
+      int write_output =
+        (write_output_frequency > 0 && k % write_output_frequency == 0);
+      int check_gradient =
+        (k > 0 && gradient_check_frequency > 0 &&
+         k % gradient_check_frequency == 0);
+      int write_design = (history && history->isDesignDue(k));
+      if (k - active_set_iter >= active_set_expand_freq ||
+          write_output || check_gradient || write_design){
+        expandActiveSet();
+        active_set_iter = k;
+      }
+    }
+
     // Print out the current solution progress using the
     // hook in the problem definition
     if (write_output_frequency > 0 && k % write_output_frequency == 0){
+      profiler->start(PAROPT_PROFILE_OUTPUT);
       if (checkpoint){
         // Write the checkpoint file, if it fails once, set
         // the file pointer to null so it won't print again
-        if (writeSolutionFile(checkpoint)){
+        if (writeCheckpoint(checkpoint, use_async_checkpoint)){
           fprintf(stderr, "ParOpt: Checkpoint file %s creation failed\n",
                   checkpoint);
           checkpoint = NULL;
         }
       }
       prob->writeOutput(k, x);
+      profiler->stop(PAROPT_PROFILE_OUTPUT);
+    }
+
+    // Write the design history snapshot
+    if (history && history->isDesignDue(k)){
+      profiler->start(PAROPT_PROFILE_OUTPUT);
+      if (history->writeDesign(k, x)){
+        fprintf(stderr, "ParOpt: Design history write failed\n");
+      }
+      profiler->stop(PAROPT_PROFILE_OUTPUT);
     }
 
     // Print to screen the gradient check results at
@@ -5216,10 +6882,35 @@ int ParOptInteriorPoint::optimize( const char *checkpoint ){
                 rho_penalty_search, info);
       }
 
+      if (profile_output){
+        profiler->printIteration(outfp);
+      }
+
       // Flush the buffer so that we can see things immediately
       fflush(outfp);
     }
 
+    // Write the record to the binary history on the root processor
+    if (history && history->isOpen()){
+      double values[PAROPT_HISTORY_NUM_FIELDS];
+      values[0] = k;
+      values[1] = neval;
+      values[2] = ngeval;
+      values[3] = nhvec;
+      values[4] = alpha_prev;
+      values[5] = alpha_xprev;
+      values[6] = alpha_zprev;
+      values[7] = ParOptRealPart(fobj);
+      values[8] = max_prime;
+      values[9] = max_infeas;
+      values[10] = max_dual;
+      values[11] = barrier_param;
+      values[12] = ParOptRealPart(comp);
+      values[13] = ParOptRealPart(dm0_prev);
+      values[14] = rho_penalty_search;
+      history->writeRecord(values);
+    }
+
     // Check for convergence. We apply two different convergence
     // criteria at this point: the first based on the norm of
     // the KKT condition residuals, and the second based on the
@@ -5229,7 +6920,7 @@ int ParOptInteriorPoint::optimize( const char *checkpoint ){
         (res_norm < abs_res_tol ||
          rel_function_test ||
          (line_search_test >= 2))){
-      if (outfp && rank == opt_root){
+      if (outfp && rank == opt_root && !active_set_compressed){
         if (rel_function_test){
           fprintf(outfp, "\nParOpt: Successfully converged on relative function test\n");
         }
@@ -5248,11 +6939,30 @@ int ParOptInteriorPoint::optimize( const char *checkpoint ){
     // comparing values that might be different on different procs.
     MPI_Bcast(&converged, 1, MPI_INT, opt_root, comm);
 
+    // Only the reduced problem has converged: expand the design
+    // vectors and continue with the full problem
+    if (converged && active_set_compressed){
+      expandActiveSet();
+      active_set_iter = k;
+      computeKKTRes(barrier_param,
+                    &max_prime, &max_dual, &max_infeas, &res_norm);
+      converged = 0;
+    }
+
     // Everybody quit altogether if we've converged
     if (converged){
       break;
     }
 
+    // Compress the design vectors to the variables that are not
+    // firmly active. The residuals are compressed along with the
+    // other vectors so they do not need to be recomputed.
+    if (use_active_set && !active_set_compressed && k > active_set_iter){
+      if (compressActiveSet()){
+        active_set_iter = k;
+      }
+    }
+
     // Check if we should compute a Newton step or a quasi-Newton
     // step. Note that at this stage, we use s_qn and y_qn as
     // temporary arrays to help compute the KKT step. After
@@ -5289,9 +6999,11 @@ int ParOptInteriorPoint::optimize( const char *checkpoint ){
         setUpKKTSystem(ztemp, s_qn, y_qn, wtemp, use_qn);
 
         // Compute the inexact step using GMRES
+        profiler->start(PAROPT_PROFILE_KRYLOV);
         gmres_iters =
           computeKKTGMRESStep(ztemp, y_qn, s_qn, wtemp,
                               gmres_rtol, gmres_atol, use_qn);
+        profiler->stop(PAROPT_PROFILE_KRYLOV);
 
         if (abs_step_tol > 0.0){
           step_norm_prev = computeStepNorm();
@@ -5339,9 +7051,12 @@ int ParOptInteriorPoint::optimize( const char *checkpoint ){
       else if (use_diag_hessian){
         use_qn = 0;
         int fail = prob->evalHessianDiag(x, z, zw, hdiag);
+        kkt_diag_valid = 0;
         if (fail){
           fprintf(stderr,
                   "ParOpt: Hessian diagonal evaluation failed\n");
+          completeCheckpoint();
+          profiler->stop(PAROPT_PROFILE_TOTAL);
           return fail;
         }
       }
@@ -5509,7 +7224,14 @@ int ParOptInteriorPoint::optimize( const char *checkpoint ){
           if (alpha_min > 0.5){
             alpha_min = 0.5;
           }
-          line_fail = lineSearch(alpha_min, &alpha, m0, dm0);
+          profiler->start(PAROPT_PROFILE_LINE_SEARCH);
+          if (line_search_batch_size > 1){
+            line_fail = lineSearchBatch(alpha_min, &alpha, m0, dm0);
+          }
+          else {
+            line_fail = lineSearch(alpha_min, &alpha, m0, dm0);
+          }
+          profiler->stop(PAROPT_PROFILE_LINE_SEARCH);
 
           // If the line search was successful, quit
           if (!(line_fail & PAROPT_LINE_SEARCH_FAILURE)){
@@ -5553,6 +7275,7 @@ int ParOptInteriorPoint::optimize( const char *checkpoint ){
     if (qn && use_quasi_newton_update &&
         (line_fail & PAROPT_LINE_SEARCH_FAILURE)){
       qn->reset();
+      kkt_system_valid = 0;
     }
 
     // Create a string to print to the screen
@@ -5600,9 +7323,32 @@ int ParOptInteriorPoint::optimize( const char *checkpoint ){
         // the complementarity at the new step
         sprintf(&info[strlen(info)], "%s ", "cmpEq");
       }
+      if (active_set_compressed){
+        // The step was computed in the reduced space
+        sprintf(&info[strlen(info)], "%s ", "redSp");
+      }
     }
   }
 
+  // Expand the design vectors if the iterations stopped in the
+  // reduced-space mode
+  expandActiveSet();
+
+  // Finish writing the last checkpoint file
+  if (completeCheckpoint() && checkpoint){
+    fprintf(stderr, "ParOpt: Checkpoint file %s creation failed\n",
+            checkpoint);
+  }
+
+  // The final point can be used to warm-start the next optimization
+  warm_start_ready = 1;
+
+  profiler->stop(PAROPT_PROFILE_TOTAL);
+  if (profile_output && outfp && rank == opt_root){
+    profiler->printSummary(outfp);
+    fflush(outfp);
+  }
+
   // Success - we completed the optimization
   return 0;
 }
@@ -5774,7 +7520,7 @@ int ParOptInteriorPoint::computeKKTMinResStep( ParOptScalar *ztmp,
     }
 
     // Compute the vector product with the exact Hessian
-    prob->evalHvecProduct(x, z, zw, xtmp3, tv);
+    evalHvecProduct(x, z, zw, xtmp3, tv);
     nhvec++;
 
     // Keep track of the number of iterations
@@ -5954,15 +7700,16 @@ int ParOptInteriorPoint::computeKKTMinResStep( ParOptScalar *ztmp,
   // Add the contributions from the objective and dense constraints
   ParOptScalar fpr = g->dot(px);
   ParOptScalar cpr = 0.0;
+  Acvec->mdot(px, ncon, ctemp);
   if (dense_inequality){
     for ( int i = 0; i < ncon; i++ ){
-      ParOptScalar deriv = (Ac[i]->dot(px) - ps[i] + pt[i]);
+      ParOptScalar deriv = (ctemp[i] - ps[i] + pt[i]);
       cpr += cscale*(c[i] - s[i] + t[i])*deriv;
     }
   }
   else {
     for ( int i = 0; i < ncon; i++ ){
-      cpr += cscale*c[i]*Ac[i]->dot(px);
+      cpr += cscale*c[i]*ctemp[i];
     }
   }
 
@@ -6072,7 +7819,7 @@ ParOptScalar ParOptInteriorPoint::evalObjBarrierDeriv(){
   input[0] = pos_presult;
   input[1] = neg_presult;
 
-  MPI_Allreduce(input, result, 2, PAROPT_MPI_TYPE, MPI_SUM, comm);
+  ParOptAllreduce(input, result, 2, PAROPT_MPI_TYPE, MPI_SUM, comm);
 
   // Extract the result of the summation over all processors
   pos_presult = result[0];
@@ -6112,55 +7859,874 @@ ParOptScalar ParOptInteriorPoint::evalObjBarrierDeriv(){
 }
 
 /*
-  This function approximately solves the linearized KKT system with
-  Hessian-vector products using right-preconditioned GMRES.  This
-  procedure uses a preconditioner formed from a portion of the KKT
-  system.  Grouping the Lagrange multipliers and slack variables from
-  the remaining portion of the matrix, yields the following
-  decomposition:
+  Apply the GMRES preconditioner to the vector [ w, walpha*r ], where
+  r contains the remaining components of the right-hand-side. The
+  result is stored in the step components (px, pt, pz, ps, psw).
 
-  K = [ B; A ] + [ H - B; 0 ]
-  .   [ E; C ]   [     0; 0 ]
+  Note that xtmp3 is used as a temporary vector.
+*/
+void ParOptInteriorPoint::applyKKTGMRESPrecon( ParOptVec *w,
+                                               ParOptScalar walpha,
+                                               ParOptScalar *ztmp,
+                                               ParOptVec *xtmp1,
+                                               ParOptVec *xtmp2,
+                                               ParOptVec *xtmp3,
+                                               ParOptVec *wtmp,
+                                               int use_qn ){
+  // Get the size of the limited-memory BFGS subspace
+  ParOptScalar b0;
+  const ParOptScalar *d, *M;
+  ParOptVec **Z;
+  int size = 0;
+  if (qn && use_qn){
+    size = qn->getCompactMat(&b0, &d, &M, &Z);
+  }
 
-  Setting the precontioner as:
+  // Solve the first part of the equation
+  solveKKTDiagSystem(w, walpha,
+                     rt, rc, rcw, rs, rsw, rzt, rzl, rzu,
+                     px, pt, pz, ps, psw, xtmp2, wtmp);
 
-  M = [ B; A ]
-  .   [ E; C ]
+  if (size > 0){
+    // dz = Z^{T}*xt1
+    px->mdot(Z, size, ztmp);
 
-  We use right-preconditioning and solve the following system:
+    // Compute dz <- Ce^{-1}*dz
+    int one = 1, info = 0;
+    LAPACKdgetrs("N", &size, &one,
+                 Ce, &size, cpiv, ztmp, &size, &info);
 
-  K*M^{-1}*u = b
+    // Compute rx = Z^{T}*dz
+    xtmp2->zeroEntries();
+    for ( int k = 0; k < size; k++ ){
+      xtmp2->axpy(ztmp[k], Z[k]);
+    }
 
-  where M*x = u, so we compute x = M^{-1}*u
+    // Solve the digaonal system again, this time simplifying the
+    // result due to the structure of the right-hand-side.
+    solveKKTDiagSystem(xtmp2, xtmp1, ztmp, xtmp3, wtmp);
 
-  {[ I; 0 ] + [ H - B; 0 ]*M^{-1}}[ ux ] = [ bx ]
-  {[ 0; I ] + [     0; 0 ]       }[ uy ]   [ by ]
+    // Add the final contributions
+    px->axpy(-1.0, xtmp1);
+  }
+}
+
+/*
+  Evaluate the directional derivatives of the objective and barrier
+  terms, the dense constraint infeasibility and the sparse constraint
+  infeasibility along the current step (px, ps, pt, psw).
+
+  Note that xtmp is used as a temporary vector.
 */
-int ParOptInteriorPoint::computeKKTGMRESStep( ParOptScalar *ztmp,
-                                              ParOptVec *xtmp1, ParOptVec *xtmp2,
-                                              ParOptVec *wtmp,
-                                              double rtol, double atol,
-                                              int use_qn ){
-  // Check that the subspace has been allocated
-  if (gmres_subspace_size <= 0){
-    int rank;
-    MPI_Comm_rank(comm, &rank);
-    if (rank == opt_root){
-      fprintf(stderr, "ParOpt error: gmres_subspace_size not set\n");
-    }
-    return 0;
+void ParOptInteriorPoint::evalKKTGMRESProjections( ParOptScalar cscale,
+                                                   ParOptScalar cwscale,
+                                                   ParOptVec *xtmp,
+                                                   ParOptScalar *fproj,
+                                                   ParOptScalar *aproj,
+                                                   ParOptScalar *awproj ){
+  *fproj = evalObjBarrierDeriv();
+
+  // Compute the directional derivative of the l2 constraint infeasibility
+  // along the direction px.
+  // Queue the products Ac*px and the sparse constraint terms so that
+  // they are computed with a single reduction
+  ParOptReductionContext ctx(comm);
+  for ( int j = 0; j < ncon; j++ ){
+    ctx.addDot(Ac[j], px);
+  }
+  int hawx = -1, hawsw = -1;
+  if (nwcon > 0){
+    // rcw = -(cw - sw)
+    xtmp->zeroEntries();
+    prob->addSparseJacobianTranspose(1.0, x, rcw, xtmp);
+    hawx = ctx.addDot(px, xtmp);
+
+    if (sparse_inequality){
+      hawsw = ctx.addDot(rcw, psw);
+    }
+  }
+  ctx.reduce();
+
+  *aproj = 0.0;
+  if (dense_inequality){
+    for ( int j = 0; j < ncon; j++ ){
+      ParOptScalar cj_deriv = (ctx.getScalar(j) - ps[j] + pt[j]);
+      *aproj -= cscale*rc[j]*cj_deriv;
+    }
+  }
+  else {
+    for ( int j = 0; j < ncon; j++ ){
+      *aproj -= cscale*rc[j]*ctx.getScalar(j);
+    }
+  }
+
+  // Add the contributions from the sparse constraints (if any are defined)
+  *awproj = 0.0;
+  if (nwcon > 0){
+    *awproj = -cwscale*ctx.getScalar(hawx);
+
+    if (sparse_inequality){
+      *awproj += cwscale*ctx.getScalar(hawsw);
+    }
+  }
+}
+
+/*
+  Complete the product of the right-preconditioned KKT matrix with w,
+  given the preconditioned components in px. This computes
+
+  y = w + (H - B)*px
+*/
+void ParOptInteriorPoint::applyKKTGMRESOperator( ParOptVec *w,
+                                                 ParOptVec *y,
+                                                 int use_qn ){
+  // Compute the vector product with the exact Hessian
+  evalHvecProduct(x, z, zw, px, y);
+  nhvec++;
+
+  // Add the term -B*W[i]
+  if (qn && use_qn){
+    qn->multAdd(-1.0, px, y);
+  }
+
+  // Add the term from the diagonal
+  y->axpy(1.0, w);
+}
+
+/*
+  Apply the Givens rotations to the i-th column of the Hessenberg
+  matrix, update the residual and check the GMRES convergence
+  criteria. The solution is only accepted when it is a candidate
+  descent direction.
+
+  @param i the index of the new column
+  @param bnorm the norm of the right-hand-side
+  @param infeas the constraint infeasibility
+  @return 1 if the iteration has converged, 0 otherwise
+*/
+int ParOptInteriorPoint::updateKKTGMRESResidual( int i, ParOptScalar bnorm,
+                                                 ParOptScalar infeas,
+                                                 double rtol, double atol ){
+  ParOptScalar *H = gmres_H;
+  ParOptScalar *res = gmres_res;
+  ParOptScalar *y = gmres_y;
+  ParOptScalar *Qcos = &gmres_Q[0];
+  ParOptScalar *Qsin = &gmres_Q[gmres_subspace_size];
+  int hptr = (i+1)*(i+2)/2 - 1;
+  int niters = i+1;
+
+  // Apply the existing part of Q to the new components of the
+  // Hessenberg matrix
+  for ( int k = 0; k < i; k++ ){
+    ParOptScalar h1 = H[k + hptr];
+    ParOptScalar h2 = H[k+1 + hptr];
+    H[k + hptr] = h1*Qcos[k] + h2*Qsin[k];
+    H[k+1 + hptr] = -h1*Qsin[k] + h2*Qcos[k];
+  }
+
+  // Now, compute the rotation for the new column that was just added
+  ParOptScalar h1 = H[i + hptr];
+  ParOptScalar h2 = H[i+1 + hptr];
+  ParOptScalar sq = sqrt(h1*h1 + h2*h2);
+
+  Qcos[i] = h1/sq;
+  Qsin[i] = h2/sq;
+  H[i + hptr] = h1*Qcos[i] + h2*Qsin[i];
+  H[i+1 + hptr] = -h1*Qsin[i] + h2*Qcos[i];
+
+  // Update the residual
+  h1 = res[i];
+  res[i] = h1*Qcos[i];
+  res[i+1] = -h1*Qsin[i];
+
+  // Check the contribution to the projected derivative terms. First
+  // evaluate the weights y[] for each
+  for ( int j = niters-1; j >= 0; j-- ){
+    y[j] = res[j];
+    for ( int k = j+1; k < niters; k++ ){
+      int hptr = (k+1)*(k+2)/2 - 1;
+      y[j] = y[j] - H[j + hptr]*y[k];
+    }
+
+    int hptr = (j+1)*(j+2)/2 - 1;
+    y[j] = y[j]/H[j + hptr];
+  }
+
+  // Compute the projection of the solution px on to the gradient
+  // direction and the constraint Jacobian directions, including the
+  // contribution from the recycled space (if any)
+  ParOptScalar fpr = gmres_fproj0, cpr = gmres_cproj0;
+  for ( int j = 0; j < niters; j++ ){
+    fpr += y[j]*gmres_fproj[j];
+    cpr += y[j]*(gmres_aproj[j] + gmres_awproj[j]);
+  }
+
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if (rank == opt_root && output_level > 0){
+    fprintf(outfp, "      %4d %4d %7.1e %7.1e %8.1e %8.1e\n",
+            nhvec, i+1, fabs(ParOptRealPart(res[i+1])),
+            fabs(ParOptRealPart(res[i+1]/bnorm)),
+            ParOptRealPart(fpr), ParOptRealPart(cpr));
+    fflush(outfp);
+  }
+
+  // Check first that the direction is a candidate descent direction
+  int constraint_descent = 0;
+  if (ParOptRealPart(cpr) <= -0.01*ParOptRealPart(infeas)){
+    constraint_descent = 1;
+  }
+  if (ParOptRealPart(fpr) < 0.0 || constraint_descent){
+    // Check for convergence
+    if (fabs(ParOptRealPart(res[i+1])) < atol ||
+        fabs(ParOptRealPart(res[i+1])) < rtol*ParOptRealPart(bnorm)){
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/*
+  Apply the Givens rotations to the i-th column of the block
+  Hessenberg matrix, update the residual and check the GMRES
+  convergence criteria.
+
+  The block Hessenberg matrix is stored as a dense column-major matrix
+  and the i-th column has non-zero entries in the rows 0 through
+  i+bsize. The entries below the diagonal are eliminated with bsize
+  rotations for each column, each between the diagonal row and one of
+  the rows below it.
+
+  @param i the index of the new column
+  @param bsize the block size
+  @param bnorm the norm of the right-hand-side
+  @param infeas the constraint infeasibility
+  @return 1 if the iteration has converged, 0 otherwise
+*/
+int ParOptInteriorPoint::updateKKTBlockGMRESResidual( int i, int bsize,
+                                                      ParOptScalar bnorm,
+                                                      ParOptScalar infeas,
+                                                      double rtol,
+                                                      double atol ){
+  const int ldh = gmres_subspace_size + gmres_block_size;
+  ParOptScalar *H = gmres_H;
+  ParOptScalar *res = gmres_res;
+  ParOptScalar *y = gmres_y;
+  ParOptScalar *Qcos = &gmres_Q[0];
+  ParOptScalar *Qsin = &gmres_Q[gmres_subspace_size*gmres_block_size];
+  ParOptScalar *h = &H[ldh*i];
+  int niters = i+1;
+
+  // Apply the existing rotations to the new column
+  for ( int k = 0; k < i; k++ ){
+    for ( int l = 1; l <= bsize; l++ ){
+      int q = k*bsize + l-1;
+      ParOptScalar h1 = h[k];
+      ParOptScalar h2 = h[k+l];
+      h[k] = h1*Qcos[q] + h2*Qsin[q];
+      h[k+l] = -h1*Qsin[q] + h2*Qcos[q];
+    }
+  }
+
+  // Compute the rotations that eliminate the entries below the
+  // diagonal of the new column and apply them to the residual
+  for ( int l = 1; l <= bsize; l++ ){
+    int q = i*bsize + l-1;
+    ParOptScalar h1 = h[i];
+    ParOptScalar h2 = h[i+l];
+    ParOptScalar sq = sqrt(h1*h1 + h2*h2);
+
+    if (ParOptRealPart(sq) == 0.0){
+      Qcos[q] = 1.0;
+      Qsin[q] = 0.0;
+    }
+    else {
+      Qcos[q] = h1/sq;
+      Qsin[q] = h2/sq;
+    }
+    h[i] = h1*Qcos[q] + h2*Qsin[q];
+    h[i+l] = -h1*Qsin[q] + h2*Qcos[q];
+
+    h1 = res[i];
+    h2 = res[i+l];
+    res[i] = h1*Qcos[q] + h2*Qsin[q];
+    res[i+l] = -h1*Qsin[q] + h2*Qcos[q];
+  }
+
+  // The norm of the residual is the norm of the remaining entries
+  ParOptScalar rnorm = 0.0;
+  for ( int l = 1; l <= bsize; l++ ){
+    rnorm += res[i+l]*res[i+l];
+  }
+  rnorm = sqrt(rnorm);
+
+  // Evaluate the weights y[] for the projected derivative terms
+  for ( int j = niters-1; j >= 0; j-- ){
+    y[j] = res[j];
+    for ( int k = j+1; k < niters; k++ ){
+      y[j] = y[j] - H[j + ldh*k]*y[k];
+    }
+    y[j] = y[j]/H[j + ldh*j];
+  }
+
+  // Compute the projection of the solution px on to the gradient
+  // direction and the constraint Jacobian directions
+  ParOptScalar fpr = 0.0, cpr = 0.0;
+  for ( int j = 0; j < niters; j++ ){
+    fpr += y[j]*gmres_fproj[j];
+    cpr += y[j]*(gmres_aproj[j] + gmres_awproj[j]);
+  }
+
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if (rank == opt_root && output_level > 0){
+    fprintf(outfp, "      %4d %4d %7.1e %7.1e %8.1e %8.1e\n",
+            nhvec, i+1, fabs(ParOptRealPart(rnorm)),
+            fabs(ParOptRealPart(rnorm/bnorm)),
+            ParOptRealPart(fpr), ParOptRealPart(cpr));
+    fflush(outfp);
+  }
+
+  // Check first that the direction is a candidate descent direction
+  int constraint_descent = 0;
+  if (ParOptRealPart(cpr) <= -0.01*ParOptRealPart(infeas)){
+    constraint_descent = 1;
+  }
+  if (ParOptRealPart(fpr) < 0.0 || constraint_descent){
+    // Check for convergence
+    if (fabs(ParOptRealPart(rnorm)) < atol ||
+        fabs(ParOptRealPart(rnorm)) < rtol*ParOptRealPart(bnorm)){
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/*
+  Perform the block GMRES iterations for the KKT system.
+
+  On entry, W[0] and alpha[0] contain the normalized right-hand-side
+  and res[0] contains its norm. The block of starting vectors is
+  completed with the stored solutions of the previous solves, which
+  are orthogonalized against the right-hand-side and each other.
+  Stored solutions that are nearly in the span of the block are
+  skipped. Since the right-hand-side is the first vector in the
+  block, the initial residual is bnorm*e1.
+
+  At each iteration, the preconditioner is applied to each direction
+  in the current block, and the Hessian-vector products with all of
+  the preconditioned directions are computed with a single call. The
+  new basis vectors are orthogonalized using modified Gram-Schmidt and
+  the convergence criteria are checked after each new column.
+
+  @param bsize the maximum block size
+  @param gamma the scalar multiple of the remaining components
+  @return the number of columns of the block Hessenberg matrix
+*/
+int ParOptInteriorPoint::computeKKTBlockGMRESIters( int bsize,
+                                                    ParOptScalar beta,
+                                                    ParOptScalar bnorm,
+                                                    ParOptScalar cscale,
+                                                    ParOptScalar cwscale,
+                                                    ParOptScalar infeas,
+                                                    ParOptScalar *ztmp,
+                                                    ParOptVec *xtmp1,
+                                                    ParOptVec *xtmp2,
+                                                    ParOptVec *wtmp,
+                                                    double rtol,
+                                                    double atol,
+                                                    int use_qn,
+                                                    ParOptScalar *gamma ){
+  const int m = gmres_subspace_size;
+  const int ldh = m + gmres_block_size;
+  ParOptScalar *H = gmres_H;
+  ParOptScalar *alpha = gmres_alpha;
+  ParOptScalar *res = gmres_res;
+  ParOptScalar *fproj = gmres_fproj;
+  ParOptScalar *aproj = gmres_aproj;
+  ParOptScalar *awproj = gmres_awproj;
+  ParOptVec **W = gmres_W;
+  ParOptVec **P = gmres_P;
+
+  // Complete the block of starting vectors. The stored solutions have
+  // unit norm and no component in the remaining variables.
+  int nstart = 1;
+  for ( int k = 0; k < gmres_num_seeds && nstart < bsize; k++ ){
+    ParOptVec *v = W[nstart];
+    v->copyValues(gmres_seeds[k]);
+    alpha[nstart] = 0.0;
+    for ( int j = nstart-1; j >= 0; j-- ){
+      ParOptScalar hj = v->dot(W[j]) + beta*alpha[nstart]*alpha[j];
+      v->axpy(-hj, W[j]);
+      alpha[nstart] -= hj*alpha[j];
+    }
+
+    ParOptScalar vnorm = sqrt(v->dot(v) + beta*alpha[nstart]*alpha[nstart]);
+    if (ParOptRealPart(vnorm) > 1e-8){
+      v->scale(1.0/vnorm);
+      alpha[nstart] *= 1.0/vnorm;
+      nstart++;
+    }
+  }
+  bsize = nstart;
+
+  // Set the initial residual
+  for ( int i = 1; i < ldh; i++ ){
+    res[i] = 0.0;
+  }
+
+  int niters = 0;
+  int converged = 0;
+  for ( int i0 = 0; i0 + bsize <= m && !converged; i0 += bsize ){
+    // Apply the preconditioner to each direction in the block
+    // and compute the directional derivatives. Note that this
+    // uses the output vectors W[i+bsize] as temporary vectors.
+    for ( int j = 0; j < bsize; j++ ){
+      int i = i0 + j;
+      applyKKTGMRESPrecon(W[i], alpha[i]/bnorm, ztmp, xtmp1, xtmp2,
+                          W[i+bsize], wtmp, use_qn);
+      evalKKTGMRESProjections(cscale, cwscale, xtmp1,
+                              &fproj[i], &aproj[i], &awproj[i]);
+      P[j]->copyValues(px);
+    }
+
+    // Compute the products with the exact Hessian for the block
+    evalHvecProductBlock(x, z, zw, bsize, P, &W[i0+bsize]);
+    nhvec += bsize;
+
+    // Complete the products W[i+bsize] = K*M^{-1}*W[i]
+    for ( int j = 0; j < bsize; j++ ){
+      int i = i0 + j;
+      if (qn && use_qn){
+        qn->multAdd(-1.0, P[j], W[i+bsize]);
+      }
+      W[i+bsize]->axpy(1.0, W[i]);
+      alpha[i+bsize] = alpha[i];
+    }
+
+    for ( int j = 0; j < bsize; j++ ){
+      int i = i0 + j;
+      int n = i + bsize;
+      ParOptScalar *h = &H[ldh*i];
+
+      // Build the orthogonal factorization MGS
+      ParOptScalar hsum = 0.0;
+      for ( int k = n-1; k >= 0; k-- ){
+        h[k] = W[n]->dot(W[k]) + beta*alpha[n]*alpha[k];
+        hsum += h[k]*h[k];
+
+        W[n]->axpy(-h[k], W[k]);
+        alpha[n] -= h[k]*alpha[k];
+      }
+
+      // Compute the norm of the combined vector
+      h[n] = sqrt(W[n]->dot(W[n]) + beta*alpha[n]*alpha[n]);
+
+      // If the new vector is in the span of the basis, the subspace
+      // is invariant, stop after this column
+      if (ParOptRealPart(h[n]) <= 1e-12*ParOptRealPart(sqrt(hsum))){
+        h[n] = 0.0;
+        converged = 1;
+      }
+      else {
+        // Normalize the combined vector
+        W[n]->scale(1.0/h[n]);
+        alpha[n] *= 1.0/h[n];
+      }
+
+      niters++;
+
+      // Update the QR factorization and check for convergence
+      if (updateKKTBlockGMRESResidual(i, bsize, bnorm, infeas,
+                                      rtol, atol) || converged){
+        converged = 1;
+        break;
+      }
+    }
+  }
+
+  // Compute the linear combination of the basis vectors. The matrix
+  // H is now upper triangular.
+  for ( int i = niters-1; i >= 0; i-- ){
+    for ( int j = i+1; j < niters; j++ ){
+      res[i] = res[i] - H[i + ldh*j]*res[j];
+    }
+    res[i] = res[i]/H[i + ldh*i];
+  }
+
+  *gamma = res[0]*alpha[0];
+  W[0]->scale(res[0]);
+  for ( int i = 1; i < niters; i++ ){
+    W[0]->axpy(res[i], W[i]);
+    *gamma += res[i]*alpha[i];
+  }
+
+  return niters;
+}
+
+/*
+  Kernels for the mixed precision GMRES basis. The basis vectors are
+  stored in single precision, while the work vectors and all of the
+  sums are computed in full precision.
+*/
+
+/*
+  Compute the inner product of the full precision vector x with the
+  single precision vector w. The partial array must have one entry for
+  each block of the vectors.
+*/
+static ParOptScalar ParOptLowPrecisionDot( MPI_Comm comm, int n,
+                                           const ParOptScalar *x,
+                                           const ParOptLowScalar *w,
+                                           ParOptScalar *partial ){
+  ParOptScalar res = 0.0;
+#ifdef PAROPT_USE_OPENMP
+  int nblocks = (n + PAROPT_GMRES_BLOCK_SIZE - 1)/PAROPT_GMRES_BLOCK_SIZE;
+
+  PAROPT_OMP_FOR
+  for ( int k = 0; k < nblocks; k++ ){
+    int end = (k+1)*PAROPT_GMRES_BLOCK_SIZE;
+    if (end > n){ end = n; }
+
+    ParOptScalar sum = 0.0;
+    for ( int i = k*PAROPT_GMRES_BLOCK_SIZE; i < end; i++ ){
+      sum += x[i]*ParOptScalar(w[i]);
+    }
+    partial[k] = sum;
+  }
+
+  for ( int k = 0; k < nblocks; k++ ){
+    res += partial[k];
+  }
+#else
+  for ( int i = 0; i < n; i++ ){
+    res += x[i]*ParOptScalar(w[i]);
+  }
+#endif // PAROPT_USE_OPENMP
+
+  ParOptScalar sum = 0.0;
+  ParOptAllreduce(&res, &sum, 1, PAROPT_MPI_TYPE, MPI_SUM, comm);
+  return sum;
+}
+
+/*
+  Compute x <- x + alpha*w
+*/
+static void ParOptLowPrecisionAxpy( int n, ParOptScalar alpha,
+                                    const ParOptLowScalar *w,
+                                    ParOptScalar *x ){
+  PAROPT_OMP_FOR
+  for ( int i = 0; i < n; i++ ){
+    x[i] += alpha*ParOptScalar(w[i]);
+  }
+}
+
+/*
+  Round x to single precision and store it in w. The rounded values
+  are copied back to x, so that the products computed with x are
+  consistent with the stored basis.
+*/
+static void ParOptLowPrecisionStore( int n, ParOptScalar *x,
+                                     ParOptLowScalar *w ){
+  PAROPT_OMP_FOR
+  for ( int i = 0; i < n; i++ ){
+    w[i] = ParOptLowScalar(x[i]);
+    x[i] = ParOptScalar(w[i]);
+  }
+}
+
+/*
+  Compute the products of the KKT matrix with the recycled vectors U
+  and orthonormalize the result, so that C = K*M^{-1}*U with
+  C^{T}*C = I. The same transformation is applied to U and to the
+  projections of M^{-1}*U on to the gradient and constraint
+  directions. Vectors that are nearly linearly dependent are dropped.
+
+  Note that the recycled vectors only have design components, so the
+  inner products only involve the design components.
+
+  @return the number of recycled vectors that are retained
+*/
+int ParOptInteriorPoint::initKKTGMRESRecycle( ParOptScalar cscale,
+                                              ParOptScalar cwscale,
+                                              ParOptScalar *ztmp,
+                                              ParOptVec *xtmp1,
+                                              ParOptVec *xtmp2,
+                                              ParOptVec *wtmp,
+                                              int use_qn ){
+  ParOptVec **U = gmres_U;
+  ParOptVec **C = gmres_C;
+  ParOptScalar *h = gmres_y;
+
+  int k = 0;
+  for ( int j = 0; j < gmres_num_recycle; j++ ){
+    // Move the vector to the next retained position
+    if (j != k){
+      ParOptVec *tmp = U[k];
+      U[k] = U[j];
+      U[j] = tmp;
+    }
+
+    // Compute M^{-1}*[ U[k], 0 ] and its projections. Note that this
+    // call uses C[k] as a temporary vector.
+    applyKKTGMRESPrecon(U[k], 0.0, ztmp, xtmp1, xtmp2, C[k], wtmp, use_qn);
+    ParOptScalar fp, ap, awp;
+    evalKKTGMRESProjections(cscale, cwscale, xtmp1, &fp, &ap, &awp);
+    ParOptScalar cp = ap + awp;
+
+    // Compute C[k] = K*M^{-1}*U[k]
+    applyKKTGMRESOperator(U[k], C[k], use_qn);
+    ParOptScalar cnorm = C[k]->norm();
+
+    // Orthogonalize against the previous vectors using classical
+    // Gram-Schmidt with re-orthogonalization
+    for ( int pass = 0; pass < 2 && k > 0; pass++ ){
+      C[k]->mdot(C, k, h);
+      for ( int l = 0; l < k; l++ ){
+        C[k]->axpy(-h[l], C[l]);
+        U[k]->axpy(-h[l], U[l]);
+        fp -= h[l]*gmres_ufproj[l];
+        cp -= h[l]*gmres_ucproj[l];
+      }
+    }
+
+    // Normalize the vector or drop it if it is dependent
+    ParOptScalar rnorm = C[k]->norm();
+    if (ParOptRealPart(rnorm) > 1e-10*ParOptRealPart(cnorm)){
+      C[k]->scale(1.0/rnorm);
+      U[k]->scale(1.0/rnorm);
+      gmres_ufproj[k] = fp/rnorm;
+      gmres_ucproj[k] = cp/rnorm;
+      k++;
+    }
+  }
+
+  gmres_num_recycle = k;
+
+  return k;
+}
+
+/*
+  Compute the recycled space for the next GMRES solve from the
+  harmonic Ritz vectors of the current solve.
+
+  The augmented space V = [ U*D, W[0:m] ], where D normalizes the
+  columns of U, satisfies K*M^{-1}*V = Z*G with Z = [ C, W[0:m+1] ]
+  and
+
+  G = [ D  B    ]
+  .   [ 0  Hbar ]
+
+  The harmonic Ritz pairs satisfy G^{T}*G*p = theta*G^{T}*Z^{T}*V*p.
+  The vectors V*p corresponding to the harmonic Ritz values with the
+  smallest magnitude are stored in gmres_Unew. Since the KKT matrix is
+  not symmetric, the harmonic Ritz values may be complex. In this
+  case, the real and imaginary parts of the vector are both stored.
+  The eigenvalue problem is solved with the real parts of the
+  coefficients.
+
+  @param niters the number of GMRES iterations in the current solve
+*/
+void ParOptInteriorPoint::updateKKTGMRESRecycle( int niters ){
+  const int m = gmres_subspace_size;
+  int kmax = gmres_recycle_size;
+  if (kmax > m){
+    kmax = m;
+  }
+
+  int k = gmres_num_recycle;
+  int n = k + niters;
+  int ld = n+1;
+  gmres_num_new_recycle = 0;
+
+  // Compute the inner products of U with U, C and W with a single
+  // reduction
+  ParOptReductionContext ctx(comm);
+  int *hctx = new int[ k*(k + niters + 2) ];
+  for ( int j = 0; j < k; j++ ){
+    int *hj = &hctx[j*(k + niters + 2)];
+    hj[0] = ctx.addDot(gmres_U[j], gmres_U[j]);
+    for ( int l = 0; l < k; l++ ){
+      hj[1+l] = ctx.addDot(gmres_C[l], gmres_U[j]);
+    }
+    for ( int r = 0; r <= niters; r++ ){
+      hj[1+k+r] = ctx.addDot(gmres_W[r], gmres_U[j]);
+    }
+  }
+  ctx.reduce();
+
+  // Form G and Z^{T}*V in column-major order
+  ParOptScalar *G = new ParOptScalar[ ld*n ];
+  ParOptScalar *ZV = new ParOptScalar[ ld*n ];
+  double *d = new double[ k+1 ];
+  memset(G, 0, ld*n*sizeof(ParOptScalar));
+  memset(ZV, 0, ld*n*sizeof(ParOptScalar));
+
+  for ( int j = 0; j < k; j++ ){
+    int *hj = &hctx[j*(k + niters + 2)];
+    d[j] = 1.0/sqrt(ParOptRealPart(ctx.getScalar(hj[0])));
+    G[j + ld*j] = d[j];
+    for ( int l = 0; l < k; l++ ){
+      ZV[l + ld*j] = d[j]*ParOptRealPart(ctx.getScalar(hj[1+l]));
+    }
+    for ( int r = 0; r <= niters; r++ ){
+      ZV[k+r + ld*j] = d[j]*ParOptRealPart(ctx.getScalar(hj[1+k+r]));
+    }
+  }
+  for ( int i = 0; i < niters; i++ ){
+    int col = k+i;
+    for ( int l = 0; l < k; l++ ){
+      G[l + ld*col] = ParOptRealPart(gmres_B[l + k*i]);
+    }
+    for ( int r = 0; r <= i+1; r++ ){
+      G[k+r + ld*col] = ParOptRealPart(gmres_G[r + (m+1)*i]);
+    }
+    ZV[k+i + ld*col] = 1.0;
+  }
+  delete [] hctx;
+
+  // Compute A = G^{T}*G and T = G^{T}*Z^{T}*V
+  ParOptScalar *A = new ParOptScalar[ n*n ];
+  ParOptScalar *T = new ParOptScalar[ n*n ];
+  ParOptScalar one = 1.0, zero = 0.0;
+  BLASdgemm("T", "N", &n, &n, &ld, &one, G, &ld, G, &ld, &zero, A, &n);
+  BLASdgemm("T", "N", &n, &n, &ld, &one, G, &ld, ZV, &ld, &zero, T, &n);
+
+  // Compute A^{-1}*T, whose eigenvalues are the reciprocals of the
+  // harmonic Ritz values
+  int *ipiv = new int[ n ];
+  int info = 0;
+  LAPACKdgetrf(&n, &n, A, &n, ipiv, &info);
+  if (info == 0){
+    LAPACKdgetrs("N", &n, &n, A, &n, ipiv, T, &n, &info);
+  }
+
+  double *Ar = new double[ n*n ];
+  double *wr = new double[ n ];
+  double *wi = new double[ n ];
+  double *vr = new double[ n*n ];
+  int lwork = 8*n;
+  double *work = new double[ lwork ];
+  if (info == 0){
+    for ( int i = 0; i < n*n; i++ ){
+      Ar[i] = ParOptRealPart(T[i]);
+    }
+    int ldvl = 1;
+    LAPACKdgeev("N", "V", &n, Ar, &n, wr, wi, NULL, &ldvl,
+                vr, &n, work, &lwork, &info);
+  }
+
+  if (info == 0){
+    // Select the eigenvectors with the largest magnitude eigenvalues
+    // of A^{-1}*T, which have the smallest harmonic Ritz values
+    int *used = new int[ n ];
+    memset(used, 0, n*sizeof(int));
+    int knew = 0;
+    while (knew < kmax){
+      int index = -1;
+      double wmax = 0.0;
+      for ( int i = 0; i < n; i++ ){
+        double w = sqrt(wr[i]*wr[i] + wi[i]*wi[i]);
+        if (!used[i] && (index < 0 || w > wmax)){
+          index = i;
+          wmax = w;
+        }
+      }
+      if (index < 0){
+        break;
+      }
+
+      // Complex conjugate pairs are stored in consecutive columns as
+      // the real and imaginary parts of the first eigenvector
+      int ncols = 1;
+      if (wi[index] != 0.0){
+        if (wi[index] < 0.0){
+          index--;
+        }
+        used[index+1] = 1;
+        ncols = 2;
+      }
+      used[index] = 1;
+
+      for ( int c = 0; c < ncols && knew < kmax; c++ ){
+        const double *p = &vr[n*(index + c)];
+        ParOptVec *unew = gmres_Unew[knew];
+        unew->zeroEntries();
+        for ( int j = 0; j < k; j++ ){
+          unew->axpy(p[j]*d[j], gmres_U[j]);
+        }
+        for ( int i = 0; i < niters; i++ ){
+          unew->axpy(p[k+i], gmres_W[i]);
+        }
+        knew++;
+      }
+    }
+    gmres_num_new_recycle = knew;
+    delete [] used;
+  }
+
+  delete [] G;
+  delete [] ZV;
+  delete [] d;
+  delete [] A;
+  delete [] T;
+  delete [] ipiv;
+  delete [] Ar;
+  delete [] wr;
+  delete [] wi;
+  delete [] vr;
+  delete [] work;
+}
+
+/*
+  This function approximately solves the linearized KKT system with
+  Hessian-vector products using right-preconditioned GMRES.  This
+  procedure uses a preconditioner formed from a portion of the KKT
+  system.  Grouping the Lagrange multipliers and slack variables from
+  the remaining portion of the matrix, yields the following
+  decomposition:
+
+  K = [ B; A ] + [ H - B; 0 ]
+  .   [ E; C ]   [     0; 0 ]
+
+  Setting the precontioner as:
+
+  M = [ B; A ]
+  .   [ E; C ]
+
+  We use right-preconditioning and solve the following system:
+
+  K*M^{-1}*u = b
+
+  where M*x = u, so we compute x = M^{-1}*u
+
+  {[ I; 0 ] + [ H - B; 0 ]*M^{-1}}[ ux ] = [ bx ]
+  {[ 0; I ] + [     0; 0 ]       }[ uy ]   [ by ]
+*/
+int ParOptInteriorPoint::computeKKTGMRESStep( ParOptScalar *ztmp,
+                                              ParOptVec *xtmp1, ParOptVec *xtmp2,
+                                              ParOptVec *wtmp,
+                                              double rtol, double atol,
+                                              int use_qn ){
+  // Check that the subspace has been allocated
+  if (gmres_subspace_size <= 0){
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    if (rank == opt_root){
+      fprintf(stderr, "ParOpt error: gmres_subspace_size not set\n");
+    }
+    return 0;
   }
 
   // Initialize the data from the gmres object
   ParOptScalar *H = gmres_H;
   ParOptScalar *alpha = gmres_alpha;
   ParOptScalar *res = gmres_res;
-  ParOptScalar *y = gmres_y;
   ParOptScalar *fproj = gmres_fproj;
   ParOptScalar *aproj = gmres_aproj;
   ParOptScalar *awproj = gmres_awproj;
-  ParOptScalar *Qcos = &gmres_Q[0];
-  ParOptScalar *Qsin = &gmres_Q[gmres_subspace_size];
   ParOptVec **W = gmres_W;
 
   // Compute the beta factor: the product of the diagonal terms
@@ -6176,31 +8742,33 @@ int ParOptInteriorPoint::computeKKTGMRESStep( ParOptScalar *ztmp,
       beta += rzt[i]*rzt[i];
     }
   }
+
+  // Compute the distributed contributions with a single reduction
+  ParOptReductionContext ctx(comm);
+  int hrzl = -1, hrzu = -1, hrcw = -1, hrsw = -1;
   if (use_lower){
-    beta += rzl->dot(rzl);
+    hrzl = ctx.addDot(rzl, rzl);
   }
   if (use_upper){
-    beta += rzu->dot(rzu);
+    hrzu = ctx.addDot(rzu, rzu);
   }
   if (nwcon > 0){
-    beta += rcw->dot(rcw);
+    hrcw = ctx.addDot(rcw, rcw);
     if (sparse_inequality){
-      beta += rsw->dot(rsw);
+      hrsw = ctx.addDot(rsw, rsw);
     }
   }
+  int hrx = ctx.addDot(rx, rx);
+  ctx.reduce();
 
-  // Compute the norm of the initial vector
-  ParOptScalar bnorm = sqrt(rx->dot(rx) + beta);
-
-  // Broadcast the norm of the residuals and the beta parameter to
-  // keep things consistent across processors
-  ParOptScalar temp[2];
-  temp[0] = bnorm;
-  temp[1] = beta;
-  MPI_Bcast(temp, 2, PAROPT_MPI_TYPE, opt_root, comm);
+  if (hrzl >= 0){ beta += ctx.getScalar(hrzl); }
+  if (hrzu >= 0){ beta += ctx.getScalar(hrzu); }
+  if (hrcw >= 0){ beta += ctx.getScalar(hrcw); }
+  if (hrsw >= 0){ beta += ctx.getScalar(hrsw); }
 
-  bnorm = temp[0];
-  beta = temp[1];
+  // Compute the norm of the initial vector. The result of the
+  // reduction is identical on all processors.
+  ParOptScalar bnorm = sqrt(ctx.getScalar(hrx) + beta);
 
   // Compute the final value of the beta term
   beta *= 1.0/(bnorm*bnorm);
@@ -6227,17 +8795,46 @@ int ParOptInteriorPoint::computeKKTGMRESStep( ParOptScalar *ztmp,
   // infeasibility and store it.
   ParOptScalar cwinfeas = 0.0, cwscale = 0.0;
   if (nwcon > 0){
-    cwinfeas = sqrt(rcw->dot(rcw));
+    cwinfeas = sqrt(ctx.getScalar(hrcw));
     if (ParOptRealPart(cwinfeas) != 0.0){
       cwscale = 1.0/cwinfeas;
     }
   }
 
-  // Initialize the residual norm
-  res[0] = bnorm;
-  W[0]->copyValues(rx);
-  W[0]->scale(1.0/res[0]);
-  alpha[0] = 1.0;
+  // Recycle the Krylov subspace when using the standard method
+  int recycle = (gmres_U && !gmres_P && !gmres_mixed_precision &&
+                 gmres_type == PAROPT_MGS_GMRES);
+  int nrecycle = 0;
+  ParOptScalar *cb = NULL;
+  gmres_fproj0 = gmres_cproj0 = 0.0;
+  if (recycle){
+    nrecycle = initKKTGMRESRecycle(cscale, cwscale, ztmp,
+                                   xtmp1, xtmp2, wtmp, use_qn);
+  }
+
+  if (nrecycle > 0){
+    // Take the initial solution U*C^{T}*b and start from the residual
+    // b - C*C^{T}*b. The recycled vectors have no components outside
+    // the design space.
+    cb = &gmres_B[nrecycle*gmres_subspace_size];
+    rx->mdot(gmres_C, nrecycle, cb);
+    W[0]->copyValues(rx);
+    for ( int l = 0; l < nrecycle; l++ ){
+      W[0]->axpy(-cb[l], gmres_C[l]);
+      gmres_fproj0 += cb[l]*gmres_ufproj[l];
+      gmres_cproj0 += cb[l]*gmres_ucproj[l];
+    }
+    res[0] = sqrt(W[0]->dot(W[0]) + beta*bnorm*bnorm);
+    W[0]->scale(1.0/res[0]);
+    alpha[0] = bnorm/res[0];
+  }
+  else {
+    // Initialize the residual norm
+    res[0] = bnorm;
+    W[0]->copyValues(rx);
+    W[0]->scale(1.0/res[0]);
+    alpha[0] = 1.0;
+  }
 
   // Keep track of the actual number of iterations
   int niters = 0;
@@ -6250,202 +8847,317 @@ int ParOptInteriorPoint::computeKKTGMRESStep( ParOptScalar *ztmp,
     fprintf(outfp, "%5s %4s %4s %7s %7s %8s %8s gmres rtol: %7.1e\n",
             "gmres", "nhvc", "iter", "res", "rel", "fproj", "cproj", rtol);
     fprintf(outfp, "      %4d %4d %7.1e %7.1e\n",
-            nhvec, 0, fabs(ParOptRealPart(res[0])), 1.0);
+            nhvec, 0, fabs(ParOptRealPart(res[0])),
+            fabs(ParOptRealPart(res[0]/bnorm)));
   }
 
-  for ( int i = 0; i < gmres_subspace_size; i++ ){
-    // Compute M^{-1}*[ W[i], alpha[i]*yc, ... ]
-    // Get the size of the limited-memory BFGS subspace
-    ParOptScalar b0;
-    const ParOptScalar *d, *M;
-    ParOptVec **Z;
-    int size = 0;
-    if (qn && use_qn){
-      size = qn->getCompactMat(&b0, &d, &M, &Z);
-    }
+  // Use the block method once previous solutions are available
+  int bsize = 1;
+  if (gmres_P){
+    bsize = 1 + gmres_num_seeds;
+  }
 
-    // Solve the first part of the equation
-    solveKKTDiagSystem(W[i], alpha[i]/bnorm,
-                       rt, rc, rcw, rs, rsw, rzt, rzl, rzu,
-                       px, pt, pz, ps, psw, xtmp2, wtmp);
+  ParOptScalar gamma = 0.0;
+  if (bsize > 1){
+    niters = computeKKTBlockGMRESIters(bsize, beta, bnorm, cscale, cwscale,
+                                       cinfeas + cwinfeas, ztmp,
+                                       xtmp1, xtmp2, wtmp, rtol, atol,
+                                       use_qn, &gamma);
+  }
+  else if (gmres_type == PAROPT_PIPELINED_GMRES && !gmres_mixed_precision){
+    // Allocate the vectors that store the products of the
+    // preconditioned operator with the basis vectors
+    if (!gmres_AW){
+      gmres_AW = new ParOptVec*[ gmres_subspace_size ];
+      for ( int i = 0; i < gmres_subspace_size; i++ ){
+        gmres_AW[i] = prob->createDesignVec();
+        gmres_AW[i]->incref();
+      }
+    }
+    ParOptVec **AW = gmres_AW;
 
-    if (size > 0){
-      // dz = Z^{T}*xt1
-      px->mdot(Z, size, ztmp);
+    // The reduction context for the orthogonalization
+    ParOptReductionContext orth(comm);
 
-      // Compute dz <- Ce^{-1}*dz
-      int one = 1, info = 0;
-      LAPACKdgetrs("N", &size, &one,
-                   Ce, &size, cpiv, ztmp, &size, &info);
+    // Compute AW[0] = K*M^{-1}*W[0] and the projections for W[0]
+    applyKKTGMRESPrecon(W[0], alpha[0]/bnorm, ztmp, xtmp1, xtmp2, AW[0],
+                        wtmp, use_qn);
+    evalKKTGMRESProjections(cscale, cwscale, xtmp1,
+                            &fproj[0], &aproj[0], &awproj[0]);
+    applyKKTGMRESOperator(W[0], AW[0], use_qn);
 
-      // Compute rx = Z^{T}*dz
-      xtmp2->zeroEntries();
-      for ( int k = 0; k < size; k++ ){
-        xtmp2->axpy(ztmp[k], Z[k]);
+    for ( int i = 0; i < gmres_subspace_size; i++ ){
+      // Start the reduction for the products of AW[i] with the
+      // existing basis vectors and with itself. Note that the scalar
+      // component of AW[i] is equal to alpha[i].
+      orth.reset();
+      for ( int j = 0; j <= i; j++ ){
+        orth.addDot(AW[i], W[j]);
+      }
+      int hnorm = orth.addDot(AW[i], AW[i]);
+      orth.beginReduce();
+
+      // While the reduction is in progress, compute the product of
+      // the preconditioned operator with AW[i]. Since
+      // AW[i] = H[i+1,i]*W[i+1] + sum_{j} H[j,i]*W[j], this product
+      // is used to compute AW[i+1] once the coefficients are known.
+      ParOptScalar fnext = 0.0, anext = 0.0, awnext = 0.0;
+      int has_next = (i+1 < gmres_subspace_size);
+      if (has_next){
+        applyKKTGMRESPrecon(AW[i], alpha[i]/bnorm, ztmp, xtmp1, xtmp2,
+                            AW[i+1], wtmp, use_qn);
+        evalKKTGMRESProjections(cscale, cwscale, xtmp1,
+                                &fnext, &anext, &awnext);
+        applyKKTGMRESOperator(AW[i], AW[i+1], use_qn);
+      }
+
+      orth.endReduce();
+
+      // Compute the new column of the Hessenberg matrix using
+      // classical Gram-Schmidt
+      int hptr = (i+1)*(i+2)/2 - 1;
+      ParOptScalar hsum = 0.0;
+      for ( int j = 0; j <= i; j++ ){
+        H[j + hptr] = orth.getScalar(j) + beta*alpha[i]*alpha[j];
+        hsum += H[j + hptr]*H[j + hptr];
+      }
+      ParOptScalar anorm = orth.getScalar(hnorm) + beta*alpha[i]*alpha[i];
+
+      // Form the new basis vector W[i+1]
+      W[i+1]->copyValues(AW[i]);
+      alpha[i+1] = alpha[i];
+      for ( int j = 0; j <= i; j++ ){
+        W[i+1]->axpy(-H[j + hptr], W[j]);
+        alpha[i+1] -= H[j + hptr]*alpha[j];
+      }
+
+      // Compute the norm of the new vector from the reduced values.
+      // If there is severe cancellation, compute the norm explicitly.
+      ParOptScalar hnext = anorm - hsum;
+      if (ParOptRealPart(hnext) <= 1e-8*ParOptRealPart(anorm)){
+        hnext = W[i+1]->dot(W[i+1]) + beta*alpha[i+1]*alpha[i+1];
+      }
+      H[i+1 + hptr] = sqrt(hnext);
+
+      // Normalize the combined vector
+      W[i+1]->scale(1.0/H[i+1 + hptr]);
+      alpha[i+1] *= 1.0/H[i+1 + hptr];
+
+      if (has_next){
+        // Complete the computation of AW[i+1] = K*M^{-1}*W[i+1] and
+        // the projections for W[i+1] using the recurrence
+        for ( int j = 0; j <= i; j++ ){
+          AW[i+1]->axpy(-H[j + hptr], AW[j]);
+          fnext -= H[j + hptr]*fproj[j];
+          anext -= H[j + hptr]*aproj[j];
+          awnext -= H[j + hptr]*awproj[j];
+        }
+        AW[i+1]->scale(1.0/H[i+1 + hptr]);
+        fproj[i+1] = fnext/H[i+1 + hptr];
+        aproj[i+1] = anext/H[i+1 + hptr];
+        awproj[i+1] = awnext/H[i+1 + hptr];
       }
 
-      // Solve the digaonal system again, this time simplifying the
-      // result due to the structure of the right-hand-side.  Note
-      // that this call uses W[i+1] as a temporary vector.
-      solveKKTDiagSystem(xtmp2, xtmp1, ztmp, W[i+1], wtmp);
+      niters++;
 
-      // Add the final contributions
-      px->axpy(-1.0, xtmp1);
+      // Update the QR factorization and check for convergence
+      if (updateKKTGMRESResidual(i, bnorm, cinfeas + cwinfeas,
+                                 rtol, atol)){
+        break;
+      }
     }
+  }
+  else if (gmres_mixed_precision){
+    // The basis vectors are stored in Wf, while W[0] and W[1]
+    // alternate as the full precision copies of the current and the
+    // next basis vector
+    ParOptLowScalar *Wf = gmres_Wf;
+    ParOptScalar *wvals = NULL;
+    W[0]->getArray(&wvals);
+    ParOptLowPrecisionStore(nvars, wvals, &Wf[0]);
 
-    // px now contains the current estimate of the step in the design
-    // variables.
-    fproj[i] = evalObjBarrierDeriv();
+    for ( int i = 0; i < gmres_subspace_size; i++ ){
+      ParOptVec *wcur = W[i % 2];
+      ParOptVec *wnext = W[(i+1) % 2];
 
-    // Compute the directional derivative of the l2 constraint infeasibility
-    // along the direction px.
-    aproj[i] = 0.0;
-    if (dense_inequality){
-      for ( int j = 0; j < ncon; j++ ){
-        ParOptScalar cj_deriv = (Ac[j]->dot(px) - ps[j] + pt[j]);
-        aproj[i] -= cscale*rc[j]*cj_deriv;
-      }
-    }
-    else {
-      for ( int j = 0; j < ncon; j++ ){
-        aproj[i] -= cscale*rc[j]*Ac[j]->dot(px);
-      }
-    }
+      // Compute M^{-1}*[ W[i], alpha[i]*yc, ... ] using wnext as a
+      // temporary vector
+      applyKKTGMRESPrecon(wcur, alpha[i]/bnorm, ztmp, xtmp1, xtmp2, wnext,
+                          wtmp, use_qn);
+      evalKKTGMRESProjections(cscale, cwscale, xtmp1,
+                              &fproj[i], &aproj[i], &awproj[i]);
 
-    // Add the contributions from the sparse constraints (if any are defined)
-    awproj[i] = 0.0;
-    if (nwcon > 0){
-      // rcw = -(cw - sw)
-      xtmp1->zeroEntries();
-      prob->addSparseJacobianTranspose(1.0, x, rcw, xtmp1);
-      awproj[i] = -cwscale*px->dot(xtmp1);
+      // Compute wnext = K*M^{-1}*W[i]
+      applyKKTGMRESOperator(wcur, wnext, use_qn);
 
-      if (sparse_inequality){
-        awproj[i] += cwscale*rcw->dot(psw);
-      }
-    }
+      // Set the value of the scalar
+      alpha[i+1] = alpha[i];
 
-    // Compute the vector product with the exact Hessian
-    prob->evalHvecProduct(x, z, zw, px, W[i+1]);
-    nhvec++;
+      // Build the orthogonal factorization MGS against the stored basis
+      wnext->getArray(&wvals);
+      int hptr = (i+1)*(i+2)/2 - 1;
+      for ( int j = i; j >= 0; j-- ){
+        H[j + hptr] = ParOptLowPrecisionDot(comm, nvars, wvals,
+                                            &Wf[j*nvars],
+                                            gmres_Wf_partial) +
+          beta*alpha[i+1]*alpha[j];
 
-    // Add the term -B*W[i]
-    if (qn && use_qn){
-      qn->multAdd(-1.0, px, W[i+1]);
-    }
+        ParOptLowPrecisionAxpy(nvars, -H[j + hptr], &Wf[j*nvars], wvals);
+        alpha[i+1] -= H[j + hptr]*alpha[j];
+      }
 
-    // Add the term from the diagonal
-    W[i+1]->axpy(1.0, W[i]);
+      // Compute the norm of the combined vector
+      H[i+1 + hptr] = sqrt(wnext->dot(wnext) +
+                           beta*alpha[i+1]*alpha[i+1]);
 
-    // Set the value of the scalar
-    alpha[i+1] = alpha[i];
+      // Normalize the combined vector and store it
+      wnext->scale(1.0/H[i+1 + hptr]);
+      alpha[i+1] *= 1.0/H[i+1 + hptr];
+      ParOptLowPrecisionStore(nvars, wvals, &Wf[(i+1)*nvars]);
 
-    // Build the orthogonal factorization MGS
-    int hptr = (i+1)*(i+2)/2 - 1;
-    for ( int j = i; j >= 0; j-- ){
-      H[j + hptr] = W[i+1]->dot(W[j]) + beta*alpha[i+1]*alpha[j];
+      niters++;
 
-      W[i+1]->axpy(-H[j + hptr], W[j]);
-      alpha[i+1] -= H[j + hptr]*alpha[j];
+      // Update the QR factorization and check for convergence
+      if (updateKKTGMRESResidual(i, bnorm, cinfeas + cwinfeas,
+                                 rtol, atol)){
+        break;
+      }
     }
+  }
+  else {
+    for ( int i = 0; i < gmres_subspace_size; i++ ){
+      // Compute M^{-1}*[ W[i], alpha[i]*yc, ... ]. Note that this
+      // call uses W[i+1] as a temporary vector.
+      applyKKTGMRESPrecon(W[i], alpha[i]/bnorm, ztmp, xtmp1, xtmp2, W[i+1],
+                          wtmp, use_qn);
+
+      // px now contains the current estimate of the step in the
+      // design variables. Compute the directional derivatives.
+      evalKKTGMRESProjections(cscale, cwscale, xtmp1,
+                              &fproj[i], &aproj[i], &awproj[i]);
+
+      // Compute W[i+1] = K*M^{-1}*W[i]
+      applyKKTGMRESOperator(W[i], W[i+1], use_qn);
+
+      // Project out the recycled space. The solution is corrected by
+      // -U*B*y, so the projections are modified accordingly.
+      if (nrecycle > 0){
+        ParOptScalar *b = &gmres_B[nrecycle*i];
+        W[i+1]->mdot(gmres_C, nrecycle, b);
+        for ( int l = 0; l < nrecycle; l++ ){
+          W[i+1]->axpy(-b[l], gmres_C[l]);
+          fproj[i] -= b[l]*gmres_ufproj[l];
+          aproj[i] -= b[l]*gmres_ucproj[l];
+        }
+      }
 
-    // Compute the norm of the combined vector
-    H[i+1 + hptr] = sqrt(W[i+1]->dot(W[i+1]) +
-                         beta*alpha[i+1]*alpha[i+1]);
+      // Set the value of the scalar
+      alpha[i+1] = alpha[i];
 
-    // Normalize the combined vector
-    W[i+1]->scale(1.0/H[i+1 + hptr]);
-    alpha[i+1] *= 1.0/H[i+1 + hptr];
+      // Build the orthogonal factorization MGS
+      int hptr = (i+1)*(i+2)/2 - 1;
+      for ( int j = i; j >= 0; j-- ){
+        H[j + hptr] = W[i+1]->dot(W[j]) + beta*alpha[i+1]*alpha[j];
 
-    // Apply the existing part of Q to the new components of the
-    // Hessenberg matrix
-    for ( int k = 0; k < i; k++ ){
-      ParOptScalar h1 = H[k + hptr];
-      ParOptScalar h2 = H[k+1 + hptr];
-      H[k + hptr] = h1*Qcos[k] + h2*Qsin[k];
-      H[k+1 + hptr] = -h1*Qsin[k] + h2*Qcos[k];
-    }
+        W[i+1]->axpy(-H[j + hptr], W[j]);
+        alpha[i+1] -= H[j + hptr]*alpha[j];
+      }
 
-    // Now, compute the rotation for the new column that was just added
-    ParOptScalar h1 = H[i + hptr];
-    ParOptScalar h2 = H[i+1 + hptr];
-    ParOptScalar sq = sqrt(h1*h1 + h2*h2);
+      // Compute the norm of the combined vector
+      H[i+1 + hptr] = sqrt(W[i+1]->dot(W[i+1]) +
+                           beta*alpha[i+1]*alpha[i+1]);
 
-    Qcos[i] = h1/sq;
-    Qsin[i] = h2/sq;
-    H[i + hptr] = h1*Qcos[i] + h2*Qsin[i];
-    H[i+1 + hptr] = -h1*Qsin[i] + h2*Qcos[i];
+      // Normalize the combined vector
+      W[i+1]->scale(1.0/H[i+1 + hptr]);
+      alpha[i+1] *= 1.0/H[i+1 + hptr];
 
-    // Update the residual
-    h1 = res[i];
-    res[i] = h1*Qcos[i];
-    res[i+1] = -h1*Qsin[i];
+      // Save the column before it is rotated
+      if (recycle){
+        for ( int j = 0; j <= i+1; j++ ){
+          gmres_G[j + (gmres_subspace_size+1)*i] = H[j + hptr];
+        }
+      }
 
-    niters++;
+      niters++;
 
-    // Check the contribution to the projected derivative terms. First
-    // evaluate the weights y[] for each
-    for ( int j = niters-1; j >= 0; j-- ){
-      y[j] = res[j];
-      for ( int k = j+1; k < niters; k++ ){
-        int hptr = (k+1)*(k+2)/2 - 1;
-        y[j] = y[j] - H[j + hptr]*y[k];
+      // Update the QR factorization and check for convergence
+      if (updateKKTGMRESResidual(i, bnorm, cinfeas + cwinfeas,
+                                 rtol, atol)){
+        break;
       }
-
-      int hptr = (j+1)*(j+2)/2 - 1;
-      y[j] = y[j]/H[j + hptr];
     }
+  }
 
-    // Compute the projection of the solution px on to the gradient
-    // direction and the constraint Jacobian directions
-    ParOptScalar fpr = 0.0, cpr = 0.0;
-    for ( int j = 0; j < niters; j++ ){
-      fpr += y[j]*fproj[j];
-      cpr += y[j]*(aproj[j] + awproj[j]);
-    }
+  // Compute the recycled space for the next solve before the basis
+  // is overwritten
+  if (recycle){
+    updateKKTGMRESRecycle(niters);
+  }
 
-    if (rank == opt_root && output_level > 0){
-      fprintf(outfp, "      %4d %4d %7.1e %7.1e %8.1e %8.1e\n",
-              nhvec, i+1, fabs(ParOptRealPart(res[i+1])),
-              fabs(ParOptRealPart(res[i+1]/bnorm)),
-              ParOptRealPart(fpr), ParOptRealPart(cpr));
-      fflush(outfp);
+  if (bsize == 1){
+    // Now, compute the solution - the linear combination of the
+    // Arnoldi vectors. H is now an upper triangular matrix.
+    for ( int i = niters-1; i >= 0; i-- ){
+      for ( int j = i+1; j < niters; j++ ){
+        int hptr = (j+1)*(j+2)/2 - 1;
+        res[i] = res[i] - H[i + hptr]*res[j];
+      }
+
+      int hptr = (i+1)*(i+2)/2 - 1;
+      res[i] = res[i]/H[i + hptr];
     }
 
-    // Check first that the direction is a candidate descent direction
-    int constraint_descent = 0;
-    if (ParOptRealPart(cpr) <= -0.01*ParOptRealPart(cinfeas + cwinfeas)){
-      constraint_descent = 1;
+    // Compute the linear combination of the vectors
+    // that will be the output
+    gamma = res[0]*alpha[0];
+    if (gmres_mixed_precision){
+      ParOptScalar *wvals = NULL;
+      W[0]->getArray(&wvals);
+      W[0]->zeroEntries();
+      for ( int i = 0; i < niters; i++ ){
+        ParOptLowPrecisionAxpy(nvars, res[i], &gmres_Wf[i*nvars], wvals);
+      }
     }
-    if (ParOptRealPart(fpr) < 0.0 || constraint_descent){
-      // Check for convergence
-      if (fabs(ParOptRealPart(res[i+1])) < atol ||
-          fabs(ParOptRealPart(res[i+1])) < rtol*ParOptRealPart(bnorm)){
-        break;
+    else {
+      W[0]->scale(res[0]);
+      for ( int i = 1; i < niters; i++ ){
+        W[0]->axpy(res[i], W[i]);
       }
     }
-  }
+    for ( int i = 1; i < niters; i++ ){
+      gamma += res[i]*alpha[i];
+    }
 
-  // Now, compute the solution - the linear combination of the
-  // Arnoldi vectors. H is now an upper triangular matrix.
-  for ( int i = niters-1; i >= 0; i-- ){
-    for ( int j = i+1; j < niters; j++ ){
-      int hptr = (j+1)*(j+2)/2 - 1;
-      res[i] = res[i] - H[i + hptr]*res[j];
+    // Add the component from the recycled space U*(C^{T}*b - B*y)
+    for ( int l = 0; l < nrecycle; l++ ){
+      ParOptScalar coef = cb[l];
+      for ( int i = 0; i < niters; i++ ){
+        coef -= gmres_B[l + nrecycle*i]*res[i];
+      }
+      W[0]->axpy(coef, gmres_U[l]);
     }
 
-    int hptr = (i+1)*(i+2)/2 - 1;
-    res[i] = res[i]/H[i + hptr];
+    // Replace the recycled space with the new harmonic Ritz vectors
+    if (recycle && gmres_num_new_recycle > 0){
+      ParOptVec **tmp = gmres_U;
+      gmres_U = gmres_Unew;
+      gmres_Unew = tmp;
+      gmres_num_recycle = gmres_num_new_recycle;
+    }
   }
 
-  // Compute the linear combination of the vectors
-  // that will be the output
-  W[0]->scale(res[0]);
-  ParOptScalar gamma = res[0]*alpha[0];
-
-  for ( int i = 1; i < niters; i++ ){
-    W[0]->axpy(res[i], W[i]);
-    gamma += res[i]*alpha[i];
+  // Store the normalized solution to seed the next block solve
+  if (gmres_P){
+    ParOptScalar wnorm = W[0]->norm();
+    if (ParOptRealPart(wnorm) > 0.0){
+      ParOptVec *seed = gmres_seeds[gmres_seed_ptr];
+      seed->copyValues(W[0]);
+      seed->scale(1.0/wnorm);
+      gmres_seed_ptr = (gmres_seed_ptr + 1) % (gmres_block_size-1);
+      if (gmres_num_seeds < gmres_block_size-1){
+        gmres_num_seeds++;
+      }
+    }
   }
 
   // Normalize the gamma parameter
@@ -6519,15 +9231,16 @@ int ParOptInteriorPoint::computeKKTGMRESStep( ParOptScalar *ztmp,
   // Add the contributions from the objective and dense constraints
   ParOptScalar fpr = evalObjBarrierDeriv();
   ParOptScalar cpr = 0.0;
+  Acvec->mdot(px, ncon, ctemp);
   if (dense_inequality){
     for ( int i = 0; i < ncon; i++ ){
-      ParOptScalar deriv = (Ac[i]->dot(px) - ps[i] + pt[i]);
+      ParOptScalar deriv = (ctemp[i] - ps[i] + pt[i]);
       cpr += cscale*(c[i] - s[i] + t[i])*deriv;
     }
   }
   else {
     for ( int i = 0; i < ncon; i++ ){
-      cpr += cscale*c[i]*Ac[i]->dot(px);
+      cpr += cscale*c[i]*ctemp[i];
     }
   }
 
@@ -6608,7 +9321,7 @@ void ParOptInteriorPoint::checkKKTStep( int iteration, int is_newton ){
 
   // Check the first residual equation
   if (is_newton){
-    prob->evalHvecProduct(x, z, zw, px, rx);
+    evalHvecProduct(x, z, zw, px, rx);
   }
   else if (use_diag_hessian){
     prob->evalHessianDiag(x, z, zw, hdiag);
@@ -6631,8 +9344,9 @@ void ParOptInteriorPoint::checkKKTStep( int iteration, int is_newton ){
     }
   }
   for ( int i = 0; i < ncon; i++ ){
-    rx->axpy(-pz[i] - z[i], Ac[i]);
+    ctemp[i] = -pz[i] - z[i];
   }
+  Acvec->maxpy(ncon, ctemp, rx);
   if (use_lower){
     rx->axpy(-1.0, pzl);
     rx->axpy(-1.0, zl);
@@ -6673,7 +9387,7 @@ void ParOptInteriorPoint::checkKKTStep( int iteration, int is_newton ){
   // Find the maximum value of the residual equations
   // for the constraints
   max_val = 0.0;
-  px->mdot(Ac, ncon, rc);
+  Acvec->mdot(px, ncon, rc);
   for ( int i = 0; i < ncon; i++ ){
     ParOptScalar val = rc[i] + c[i];
     if (dense_inequality){
@@ -6741,7 +9455,7 @@ void ParOptInteriorPoint::checkKKTStep( int iteration, int is_newton ){
     }
   }
 
-  MPI_Allreduce(MPI_IN_PLACE, &max_val, 1, MPI_DOUBLE, MPI_MAX, comm);
+  ParOptAllreduce(MPI_IN_PLACE, &max_val, 1, MPI_DOUBLE, MPI_MAX, comm);
 
   if (rank == opt_root && use_lower){
     printf("max |Zl*px + (X - LB)*pzl + (Zl*(x - lb) - mu)|: %10.4e\n",
@@ -6764,7 +9478,7 @@ void ParOptInteriorPoint::checkKKTStep( int iteration, int is_newton ){
     }
   }
 
-  MPI_Allreduce(MPI_IN_PLACE, &max_val, 1, MPI_DOUBLE, MPI_MAX, comm);
+  ParOptAllreduce(MPI_IN_PLACE, &max_val, 1, MPI_DOUBLE, MPI_MAX, comm);
 
   if (rank == opt_root && use_upper){
     printf("max |-Zu*px + (UB - X)*pzu + (Zu*(ub - x) - mu)|: %10.4e\n",
@@ -5,6 +5,9 @@
 #include "ParOptVec.h"
 #include "ParOptQuasiNewton.h"
 #include "ParOptProblem.h"
+#include "ParOptProfiler.h"
+#include "ParOptActiveSet.h"
+#include "ParOptHistory.h"
 
 /*
   Different options for use within ParOpt
@@ -25,6 +28,9 @@ enum ParOptStartingPointStrategy { PAROPT_NO_START_STRATEGY,
                                    PAROPT_LEAST_SQUARES_MULTIPLIERS,
                                    PAROPT_AFFINE_STEP };
 
+enum ParOptGMRESType { PAROPT_MGS_GMRES,
+                       PAROPT_PIPELINED_GMRES };
+
 /*
   ParOpt is a parallel optimizer implemented in C++ for large-scale
   constrained optimization.
@@ -178,6 +184,7 @@ class ParOptInteriorPoint : public ParOptBase {
   void setNormType( ParOptNormType _norm_type );
   void setBarrierStrategy( ParOptBarrierStrategy strategy );
   void setStartingPointStrategy( ParOptStartingPointStrategy strategy );
+  void setUseWarmStart( int truth );
   void setInitStartingPoint( int init );
   void setMaxMajorIterations( int iters );
   void setAbsOptimalityTol( double tol );
@@ -206,6 +213,7 @@ class ParOptInteriorPoint : public ParOptBase {
   void setUseLineSearch( int truth );
   void setMaxLineSearchIters( int iters );
   void setBacktrackingLineSearch( int truth );
+  void setLineSearchBatchSize( int size );
   void setArmijoParam( double c1 );
   void setPenaltyDescentFraction( double frac );
   void setMinPenaltyParameter( double rho_min );
@@ -214,6 +222,12 @@ class ParOptInteriorPoint : public ParOptBase {
   // -----------------------------------------------
   void setUseDiagHessian( int truth );
 
+  // Set parameters for the reduced-space (active set) mode
+  // ------------------------------------------------------
+  void setUseActiveSet( int truth );
+  void setActiveSetTolerance( double tol );
+  void setActiveSetExpandFrequency( int freq );
+
   // Set parameters for the internal GMRES algorithm
   // -----------------------------------------------
   void setUseHvecProduct( int truth );
@@ -222,6 +236,10 @@ class ParOptInteriorPoint : public ParOptBase {
   void setEisenstatWalkerParameters( double gamma, double alpha );
   void setGMRESTolerances( double rtol, double atol );
   void setGMRESSubspaceSize( int _gmres_subspace_size );
+  void setGMRESType( ParOptGMRESType type );
+  void setGMRESMixedPrecision( int truth );
+  void setGMRESBlockSize( int size );
+  void setGMRESRecycleSize( int size );
 
   // Quasi-Newton options
   // --------------------
@@ -244,11 +262,26 @@ class ParOptInteriorPoint : public ParOptBase {
   void setOutputFile( const char *filename );
   void setOutputLevel( int level );
 
+  // Write the binary iteration and design history
+  // ---------------------------------------------
+  void setHistoryFile( const char *filename );
+  void setDesignHistoryFile( const char *filename, int freq );
+
+  // Get the profiler and print the profile to the output file
+  // ---------------------------------------------------------
+  ParOptProfiler *getProfiler(){ return profiler; }
+  void setProfileOutput( int truth );
+
   // Write out the design variables to a binary format (fast MPI/IO)
   // ---------------------------------------------------------------
   int writeSolutionFile( const char *filename );
   int readSolutionFile( const char *filename );
 
+  // Write the checkpoint file without blocking the optimization
+  // -----------------------------------------------------------
+  void setUseAsyncCheckpoint( int truth );
+  int completeCheckpoint();
+
   // Check the merit function derivative at the given point
   // ------------------------------------------------------
   void checkMeritFuncGradient( ParOptVec *xpt=NULL, double dh=1e-6 );
@@ -275,10 +308,32 @@ class ParOptInteriorPoint : public ParOptBase {
 
   // Check and initialize the design variables and their bounds
   void initAndCheckDesignAndBounds();
+  void initWarmStartPoint( ParOptVec *xprev );
+
+  // Compress the design vectors to the free variables, or expand them
+  int compressActiveSet();
+  void expandActiveSet();
+
+  // Evaluate the problem functions and record the time spent
+  int evalObjCon( ParOptVec *xt, ParOptScalar *fobj, ParOptScalar *cons );
+  int evalObjConBatch( int npts, ParOptVec **xt, ParOptScalar *fobj,
+                       ParOptScalar *cons, int *fail );
+  int evalObjConGradient( ParOptVec *xt, ParOptVec *gt, ParOptVec **At );
+  int evalHvecProduct( ParOptVec *xt, ParOptScalar *zt, ParOptVec *zwt,
+                       ParOptVec *px, ParOptVec *hvec );
+  int evalHvecProductBlock( ParOptVec *xt, ParOptScalar *zt,
+                            ParOptVec *zwt, int nvecs,
+                            ParOptVec **px, ParOptVec **hvec );
+
+  // Write the solution and quasi-Newton state to a file
+  int writeCheckpoint( const char *filename, int nonblocking );
+  int commitCheckpoint( const char *filename, int fail );
 
   // Factor/apply the Cw matrix
   int factorCw();
   int applyCwFactor( ParOptVec *vec );
+  int factorDmat();
+  int applyDmatFactor( ParOptScalar *vec );
 
   // Compute the negative of the KKT residuals - return
   // the maximum primal, dual residuals and the max infeasibility
@@ -294,6 +349,9 @@ class ParOptInteriorPoint : public ParOptBase {
   // Set up the diagonal KKT system
   void setUpKKTDiagSystem( ParOptVec *xt, ParOptVec *wt, int use_qn );
 
+  // Mark the KKT factorizations as out of date
+  void invalidateKKTFactorization();
+
   // Solve the diagonal KKT system
   void solveKKTDiagSystem( ParOptVec *bx, ParOptScalar *bt,
                            ParOptScalar *bc, ParOptVec *bcw,
@@ -352,6 +410,36 @@ class ParOptInteriorPoint : public ParOptBase {
                            ParOptVec *xtmp2, ParOptVec *wtmp,
                            double rtol, double atol, int use_qn );
 
+  // Free the GMRES subspace data
+  void deleteGMRESSubspace();
+
+  // Functions used within the GMRES iteration
+  void applyKKTGMRESPrecon( ParOptVec *w, ParOptScalar walpha,
+                            ParOptScalar *ztmp, ParOptVec *xtmp1,
+                            ParOptVec *xtmp2, ParOptVec *xtmp3,
+                            ParOptVec *wtmp, int use_qn );
+  void evalKKTGMRESProjections( ParOptScalar cscale, ParOptScalar cwscale,
+                                ParOptVec *xtmp, ParOptScalar *fproj,
+                                ParOptScalar *aproj, ParOptScalar *awproj );
+  void applyKKTGMRESOperator( ParOptVec *w, ParOptVec *y, int use_qn );
+  int updateKKTGMRESResidual( int i, ParOptScalar bnorm,
+                              ParOptScalar infeas,
+                              double rtol, double atol );
+  int computeKKTBlockGMRESIters( int bsize, ParOptScalar beta,
+                                 ParOptScalar bnorm, ParOptScalar cscale,
+                                 ParOptScalar cwscale, ParOptScalar infeas,
+                                 ParOptScalar *ztmp, ParOptVec *xtmp1,
+                                 ParOptVec *xtmp2, ParOptVec *wtmp,
+                                 double rtol, double atol, int use_qn,
+                                 ParOptScalar *gamma );
+  int updateKKTBlockGMRESResidual( int i, int bsize, ParOptScalar bnorm,
+                                   ParOptScalar infeas,
+                                   double rtol, double atol );
+  int initKKTGMRESRecycle( ParOptScalar cscale, ParOptScalar cwscale,
+                           ParOptScalar *ztmp, ParOptVec *xtmp1,
+                           ParOptVec *xtmp2, ParOptVec *wtmp, int use_qn );
+  void updateKKTGMRESRecycle( int niters );
+
   // Check that the KKT step is computed correctly
   void checkKKTStep( int iteration, int is_newton );
 
@@ -369,11 +457,23 @@ class ParOptInteriorPoint : public ParOptBase {
                     ParOptScalar alpha, const ParOptScalar *pvals,
                     const ParOptScalar *lbvals, const ParOptScalar *lower_value,
                     const ParOptScalar *ubvals, const ParOptScalar *upper_value );
+  void computeStepVec( ParOptVec *xvec, ParOptVec *x0vec,
+                       ParOptScalar alpha, ParOptVec *pvec,
+                       ParOptVec *lower, ParOptScalar *lower_value,
+                       ParOptVec *upper, ParOptScalar *upper_value );
+  void computeStep( int nvals, ParOptScalar *xvals, const ParOptScalar *x0vals,
+                    ParOptScalar alpha, const ParOptScalar *pvals,
+                    const ParOptScalar *lbvals, const ParOptScalar *lower_value,
+                    const ParOptScalar *ubvals, const ParOptScalar *upper_value );
 
   // Perform the line search
   int lineSearch( double alpha_min, double *_alpha,
                   ParOptScalar m0, ParOptScalar dm0 );
 
+  // Perform the line search evaluating several step lengths at once
+  int lineSearchBatch( double alpha_min, double *_alpha,
+                       ParOptScalar m0, ParOptScalar dm0 );
+
   // Scale the step by the distance-to-the-boundary rule
   int scaleKKTStep( double tau, ParOptScalar comp, int inexact_newton_step,
                     double *_alpha_x, double *_alpha_z );
@@ -418,6 +518,9 @@ class ParOptInteriorPoint : public ParOptBase {
   // The type of starting point initialization strategy to use
   ParOptStartingPointStrategy starting_point_strategy;
 
+  // Start from the primal-dual point of the previous optimization
+  int use_warm_start, warm_start_ready;
+
   // The type of barrier strategy to use
   ParOptBarrierStrategy barrier_strategy;
 
@@ -460,6 +563,8 @@ class ParOptInteriorPoint : public ParOptBase {
   // The objective, gradient, constraints, and constraint gradients
   ParOptScalar fobj, *c;
   ParOptVec *g, **Ac;
+  ParOptMultiVec *Acvec; // Storage for the constraint gradients
+  ParOptScalar *ctemp; // Temporary array of size ncon
 
   // The data for the block-diagonal matrix
   ParOptScalar *Cw;
@@ -467,8 +572,21 @@ class ParOptInteriorPoint : public ParOptBase {
   // Data required for solving the KKT system
   ParOptVec *Cvec;
   ParOptVec **Ew;
+  ParOptMultiVec *Ewvec; // Storage for the Ew vectors
   ParOptScalar *Dmat, *Ce;
   int *dpiv, *cpiv;
+  int dwork_size;
+  ParOptScalar *dwork; // Work array for the assembly and factorization
+  ParOptScalar *dwblock; // Block of the products Cw^{-1}*Ew (may be NULL)
+  int dmat_cholesky; // Flag indicating the factorization of Dmat
+
+  // Flags and data used to decide whether the factorization of the
+  // diagonal KKT system (Cvec, Cw, Ew and Dmat) and the quasi-Newton
+  // Schur complement Ce can be reused
+  int kkt_diag_valid, kkt_system_valid;
+  int kkt_diag_use_hdiag, kkt_system_use_qn;
+  ParOptScalar kkt_diag_b0;
+  double kkt_diag_sigma;
 
   // Storage for the Quasi-Newton updates
   ParOptCompactQuasiNewton *qn;
@@ -522,6 +640,15 @@ class ParOptInteriorPoint : public ParOptBase {
   double min_rho_penalty_search;
   double penalty_descent_fraction, armijo_constant;
 
+  // Data for the speculative line search: the trial points, their
+  // step lengths, function values and fail flags
+  int line_search_batch_size;
+  ParOptVec **line_search_x;
+  double *line_search_alpha;
+  ParOptScalar *line_search_fobj, *line_search_con;
+  ParOptScalar *line_search_best_con;
+  int *line_search_fail;
+
   // Function precision and design variable precision
   double function_precision;
   double design_precision;
@@ -536,6 +663,21 @@ class ParOptInteriorPoint : public ParOptBase {
   int use_diag_hessian;
   ParOptVec *hdiag;
 
+  // Data for the reduced-space mode. When the design vectors are
+  // compressed, nvars is the local number of free variables and the
+  // values of the fixed variables are stored in active_set_xfixed.
+  // The fixed entries of the quasi-Newton vectors are set from the
+  // zero-filled array active_set_zeros.
+  int use_active_set;
+  double active_set_tol;
+  int active_set_expand_freq;
+  int nvars_full;
+  int active_set_compressed;
+  ParOptActiveSet *active_set;
+  int *active_set_flags;
+  ParOptScalar *active_set_xfixed;
+  ParOptScalar *active_set_zeros;
+
   // Set the minimum value of the multipliers/slacks in the affine
   // step starting point initialization procedure
   double start_affine_multiplier_min;
@@ -551,7 +693,24 @@ class ParOptInteriorPoint : public ParOptBase {
   int gmres_subspace_size;
   ParOptScalar *gmres_H, *gmres_alpha, *gmres_res, *gmres_Q;
   ParOptScalar *gmres_y, *gmres_fproj, *gmres_aproj, *gmres_awproj;
+  int gmres_num_W;
   ParOptVec **gmres_W;
+  ParOptGMRESType gmres_type;
+  ParOptVec **gmres_AW; // Products with the basis for pipelined GMRES
+  int gmres_mixed_precision;
+  ParOptLowScalar *gmres_Wf; // Single precision basis for mixed precision
+  ParOptScalar *gmres_Wf_partial; // Block partial sums for the basis products
+  int gmres_block_size;
+  int gmres_num_seeds, gmres_seed_ptr;
+  ParOptVec **gmres_P; // Preconditioned directions for block GMRES
+  ParOptVec **gmres_seeds; // Previous solutions used to seed block GMRES
+  int gmres_recycle_size, gmres_num_recycle, gmres_num_new_recycle;
+  ParOptVec **gmres_U, **gmres_C; // Recycled space U and C = K*M^{-1}*U
+  ParOptVec **gmres_Unew; // The recycled space for the next solve
+  ParOptScalar *gmres_B; // Projections C^{T}*K*M^{-1}*W
+  ParOptScalar *gmres_G; // Copy of the Hessenberg matrix before rotation
+  ParOptScalar *gmres_ufproj, *gmres_ucproj; // Projections for U
+  ParOptScalar gmres_fproj0, gmres_cproj0; // Projections of the U component
 
   // Check the step at this major iteration - for debugging
   int major_iter_step_check;
@@ -566,6 +725,26 @@ class ParOptInteriorPoint : public ParOptBase {
   // The file pointer to use for printing things out
   FILE *outfp;
   int output_level;
+
+  // The binary iteration and design history (may be NULL)
+  ParOptHistory *history;
+
+  // The timers and counters for each phase of the optimization
+  ParOptProfiler *profiler;
+  int profile_output;
+
+  // Data for the non-blocking checkpoint writes. The solution is
+  // copied into one of two staging buffers so that the next snapshot
+  // can be taken while the previous write is still in progress.
+  int use_async_checkpoint;
+  int checkpoint_pending;
+  char *checkpoint_fname; // The file replaced once the write completes
+  MPI_File checkpoint_fp;
+  MPI_Request checkpoint_request;
+  MPI_Datatype checkpoint_filetype;
+  ParOptScalar *checkpoint_buffer[2];
+  int checkpoint_buffer_size[2];
+  int checkpoint_buffer_index;
 };
 
 #endif // PAR_OPT_INTERIOR_POINT_H
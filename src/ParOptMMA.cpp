@@ -3,6 +3,11 @@
 #include "ParOptBlasLapack.h"
 #include "ParOptMMA.h"
 
+// The fields in the binary history file
+static const int MMA_HISTORY_NUM_FIELDS = 7;
+static const char *mma_history_fields[] =
+  {"MMA", "sub-iter", "fobj", "l1-opt", "linft-opt", "l1-lambd", "infeas"};
+
 // Helper functions
 inline ParOptScalar min2( ParOptScalar a, ParOptScalar b ){
   if (ParOptRealPart(a) < ParOptRealPart(b)){
@@ -22,6 +27,13 @@ inline ParOptScalar max2( ParOptScalar a, ParOptScalar b ){
   }
 }
 
+/*
+  The number of design variables in each block of the fused
+  coefficient and gradient kernels. The temporaries for a block are
+  stored on the stack.
+*/
+static const int PAROPT_MMA_BLOCK_SIZE = 128;
+
 /*
   Create the ParOptMMA object
 */
@@ -45,11 +57,18 @@ ParOptProblem(_prob->getMPIComm()){
   bound_relax = 0.0;
   eps_regularization = 1e-3;
   delta_regularization = 1e-5;
+  penalty_gamma = 1e3;
+  max_dual_iters = 100;
+  dual_tol = 1e-8;
+  use_active_set = 0;
+  active_set_tol = 1e-3;
+  active_set_expand_freq = 10;
 
   // Set the file pointer to NULL
   first_print = 1;
   fp = NULL;
   print_level = 1;
+  history = NULL;
 
   // Set the default to stdout
   int rank;
@@ -67,6 +86,13 @@ ParOptProblem(_prob->getMPIComm()){
   mma_iter = 0;
   subproblem_iter = 0;
 
+  // Create the profiler. The total time is measured from the creation
+  // of the MMA object since the iterations are driven externally.
+  profiler = new ParOptProfiler();
+  profiler->incref();
+  profiler->start(PAROPT_PROFILE_TOTAL);
+  profile_output = 0;
+
   // Initialize the data
   initialize();
 }
@@ -78,7 +104,11 @@ ParOptMMA::~ParOptMMA(){
   if (fp && fp != stdout){
     fclose(fp);
   }
+  if (history){
+    history->decref();
+  }
   prob->decref();
+  profiler->decref();
 
   xvec->decref();
   x1vec->decref();
@@ -92,22 +122,28 @@ ParOptMMA::~ParOptMMA(){
     Avecs[i]->decref();
   }
   delete [] Avecs;
+  delete [] Aptr;
+  delete [] Acptr;
 
   Lvec->decref();
   Uvec->decref();
   alphavec->decref();
   betavec->decref();
-  p0vec->decref();
-  q0vec->decref();
+  delete [] pq;
+  delete [] fvals;
 
   if (use_true_mma){
-    for ( int i = 0; i < m; i++ ){
-      pivecs[i]->decref();
-      qivecs[i]->decref();
-    }
-    delete [] qivecs;
-    delete [] pivecs;
     delete [] b;
+    delete [] dual_vals;
+    delete [] dual_mat;
+    delete [] dual_grad;
+    delete [] dual_step;
+    delete [] dual_trial;
+    delete [] dual_dg;
+    delete [] dual_free;
+    delete [] dual_fixed;
+    delete [] active_set_flags;
+    active_set->decref();
   }
   else {
     if (cwvec){
@@ -143,8 +179,11 @@ void ParOptMMA::initialize(){
   // Allocate space for the problem gradients
   gvec = prob->createDesignVec();  gvec->incref();
   Avecs = new ParOptVec*[ m ];
+  Aptr = new ParOptScalar*[ m ];
+  Acptr = new ParOptScalar*[ m ];
   for ( int i = 0; i < m; i++ ){
     Avecs[i] = prob->createDesignVec();  Avecs[i]->incref();
+    Avecs[i]->getArray(&Aptr[i]);
   }
 
   // Create the move limit/asymptote vectors
@@ -155,28 +194,50 @@ void ParOptMMA::initialize(){
   alphavec->set(0.0);
   betavec->set(1.0);
 
-  // Create the coefficient vectors
-  p0vec = prob->createDesignVec();  p0vec->incref();
-  q0vec = prob->createDesignVec();  q0vec->incref();
+  // Create the interleaved coefficients for the objective and, for
+  // the true MMA approximation, the constraints
+  ncoef = 1;
+  if (use_true_mma){
+    ncoef = m+1;
+  }
+  pq = new ParOptScalar[ 2*ncoef*n ];
+  memset(pq, 0, 2*ncoef*n*sizeof(ParOptScalar));
+  fvals = new ParOptScalar[ m+1 ];
 
   // Set the sparse constraint vector to NULL
   cwvec = NULL;
 
   if (use_true_mma){
-    pivecs = new ParOptVec*[ m ];
-    qivecs = new ParOptVec*[ m ];
-    for ( int i = 0; i < m; i++ ){
-      pivecs[i] = prob->createDesignVec();  pivecs[i]->incref();
-      qivecs[i] = prob->createDesignVec();  qivecs[i]->incref();
-    }
-
     b = new ParOptScalar[ m ];
     memset(b, 0, m*sizeof(ParOptScalar));
+
+    // Allocate the data for the dual solver. The dual Hessian is
+    // stored in packed upper-triangular format after the dual
+    // function value and its gradient.
+    int nh = m*(m+1)/2;
+    dual_vals = new ParOptScalar[ 1 + m + nh ];
+    dual_mat = new ParOptScalar[ nh ];
+    dual_grad = new ParOptScalar[ m ];
+    dual_step = new ParOptScalar[ m ];
+    dual_trial = new ParOptScalar[ m ];
+    dual_dg = new ParOptScalar[ m ];
+    dual_free = new int[ m ];
+
+    // Allocate the index map and the contributions from the
+    // variables that are fixed in the reduced-space mode
+    active_set = new ParOptActiveSet(comm, n);
+    active_set->incref();
+    active_set_flags = new int[ n ];
+    dual_fixed = new ParOptScalar[ 1 + m ];
   }
   else {
-    pivecs = NULL;
-    qivecs = NULL;
     b = NULL;
+    dual_vals = dual_mat = NULL;
+    dual_grad = dual_step = dual_trial = dual_dg = NULL;
+    dual_free = NULL;
+    active_set = NULL;
+    active_set_flags = NULL;
+    dual_fixed = NULL;
   }
 
   if (nwcon > 0){
@@ -279,6 +340,65 @@ void ParOptMMA::setRegularization( double eps, double delta ){
   delta_regularization = delta;
 }
 
+/*
+  Set the upper bound on the multipliers in the dual solver. This is
+  equivalent to an l1 penalty on the violation of the approximate
+  constraints so that the dual problem remains bounded when the
+  subproblem is infeasible.
+*/
+void ParOptMMA::setPenaltyGamma( double val ){
+  if (val > 0.0){
+    penalty_gamma = val;
+  }
+}
+
+/*
+  Set the maximum number of iterations in the dual solver
+*/
+void ParOptMMA::setMaxDualIterations( int val ){
+  if (val >= 1){
+    max_dual_iters = val;
+  }
+}
+
+/*
+  Set the convergence tolerance for the projected dual gradient
+*/
+void ParOptMMA::setDualTolerance( double val ){
+  if (val > 0.0){
+    dual_tol = val;
+  }
+}
+
+/*
+  Set the flag to use the reduced-space mode in the dual solver. In
+  this mode, the variables that are firmly held at their bounds are
+  fixed for the subproblem, and each evaluation of the dual only
+  loops over the remaining free variables.
+*/
+void ParOptMMA::setUseActiveSet( int truth ){
+  use_active_set = truth;
+}
+
+/*
+  Set the relative tolerance on the derivative of the subproblem
+  Lagrangian used to detect the variables that are firmly active
+*/
+void ParOptMMA::setActiveSetTolerance( double val ){
+  if (val > 0.0){
+    active_set_tol = val;
+  }
+}
+
+/*
+  Set the MMA iteration frequency at which all variables are freed
+*/
+void ParOptMMA::setActiveSetExpandFrequency( int val ){
+  if (val >= 1){
+    active_set_expand_freq = val;
+  }
+}
+
 /*
   Set the output file (only on the root proc)
 */
@@ -293,6 +413,52 @@ void ParOptMMA::setOutputFile( const char *filename ){
   }
 }
 
+/*
+  Create the history object with the MMA record schema
+*/
+ParOptHistory* ParOptMMA::createHistory(){
+  if (!history){
+    history = new ParOptHistory(comm, MMA_HISTORY_NUM_FIELDS,
+                                mma_history_fields);
+    history->incref();
+  }
+  return history;
+}
+
+/*
+  Write the binary iteration history (only on the root proc). The
+  records contain the same fields as the output file and are written
+  regardless of the print level.
+*/
+void ParOptMMA::setHistoryFile( const char *filename ){
+  if (createHistory()->openHistoryFile(filename)){
+    fprintf(stderr, "ParOptMMA: History file %s creation failed\n",
+            filename);
+  }
+}
+
+/*
+  Write a snapshot of the design variables every freq MMA iterations
+*/
+void ParOptMMA::setDesignHistoryFile( const char *filename, int freq ){
+  if (createHistory()->openDesignHistoryFile(filename, n, freq)){
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    if (rank == 0){
+      fprintf(stderr, "ParOptMMA: Design history file %s "
+              "creation failed\n", filename);
+    }
+  }
+}
+
+/*
+  Print the time spent in each phase after each MMA iteration. The
+  summary can be printed through the profiler object.
+*/
+void ParOptMMA::setProfileOutput( int truth ){
+  profile_output = truth;
+}
+
 /*
   Write the parameters to the output file
 */
@@ -311,6 +477,14 @@ void ParOptMMA::printOptionsSummary( FILE *fp ){
     fprintf(fp, "%-30s %15g\n", "bound_relax", bound_relax);
     fprintf(fp, "%-30s %15g\n", "eps_regularization", eps_regularization);
     fprintf(fp, "%-30s %15g\n", "delta_regularization", delta_regularization);
+    fprintf(fp, "%-30s %15g\n", "penalty_gamma", penalty_gamma);
+    fprintf(fp, "%-30s %15d\n", "max_dual_iters", max_dual_iters);
+    fprintf(fp, "%-30s %15g\n", "dual_tol", dual_tol);
+    fprintf(fp, "%-30s %15d\n", "use_active_set", use_active_set);
+    fprintf(fp, "%-30s %15g\n", "active_set_tol", active_set_tol);
+    fprintf(fp, "%-30s %15d\n", "active_set_expand_freq",
+            active_set_expand_freq);
+    fprintf(fp, "%-30s %15d\n", "profile_output", profile_output);
     fprintf(fp, "\n");
   }
 }
@@ -422,8 +596,8 @@ void ParOptMMA::computeKKTError( double *l1,
   }
 
   // All-reduce the norms across all processors
-  MPI_Allreduce(&l1_norm, l1, 1, MPI_DOUBLE, MPI_SUM, comm);
-  MPI_Allreduce(&infty_norm, linfty, 1, MPI_DOUBLE, MPI_MAX, comm);
+  ParOptAllreduce(&l1_norm, l1, 1, MPI_DOUBLE, MPI_SUM, comm);
+  ParOptAllreduce(&infty_norm, linfty, 1, MPI_DOUBLE, MPI_MAX, comm);
 }
 
 /*
@@ -473,14 +647,18 @@ int ParOptMMA::initializeSubProblem( ParOptVec *xv ){
   }
 
   // Evaluate the objective/constraint gradients
+  profiler->start(PAROPT_PROFILE_EVAL_OBJ_CON);
   int fail_obj = prob->evalObjCon(xvec, &fobj, cons);
+  profiler->stop(PAROPT_PROFILE_EVAL_OBJ_CON);
   if (fail_obj){
     fprintf(stderr,
       "ParOptMMA: Objective evaluation failed\n");
     return fail_obj;
   }
 
+  profiler->start(PAROPT_PROFILE_EVAL_GRADIENT);
   int fail_grad = prob->evalObjConGradient(xvec, gvec, Avecs);
+  profiler->stop(PAROPT_PROFILE_EVAL_GRADIENT);
   if (fail_grad){
     fprintf(stderr,
       "ParOptMMA: Gradient evaluation failed\n");
@@ -492,17 +670,26 @@ int ParOptMMA::initializeSubProblem( ParOptVec *xv ){
     prob->evalSparseCon(xvec, cwvec);
   }
 
-  // Compute the KKT error, and print it out to a file
-  if (print_level > 0){
+  // Compute the KKT error, and print it out to a file. The history
+  // flag is the same on all procs since the KKT error is collective.
+  int write_history = (history != NULL);
+  if (print_level > 0 || write_history){
     double l1, linfty, infeas;
     computeKKTError(&l1, &linfty, &infeas);
 
-    if (fp){
-      double l1_lambda = 0.0;
-      for ( int i = 0; i < m; i++ ){
-        l1_lambda += fabs(ParOptRealPart(z[i]));
-      }
+    double l1_lambda = 0.0;
+    for ( int i = 0; i < m; i++ ){
+      l1_lambda += fabs(ParOptRealPart(z[i]));
+    }
 
+    if (write_history && history->isOpen()){
+      double values[MMA_HISTORY_NUM_FIELDS] = {
+        1.0*mma_iter, 1.0*subproblem_iter, ParOptRealPart(fobj),
+        l1, linfty, l1_lambda, infeas};
+      history->writeRecord(values);
+    }
+
+    if (fp && print_level > 0){
       if (first_print){
         printOptionsSummary(fp);
       }
@@ -514,6 +701,9 @@ int ParOptMMA::initializeSubProblem( ParOptVec *xv ){
       fprintf(fp, "%5d %8d %15.6e %9.3e %9.3e %9.3e %9.3e\n",
               mma_iter, subproblem_iter, ParOptRealPart(fobj), l1,
               linfty, l1_lambda, infeas);
+      if (profile_output){
+        profiler->printIteration(fp);
+      }
       fflush(fp);
 
       // Set the first print flag to false
@@ -521,6 +711,17 @@ int ParOptMMA::initializeSubProblem( ParOptVec *xv ){
     }
   }
 
+  // Write the design history snapshot
+  if (history && history->isDesignDue(mma_iter)){
+    if (history->writeDesign(mma_iter, xvec)){
+      fprintf(stderr, "ParOptMMA: Design history write failed\n");
+    }
+  }
+
+  // The remainder of the subproblem set up is recorded with the
+  // evaluation of the approximate functions
+  profiler->start(PAROPT_PROFILE_SUBPROBLEM);
+
   // Get the current values of the design variables
   ParOptScalar *x, *x1, *x2;
   xvec->getArray(&x);
@@ -537,69 +738,10 @@ int ParOptMMA::initializeSubProblem( ParOptVec *xv ){
   lbvec->getArray(&lb);
   ubvec->getArray(&ub);
 
-  // Set all of the asymptote values
-  if (mma_iter < 2){
-    for ( int j = 0; j < n; j++ ){
-      L[j] = x[j] - init_asymptote_offset*(ub[j] - lb[j]);
-      U[j] = x[j] + init_asymptote_offset*(ub[j] - lb[j]);
-    }
-  }
-  else {
-    for ( int j = 0; j < n; j++ ){
-      // Compute the product of the difference of the two previous
-      // updates to determine how to update the move limits. If the
-      // signs are different, then indc < 0.0 and we contract the
-      // asymptotes, otherwise we expand the asymptotes.
-      ParOptScalar indc = (x[j] - x1[j])*(x1[j] - x2[j]);
-
-      // Store the previous values of the asymptotes
-      ParOptScalar Lprev = L[j];
-      ParOptScalar Uprev = U[j];
-
-      // Compute the interval length
-      ParOptScalar intrvl = max2(ub[j] - lb[j], 0.01);
-      intrvl = min2(intrvl, 100.0);
-
-      if (ParOptRealPart(indc) < 0.0){
-        // oscillation -> contract the asymptotes
-        L[j] = x[j] - asymptote_contract*(x1[j] - Lprev);
-        U[j] = x[j] + asymptote_contract*(Uprev - x1[j]);
-      }
-      else {
-        // Relax the asymptotes
-        L[j] = x[j] - asymptote_relax*(x1[j] - Lprev);
-        U[j] = x[j] + asymptote_relax*(Uprev - x1[j]);
-      }
-
-      // Ensure that the asymptotes do not converge entirely on the
-      // design variable value
-      L[j] = min2(L[j], x[j] - min_asymptote_offset*intrvl);
-      U[j] = max2(U[j], x[j] + min_asymptote_offset*intrvl);
-
-      // Enforce a maximum offset so that the asymptotes do not
-      // move too far away from the design variables
-      L[j] = max2(L[j], x[j] - max_asymptote_offset*intrvl);
-      U[j] = min2(U[j], x[j] + max_asymptote_offset*intrvl);
-    }
-  }
-
   // Get the objective gradient array
   ParOptScalar *g;
   gvec->getArray(&g);
 
-  // Allocate a temp array to store the pointers
-  // to the constraint vector
-  ParOptScalar **A = new ParOptScalar*[ m ];
-  for ( int i = 0; i < m; i++ ){
-    Avecs[i]->getArray(&A[i]);
-  }
-
-  // Get the coefficients for the objective/constraint approximation
-  // information
-  ParOptScalar *p0, *q0;
-  p0vec->getArray(&p0);
-  q0vec->getArray(&q0);
-
   // Get the move limit vectors
   ParOptScalar *alpha, *beta;
   alphavec->getArray(&alpha);
@@ -610,73 +752,134 @@ int ParOptMMA::initializeSubProblem( ParOptVec *xv ){
   const double eps = eps_regularization;
   const double eta = delta_regularization;
 
-  // Compute the values of the lower/upper assymptotes
-  for ( int j = 0; j < n; j++ ){
-    // Compute the move limits to avoid division by zero
-    alpha[j] = max2(max2(lb[j], 0.9*L[j] + 0.1*x[j]),
-                    x[j] - 0.5*(ub[j] - lb[j]));
-    beta[j] = min2(min2(ub[j], 0.9*U[j] + 0.1*x[j]),
-                   x[j] + 0.5*(ub[j] - lb[j]));
-
-    // Compute the coefficients for the objective
-    ParOptScalar gpos = max2(0.0, g[j]);
-    ParOptScalar gneg = max2(0.0, -g[j]);
-    p0[j] = (U[j] - x[j])*(U[j] - x[j])*((1.0 + eta)*gpos +
-                                         eta*gneg + eps/(ub[j] - lb[j]));
-    q0[j] = (x[j] - L[j])*(x[j] - L[j])*((1.0 + eta)*gneg +
-                                         eta*gpos + eps/(ub[j] - lb[j]));
-  }
+  // The offsets of the asymptotes for each variable and the
+  // regularization term within the current block
+  ParOptScalar Ud[PAROPT_MMA_BLOCK_SIZE], Ld[PAROPT_MMA_BLOCK_SIZE];
+  ParOptScalar ew[PAROPT_MMA_BLOCK_SIZE];
 
   if (use_true_mma){
     memset(b, 0, m*sizeof(ParOptScalar));
-    for ( int i = 0; i < m; i++ ){
-      ParOptScalar *pi, *qi;
-      pivecs[i]->getArray(&pi);
-      qivecs[i]->getArray(&qi);
+  }
 
-      // Compute the coefficients for the constraints.  Here we form a
+  // Form the asymptotes, move limits and all of the coefficients in a
+  // single pass over the design variables, one block at a time
+  const int nc = 2*ncoef;
+  for ( int jb = 0; jb < n; jb += PAROPT_MMA_BLOCK_SIZE ){
+    int je = jb + PAROPT_MMA_BLOCK_SIZE;
+    if (je > n){
+      je = n;
+    }
+
+    for ( int j = jb; j < je; j++ ){
+      if (mma_iter < 2){
+        L[j] = x[j] - init_asymptote_offset*(ub[j] - lb[j]);
+        U[j] = x[j] + init_asymptote_offset*(ub[j] - lb[j]);
+      }
+      else {
+        // Compute the product of the difference of the two previous
+        // updates to determine how to update the move limits. If the
+        // signs are different, then indc < 0.0 and we contract the
+        // asymptotes, otherwise we expand the asymptotes.
+        ParOptScalar indc = (x[j] - x1[j])*(x1[j] - x2[j]);
+
+        // Store the previous values of the asymptotes
+        ParOptScalar Lprev = L[j];
+        ParOptScalar Uprev = U[j];
+
+        // Compute the interval length
+        ParOptScalar intrvl = max2(ub[j] - lb[j], 0.01);
+        intrvl = min2(intrvl, 100.0);
+
+        if (ParOptRealPart(indc) < 0.0){
+          // oscillation -> contract the asymptotes
+          L[j] = x[j] - asymptote_contract*(x1[j] - Lprev);
+          U[j] = x[j] + asymptote_contract*(Uprev - x1[j]);
+        }
+        else {
+          // Relax the asymptotes
+          L[j] = x[j] - asymptote_relax*(x1[j] - Lprev);
+          U[j] = x[j] + asymptote_relax*(Uprev - x1[j]);
+        }
+
+        // Ensure that the asymptotes do not converge entirely on the
+        // design variable value
+        L[j] = min2(L[j], x[j] - min_asymptote_offset*intrvl);
+        U[j] = max2(U[j], x[j] + min_asymptote_offset*intrvl);
+
+        // Enforce a maximum offset so that the asymptotes do not
+        // move too far away from the design variables
+        L[j] = max2(L[j], x[j] - max_asymptote_offset*intrvl);
+        U[j] = min2(U[j], x[j] + max_asymptote_offset*intrvl);
+      }
+
+      // Compute the move limits to avoid division by zero
+      alpha[j] = max2(max2(lb[j], 0.9*L[j] + 0.1*x[j]),
+                      x[j] - 0.5*(ub[j] - lb[j]));
+      beta[j] = min2(min2(ub[j], 0.9*U[j] + 0.1*x[j]),
+                     x[j] + 0.5*(ub[j] - lb[j]));
+
+      // Check that the asymptotes, limits and variables are well-defined
+      if (!(ParOptRealPart(L[j]) < ParOptRealPart(alpha[j]))){
+        fprintf(stderr, "ParOptMMA: Inconsistent lower asymptote\n");
+      }
+      if (!(ParOptRealPart(alpha[j]) <= ParOptRealPart(x[j]))){
+        fprintf(stderr, "ParOptMMA: Inconsistent lower limit\n");
+      }
+      if (!(ParOptRealPart(x[j]) <= ParOptRealPart(beta[j]))){
+        fprintf(stderr, "ParOptMMA: Inconsistent upper limit\n");
+      }
+      if (!(ParOptRealPart(beta[j]) < ParOptRealPart(U[j]))){
+        fprintf(stderr, "ParOptMMA: Inconsistent upper assymptote\n");
+      }
+
+      // Compute the coefficients for the objective
+      const int k = j - jb;
+      Ud[k] = U[j] - x[j];
+      Ld[k] = x[j] - L[j];
+      ew[k] = eps/(ub[j] - lb[j]);
+
+      ParOptScalar gpos = max2(0.0, g[j]);
+      ParOptScalar gneg = max2(0.0, -g[j]);
+      pq[nc*j] = Ud[k]*Ud[k]*((1.0 + eta)*gpos + eta*gneg + ew[k]);
+      pq[nc*j+1] = Ld[k]*Ld[k]*((1.0 + eta)*gneg + eta*gpos + ew[k]);
+    }
+
+    if (use_true_mma){
+      // Compute the coefficients for the constraints. Here we form a
       // convex approximation for -c(x) since the constraints are
       // formulated as c(x) >= 0.
-      for ( int j = 0; j < n; j++ ){
-        ParOptScalar gpos = max2(0.0, -A[i][j]);
-        ParOptScalar gneg = max2(0.0, A[i][j]);
-        pi[j] = (U[j] - x[j])*(U[j] - x[j])*((1.0 + eta)*gpos +
-                                             eta*gneg + eps/(ub[j] - lb[j]));
-        qi[j] = (x[j] - L[j])*(x[j] - L[j])*((1.0 + eta)*gneg +
-                                             eta*gpos + eps/(ub[j] - lb[j]));
-        b[i] += pi[j]/(U[j] - x[j]) + qi[j]/(x[j] - L[j]);
+      for ( int i = 0; i < m; i++ ){
+        const ParOptScalar *A = Aptr[i];
+        ParOptScalar *c = &pq[2*(i+1)];
+        ParOptScalar bi = 0.0;
+        for ( int j = jb; j < je; j++ ){
+          const int k = j - jb;
+          ParOptScalar gpos = max2(0.0, -A[j]);
+          ParOptScalar gneg = max2(0.0, A[j]);
+          ParOptScalar cp = (1.0 + eta)*gpos + eta*gneg + ew[k];
+          ParOptScalar cq = (1.0 + eta)*gneg + eta*gpos + ew[k];
+          c[nc*j] = Ud[k]*Ud[k]*cp;
+          c[nc*j+1] = Ld[k]*Ld[k]*cq;
+          bi += Ud[k]*cp + Ld[k]*cq;
+        }
+        b[i] += bi;
       }
     }
+  }
 
+  if (use_true_mma){
     // All reduce the coefficient values
-    MPI_Allreduce(MPI_IN_PLACE, b, m, PAROPT_MPI_TYPE, MPI_SUM, comm);
+    ParOptAllreduce(MPI_IN_PLACE, b, m, PAROPT_MPI_TYPE, MPI_SUM, comm);
 
     for ( int i = 0; i < m; i++ ){
       b[i] = -(cons[i] + b[i]);
     }
   }
 
-  // Check that the asymptotes, limits and variables are well-defined
-  for ( int j = 0; j < n; j++ ){
-    if (!(ParOptRealPart(L[j]) < ParOptRealPart(alpha[j]))){
-      fprintf(stderr, "ParOptMMA: Inconsistent lower asymptote\n");
-    }
-    if (!(ParOptRealPart(alpha[j]) <= ParOptRealPart(x[j]))){
-      fprintf(stderr, "ParOptMMA: Inconsistent lower limit\n");
-    }
-    if (!(ParOptRealPart(x[j]) <= ParOptRealPart(beta[j]))){
-      fprintf(stderr, "ParOptMMA: Inconsistent upper limit\n");
-    }
-    if (!(ParOptRealPart(beta[j]) < ParOptRealPart(U[j]))){
-      fprintf(stderr, "ParOptMMA: Inconsistent upper assymptote\n");
-    }
-  }
-
   // Increment the number of MMA iterations
   mma_iter++;
 
-  // Free the A pointers
-  delete [] A;
+  profiler->stop(PAROPT_PROFILE_SUBPROBLEM);
 
   return 0;
 }
@@ -731,9 +934,15 @@ void ParOptMMA::getVarsAndBounds( ParOptVec *x, ParOptVec *lb,
 
 /*
   Evaluate the objective and constraints
+
+  The objective and all of the constraint approximations are computed
+  in a single pass over the design variables and summed across the
+  processors with a single reduction.
 */
 int ParOptMMA::evalObjCon( ParOptVec *xv, ParOptScalar *fval,
                            ParOptScalar *cvals ){
+  profiler->start(PAROPT_PROFILE_SUBPROBLEM);
+
   // Get the array of design variable values
   ParOptScalar *x, *x0;
   xvec->getArray(&x0);
@@ -744,57 +953,50 @@ int ParOptMMA::evalObjCon( ParOptVec *xv, ParOptScalar *fval,
   Lvec->getArray(&L);
   Uvec->getArray(&U);
 
-  // Get the coefficients for the objective
-  ParOptScalar *p0, *q0;
-  p0vec->getArray(&p0);
-  q0vec->getArray(&q0);
-
-  // Compute the objective
-  ParOptScalar fv = 0.0;
-  for ( int j = 0; j < n; j++ ){
-    fv += p0[j]/(U[j] - x[j]) + q0[j]/(x[j] - L[j]);
-  }
-
-  // Compute the linearized constraint
-  memset(cvals, 0, m*sizeof(ParOptScalar));
+  // Compute the objective and the constraint approximations
+  memset(fvals, 0, (m+1)*sizeof(ParOptScalar));
 
+  const int nc = 2*ncoef;
   if (use_true_mma){
-    for ( int i = 0; i < m; i++ ){
-      ParOptScalar *pi, *qi;
-      pivecs[i]->getArray(&pi);
-      qivecs[i]->getArray(&qi);
-
-      // Compute the coefficients for the constraints
-      for ( int j = 0; j < n; j++ ){
-        cvals[i] += pi[j]/(U[j] - x[j]) + qi[j]/(x[j] - L[j]);
+    for ( int j = 0; j < n; j++ ){
+      ParOptScalar Uinv = 1.0/(U[j] - x[j]);
+      ParOptScalar Linv = 1.0/(x[j] - L[j]);
+      const ParOptScalar *c = &pq[nc*j];
+      for ( int i = 0; i <= m; i++ ){
+        fvals[i] += c[2*i]*Uinv + c[2*i+1]*Linv;
       }
     }
   }
   else {
-    for ( int i = 0; i < m; i++ ){
-      ParOptScalar *A;
-      Avecs[i]->getArray(&A);
-      for ( int j = 0; j < n; j++ ){
-        cvals[i] += A[j]*(x[j] - x0[j]);
+    for ( int j = 0; j < n; j++ ){
+      ParOptScalar Uinv = 1.0/(U[j] - x[j]);
+      ParOptScalar Linv = 1.0/(x[j] - L[j]);
+      fvals[0] += pq[nc*j]*Uinv + pq[nc*j+1]*Linv;
+
+      // Compute the linearized constraints
+      ParOptScalar dx = x[j] - x0[j];
+      for ( int i = 0; i < m; i++ ){
+        fvals[i+1] += Aptr[i][j]*dx;
       }
     }
   }
 
   // All reduce the data
-  MPI_Allreduce(&fv, fval, 1, PAROPT_MPI_TYPE, MPI_SUM, comm);
-  MPI_Allreduce(MPI_IN_PLACE, cvals, m, PAROPT_MPI_TYPE, MPI_SUM, comm);
+  ParOptAllreduce(MPI_IN_PLACE, fvals, m+1, PAROPT_MPI_TYPE, MPI_SUM, comm);
 
+  *fval = fvals[0];
   if (use_true_mma){
     for ( int i = 0; i < m; i++ ){
-      cvals[i] = -(cvals[i] + b[i]);
+      cvals[i] = -(fvals[i+1] + b[i]);
     }
   }
   else {
     for ( int i = 0; i < m; i++ ){
-      cvals[i] += cons[i];
+      cvals[i] = fvals[i+1] + cons[i];
     }
   }
 
+  profiler->stop(PAROPT_PROFILE_SUBPROBLEM);
   return 0;
 }
 
@@ -803,6 +1005,8 @@ int ParOptMMA::evalObjCon( ParOptVec *xv, ParOptScalar *fval,
 */
 int ParOptMMA::evalObjConGradient( ParOptVec *xv, ParOptVec *gv,
                                    ParOptVec **Ac ){
+  profiler->start(PAROPT_PROFILE_SUBPROBLEM);
+
   // Keep track of the number of subproblem gradient evaluations
   subproblem_iter++;
 
@@ -819,41 +1023,54 @@ int ParOptMMA::evalObjConGradient( ParOptVec *xv, ParOptVec *gv,
   Lvec->getArray(&L);
   Uvec->getArray(&U);
 
-  // Get the coefficients for the objective
-  ParOptScalar *p0, *q0;
-  p0vec->getArray(&p0);
-  q0vec->getArray(&q0);
-
-  // Compute the gradient of the objective
-  for ( int j = 0; j < n; j++ ){
-    ParOptScalar Uinv = 1.0/(U[j] - x[j]);
-    ParOptScalar Linv = 1.0/(x[j] - L[j]);
-    g[j] = Uinv*Uinv*p0[j] - Linv*Linv*q0[j];
-  }
-
-  // Evaluate the gradient
   if (use_true_mma){
     for ( int i = 0; i < m; i++ ){
-      ParOptScalar *pi, *qi;
-      pivecs[i]->getArray(&pi);
-      qivecs[i]->getArray(&qi);
+      Ac[i]->getArray(&Acptr[i]);
+    }
+  }
 
-      ParOptScalar *A;
-      Ac[i]->getArray(&A);
+  // Compute the gradients one block at a time so that the squared
+  // reciprocals of the asymptote offsets are shared between the
+  // objective and all of the constraints
+  ParOptScalar Uinv2[PAROPT_MMA_BLOCK_SIZE], Linv2[PAROPT_MMA_BLOCK_SIZE];
+
+  const int nc = 2*ncoef;
+  for ( int jb = 0; jb < n; jb += PAROPT_MMA_BLOCK_SIZE ){
+    int je = jb + PAROPT_MMA_BLOCK_SIZE;
+    if (je > n){
+      je = n;
+    }
 
-      for ( int j = 0; j < n; j++ ){
-        ParOptScalar Uinv = 1.0/(U[j] - x[j]);
-        ParOptScalar Linv = 1.0/(x[j] - L[j]);
-        A[j] = Linv*Linv*qi[j] - Uinv*Uinv*pi[j];
+    // Compute the gradient of the objective
+    for ( int j = jb; j < je; j++ ){
+      const int k = j - jb;
+      ParOptScalar Uinv = 1.0/(U[j] - x[j]);
+      ParOptScalar Linv = 1.0/(x[j] - L[j]);
+      Uinv2[k] = Uinv*Uinv;
+      Linv2[k] = Linv*Linv;
+      g[j] = Uinv2[k]*pq[nc*j] - Linv2[k]*pq[nc*j+1];
+    }
+
+    // Evaluate the constraint gradients
+    if (use_true_mma){
+      for ( int i = 0; i < m; i++ ){
+        ParOptScalar *A = Acptr[i];
+        const ParOptScalar *c = &pq[2*(i+1)];
+        for ( int j = jb; j < je; j++ ){
+          const int k = j - jb;
+          A[j] = Linv2[k]*c[nc*j+1] - Uinv2[k]*c[nc*j];
+        }
       }
     }
   }
-  else {
+
+  if (!use_true_mma){
     for ( int i = 0; i < m; i++ ){
       Ac[i]->copyValues(Avecs[i]);
     }
   }
 
+  profiler->stop(PAROPT_PROFILE_SUBPROBLEM);
   return 0;
 }
 
@@ -863,6 +1080,8 @@ int ParOptMMA::evalObjConGradient( ParOptVec *xv, ParOptVec *gv,
 int ParOptMMA::evalHvecProduct( ParOptVec *xv,
                                 ParOptScalar *z, ParOptVec *zw,
                                 ParOptVec *px, ParOptVec *hvec ){
+  profiler->start(PAROPT_PROFILE_SUBPROBLEM);
+
   // Get the gradient vector
   ParOptScalar *h;
   hvec->getArray(&h);
@@ -876,22 +1095,19 @@ int ParOptMMA::evalHvecProduct( ParOptVec *xv,
   Lvec->getArray(&L);
   Uvec->getArray(&U);
 
-  // Get the coefficients for the objective
-  ParOptScalar *p0, *q0;
-  p0vec->getArray(&p0);
-  q0vec->getArray(&q0);
-
   // Get the components of the vector
   ParOptScalar *p;
   px->getArray(&p);
 
   // Compute the hessian of the objective
+  const int nc = 2*ncoef;
   for ( int j = 0; j < n; j++ ){
     ParOptScalar Uinv = 1.0/(U[j] - x[j]);
     ParOptScalar Linv = 1.0/(x[j] - L[j]);
-    h[j] = 2.0*(Uinv*Uinv*Uinv*p0[j] + Linv*Linv*Linv*q0[j])*p[j];
+    h[j] = 2.0*(Uinv*Uinv*Uinv*pq[nc*j] + Linv*Linv*Linv*pq[nc*j+1])*p[j];
   }
 
+  profiler->stop(PAROPT_PROFILE_SUBPROBLEM);
   return 0;
 }
 
@@ -901,6 +1117,8 @@ int ParOptMMA::evalHvecProduct( ParOptVec *xv,
 int ParOptMMA::evalHessianDiag( ParOptVec *xv,
                                 ParOptScalar *z, ParOptVec *zw,
                                 ParOptVec *hdiag ){
+  profiler->start(PAROPT_PROFILE_SUBPROBLEM);
+
   // Get the gradient vector
   ParOptScalar *h;
   hdiag->getArray(&h);
@@ -914,32 +1132,553 @@ int ParOptMMA::evalHessianDiag( ParOptVec *xv,
   Lvec->getArray(&L);
   Uvec->getArray(&U);
 
-  // Get the coefficients for the objective
-  ParOptScalar *p0, *q0;
-  p0vec->getArray(&p0);
-  q0vec->getArray(&q0);
-
-  // Compute the Hessian diagonal
+  // Compute the Hessian diagonal of the Lagrangian. The coefficients
+  // for each variable are contiguous, so the constraint contributions
+  // are added in the same pass as the objective.
+  const int nc = 2*ncoef;
   for ( int j = 0; j < n; j++ ){
     ParOptScalar Uinv = 1.0/(U[j] - x[j]);
     ParOptScalar Linv = 1.0/(x[j] - L[j]);
-    h[j] = 2.0*(Uinv*Uinv*Uinv*p0[j] + Linv*Linv*Linv*q0[j]);
+    ParOptScalar Uinv3 = Uinv*Uinv*Uinv;
+    ParOptScalar Linv3 = Linv*Linv*Linv;
+    const ParOptScalar *c = &pq[nc*j];
+
+    ParOptScalar pz = c[0];
+    ParOptScalar qz = c[1];
+    if (use_true_mma){
+      for ( int i = 0; i < m; i++ ){
+        pz += z[i]*c[2*(i+1)];
+        qz += z[i]*c[2*(i+1)+1];
+      }
+    }
+    h[j] = 2.0*(Uinv3*pz + Linv3*qz);
   }
 
-  if (use_true_mma){
+  profiler->stop(PAROPT_PROFILE_SUBPROBLEM);
+  return 0;
+}
+
+/*
+  Fix the variables that are firmly held at their bounds for the
+  current subproblem.
+
+  A variable is fixed when it lies on its lower (upper) bound, so that
+  the move limit coincides with the bound, and the derivative of the
+  subproblem Lagrangian with the starting multipliers is positive
+  (negative) by a relative margin of active_set_tol. The fixed
+  variables are set to the bound, and their contributions to the dual
+  function and its gradient are stored in dual_fixed.
+
+  @param lam the starting multipliers
+  @param x the variables for the subproblem (fixed entries are set)
+  @return the global number of fixed variables
+*/
+int ParOptMMA::computeActiveSet( const ParOptScalar *lam, ParOptScalar *x ){
+  ParOptScalar *xk, *lb, *ub;
+  xvec->getArray(&xk);
+  lbvec->getArray(&lb);
+  ubvec->getArray(&ub);
+  ParOptScalar *L, *U, *alpha, *beta;
+  Lvec->getArray(&L);
+  Uvec->getArray(&U);
+  alphavec->getArray(&alpha);
+  betavec->getArray(&beta);
+
+  memset(dual_fixed, 0, (1 + m)*sizeof(ParOptScalar));
+
+  const int nc = 2*ncoef;
+  for ( int j = 0; j < n; j++ ){
+    active_set_flags[j] = 0;
+
+    int at_lower = (xk[j] == lb[j] && alpha[j] == lb[j]);
+    int at_upper = (xk[j] == ub[j] && beta[j] == ub[j]);
+    if (!at_lower && !at_upper){
+      continue;
+    }
+
+    const ParOptScalar *c = &pq[nc*j];
+    ParOptScalar P = c[0];
+    ParOptScalar Q = c[1];
     for ( int i = 0; i < m; i++ ){
-      ParOptScalar *pi, *qi;
-      pivecs[i]->getArray(&pi);
-      qivecs[i]->getArray(&qi);
+      P += lam[i]*c[2*(i+1)];
+      Q += lam[i]*c[2*(i+1)+1];
+    }
 
-      for ( int j = 0; j < n; j++ ){
-        ParOptScalar Uinv = 1.0/(U[j] - x[j]);
-        ParOptScalar Linv = 1.0/(x[j] - L[j]);
-        h[j] += 2.0*z[i]*(Uinv*Uinv*Uinv*pi[j] + Linv*Linv*Linv*qi[j]);
+    // Compute the derivative of the Lagrangian at the bound
+    ParOptScalar xj = xk[j];
+    ParOptScalar Uinv = 1.0/(U[j] - xj);
+    ParOptScalar Linv = 1.0/(xj - L[j]);
+    double dp = ParOptRealPart(P*Uinv*Uinv);
+    double dq = ParOptRealPart(Q*Linv*Linv);
+    double margin = active_set_tol*(dp + dq);
+    if ((at_lower && dp - dq > margin) ||
+        (at_upper && dq - dp > margin)){
+      active_set_flags[j] = 1;
+      x[j] = xj;
+
+      dual_fixed[0] += c[0]*Uinv + c[1]*Linv;
+      for ( int i = 0; i < m; i++ ){
+        dual_fixed[1+i] += c[2*(i+1)]*Uinv + c[2*(i+1)+1]*Linv;
       }
     }
   }
 
+  active_set->setFixedVars(active_set_flags);
+
+  return active_set->getGlobalNumVars() - active_set->getGlobalNumFree();
+}
+
+/*
+  Evaluate the dual function of the MMA subproblem along with its
+  gradient and Hessian.
+
+  For fixed multipliers lam >= 0, the Lagrangian of the subproblem is
+  separable so that the minimizer for each variable is available in
+  closed form:
+
+  x = (sqrt(P)*L + sqrt(Q)*U)/(sqrt(P) + sqrt(Q))
+
+  projected onto the move limits, where P = p0 + sum_i lam_i*p_i and
+  Q = q0 + sum_i lam_i*q_i. The dual function is the value of the
+  Lagrangian at this point, its gradient is the vector of approximate
+  constraint violations and its Hessian is computed from the variables
+  that are not at the move limits.
+
+  All of the quantities are computed in a single pass over the design
+  variables and summed with a single reduction. When use_fixed is set,
+  the pass only includes the free variables in the active set, and the
+  contributions from the fixed variables, which are linear in the
+  multipliers, are added from dual_fixed.
+
+  @param lam the multipliers
+  @param x the minimizer of the Lagrangian (output)
+  @param vals the dual value, gradient and packed Hessian (output)
+  @param use_fixed flag to use the fixed variables in the active set
+*/
+void ParOptMMA::evalDual( const ParOptScalar *lam, ParOptScalar *x,
+                          ParOptScalar *vals, int use_fixed ){
+  // Get the asymptotes and move limits
+  ParOptScalar *L, *U;
+  Lvec->getArray(&L);
+  Uvec->getArray(&U);
+  ParOptScalar *alpha, *beta;
+  alphavec->getArray(&alpha);
+  betavec->getArray(&beta);
+
+  // Pointers into the dual data
+  ParOptScalar *grad = &vals[1];
+  ParOptScalar *H = &vals[1+m];
+  memset(vals, 0, (1 + m + m*(m+1)/2)*sizeof(ParOptScalar));
+
+  // The gradient of each constraint approximation w.r.t. x[j]
+  ParOptScalar *dg = dual_dg;
+
+  // Set the variables included in the pass
+  int nfree = n;
+  const int *free_index = NULL;
+  if (use_fixed){
+    nfree = active_set->getNumFree();
+    free_index = active_set->getFreeIndices();
+
+    vals[0] = dual_fixed[0];
+    for ( int i = 0; i < m; i++ ){
+      vals[0] += lam[i]*dual_fixed[1+i];
+      grad[i] = dual_fixed[1+i];
+    }
+  }
+
+  const int nc = 2*ncoef;
+  for ( int jj = 0; jj < nfree; jj++ ){
+    const int j = (free_index ? free_index[jj] : jj);
+    const ParOptScalar *c = &pq[nc*j];
+    ParOptScalar P = c[0];
+    ParOptScalar Q = c[1];
+    for ( int i = 0; i < m; i++ ){
+      P += lam[i]*c[2*(i+1)];
+      Q += lam[i]*c[2*(i+1)+1];
+    }
+
+    // Find the minimizer and check whether it is within the limits
+    ParOptScalar sP = sqrt(P);
+    ParOptScalar sQ = sqrt(Q);
+    ParOptScalar xj = (sP*L[j] + sQ*U[j])/(sP + sQ);
+    int is_free = 1;
+    if (ParOptRealPart(xj) <= ParOptRealPart(alpha[j])){
+      xj = alpha[j];
+      is_free = 0;
+    }
+    else if (ParOptRealPart(xj) >= ParOptRealPart(beta[j])){
+      xj = beta[j];
+      is_free = 0;
+    }
+    x[j] = xj;
+
+    ParOptScalar Uinv = 1.0/(U[j] - xj);
+    ParOptScalar Linv = 1.0/(xj - L[j]);
+    vals[0] += P*Uinv + Q*Linv;
+    for ( int i = 0; i < m; i++ ){
+      grad[i] += c[2*(i+1)]*Uinv + c[2*(i+1)+1]*Linv;
+    }
+
+    // Add the contribution to the Hessian from the free variables
+    if (is_free){
+      ParOptScalar Uinv2 = Uinv*Uinv;
+      ParOptScalar Linv2 = Linv*Linv;
+      ParOptScalar dinv = 0.5/(P*Uinv2*Uinv + Q*Linv2*Linv);
+      for ( int i = 0; i < m; i++ ){
+        dg[i] = c[2*(i+1)]*Uinv2 - c[2*(i+1)+1]*Linv2;
+      }
+      for ( int s = 0; s < m; s++ ){
+        ParOptScalar t = dinv*dg[s];
+        ParOptScalar *Hs = &H[s*(s+1)/2];
+        for ( int r = 0; r <= s; r++ ){
+          Hs[r] -= dg[r]*t;
+        }
+      }
+    }
+  }
+
+  ParOptAllreduce(MPI_IN_PLACE, vals, 1 + m + m*(m+1)/2,
+                  PAROPT_MPI_TYPE, MPI_SUM, comm);
+
+  // Add the contribution from the right-hand side
+  for ( int i = 0; i < m; i++ ){
+    vals[0] += lam[i]*b[i];
+    grad[i] += b[i];
+  }
+}
+
+/*
+  Solve the MMA subproblem using the dual method.
+
+  This is an alternative to solving the subproblem with the interior
+  point method that is suited to problems with many design variables
+  and a modest number of dense constraints, such as topology
+  optimization. The dual problem is
+
+  max W(lam) subject to 0 <= lam <= penalty_gamma
+
+  where the upper bound on the multipliers is equivalent to an exact
+  l1 penalty on the constraint violation. The dual problem is solved
+  with a projected Newton method. Each evaluation of the dual requires
+  one pass over the design variables and a single reduction of size
+  1 + m + m*(m+1)/2.
+
+  The current multipliers are used as the starting point. On exit, the
+  multipliers and the bound multipliers are stored so that
+  computeKKTError() can be called after initializeSubProblem().
+
+  Sparse constraints and the linearized constraints are not supported.
+
+  @param xv the solution of the subproblem (output)
+  @return zero on success, or a non-zero value if the method cannot be used
+*/
+int ParOptMMA::solveDualSubProblem( ParOptVec *xv ){
+  if (!use_true_mma || nwcon > 0){
+    fprintf(stderr, "ParOptMMA: The dual solver requires the true MMA "
+            "approximation without sparse constraints\n");
+    return 1;
+  }
+  if (!prob->isDenseInequality()){
+    fprintf(stderr, "ParOptMMA: The dual solver requires inequality "
+            "constraints\n");
+    return 1;
+  }
+
+  profiler->start(PAROPT_PROFILE_SUBPROBLEM);
+
+  ParOptScalar *x;
+  xv->getArray(&x);
+
+  // Start from the previous multipliers
+  ParOptScalar *lam = z;
+  for ( int i = 0; i < m; i++ ){
+    lam[i] = max2(0.0, min2(lam[i], penalty_gamma));
+  }
+
+  // Fix the variables that are firmly active, except at the MMA
+  // iterations where all of the variables are freed
+  int use_fixed = 0;
+  if (use_active_set && mma_iter % active_set_expand_freq != 0){
+    int nfixed = computeActiveSet(lam, x);
+    use_fixed = (nfixed > 0);
+    if (print_level > 1 && fp){
+      fprintf(fp, "ParOptMMA: %d of %d variables fixed in the dual solver\n",
+              nfixed, active_set->getGlobalNumVars());
+    }
+  }
+
+  // Pointers into the dual data
+  ParOptScalar *grad = &dual_vals[1];
+  ParOptScalar *H = &dual_vals[1+m];
+  evalDual(lam, x, dual_vals, use_fixed);
+
+  // The tolerance is relative to the magnitude of the constraints
+  double tol = 1.0;
+  for ( int i = 0; i < m; i++ ){
+    double bi = fabs(ParOptRealPart(b[i]));
+    if (bi > tol){
+      tol = bi;
+    }
+  }
+  tol *= dual_tol;
+
+  int iter = 0;
+  double res = 0.0;
+  for ( ; iter < max_dual_iters; iter++ ){
+    // Compute the norm of the projected gradient
+    res = 0.0;
+    for ( int i = 0; i < m; i++ ){
+      ParOptScalar t = max2(0.0, min2(lam[i] + grad[i], penalty_gamma));
+      double r = fabs(ParOptRealPart(t - lam[i]));
+      if (r > res){
+        res = r;
+      }
+    }
+
+    if (print_level > 1 && fp){
+      fprintf(fp, "%5s %4d %15.6e %9.3e\n", "dual", iter,
+              ParOptRealPart(dual_vals[0]), res);
+    }
+    if (res < tol){
+      break;
+    }
+
+    // Determine the multipliers that are held at their bounds
+    double eps_active = (res < 1e-3 ? res : 1e-3);
+    int nfree = 0;
+    for ( int i = 0; i < m; i++ ){
+      double li = ParOptRealPart(lam[i]);
+      double gi = ParOptRealPart(grad[i]);
+      if ((li <= eps_active && gi < 0.0) ||
+          (li >= penalty_gamma - eps_active && gi > 0.0)){
+        dual_free[i] = -1;
+      }
+      else {
+        dual_free[i] = nfree;
+        nfree++;
+      }
+    }
+
+    // Form the reduced Newton system for the free multipliers. The
+    // dual Hessian is only semi-definite, so add a small diagonal term.
+    double hmax = 0.0;
+    for ( int i = 0; i < m; i++ ){
+      double hii = -ParOptRealPart(H[i + i*(i+1)/2]);
+      if (hii > hmax){
+        hmax = hii;
+      }
+    }
+    double delta = 1e-8*hmax + 1e-14;
+
+    for ( int s = 0; s < m; s++ ){
+      int fs = dual_free[s];
+      if (fs >= 0){
+        for ( int r = 0; r <= s; r++ ){
+          int fr = dual_free[r];
+          if (fr >= 0){
+            dual_mat[fr + fs*(fs+1)/2] = -H[r + s*(s+1)/2];
+          }
+        }
+        dual_mat[fs + fs*(fs+1)/2] += delta;
+        dual_step[fs] = grad[s];
+      }
+    }
+
+    int info = 0;
+    if (nfree > 0){
+      int one = 1;
+      LAPACKdpptrf("U", &nfree, dual_mat, &info);
+      if (info == 0){
+        LAPACKdpptrs("U", &nfree, &one, dual_mat, dual_step, &nfree, &info);
+      }
+    }
+
+    // Scatter the step into the full vector. The free multipliers take
+    // the Newton step, or a diagonally scaled gradient step if the
+    // factorization fails, while the multipliers held at their bounds
+    // are moved onto the bound.
+    double smax = 0.0;
+    for ( int i = 0; i < m; i++ ){
+      if (dual_free[i] < 0){
+        if (ParOptRealPart(grad[i]) < 0.0){
+          dual_grad[i] = -lam[i];
+        }
+        else {
+          dual_grad[i] = penalty_gamma - lam[i];
+        }
+      }
+      else {
+        if (info == 0){
+          dual_grad[i] = dual_step[dual_free[i]];
+        }
+        else {
+          double hii = -ParOptRealPart(H[i + i*(i+1)/2]);
+          dual_grad[i] = grad[i]/(hii > delta ? hii : delta);
+        }
+
+        double si = fabs(ParOptRealPart(dual_grad[i]));
+        if (si > smax){
+          smax = si;
+        }
+      }
+    }
+
+    // Limit the length of the step for the free multipliers to the
+    // size of the feasible box
+    ParOptScalar *step = dual_step;
+    for ( int i = 0; i < m; i++ ){
+      step[i] = dual_grad[i];
+      if (dual_free[i] >= 0 && smax > penalty_gamma){
+        step[i] *= penalty_gamma/smax;
+      }
+      dual_grad[i] = grad[i];
+    }
+
+    // Perform a line search along the projection arc. The dual
+    // Hessian neglects the variables that become free along the step,
+    // so the step may overshoot the maximum. The directional
+    // derivative at each trial point is used to bracket the maximum
+    // and estimate the step length by the Illinois variant of the
+    // method of false position.
+    ParOptScalar W0 = dual_vals[0];
+    double t = 1.0, tlo = 0.0, thi = 1.0;
+    double dhi = 0.0;
+    int side = 0;
+
+    // The initial directional derivative
+    ParOptScalar dphi0 = 0.0;
+    for ( int i = 0; i < m; i++ ){
+      dphi0 += dual_grad[i]*step[i];
+    }
+    double d0 = ParOptRealPart(dphi0);
+    double dlo = d0;
+
+    double dmax = 0.0;
+    int accept = 0;
+    for ( int k = 0; k < 30 && !accept; k++ ){
+      ParOptScalar ascent = 0.0;
+      dmax = 0.0;
+      for ( int i = 0; i < m; i++ ){
+        dual_trial[i] = max2(0.0, min2(lam[i] + t*step[i], penalty_gamma));
+        ascent += dual_grad[i]*(dual_trial[i] - lam[i]);
+        double d = fabs(ParOptRealPart(dual_trial[i] - lam[i]));
+        if (d > dmax){
+          dmax = d;
+        }
+      }
+      evalDual(dual_trial, x, dual_vals, use_fixed);
+
+      // Compute the directional derivative at the trial point
+      ParOptScalar dphi = 0.0;
+      for ( int i = 0; i < m; i++ ){
+        dphi += grad[i]*(dual_trial[i] - lam[i]);
+      }
+      double dt = ParOptRealPart(dphi)/t;
+
+      // Accept the step if there is sufficient ascent and either the
+      // directional derivative has been sufficiently reduced, or the
+      // full step does not overshoot the maximum
+      if (ParOptRealPart(dual_vals[0]) >= ParOptRealPart(W0 + 1e-4*ascent) &&
+          (fabs(dt) <= 0.5*d0 || (k == 0 && dt >= 0.0))){
+        accept = 1;
+        memcpy(lam, dual_trial, m*sizeof(ParOptScalar));
+      }
+      else {
+        if (dt < 0.0){
+          thi = t;
+          dhi = dt;
+          if (side < 0){
+            dlo *= 0.5;
+          }
+          side = -1;
+        }
+        else {
+          tlo = t;
+          dlo = dt;
+          if (side > 0){
+            dhi *= 0.5;
+          }
+          side = 1;
+        }
+
+        // Select the next step within the bracket
+        double w = 0.5;
+        if (dhi < 0.0 && dlo > 0.0){
+          w = dlo/(dlo - dhi);
+          if (w < 0.01){
+            w = 0.01;
+          }
+          else if (w > 0.99){
+            w = 0.99;
+          }
+        }
+        t = tlo + w*(thi - tlo);
+      }
+    }
+
+    if (!accept){
+      // The line search failed: x and the dual data no longer
+      // correspond to the multipliers
+      evalDual(lam, x, dual_vals, use_fixed);
+      break;
+    }
+    else if (dmax <= 1e-12*penalty_gamma){
+      // The multipliers are no longer changing: the remaining
+      // residual is at the level of the round-off error
+      break;
+    }
+  }
+
+  if (print_level > 0 && fp && res >= tol){
+    fprintf(fp, "ParOptMMA: Dual solver stopped with projected "
+            "gradient %9.3e after %d iterations\n", res, iter);
+  }
+
+  if (use_fixed){
+    // Recover the variables from the final multipliers with a pass
+    // over all of the variables, so that any fixed variable that is
+    // no longer active at the final multipliers is released
+    evalDual(lam, x, dual_vals, 0);
+  }
+
+  // Compute the bound multipliers from the gradient of the
+  // Lagrangian at the variables on the move limits
+  ParOptScalar *L, *U, *alpha, *beta;
+  Lvec->getArray(&L);
+  Uvec->getArray(&U);
+  alphavec->getArray(&alpha);
+  betavec->getArray(&beta);
+  ParOptScalar *zl, *zu;
+  zlvec->getArray(&zl);
+  zuvec->getArray(&zu);
+
+  const int nc = 2*ncoef;
+  for ( int j = 0; j < n; j++ ){
+    zl[j] = zu[j] = 0.0;
+    if (x[j] == alpha[j] || x[j] == beta[j]){
+      const ParOptScalar *c = &pq[nc*j];
+      ParOptScalar P = c[0];
+      ParOptScalar Q = c[1];
+      for ( int i = 0; i < m; i++ ){
+        P += lam[i]*c[2*(i+1)];
+        Q += lam[i]*c[2*(i+1)+1];
+      }
+
+      ParOptScalar Uinv = 1.0/(U[j] - x[j]);
+      ParOptScalar Linv = 1.0/(x[j] - L[j]);
+      ParOptScalar d = P*Uinv*Uinv - Q*Linv*Linv;
+      if (x[j] == alpha[j]){
+        zl[j] = max2(0.0, d);
+      }
+      else {
+        zu[j] = max2(0.0, -d);
+      }
+    }
+  }
+
+  profiler->stop(PAROPT_PROFILE_SUBPROBLEM);
+
   return 0;
 }
 
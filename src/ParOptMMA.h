@@ -2,6 +2,9 @@
 #define PAR_OPT_QUASI_SEPARABLE_H
 
 #include "ParOptProblem.h"
+#include "ParOptProfiler.h"
+#include "ParOptActiveSet.h"
+#include "ParOptHistory.h"
 #include <stdio.h>
 
 /*
@@ -13,7 +16,9 @@
   a sequential, separable convex approximation technique,
   developed by Svanberg, that is commonly used in topology
   optimization. This method cannot incorporate sparse constraints
-  directly and so they are ignored.
+  directly and so they are ignored. The subproblem can be solved
+  either by passing this object to ParOptInteriorPoint or with the
+  dual method in solveDualSubProblem().
 
   The second mode is can be used to set up and run a convex sub-problem
   where the objective is governed by the same approximation
@@ -37,6 +42,9 @@ class ParOptMMA : public ParOptProblem {
   // Initialize data for the subproblem
   int initializeSubProblem( ParOptVec *x );
 
+  // Solve the subproblem using the dual method
+  int solveDualSubProblem( ParOptVec *x );
+
   // Compute the KKT error based on the current multiplier estimates
   void computeKKTError( double *l1, double *linfty, double *infeas );
 
@@ -60,10 +68,24 @@ class ParOptMMA : public ParOptProblem {
   void setMaxAsymptoteOffset( double val );
   void setBoundRelax( double val );
   void setRegularization( double eps, double delta );
+  void setPenaltyGamma( double val );
+  void setMaxDualIterations( int val );
+  void setDualTolerance( double val );
+  void setUseActiveSet( int truth );
+  void setActiveSetTolerance( double val );
+  void setActiveSetExpandFrequency( int val );
 
   // Set the output file (only on the root proc)
   void setOutputFile( const char *filename );
 
+  // Write the binary iteration and design history
+  void setHistoryFile( const char *filename );
+  void setDesignHistoryFile( const char *filename, int freq );
+
+  // Get the profiler and print the profile to the output file
+  ParOptProfiler *getProfiler(){ return profiler; }
+  void setProfileOutput( int truth );
+
   // Create the design vectors
   ParOptVec *createDesignVec();
   ParOptVec *createConstraintVec();
@@ -123,6 +145,13 @@ class ParOptMMA : public ParOptProblem {
   // Print the options summary
   void printOptionsSummary( FILE *fp );
 
+  // Fix the variables that are firmly active in the dual solver
+  int computeActiveSet( const ParOptScalar *lam, ParOptScalar *x );
+
+  // Evaluate the dual function, its gradient and Hessian
+  void evalDual( const ParOptScalar *lam, ParOptScalar *x,
+                 ParOptScalar *vals, int use_fixed=0 );
+
   // File pointer for the summary file - depending on the settings
   FILE *fp;
   int first_print;
@@ -130,6 +159,14 @@ class ParOptMMA : public ParOptProblem {
   // Settings for what to write out to a file or not...
   int print_level; // == 0 => no print, 1 MMA iters, 2 MMA+subproblem
 
+  // The binary iteration and design history (may be NULL)
+  ParOptHistory *history;
+  ParOptHistory *createHistory();
+
+  // The timers and counters for each phase of the optimization
+  ParOptProfiler *profiler;
+  int profile_output;
+
   // Communicator for this problem
   MPI_Comm comm;
 
@@ -149,6 +186,16 @@ class ParOptMMA : public ParOptProblem {
   double eps_regularization;
   double delta_regularization;
 
+  // Parameters for the dual subproblem solver
+  double penalty_gamma; // Upper bound on the dual multipliers
+  int max_dual_iters; // Maximum number of dual Newton iterations
+  double dual_tol; // Tolerance on the projected dual gradient
+
+  // Parameters for the reduced-space mode in the dual solver
+  int use_active_set; // Fix the firmly active variables
+  double active_set_tol; // Relative margin for the active set test
+  int active_set_expand_freq; // Iteration frequency to free all variables
+
   // Keep track of the number of iterations
   int mma_iter;
   int subproblem_iter;
@@ -168,6 +215,7 @@ class ParOptMMA : public ParOptProblem {
   // The objective, constraint and gradient information
   ParOptScalar fobj, *cons;
   ParOptVec *gvec, **Avecs;
+  ParOptScalar **Aptr, **Acptr; // Pointers to the gradient arrays
 
   // The assymptotes
   ParOptVec *Lvec, *Uvec;
@@ -175,13 +223,33 @@ class ParOptMMA : public ParOptProblem {
   // The move limits
   ParOptVec *alphavec, *betavec;
 
-  // The coefficients for the approximation
-  ParOptVec *p0vec, *q0vec; // The objective coefs
-  ParOptVec **pivecs, **qivecs; // The constraint coefs
+  // The coefficients for the approximation, stored interleaved for
+  // each variable as (p0, q0, p1, q1, ..., pm, qm) where the first
+  // pair is for the objective. With the linearized constraints only
+  // the objective coefficients are stored.
+  int ncoef;
+  ParOptScalar *pq;
 
   // The right-hand side for the constraints in the subproblem
   ParOptScalar *b;
 
+  // Values of the approximate objective and constraints
+  ParOptScalar *fvals;
+
+  // Data for the dual solver: the dual value, gradient and Hessian,
+  // the reduced Newton system, the trial multipliers and the
+  // constraint gradients for a single variable
+  ParOptScalar *dual_vals, *dual_mat;
+  ParOptScalar *dual_grad, *dual_step, *dual_trial, *dual_dg;
+  int *dual_free;
+
+  // The index map of the free variables for the dual solver and the
+  // contributions from the fixed variables to the dual function and
+  // its gradient
+  ParOptActiveSet *active_set;
+  int *active_set_flags;
+  ParOptScalar *dual_fixed;
+
   // The sparse constraint vector
   ParOptVec *cwvec;
 
@@ -0,0 +1,314 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ParOptMultiVec.h"
+#include "ParOptProfiler.h"
+#include "ParOptActiveSet.h"
+
+/*
+  The number of rows processed at a time by the block kernels. The
+  corresponding segment of the input or output vector remains in
+  cache while each of the columns are processed.
+*/
+static const int PAROPT_MULTIVEC_BLOCK_SIZE = 512;
+
+/**
+  Allocate a block of vectors with contiguous column-major storage
+
+  @param comm the communicator for the vectors
+  @param size the number of local components of each vector
+  @param nvecs the number of vectors
+*/
+ParOptMultiVec::ParOptMultiVec( MPI_Comm _comm, int _size, int _nvecs ){
+  comm = _comm;
+  size = ld = _size;
+  nvecs = _nvecs;
+
+#ifdef PAROPT_USE_OPENMP
+  // Touch the memory with the threads that will process each block
+  data = ParOptAllocAligned(ld*nvecs, 0);
+  int nblocks = (size + PAROPT_MULTIVEC_BLOCK_SIZE - 1)/PAROPT_MULTIVEC_BLOCK_SIZE;
+  PAROPT_OMP_FOR
+  for ( int k = 0; k < nblocks; k++ ){
+    int start = k*PAROPT_MULTIVEC_BLOCK_SIZE;
+    int end = start + PAROPT_MULTIVEC_BLOCK_SIZE;
+    if (end > size){ end = size; }
+    for ( int j = 0; j < nvecs; j++ ){
+      for ( int i = start; i < end; i++ ){
+        data[i + j*ld] = 0.0;
+      }
+    }
+  }
+
+  // Allocate the storage for the partial sums computed by mdot
+  partial = new ParOptScalar[ nvecs*nblocks + 1 ];
+#else
+  data = ParOptAllocAligned(ld*nvecs);
+  partial = NULL;
+#endif // PAROPT_USE_OPENMP
+
+  // Create the column vectors that share the storage
+  vecs = new ParOptVec*[ nvecs ];
+  for ( int j = 0; j < nvecs; j++ ){
+    vecs[j] = new ParOptBasicVec(comm, size, &data[j*ld]);
+    vecs[j]->incref();
+  }
+}
+
+/**
+  Create a block of vectors from separately allocated vectors
+
+  @param nvecs the number of vectors
+  @param vecs the array of vectors
+*/
+ParOptMultiVec::ParOptMultiVec( int _nvecs, ParOptVec **_vecs ){
+  comm = MPI_COMM_NULL;
+  nvecs = _nvecs;
+  data = NULL;
+  partial = NULL;
+
+  size = ld = 0;
+  vecs = new ParOptVec*[ nvecs ];
+  for ( int j = 0; j < nvecs; j++ ){
+    vecs[j] = _vecs[j];
+    vecs[j]->incref();
+  }
+  if (nvecs > 0){
+    size = ld = vecs[0]->getArray(NULL);
+  }
+}
+
+/**
+  Free the vectors and the contiguous storage
+*/
+ParOptMultiVec::~ParOptMultiVec(){
+  for ( int j = 0; j < nvecs; j++ ){
+    vecs[j]->decref();
+  }
+  delete [] vecs;
+
+  if (data){
+    ParOptFreeAligned(data, ld*nvecs);
+  }
+  if (partial){
+    delete [] partial;
+  }
+}
+
+/**
+  Get the number of vectors in the block
+
+  @return the number of vectors
+*/
+int ParOptMultiVec::getNumVecs(){
+  return nvecs;
+}
+
+/**
+  Get the i-th vector in the block
+
+  @param i the index of the vector
+  @return the vector (or NULL if the index is out of range)
+*/
+ParOptVec *ParOptMultiVec::getVec( int i ){
+  if (i >= 0 && i < nvecs){
+    return vecs[i];
+  }
+  return NULL;
+}
+
+/**
+  Get the array of vectors in the block
+
+  @return the array of vectors
+*/
+ParOptVec **ParOptMultiVec::getVecs(){
+  return vecs;
+}
+
+/**
+  Get the contiguous column-major storage for the block. The leading
+  dimension is equal to the local size of each vector, unless the
+  vectors have been compressed to the free variables of an active set.
+
+  @param array pointer set to the storage (NULL if not contiguous)
+  @param lda the leading dimension of the storage (may be NULL)
+  @return the local size of each vector
+*/
+int ParOptMultiVec::getArray( ParOptScalar **array, int *lda ){
+  if (array){
+    *array = data;
+  }
+  if (lda){
+    *lda = ld;
+  }
+  return size;
+}
+
+/**
+  Compress each of the vectors in the block to the free variables of
+  the active set. The columns remain in place so the leading dimension
+  of the contiguous storage is unchanged.
+
+  The block is either compressed entirely or left unchanged: if any
+  column cannot be compressed, the columns that were already
+  compressed are expanded again. The permutation is stable, so this
+  restores their original values exactly.
+
+  @param active the active set index map
+  @return non-zero if any of the vectors could not be compressed
+*/
+int ParOptMultiVec::compressEntries( ParOptActiveSet *active ){
+  for ( int j = 0; j < nvecs; j++ ){
+    if (vecs[j]->compressEntries(active)){
+      for ( int k = 0; k < j; k++ ){
+        vecs[k]->expandEntries(active);
+      }
+      return 1;
+    }
+  }
+  size = active->getNumFree();
+  return 0;
+}
+
+/**
+  Expand each of the vectors in the block to the full set of variables
+
+  As with compression, the block is either expanded entirely or left
+  compressed: if any column cannot be expanded, the columns that were
+  already expanded are compressed again.
+
+  @param active the active set index map used to compress the vectors
+  @param fixed_values values for the fixed entries (may be NULL)
+  @return non-zero if any of the vectors could not be expanded
+*/
+int ParOptMultiVec::expandEntries( ParOptActiveSet *active,
+                                   const ParOptScalar *fixed_values ){
+  for ( int j = 0; j < nvecs; j++ ){
+    if (vecs[j]->expandEntries(active, fixed_values)){
+      for ( int k = 0; k < j; k++ ){
+        vecs[k]->compressEntries(active);
+      }
+      return 1;
+    }
+  }
+  size = active->getNumVars();
+  return 0;
+}
+
+/**
+  Compute the dot products of the first n vectors with x using a
+  single reduction. When the storage is contiguous, this is computed
+  in blocks of rows so that x is only read from memory once.
+
+  @param x the input vector
+  @param n the number of vectors to use
+  @param output the array of dot products: output[j] = vecs[j]^{T}*x
+*/
+void ParOptMultiVec::mdot( ParOptVec *x, int n, ParOptScalar *output ){
+  if (n > nvecs){
+    n = nvecs;
+  }
+  if (n <= 0){
+    return;
+  }
+  if (!data){
+    x->mdot(vecs, n, output);
+    return;
+  }
+
+  ParOptScalar *xvals;
+  x->getArray(&xvals);
+
+  for ( int j = 0; j < n; j++ ){
+    output[j] = 0.0;
+  }
+
+  int nblocks = (size + PAROPT_MULTIVEC_BLOCK_SIZE - 1)/PAROPT_MULTIVEC_BLOCK_SIZE;
+#ifdef PAROPT_USE_OPENMP
+  // Compute the partial products for each block in parallel and sum
+  // them in a fixed order so the result is independent of the number
+  // of threads
+  PAROPT_OMP_FOR
+  for ( int k = 0; k < nblocks; k++ ){
+    int start = k*PAROPT_MULTIVEC_BLOCK_SIZE;
+    int end = start + PAROPT_MULTIVEC_BLOCK_SIZE;
+    if (end > size){ end = size; }
+
+    for ( int j = 0; j < n; j++ ){
+      const ParOptScalar *a = &data[j*ld];
+      ParOptScalar sum = 0.0;
+      for ( int i = start; i < end; i++ ){
+        sum += a[i]*xvals[i];
+      }
+      partial[j + k*n] = sum;
+    }
+  }
+
+  for ( int k = 0; k < nblocks; k++ ){
+    for ( int j = 0; j < n; j++ ){
+      output[j] += partial[j + k*n];
+    }
+  }
+#else
+  for ( int k = 0; k < nblocks; k++ ){
+    int start = k*PAROPT_MULTIVEC_BLOCK_SIZE;
+    int end = start + PAROPT_MULTIVEC_BLOCK_SIZE;
+    if (end > size){ end = size; }
+
+    for ( int j = 0; j < n; j++ ){
+      const ParOptScalar *a = &data[j*ld];
+      ParOptScalar sum = 0.0;
+      for ( int i = start; i < end; i++ ){
+        sum += a[i]*xvals[i];
+      }
+      output[j] += sum;
+    }
+  }
+#endif // PAROPT_USE_OPENMP
+
+  ParOptAllreduce(MPI_IN_PLACE, output, n, PAROPT_MPI_TYPE, MPI_SUM, comm);
+}
+
+/**
+  Add a linear combination of the first n vectors to y. When the
+  storage is contiguous, this is computed in blocks of rows so that y
+  is only read and written once.
+
+  @param n the number of vectors to use
+  @param alpha the coefficients for each vector
+  @param y the output vector: y <- y + sum_{j} alpha[j]*vecs[j]
+*/
+void ParOptMultiVec::maxpy( int n, const ParOptScalar *alpha,
+                            ParOptVec *y ){
+  if (n > nvecs){
+    n = nvecs;
+  }
+  if (n <= 0){
+    return;
+  }
+  if (!data){
+    for ( int j = 0; j < n; j++ ){
+      y->axpy(alpha[j], vecs[j]);
+    }
+    return;
+  }
+
+  ParOptScalar *yvals;
+  y->getArray(&yvals);
+
+  int nblocks = (size + PAROPT_MULTIVEC_BLOCK_SIZE - 1)/PAROPT_MULTIVEC_BLOCK_SIZE;
+  PAROPT_OMP_FOR
+  for ( int k = 0; k < nblocks; k++ ){
+    int start = k*PAROPT_MULTIVEC_BLOCK_SIZE;
+    int end = start + PAROPT_MULTIVEC_BLOCK_SIZE;
+    if (end > size){ end = size; }
+
+    for ( int j = 0; j < n; j++ ){
+      const ParOptScalar *a = &data[j*ld];
+      const ParOptScalar aj = alpha[j];
+      for ( int i = start; i < end; i++ ){
+        yvals[i] += aj*a[i];
+      }
+    }
+  }
+}
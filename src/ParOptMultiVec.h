@@ -0,0 +1,63 @@
+#ifndef PAR_OPT_MULTI_VEC_H
+#define PAR_OPT_MULTI_VEC_H
+
+#include "ParOptVec.h"
+
+/*
+  A block of distributed vectors with the same parallel layout.
+
+  When possible, the vectors are stored contiguously in column-major
+  order so that products with the entire block can be computed in a
+  single pass through memory. The individual columns are accessible
+  as ParOptVec objects that share the contiguous storage.
+
+  If the vectors cannot be stored contiguously (for instance, when
+  they are supplied by a user-defined ParOptVec implementation) they
+  are stored as separate vectors, and the block operations fall back
+  to the standard ParOptVec operations.
+*/
+class ParOptMultiVec : public ParOptBase {
+ public:
+  ParOptMultiVec( MPI_Comm _comm, int _size, int _nvecs );
+  ParOptMultiVec( int _nvecs, ParOptVec **_vecs );
+  ~ParOptMultiVec();
+
+  // Get the number of vectors and the vectors themselves
+  int getNumVecs();
+  ParOptVec *getVec( int i );
+  ParOptVec **getVecs();
+
+  // Get the contiguous column-major storage (if it exists)
+  int getArray( ParOptScalar **array, int *lda=NULL );
+
+  // Compress/expand all of the vectors with the active set index map
+  int compressEntries( ParOptActiveSet *active );
+  int expandEntries( ParOptActiveSet *active,
+                     const ParOptScalar *fixed_values=NULL );
+
+  // Compute output[j] = vecs[j]^{T}*x for the first n vectors
+  void mdot( ParOptVec *x, int n, ParOptScalar *output );
+
+  // Compute y <- y + sum_{j} alpha[j]*vecs[j] for the first n vectors
+  void maxpy( int n, const ParOptScalar *alpha, ParOptVec *y );
+
+ private:
+  MPI_Comm comm;
+
+  // The local size of each vector and the number of vectors
+  int size, nvecs;
+
+  // The contiguous storage with leading dimension ld (may be NULL).
+  // The leading dimension is larger than size when the vectors are
+  // compressed to the free variables of an active set.
+  int ld;
+  ParOptScalar *data;
+
+  // The block partial sums for the threaded products (may be NULL)
+  ParOptScalar *partial;
+
+  // The vectors (views into data when the storage is contiguous)
+  ParOptVec **vecs;
+};
+
+#endif // PAR_OPT_MULTI_VEC_H
@@ -1,6 +1,58 @@
 #include "ParOptProblem.h"
 #include "ParOptComplexStep.h"
 #include <string.h>
+#include <typeinfo>
+
+/*
+  Create a block of design vectors. Contiguous storage is only used
+  when the vector type is exactly ParOptBasicVec, since user-defined
+  vector types may use a different internal layout.
+*/
+ParOptMultiVec *ParOptProblem::createDesignMultiVec( int nvecs ){
+  ParOptVec *vec = createDesignVec();
+  vec->incref();
+  int size = vec->getArray(NULL);
+  int is_basic = (typeid(*vec) == typeid(ParOptBasicVec));
+  vec->decref();
+
+  if (is_basic){
+    return new ParOptMultiVec(comm, size, nvecs);
+  }
+
+  ParOptVec **vecs = new ParOptVec*[ nvecs ];
+  for ( int i = 0; i < nvecs; i++ ){
+    vecs[i] = createDesignVec();
+  }
+  ParOptMultiVec *mvec = new ParOptMultiVec(nvecs, vecs);
+  delete [] vecs;
+
+  return mvec;
+}
+
+/*
+  Create a block of constraint vectors with contiguous storage when
+  the vector type is exactly ParOptBasicVec
+*/
+ParOptMultiVec *ParOptProblem::createConstraintMultiVec( int nvecs ){
+  ParOptVec *vec = createConstraintVec();
+  vec->incref();
+  int size = vec->getArray(NULL);
+  int is_basic = (typeid(*vec) == typeid(ParOptBasicVec));
+  vec->decref();
+
+  if (is_basic){
+    return new ParOptMultiVec(comm, size, nvecs);
+  }
+
+  ParOptVec **vecs = new ParOptVec*[ nvecs ];
+  for ( int i = 0; i < nvecs; i++ ){
+    vecs[i] = createConstraintVec();
+  }
+  ParOptMultiVec *mvec = new ParOptMultiVec(nvecs, vecs);
+  delete [] vecs;
+
+  return mvec;
+}
 
 void ParOptProblem::checkGradients( double dh, ParOptVec *xvec,
                                     int check_hvec_product ){
@@ -134,8 +186,40 @@ void ParOptProblem::checkGradients( double dh, ParOptVec *xvec,
 
 #ifdef PAROPT_USE_COMPLEX
   ParOptScalar pfd = ParOptImagPart(fobj2)/dh;
+  for ( int i = 0; i < ncon; i++ ){
+    ctemp[i] = ParOptImagPart(ctemp[i])/dh;
+  }
 #else
   ParOptScalar pfd = (fobj2 - fobj)/dh;
+  for ( int i = 0; i < ncon; i++ ){
+    ctemp[i] = (ctemp[i] - c[i])/dh;
+  }
+
+  // If the problem can be evaluated with complex design variables,
+  // replace the finite-difference values with a complex step
+  int use_complex_step = 0;
+  if (useComplexStep()){
+    ParOptScalar *xvals;
+    x->getArray(&xvals);
+
+    ParOptComplex *xc = new ParOptComplex[ nvars ];
+    ParOptComplex *cc = new ParOptComplex[ ncon ];
+    for ( int i = 0; i < nvars; i++ ){
+      xc[i] = ParOptComplex(xvals[i], dh*pxvals[i]);
+    }
+
+    ParOptComplex fc;
+    if (evalObjConComplex(xc, &fc, cc) == 0){
+      use_complex_step = 1;
+      pfd = ParOptImagPart(fc)/dh;
+      for ( int i = 0; i < ncon; i++ ){
+        ctemp[i] = ParOptImagPart(cc[i])/dh;
+      }
+    }
+
+    delete [] xc;
+    delete [] cc;
+  }
 #endif // PAROPT_USE_COMPLEX
 
   // Print out the results on the root processor
@@ -143,6 +227,11 @@ void ParOptProblem::checkGradients( double dh, ParOptVec *xvec,
   MPI_Comm_rank(comm, &rank);
 
   if (rank == 0){
+#ifndef PAROPT_USE_COMPLEX
+    if (use_complex_step){
+      printf("Using a complex step for the gradient test\n");
+    }
+#endif // PAROPT_USE_COMPLEX
     printf("Objective gradient test\n");
     printf("Objective FD: %15.8e  Actual: %15.8e  Err: %8.2e  "
            "Rel err: %8.2e\n", ParOptRealPart(pfd), ParOptRealPart(pobj),
@@ -151,11 +240,7 @@ void ParOptProblem::checkGradients( double dh, ParOptVec *xvec,
 
     printf("\nConstraint gradient test\n");
     for ( int i = 0; i < ncon; i++ ){
-#ifdef PAROPT_USE_COMPLEX
-      ParOptScalar fd = ParOptImagPart(ctemp[i])/dh;
-#else
-      ParOptScalar fd = (ctemp[i] - c[i])/dh;
-#endif // PAROPT_USE_COMPLEX
+      ParOptScalar fd = ctemp[i];
 
       printf("Con[%3d]  FD: %15.8e  Actual: %15.8e  Err: %8.2e  "
              "Rel err: %8.2e\n", i, ParOptRealPart(fd),
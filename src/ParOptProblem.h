@@ -2,6 +2,7 @@
 #define PAR_OPT_PROBLEM_H
 
 #include "ParOptVec.h"
+#include "ParOptMultiVec.h"
 
 /*
   This code is the virtual base class problem definition for the
@@ -46,6 +47,7 @@ class ParOptProblem : public ParOptBase {
   ParOptProblem( MPI_Comm _comm ){
     comm = _comm;
     nvars = ncon = nwcon = nwblock = 0;
+    design_pool = con_pool = NULL;
   }
   /**
     Create a ParOptProblem class and define the problem layout.
@@ -64,16 +66,28 @@ class ParOptProblem : public ParOptBase {
     ncon = _ncon;
     nwcon = _nwcon;
     nwblock = _nwblock;
+    design_pool = con_pool = NULL;
+  }
+  virtual ~ParOptProblem(){
+    if (design_pool){ design_pool->decref(); }
+    if (con_pool){ con_pool->decref(); }
   }
-  virtual ~ParOptProblem(){}
 
   /**
     Create a new distributed design vector
 
+    The default implementation takes the storage from a pool owned by
+    the problem, so that the storage is reused when the vectors of an
+    optimizer or subproblem are deleted and new vectors are created.
+
     @return a new distributed design vector
   */
   virtual ParOptVec *createDesignVec(){
-    return new ParOptBasicVec(comm, nvars);
+    if (!design_pool){
+      design_pool = new ParOptVecPool(comm, nvars);
+      design_pool->incref();
+    }
+    return design_pool->createVec();
   }
 
   /**
@@ -82,9 +96,43 @@ class ParOptProblem : public ParOptBase {
     @return a new distributed sparse constraint vector
   */
   virtual ParOptVec *createConstraintVec(){
-    return new ParOptBasicVec(comm, nwcon);
+    if (!con_pool){
+      con_pool = new ParOptVecPool(comm, nwcon);
+      con_pool->incref();
+    }
+    return con_pool->createVec();
+  }
+
+  /**
+    Free the pooled vector storage that is not currently in use
+  */
+  void clearVecPools(){
+    if (design_pool){ design_pool->clear(); }
+    if (con_pool){ con_pool->clear(); }
   }
 
+  /**
+    Create a block of distributed design vectors. The default
+    implementation uses contiguous storage when the design vectors
+    are ParOptBasicVec objects, otherwise the vectors are created
+    separately using createDesignVec().
+
+    @param nvecs the number of vectors in the block
+    @return a new block of design vectors
+  */
+  virtual ParOptMultiVec *createDesignMultiVec( int nvecs );
+
+  /**
+    Create a block of distributed constraint vectors. The default
+    implementation uses contiguous storage when the constraint vectors
+    are ParOptBasicVec objects, otherwise the vectors are created
+    separately using createConstraintVec().
+
+    @param nvecs the number of vectors in the block
+    @return a new block of constraint vectors
+  */
+  virtual ParOptMultiVec *createConstraintMultiVec( int nvecs );
+
   /**
     Get the communicator for the problem
 
@@ -108,6 +156,11 @@ class ParOptProblem : public ParOptBase {
     ncon = _ncon;
     nwcon = _nwcon;
     nwblock = _nwblock;
+
+    // The existing vectors keep a reference to their pools
+    if (design_pool){ design_pool->decref(); }
+    if (con_pool){ con_pool->decref(); }
+    design_pool = con_pool = NULL;
   }
 
   /**
@@ -174,13 +227,44 @@ class ParOptProblem : public ParOptBase {
 
     @param x is the design variable vector
     @param fobj is the objective value at x
-    @param cons is the array of constraint vaules at x
+    @param cons is the array of constraint values at x
     @return zero on success, non-zero fail flag on error
   */
   virtual int evalObjCon( ParOptVec *x,
                           ParOptScalar *fobj,
                           ParOptScalar *cons ) = 0;
 
+  /**
+    Evaluate the objective and constraints at several points.
+
+    This is used by the speculative line search to evaluate a set of
+    trial points at once. Problems with spare resources can override
+    this to evaluate the points concurrently, for instance on separate
+    sub-communicators or through an external scheduler. The default
+    implementation evaluates each point in turn using evalObjCon().
+
+    The points are ordered so that the point most likely to be
+    accepted is last. After this call, the gradient may be evaluated
+    at x[npts-1] without a further call to evalObjCon(). If a
+    different point is accepted, evalObjCon() is called at that point
+    before the gradient is evaluated.
+
+    @param npts is the number of points
+    @param x is the array of design variable vectors
+    @param fobj is the array of objective values at each point
+    @param cons is the array of constraint values: cons[ncon*i + j]
+    @param fail is the array of fail flags for each point
+    @return zero on success, non-zero fail flag if the batch failed
+  */
+  virtual int evalObjConBatch( int npts, ParOptVec **x,
+                               ParOptScalar *fobj,
+                               ParOptScalar *cons, int *fail ){
+    for ( int i = 0; i < npts; i++ ){
+      fail[i] = evalObjCon(x[i], &fobj[i], &cons[ncon*i]);
+    }
+    return 0;
+  }
+
   /**
     Evaluate the objective and constraint gradients.
 
@@ -215,6 +299,37 @@ class ParOptProblem : public ParOptBase {
     return 0;
   }
 
+  /**
+    Evaluate the product of the Hessian with several vectors.
+
+    This is called by the block Krylov methods that generate several
+    directions at once. Problems that can amortize the cost of the
+    Hessian over several directions, for instance by linearizing once
+    or by performing a single multi-right-hand-side adjoint solve,
+    should override this function. The default implementation computes
+    each product in turn using evalHvecProduct().
+
+    @param x is the design variable vector
+    @param z is the array of multipliers for the dense constraints
+    @param zw is the vector of multipliers for the sparse constraints
+    @param nvecs is the number of direction vectors
+    @param px is the array of direction vectors
+    @param hvec is the array of output vectors hvec[i] = H(x,z,zw)*px[i]
+    @return zero on success, non-zero flag on error
+  */
+  virtual int evalHvecProductBlock( ParOptVec *x,
+                                    ParOptScalar *z, ParOptVec *zw,
+                                    int nvecs, ParOptVec **px,
+                                    ParOptVec **hvec ){
+    for ( int i = 0; i < nvecs; i++ ){
+      int fail = evalHvecProduct(x, z, zw, px[i], hvec[i]);
+      if (fail){
+        return fail;
+      }
+    }
+    return 0;
+  }
+
   /**
     Evaluate the diagonal of the Hessian.
 
@@ -291,6 +406,36 @@ class ParOptProblem : public ParOptBase {
   virtual void addSparseInnerProduct( ParOptScalar alpha, ParOptVec *x,
                                       ParOptVec *cvec, ParOptScalar *A ){}
 
+  /**
+    Indicate whether the objective and constraints can be evaluated at
+    complex values of the design variables with evalObjConComplex().
+    When true, checkGradients() verifies the gradients with a complex
+    step, even when ParOptScalar is real. Default is false.
+
+    @return flag indicating whether to use the complex-step evaluation
+  */
+  virtual int useComplexStep(){ return 0; }
+
+  /**
+    Evaluate the objective and constraints at complex values of the
+    design variables.
+
+    This is only used to verify the gradients. Problems that are
+    written in terms of a template scalar type can implement this
+    function by instantiating their evaluation with ParOptComplex, so
+    that the optimization itself uses real arithmetic.
+
+    @param x is the array of local design variable values (length nvars)
+    @param fobj is the objective value at x
+    @param cons is the array of constraint values at x
+    @return zero on success, non-zero fail flag on error
+  */
+  virtual int evalObjConComplex( const ParOptComplex *x,
+                                 ParOptComplex *fobj,
+                                 ParOptComplex *cons ){
+    return 1;
+  }
+
   /**
     Check the objective and constraint gradients for this problem instance
 
@@ -308,6 +453,10 @@ class ParOptProblem : public ParOptBase {
  protected:
   MPI_Comm comm;
   int nvars, ncon, nwcon, nwblock;
+
+ private:
+  // The pools of design and sparse constraint vector storage
+  ParOptVecPool *design_pool, *con_pool;
 };
 
 #endif // PAR_OPT_PROBLEM_H
@@ -0,0 +1,321 @@
+#include "ParOptProfiler.h"
+
+/*
+  The reduction statistics accumulated on this processor
+*/
+static int paropt_reduce_count = 0;
+static double paropt_reduce_bytes = 0.0;
+static double paropt_reduce_time = 0.0;
+
+/*
+  The function evaluation cache statistics on this processor
+*/
+static int paropt_cache_hits = 0;
+static int paropt_cache_misses = 0;
+
+/*
+  The names of the phases used in the output
+*/
+static const char *paropt_profile_phase_names[] = {
+  "total",
+  "objcon",
+  "gradient",
+  "hvec",
+  "kkt_setup",
+  "kkt_solve",
+  "krylov",
+  "qn_update",
+  "line_search",
+  "subproblem",
+  "output"};
+
+/**
+  Perform an all-reduce and record the reduction statistics
+
+  The arguments are the same as MPI_Allreduce.
+*/
+int ParOptAllreduce( const void *sendbuf, void *recvbuf, int count,
+                     MPI_Datatype datatype, MPI_Op op, MPI_Comm comm ){
+  int size = 0;
+  MPI_Type_size(datatype, &size);
+
+  double t0 = MPI_Wtime();
+  int ierr = MPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm);
+  paropt_reduce_time += MPI_Wtime() - t0;
+  paropt_reduce_count++;
+  paropt_reduce_bytes += 1.0*count*size;
+
+  return ierr;
+}
+
+/**
+  Start a non-blocking all-reduce and record the reduction statistics.
+  Only the time to start the reduction is recorded.
+
+  The arguments are the same as MPI_Iallreduce.
+*/
+int ParOptIallreduce( const void *sendbuf, void *recvbuf, int count,
+                      MPI_Datatype datatype, MPI_Op op, MPI_Comm comm,
+                      MPI_Request *request ){
+  int size = 0;
+  MPI_Type_size(datatype, &size);
+
+  double t0 = MPI_Wtime();
+  int ierr = MPI_Iallreduce(sendbuf, recvbuf, count, datatype,
+                            op, comm, request);
+  paropt_reduce_time += MPI_Wtime() - t0;
+  paropt_reduce_count++;
+  paropt_reduce_bytes += 1.0*count*size;
+
+  return ierr;
+}
+
+/**
+  Get the reduction statistics accumulated on this processor
+
+  @param count the number of reductions
+  @param bytes the number of bytes reduced
+  @param time the time spent in the reductions
+*/
+void ParOptGetReductionStats( int *count, double *bytes, double *time ){
+  if (count){ *count = paropt_reduce_count; }
+  if (bytes){ *bytes = paropt_reduce_bytes; }
+  if (time){ *time = paropt_reduce_time; }
+}
+
+/**
+  Record an access to the function evaluation cache
+
+  @param hit flag indicating whether the access was a hit
+*/
+void ParOptRecordCacheAccess( int hit ){
+  if (hit){
+    paropt_cache_hits++;
+  }
+  else {
+    paropt_cache_misses++;
+  }
+}
+
+/**
+  Get the cache statistics accumulated on this processor
+
+  @param hits the number of cache hits
+  @param misses the number of cache misses
+*/
+void ParOptGetCacheStats( int *hits, int *misses ){
+  if (hits){ *hits = paropt_cache_hits; }
+  if (misses){ *misses = paropt_cache_misses; }
+}
+
+ParOptProfiler::ParOptProfiler(){
+  for ( int i = 0; i < PAROPT_PROFILE_NUM_PHASES; i++ ){
+    phase_depth[i] = 0;
+  }
+  reset();
+}
+
+/**
+  Reset all of the timers and counters. Any phases that are active
+  are restarted at the current time.
+*/
+void ParOptProfiler::reset(){
+  double t = MPI_Wtime();
+  for ( int i = 0; i < PAROPT_PROFILE_NUM_PHASES; i++ ){
+    phase_time[i] = 0.0;
+    phase_calls[i] = 0;
+    if (phase_depth[i] > 0){
+      phase_start[i] = t;
+    }
+    else {
+      phase_start[i] = 0.0;
+      phase_depth[i] = 0;
+    }
+    iter_time[i] = 0.0;
+    iter_calls[i] = 0;
+  }
+
+  ParOptGetReductionStats(&reduce_count, &reduce_bytes, &reduce_time);
+  iter_reduce_count = 0;
+  iter_reduce_bytes = 0.0;
+
+  ParOptGetCacheStats(&cache_hits, &cache_misses);
+  iter_cache_hits = 0;
+  iter_cache_misses = 0;
+}
+
+/**
+  Start the timer for the given phase. If the phase is already active,
+  only the outermost call is timed.
+
+  @param phase the phase of the optimization
+*/
+void ParOptProfiler::start( ParOptProfilePhase phase ){
+  if (phase_depth[phase] == 0){
+    phase_start[phase] = MPI_Wtime();
+  }
+  phase_depth[phase]++;
+  phase_calls[phase]++;
+}
+
+/**
+  Stop the timer for the given phase
+
+  @param phase the phase of the optimization
+*/
+void ParOptProfiler::stop( ParOptProfilePhase phase ){
+  if (phase_depth[phase] > 0){
+    phase_depth[phase]--;
+    if (phase_depth[phase] == 0){
+      phase_time[phase] += MPI_Wtime() - phase_start[phase];
+    }
+  }
+}
+
+/**
+  Get the time spent in the phase, including the time elapsed so far
+  if the phase is active
+
+  @param phase the phase of the optimization
+  @return the wall time in seconds
+*/
+double ParOptProfiler::getTime( ParOptProfilePhase phase ){
+  if (phase_depth[phase] > 0){
+    return phase_time[phase] + (MPI_Wtime() - phase_start[phase]);
+  }
+  return phase_time[phase];
+}
+
+/**
+  Get the number of times that the phase was started
+
+  @param phase the phase of the optimization
+  @return the number of calls
+*/
+int ParOptProfiler::getCalls( ParOptProfilePhase phase ){
+  return phase_calls[phase];
+}
+
+/**
+  Get the reduction statistics since the last call to reset
+
+  @param count the number of reductions
+  @param bytes the number of bytes reduced
+  @param time the time spent in the reductions
+*/
+void ParOptProfiler::getReductionStats( int *count, double *bytes,
+                                        double *time ){
+  int c;
+  double b, t;
+  ParOptGetReductionStats(&c, &b, &t);
+  if (count){ *count = c - reduce_count; }
+  if (bytes){ *bytes = b - reduce_bytes; }
+  if (time){ *time = t - reduce_time; }
+}
+
+/**
+  Get the function evaluation cache statistics since the last call to
+  reset
+
+  @param hits the number of cache hits
+  @param misses the number of cache misses
+*/
+void ParOptProfiler::getCacheStats( int *hits, int *misses ){
+  int h, m;
+  ParOptGetCacheStats(&h, &m);
+  if (hits){ *hits = h - cache_hits; }
+  if (misses){ *misses = m - cache_misses; }
+}
+
+/**
+  Get the name of the phase
+
+  @param phase the phase of the optimization
+  @return the name of the phase (or NULL if the phase is invalid)
+*/
+const char *ParOptProfiler::getPhaseName( ParOptProfilePhase phase ){
+  if (phase >= 0 && phase < PAROPT_PROFILE_NUM_PHASES){
+    return paropt_profile_phase_names[phase];
+  }
+  return NULL;
+}
+
+/**
+  Print the time and number of calls for each phase that has been
+  active since the last call as a single line of name/value pairs.
+
+  @param fp the output file
+*/
+void ParOptProfiler::printIteration( FILE *fp ){
+  int count;
+  double bytes;
+  getReductionStats(&count, &bytes, NULL);
+
+  fprintf(fp, "      profile");
+  for ( int i = 0; i < PAROPT_PROFILE_NUM_PHASES; i++ ){
+    ParOptProfilePhase phase = (ParOptProfilePhase)i;
+    double t = getTime(phase);
+    int calls = phase_calls[i];
+    if (calls > iter_calls[i] || t > iter_time[i]){
+      fprintf(fp, " %s %9.3e %d", paropt_profile_phase_names[i],
+              t - iter_time[i], calls - iter_calls[i]);
+    }
+    iter_time[i] = t;
+    iter_calls[i] = calls;
+  }
+  fprintf(fp, " reduce %d %9.3e", count - iter_reduce_count,
+          bytes - iter_reduce_bytes);
+  iter_reduce_count = count;
+  iter_reduce_bytes = bytes;
+
+  // Only print the cache statistics when the cache is in use
+  int hits, misses;
+  getCacheStats(&hits, &misses);
+  if (hits > iter_cache_hits || misses > iter_cache_misses){
+    fprintf(fp, " cache %d %d", hits - iter_cache_hits,
+            misses - iter_cache_misses);
+  }
+  iter_cache_hits = hits;
+  iter_cache_misses = misses;
+  fprintf(fp, "\n");
+}
+
+/**
+  Print a summary table of the accumulated values
+
+  @param fp the output file
+*/
+void ParOptProfiler::printSummary( FILE *fp ){
+  double total = getTime(PAROPT_PROFILE_TOTAL);
+
+  fprintf(fp, "\nParOpt: Profile summary\n");
+  fprintf(fp, "%-15s %12s %8s %8s\n", "phase", "time", "calls", "percent");
+  for ( int i = 0; i < PAROPT_PROFILE_NUM_PHASES; i++ ){
+    ParOptProfilePhase phase = (ParOptProfilePhase)i;
+    double t = getTime(phase);
+    double percent = 0.0;
+    if (total > 0.0){
+      percent = 100.0*t/total;
+    }
+    fprintf(fp, "%-15s %12.5e %8d %8.2f\n", paropt_profile_phase_names[i],
+            t, phase_calls[i], percent);
+  }
+
+  int count;
+  double bytes, time;
+  getReductionStats(&count, &bytes, &time);
+  fprintf(fp, "%-15s %12.5e %8d %8s bytes: %12.5e\n", "reduce",
+          time, count, "", bytes);
+
+  int hits, misses;
+  getCacheStats(&hits, &misses);
+  if (hits > 0 || misses > 0){
+    fprintf(fp, "%-15s %12s %8d %8s misses: %d\n", "cache_hits",
+            "", hits, "", misses);
+  }
+
+  double vec_bytes, vec_peak;
+  ParOptGetVecMemoryStats(&vec_bytes, &vec_peak);
+  fprintf(fp, "%-15s %12.5e %8s %8s peak: %12.5e\n", "vec_bytes",
+          vec_bytes, "", "", vec_peak);
+}
@@ -0,0 +1,102 @@
+#ifndef PAR_OPT_PROFILER_H
+#define PAR_OPT_PROFILER_H
+
+#include <stdio.h>
+#include "ParOptVec.h"
+
+/*
+  The phases of an optimization that are timed by the profiler.
+
+  The phases may be nested within one another. For instance, the
+  function evaluations within the line search are recorded in both
+  the line search and the function evaluation phases. As a result,
+  the phase times are inclusive and do not sum to the total time.
+*/
+enum ParOptProfilePhase { PAROPT_PROFILE_TOTAL,
+                          PAROPT_PROFILE_EVAL_OBJ_CON,
+                          PAROPT_PROFILE_EVAL_GRADIENT,
+                          PAROPT_PROFILE_EVAL_HVEC,
+                          PAROPT_PROFILE_KKT_SETUP,
+                          PAROPT_PROFILE_KKT_SOLVE,
+                          PAROPT_PROFILE_KRYLOV,
+                          PAROPT_PROFILE_QN_UPDATE,
+                          PAROPT_PROFILE_LINE_SEARCH,
+                          PAROPT_PROFILE_SUBPROBLEM,
+                          PAROPT_PROFILE_OUTPUT,
+                          PAROPT_PROFILE_NUM_PHASES };
+
+/*
+  Wrappers for the reductions performed within ParOpt. These record
+  the number of reductions, the number of bytes reduced and the time
+  spent in the reductions on this processor.
+*/
+int ParOptAllreduce( const void *sendbuf, void *recvbuf, int count,
+                     MPI_Datatype datatype, MPI_Op op, MPI_Comm comm );
+int ParOptIallreduce( const void *sendbuf, void *recvbuf, int count,
+                      MPI_Datatype datatype, MPI_Op op, MPI_Comm comm,
+                      MPI_Request *request );
+void ParOptGetReductionStats( int *count, double *bytes, double *time );
+
+/*
+  Record the hits and misses of the function evaluation cache
+  (ParOptCachedProblem) on this processor
+*/
+void ParOptRecordCacheAccess( int hit );
+void ParOptGetCacheStats( int *hits, int *misses );
+
+/*
+  Record the wall time and the number of calls for each phase of the
+  optimization, along with the reductions performed since the last
+  call to reset().
+
+  All of the values are local to the processor.
+*/
+class ParOptProfiler : public ParOptBase {
+ public:
+  ParOptProfiler();
+
+  // Reset all of the timers and counters
+  void reset();
+
+  // Start/stop the timer for a phase
+  void start( ParOptProfilePhase phase );
+  void stop( ParOptProfilePhase phase );
+
+  // Retrieve the accumulated values
+  double getTime( ParOptProfilePhase phase );
+  int getCalls( ParOptProfilePhase phase );
+  void getReductionStats( int *count, double *bytes, double *time );
+  void getCacheStats( int *hits, int *misses );
+  static const char *getPhaseName( ParOptProfilePhase phase );
+
+  // Print the values accumulated since the last call to printIteration
+  void printIteration( FILE *fp );
+
+  // Print a summary of all the accumulated values
+  void printSummary( FILE *fp );
+
+ private:
+  // The accumulated time and number of calls for each phase
+  double phase_time[PAROPT_PROFILE_NUM_PHASES];
+  int phase_calls[PAROPT_PROFILE_NUM_PHASES];
+
+  // The start time and the nesting depth of active phases
+  double phase_start[PAROPT_PROFILE_NUM_PHASES];
+  int phase_depth[PAROPT_PROFILE_NUM_PHASES];
+
+  // The values at the last call to printIteration
+  double iter_time[PAROPT_PROFILE_NUM_PHASES];
+  int iter_calls[PAROPT_PROFILE_NUM_PHASES];
+  int iter_reduce_count;
+  double iter_reduce_bytes;
+  int iter_cache_hits, iter_cache_misses;
+
+  // The reduction statistics at the last call to reset
+  int reduce_count;
+  double reduce_bytes, reduce_time;
+
+  // The cache statistics at the last call to reset
+  int cache_hits, cache_misses;
+};
+
+#endif // PAR_OPT_PROFILER_H
@@ -2,6 +2,7 @@
 #include "ParOptQuasiNewton.h"
 #include "ParOptComplexStep.h"
 #include "ParOptBlasLapack.h"
+#include "ParOptActiveSet.h"
 
 /**
   The following class implements the limited-memory BFGS update.
@@ -24,15 +25,25 @@ ParOptLBFGS::ParOptLBFGS( ParOptProblem *prob,
   hessian_update_type = PAROPT_SKIP_NEGATIVE_CURVATURE;
   epsilon_precision = 1e-12;
 
+  // Set the communicator for the batched reductions
+  comm = prob->getMPIComm();
+
+  // Allocate contiguous storage for the S/Y pairs
+  SYvecs = prob->createDesignMultiVec(2*msub_max);
+  SYvecs->incref();
+  slot = new int[ msub_max ];
+  rsy = new ParOptScalar[ 2*msub_max ];
+
   // Allocate space for the vectors
   S = new ParOptVec*[ msub_max ];
   Y = new ParOptVec*[ msub_max ];
   Z = new ParOptVec*[ 2*msub_max ];
 
   for ( int i = 0; i < msub_max; i++ ){
-    S[i] = prob->createDesignVec();
+    slot[i] = i;
+    S[i] = SYvecs->getVec(2*i);
     S[i]->incref();
-    Y[i] = prob->createDesignVec();
+    Y[i] = SYvecs->getVec(2*i+1);
     Y[i]->incref();
   }
 
@@ -81,6 +92,9 @@ ParOptLBFGS::~ParOptLBFGS(){
     S[i]->decref();
   }
   r->decref();
+  SYvecs->decref();
+  delete [] slot;
+  delete [] rsy;
 
   delete [] S;
   delete [] Y;
@@ -123,6 +137,18 @@ void ParOptLBFGS::reset(){
   msub = 0;
   b0 = 1.0;
 
+  // Restore the original ordering of the storage slots so that the
+  // stored pairs always occupy the leading columns of SYvecs
+  for ( int i = 0; i < msub_max; i++ ){
+    S[i]->decref();
+    Y[i]->decref();
+    slot[i] = i;
+    S[i] = SYvecs->getVec(2*i);
+    S[i]->incref();
+    Y[i] = SYvecs->getVec(2*i+1);
+    Y[i]->incref();
+  }
+
   // Zero the initial values of everything
   memset(d0, 0, 2*msub_max*sizeof(ParOptScalar));
   memset(rz, 0, 2*msub_max*sizeof(ParOptScalar));
@@ -158,10 +184,15 @@ int ParOptLBFGS::update( ParOptVec *x, const ParOptScalar *z,
   ParOptVec *new_y = NULL;
 
   // Compute dot products that are required for the matrix
-  // updating scheme
-  ParOptScalar yTy = y->dot(y);
-  ParOptScalar sTy = s->dot(y);
-  ParOptScalar sTs = s->dot(s);
+  // updating scheme with a single reduction
+  ParOptReductionContext ctx(comm);
+  int hyy = ctx.addDot(y, y);
+  int hsy = ctx.addDot(s, y);
+  int hss = ctx.addDot(s, s);
+  ctx.reduce();
+  ParOptScalar yTy = ctx.getScalar(hyy);
+  ParOptScalar sTy = ctx.getScalar(hsy);
+  ParOptScalar sTs = ctx.getScalar(hss);
 
   if (hessian_update_type == PAROPT_SKIP_NEGATIVE_CURVATURE){
     // Check if we should skip the update
@@ -209,18 +240,27 @@ int ParOptLBFGS::update( ParOptVec *x, const ParOptScalar *z,
       ParOptScalar theta = 0.8*sTBs/(sTBs - sTy);
 
       // Compute r = theta*y + (1 - theta)*B*s
-      r->scale(1.0 - theta);
-      r->axpy(theta, y);
+      r->axpby(theta, 1.0 - theta, y);
 
       new_y = r;
-      yTy = new_y->dot(new_y);
-      sTy = s->dot(new_y);
+      ctx.reset();
+      hyy = ctx.addDot(new_y, new_y);
+      hsy = ctx.addDot(s, new_y);
+      ctx.reduce();
+      yTy = ctx.getScalar(hyy);
+      sTy = ctx.getScalar(hsy);
     }
 
     // Set the new value of b0
     b0 = yTy/sTy;
   }
 
+  // Compute the products of s with all of the stored pairs in a
+  // single pass before the new pair is copied into storage. The
+  // values are in the storage ordering: rsy[2*slot[i]] = s^{T}*S[i]
+  // and rsy[2*slot[i]+1] = s^{T}*Y[i].
+  SYvecs->mdot(s, 2*msub, rsy);
+
   // Set up the new values
   if (msub < msub_max){
     S[msub]->copyValues(s);
@@ -233,15 +273,18 @@ int ParOptLBFGS::update( ParOptVec *x, const ParOptScalar *z,
     S[0]->copyValues(s);
     Y[0]->copyValues(new_y);
 
-    // Shift the pointers
+    // Shift the pointers and the corresponding storage slots
     ParOptVec *stemp = S[0];
     ParOptVec *ytemp = Y[0];
+    int slot_temp = slot[0];
     for ( int i = 0; i < msub-1; i++ ){
       S[i] = S[i+1];
       Y[i] = Y[i+1];
+      slot[i] = slot[i+1];
     }
     S[msub-1] = stemp;
     Y[msub-1] = ytemp;
+    slot[msub-1] = slot_temp;
 
     // Now, shift the values in the matrices
     for ( int i = 0; i < msub-1; i++ ){
@@ -261,24 +304,37 @@ int ParOptLBFGS::update( ParOptVec *x, const ParOptScalar *z,
     }
   }
 
-  // Update the matrices required for the limited-memory update.
-  // Update the S^{T}S matrix:
-  for ( int i = 0; i < msub; i++ ){
-    B[msub-1 + i*msub_max] = S[msub-1]->dot(S[i]);
+  // Update the matrices required for the limited-memory update. Only
+  // the new row and column are required since the remaining entries
+  // are retained from the previous updates. Update the S^{T}S matrix:
+  for ( int i = 0; i < msub-1; i++ ){
+    B[msub-1 + i*msub_max] = rsy[2*slot[i]];
     B[i + (msub-1)*msub_max] = B[msub-1 + i*msub_max];
   }
 
-  // Update the diagonal D-matrix
+  // Update the diagonal entries of B and the D-matrix
   if (msub > 0){
-    D[msub-1] = S[msub-1]->dot(Y[msub-1]);
+    B[msub-1 + (msub-1)*msub_max] = sTs;
+    D[msub-1] = sTy;
   }
 
   // By definition, we have the L matrix:
   // For j < i: L[i + j*msub_max] = S[i]->dot(Y[j]);
   for ( int i = 0; i < msub-1; i++ ){
-    L[msub-1 + i*msub_max] = S[msub-1]->dot(Y[i]);
+    L[msub-1 + i*msub_max] = rsy[2*slot[i]+1];
   }
 
+  // Form and factor the M-matrix
+  factorCompactMat();
+
+  return update_type;
+}
+
+/**
+  Form the M-matrix from the stored components B, L and D, set the
+  diagonal scaling and the Z vectors, and factor the M-matrix.
+*/
+void ParOptLBFGS::factorCompactMat(){
   // Set the values into the M-matrix
   memset(M, 0, 4*msub*msub*sizeof(ParOptScalar));
 
@@ -321,8 +377,6 @@ int ParOptLBFGS::update( ParOptVec *x, const ParOptScalar *z,
     int n = 2*msub, info = 0;
     LAPACKdgetrf(&n, &n, M_factor, &n, mfpiv, &info);
   }
-
-  return update_type;
 }
 
 /**
@@ -338,16 +392,17 @@ int ParOptLBFGS::update( ParOptVec *x, const ParOptScalar *z,
 */
 void ParOptLBFGS::mult( ParOptVec *x, ParOptVec *y ){
   // Set y = b0*x
-  y->copyValues(x);
-  y->scale(b0);
+  y->axpby(b0, 0.0, x);
 
   if (msub > 0){
-    // Compute rz = Z^{T}*x
-    x->mdot(Z, 2*msub, rz);
+    // Compute the products with the stored pairs in the storage
+    // order. The stored pairs occupy the leading 2*msub columns.
+    SYvecs->mdot(x, 2*msub, rsy);
 
-    // Set rz *= d0
-    for ( int i = 0; i < 2*msub; i++ ){
-      rz[i] *= d0[i];
+    // Set rz = diag{d0}*Z^{T}*x
+    for ( int i = 0; i < msub; i++ ){
+      rz[i] = d0[i]*rsy[2*slot[i]];
+      rz[i+msub] = d0[i+msub]*rsy[2*slot[i]+1];
     }
 
     // Solve rz = M^{-1}*rz
@@ -356,15 +411,14 @@ void ParOptLBFGS::mult( ParOptVec *x, ParOptVec *y ){
                  M_factor, &n, mfpiv,
                  rz, &n, &info);
 
-    // Compute rz *= d0
-    for ( int i = 0; i < 2*msub; i++ ){
-      rz[i] *= d0[i];
+    // Set the coefficients -diag{d0}*rz in the storage order
+    for ( int i = 0; i < msub; i++ ){
+      rsy[2*slot[i]] = -d0[i]*rz[i];
+      rsy[2*slot[i]+1] = -d0[i+msub]*rz[i+msub];
     }
 
-    // Now compute: y <- Z*rz
-    for ( int i = 0; i < 2*msub; i++ ){
-      y->axpy(-rz[i], Z[i]);
-    }
+    // Now compute: y <- y + Z*rsy in a single pass
+    SYvecs->maxpy(2*msub, rsy, y);
   }
 }
 
@@ -385,12 +439,14 @@ void ParOptLBFGS::multAdd( ParOptScalar alpha, ParOptVec *x, ParOptVec *y ){
   y->axpy(b0*alpha, x);
 
   if (msub > 0){
-    // Compute rz = Z^{T}*x
-    x->mdot(Z, 2*msub, rz);
+    // Compute the products with the stored pairs in the storage
+    // order. The stored pairs occupy the leading 2*msub columns.
+    SYvecs->mdot(x, 2*msub, rsy);
 
-    // Set rz *= d0
-    for ( int i = 0; i < 2*msub; i++ ){
-      rz[i] *= d0[i];
+    // Set rz = diag{d0}*Z^{T}*x
+    for ( int i = 0; i < msub; i++ ){
+      rz[i] = d0[i]*rsy[2*slot[i]];
+      rz[i+msub] = d0[i+msub]*rsy[2*slot[i]+1];
     }
 
     // Solve rz = M^{-1}*rz
@@ -399,15 +455,14 @@ void ParOptLBFGS::multAdd( ParOptScalar alpha, ParOptVec *x, ParOptVec *y ){
                  M_factor, &n, mfpiv,
                  rz, &n, &info);
 
-    // Compute rz *= d0
-    for ( int i = 0; i < 2*msub; i++ ){
-      rz[i] *= d0[i];
+    // Set the coefficients -alpha*diag{d0}*rz in the storage order
+    for ( int i = 0; i < msub; i++ ){
+      rsy[2*slot[i]] = -alpha*d0[i]*rz[i];
+      rsy[2*slot[i]+1] = -alpha*d0[i+msub]*rz[i+msub];
     }
 
-    // Now compute: y <- Z*rz
-    for ( int i = 0; i < 2*msub; i++ ){
-      y->axpy(-alpha*rz[i], Z[i]);
-    }
+    // Now compute: y <- y + Z*rsy in a single pass
+    SYvecs->maxpy(2*msub, rsy, y);
   }
 }
 
@@ -433,6 +488,148 @@ int ParOptLBFGS::getCompactMat( ParOptScalar *_b0,
   return 2*msub;
 }
 
+/*
+  Identifiers for the type of approximation stored in the state
+*/
+static const int PAROPT_LBFGS_STATE = 1;
+static const int PAROPT_LSR1_STATE = 2;
+
+/**
+  Get the size of the state of the limited-memory BFGS approximation.
+
+  The scalar values consist of the type identifier, the maximum and
+  current subspace sizes, b0 and the D, B and L matrices. The vectors
+  are the stored S/Y pairs.
+
+  @param nvals the number of scalar values
+  @param nvecs the number of design vectors
+*/
+void ParOptLBFGS::getStateSize( int *nvals, int *nvecs ){
+  *nvals = 4 + msub_max + 2*msub_max*msub_max;
+  *nvecs = 2*msub;
+}
+
+/**
+  Copy the state of the limited-memory BFGS approximation
+
+  @param vals the scalar values defining the state
+  @param vecs the S/Y pairs ordered as S[0], Y[0], S[1], Y[1], ...
+*/
+void ParOptLBFGS::getState( ParOptScalar *vals, ParOptVec **vecs ){
+  vals[0] = PAROPT_LBFGS_STATE;
+  vals[1] = msub_max;
+  vals[2] = msub;
+  vals[3] = b0;
+  memcpy(&vals[4], D, msub_max*sizeof(ParOptScalar));
+  memcpy(&vals[4 + msub_max], B, msub_max*msub_max*sizeof(ParOptScalar));
+  memcpy(&vals[4 + msub_max + msub_max*msub_max], L,
+         msub_max*msub_max*sizeof(ParOptScalar));
+
+  for ( int i = 0; i < msub; i++ ){
+    vecs[2*i] = S[i];
+    vecs[2*i+1] = Y[i];
+  }
+}
+
+/**
+  Restore the state of the limited-memory BFGS approximation
+
+  @param vals the scalar values defining the state
+  @param vecs the S/Y pairs ordered as S[0], Y[0], S[1], Y[1], ...
+  @return non-zero if the state is incompatible with this object
+*/
+int ParOptLBFGS::setState( const ParOptScalar *vals, ParOptVec **vecs ){
+  int msize = (int)ParOptRealPart(vals[1]);
+  int m = (int)ParOptRealPart(vals[2]);
+  if ((int)ParOptRealPart(vals[0]) != PAROPT_LBFGS_STATE ||
+      msize != msub_max || m < 0 || m > msub_max){
+    return 1;
+  }
+
+  reset();
+  msub = m;
+  b0 = vals[3];
+  memcpy(D, &vals[4], msub_max*sizeof(ParOptScalar));
+  memcpy(B, &vals[4 + msub_max], msub_max*msub_max*sizeof(ParOptScalar));
+  memcpy(L, &vals[4 + msub_max + msub_max*msub_max],
+         msub_max*msub_max*sizeof(ParOptScalar));
+
+  for ( int i = 0; i < msub; i++ ){
+    S[i]->copyValues(vecs[2*i]);
+    Y[i]->copyValues(vecs[2*i+1]);
+  }
+
+  factorCompactMat();
+
+  return 0;
+}
+
+/**
+  Recompute the matrices B, L and D from the stored S/Y pairs. The
+  products with each pair are computed with a single reduction.
+*/
+void ParOptLBFGS::computeInnerProducts(){
+  for ( int i = 0; i < msub; i++ ){
+    SYvecs->mdot(S[i], 2*msub, rsy);
+
+    for ( int j = 0; j < msub; j++ ){
+      B[i + j*msub_max] = rsy[2*slot[j]];
+    }
+    for ( int j = 0; j < i; j++ ){
+      L[i + j*msub_max] = rsy[2*slot[j]+1];
+    }
+    D[i] = rsy[2*slot[i]+1];
+  }
+}
+
+/**
+  Compress the stored vectors to the free variables of the active set.
+
+  The pairs restricted to the free variables define the approximation
+  of the reduced Hessian, so the inner products are recomputed. If
+  any of the restricted pairs violates the curvature condition, the
+  approximation is reset.
+
+  @param active the active set index map
+  @return non-zero if the vectors could not be compressed
+*/
+int ParOptLBFGS::compressVectors( ParOptActiveSet *active ){
+  if (SYvecs->compressEntries(active)){
+    return 1;
+  }
+  if (r->compressEntries(active)){
+    SYvecs->expandEntries(active);
+    return 1;
+  }
+
+  computeInnerProducts();
+  for ( int i = 0; i < msub; i++ ){
+    if (ParOptRealPart(D[i]) <=
+        epsilon_precision*ParOptRealPart(B[i + i*msub_max])){
+      reset();
+      return 0;
+    }
+  }
+  factorCompactMat();
+
+  return 0;
+}
+
+/**
+  Expand the stored vectors to the full set of variables. The fixed
+  entries of the pairs are set to zero, so the inner products and the
+  M-matrix are unchanged.
+
+  @param active the active set index map used to compress the vectors
+  @param zeros an array of zeros for the fixed entries
+  @return non-zero if the vectors could not be expanded
+*/
+int ParOptLBFGS::expandVectors( ParOptActiveSet *active,
+                                const ParOptScalar *zeros ){
+  return (SYvecs->expandEntries(active, zeros) ||
+          r->expandEntries(active, zeros));
+}
+
 /**
   The following class implements the limited-memory SR1 update.
 
@@ -449,17 +646,23 @@ ParOptLSR1::ParOptLSR1( ParOptProblem *prob, int _msub_max ){
 
   b0 = 1.0;
 
+  // Allocate contiguous storage for the vectors
+  SYvecs = prob->createDesignMultiVec(2*msub_max);
+  SYvecs->incref();
+  Zvecs = prob->createDesignMultiVec(msub_max);
+  Zvecs->incref();
+
   // Allocate space for the vectors
   S = new ParOptVec*[ msub_max ];
   Y = new ParOptVec*[ msub_max ];
   Z = new ParOptVec*[ msub_max ];
 
   for ( int i = 0; i < msub_max; i++ ){
-    S[i] = prob->createDesignVec();
+    S[i] = SYvecs->getVec(2*i);
     S[i]->incref();
-    Y[i] = prob->createDesignVec();
+    Y[i] = SYvecs->getVec(2*i+1);
     Y[i]->incref();
-    Z[i] = prob->createDesignVec();
+    Z[i] = Zvecs->getVec(i);
     Z[i]->incref();
   }
 
@@ -509,6 +712,8 @@ ParOptLSR1::~ParOptLSR1(){
     Z[i]->decref();
   }
   r->decref();
+  SYvecs->decref();
+  Zvecs->decref();
 
   delete [] S;
   delete [] Y;
@@ -632,6 +837,17 @@ int ParOptLSR1::update( ParOptVec *x, const ParOptScalar *z,
     L[msub-1 + i*msub_max] = S[msub-1]->dot(Y[i]);
   }
 
+  // Form and factor the M-matrix
+  factorCompactMat();
+
+  return update_type;
+}
+
+/**
+  Form the M-matrix from the stored components B, L and D, set the Z
+  vectors, and factor the M-matrix.
+*/
+void ParOptLSR1::factorCompactMat(){
   // Set the values into the M-matrix
   memset(M, 0, msub*msub*sizeof(ParOptScalar));
 
@@ -655,8 +871,7 @@ int ParOptLSR1::update( ParOptVec *x, const ParOptScalar *z,
 
   // Set the new values of the Z-vectors
   for ( int i = 0; i < msub; i++ ){
-    Z[i]->copyValues(Y[i]);
-    Z[i]->axpy(-b0, S[i]);
+    Z[i]->waxpy(-b0, S[i], Y[i]);
 
     d0[i] = 1.0;
   }
@@ -669,8 +884,6 @@ int ParOptLSR1::update( ParOptVec *x, const ParOptScalar *z,
     int n = msub, info = 0;
     LAPACKdgetrf(&n, &n, M_factor, &n, mfpiv, &info);
   }
-
-  return update_type;
 }
 
 /**
@@ -686,12 +899,11 @@ int ParOptLSR1::update( ParOptVec *x, const ParOptScalar *z,
 */
 void ParOptLSR1::mult( ParOptVec *x, ParOptVec *y ){
   // Set y = b0*x
-  y->copyValues(x);
-  y->scale(b0);
+  y->axpby(b0, 0.0, x);
 
   if (msub > 0){
     // Compute rz = Z^{T}*x
-    x->mdot(Z, msub, rz);
+    Zvecs->mdot(x, msub, rz);
 
     // Solve rz = M^{-1}*rz
     int n = msub, one = 1, info = 0;
@@ -699,10 +911,11 @@ void ParOptLSR1::mult( ParOptVec *x, ParOptVec *y ){
                  M_factor, &n, mfpiv,
                  rz, &n, &info);
 
-    // Now compute: y <- Z*rz
+    // Now compute: y <- y - Z*rz in a single pass
     for ( int i = 0; i < msub; i++ ){
-      y->axpy(-rz[i], Z[i]);
+      rz[i] = -rz[i];
     }
+    Zvecs->maxpy(msub, rz, y);
   }
 }
 
@@ -724,7 +937,7 @@ void ParOptLSR1::multAdd( ParOptScalar alpha, ParOptVec *x, ParOptVec *y ){
 
   if (msub > 0){
     // Compute rz = Z^{T}*x
-    x->mdot(Z, msub, rz);
+    Zvecs->mdot(x, msub, rz);
 
     // Solve rz = M^{-1}*rz
     int n = msub, one = 1, info = 0;
@@ -732,10 +945,11 @@ void ParOptLSR1::multAdd( ParOptScalar alpha, ParOptVec *x, ParOptVec *y ){
                  M_factor, &n, mfpiv,
                  rz, &n, &info);
 
-    // Now compute: y <- Z*rz
+    // Now compute: y <- y - alpha*Z*rz in a single pass
     for ( int i = 0; i < msub; i++ ){
-      y->axpy(-alpha*rz[i], Z[i]);
+      rz[i] = -alpha*rz[i];
     }
+    Zvecs->maxpy(msub, rz, y);
   }
 }
 
@@ -760,3 +974,133 @@ int ParOptLSR1::getCompactMat( ParOptScalar *_b0,
 
   return msub;
 }
+
+/**
+  Get the size of the state of the limited-memory SR1 approximation.
+
+  The layout is the same as the limited-memory BFGS state.
+
+  @param nvals the number of scalar values
+  @param nvecs the number of design vectors
+*/
+void ParOptLSR1::getStateSize( int *nvals, int *nvecs ){
+  *nvals = 4 + msub_max + 2*msub_max*msub_max;
+  *nvecs = 2*msub;
+}
+
+/**
+  Copy the state of the limited-memory SR1 approximation
+
+  @param vals the scalar values defining the state
+  @param vecs the S/Y pairs ordered as S[0], Y[0], S[1], Y[1], ...
+*/
+void ParOptLSR1::getState( ParOptScalar *vals, ParOptVec **vecs ){
+  vals[0] = PAROPT_LSR1_STATE;
+  vals[1] = msub_max;
+  vals[2] = msub;
+  vals[3] = b0;
+  memcpy(&vals[4], D, msub_max*sizeof(ParOptScalar));
+  memcpy(&vals[4 + msub_max], B, msub_max*msub_max*sizeof(ParOptScalar));
+  memcpy(&vals[4 + msub_max + msub_max*msub_max], L,
+         msub_max*msub_max*sizeof(ParOptScalar));
+
+  for ( int i = 0; i < msub; i++ ){
+    vecs[2*i] = S[i];
+    vecs[2*i+1] = Y[i];
+  }
+}
+
+/**
+  Restore the state of the limited-memory SR1 approximation
+
+  @param vals the scalar values defining the state
+  @param vecs the S/Y pairs ordered as S[0], Y[0], S[1], Y[1], ...
+  @return non-zero if the state is incompatible with this object
+*/
+int ParOptLSR1::setState( const ParOptScalar *vals, ParOptVec **vecs ){
+  int msize = (int)ParOptRealPart(vals[1]);
+  int m = (int)ParOptRealPart(vals[2]);
+  if ((int)ParOptRealPart(vals[0]) != PAROPT_LSR1_STATE ||
+      msize != msub_max || m < 0 || m > msub_max){
+    return 1;
+  }
+
+  reset();
+  msub = m;
+  b0 = vals[3];
+  memcpy(D, &vals[4], msub_max*sizeof(ParOptScalar));
+  memcpy(B, &vals[4 + msub_max], msub_max*msub_max*sizeof(ParOptScalar));
+  memcpy(L, &vals[4 + msub_max + msub_max*msub_max],
+         msub_max*msub_max*sizeof(ParOptScalar));
+
+  for ( int i = 0; i < msub; i++ ){
+    S[i]->copyValues(vecs[2*i]);
+    Y[i]->copyValues(vecs[2*i+1]);
+  }
+
+  factorCompactMat();
+
+  return 0;
+}
+
+/**
+  Recompute the matrices B, L and D from the stored S/Y pairs
+*/
+void ParOptLSR1::computeInnerProducts(){
+  ParOptScalar *sprod = new ParOptScalar[ 2*msub ];
+  for ( int i = 0; i < msub; i++ ){
+    S[i]->mdot(S, msub, sprod);
+    S[i]->mdot(Y, msub, &sprod[msub]);
+
+    for ( int j = 0; j < msub; j++ ){
+      B[i + j*msub_max] = sprod[j];
+    }
+    for ( int j = 0; j < i; j++ ){
+      L[i + j*msub_max] = sprod[msub + j];
+    }
+    D[i] = sprod[msub + i];
+  }
+  delete [] sprod;
+}
+
+/**
+  Compress the stored vectors to the free variables of the active set
+  and recompute the approximation from the restricted pairs
+
+  @param active the active set index map
+  @return non-zero if the vectors could not be compressed
+*/
+int ParOptLSR1::compressVectors( ParOptActiveSet *active ){
+  if (SYvecs->compressEntries(active)){
+    return 1;
+  }
+  if (Zvecs->compressEntries(active)){
+    SYvecs->expandEntries(active);
+    return 1;
+  }
+  if (r->compressEntries(active)){
+    SYvecs->expandEntries(active);
+    Zvecs->expandEntries(active);
+    return 1;
+  }
+
+  computeInnerProducts();
+  factorCompactMat();
+
+  return 0;
+}
+
+/**
+  Expand the stored vectors to the full set of variables. The fixed
+  entries are set to zero, so the approximation is unchanged.
+
+  @param active the active set index map used to compress the vectors
+  @param zeros an array of zeros for the fixed entries
+  @return non-zero if the vectors could not be expanded
+*/
+int ParOptLSR1::expandVectors( ParOptActiveSet *active,
+                               const ParOptScalar *zeros ){
+  return (SYvecs->expandEntries(active, zeros) ||
+          Zvecs->expandEntries(active, zeros) ||
+          r->expandEntries(active, zeros));
+}
@@ -45,6 +45,38 @@ class ParOptCompactQuasiNewton : public ParOptBase {
 
   // Get the maximum size of the compact representation
   virtual int getMaxLimitedMemorySize() = 0;
+
+  // Get the number of scalar values and design vectors required to
+  // store the state of the approximation in a checkpoint file. The
+  // default implementation has no state to store.
+  virtual void getStateSize( int *nvals, int *nvecs ){
+    *nvals = 0;
+    *nvecs = 0;
+  }
+
+  // Copy the scalar values defining the state and retrieve the
+  // design vectors (these must not be modified)
+  virtual void getState( ParOptScalar *vals, ParOptVec **vecs ){}
+
+  // Restore the state of the approximation from the scalar values
+  // and design vectors stored by getState(). Non-zero on failure.
+  virtual int setState( const ParOptScalar *vals, ParOptVec **vecs ){
+    return 1;
+  }
+
+  // Compress the stored vectors to the free variables of an active
+  // set, or expand them back to the full set of variables. The fixed
+  // entries are set from the zeros array (at least as long as the
+  // number of fixed variables), so that no temporary is needed. The
+  // default implementation does not support compression and returns
+  // non-zero.
+  virtual int compressVectors( ParOptActiveSet *active ){
+    return 1;
+  }
+  virtual int expandVectors( ParOptActiveSet *active,
+                             const ParOptScalar *zeros ){
+    return 1;
+  }
 };
 
 /**
@@ -93,13 +125,31 @@ class ParOptLBFGS : public ParOptCompactQuasiNewton {
   // Get the maximum size of the limited-memory BFGS
   int getMaxLimitedMemorySize();
 
+  // Store and restore the state of the approximation
+  void getStateSize( int *nvals, int *nvecs );
+  void getState( ParOptScalar *vals, ParOptVec **vecs );
+  int setState( const ParOptScalar *vals, ParOptVec **vecs );
+
+  // Compress/expand the stored vectors with the active set index map
+  int compressVectors( ParOptActiveSet *active );
+  int expandVectors( ParOptActiveSet *active, const ParOptScalar *zeros );
+
  protected:
+  // Form and factor the M-matrix from the stored components
+  void factorCompactMat();
+
+  // Recompute the inner products of the stored S/Y pairs
+  void computeInnerProducts();
+
   // Store the type of curvature handling update
   ParOptBFGSUpdateType hessian_update_type;
 
   // Set the finite-precision tolerance
   double epsilon_precision;
 
+  // The communicator for the batched reductions
+  MPI_Comm comm;
+
   // The size of the BFGS subspace
   int msub, msub_max;
 
@@ -114,6 +164,12 @@ class ParOptLBFGS : public ParOptCompactQuasiNewton {
   ParOptVec **S, **Y;
   ParOptScalar b0; // The diagonal scalar
 
+  // Contiguous storage for the S/Y pairs. The pair in storage slot k
+  // occupies the columns 2*k and 2*k+1 of the block.
+  ParOptMultiVec *SYvecs;
+  int *slot; // The storage slot for each S/Y pair
+  ParOptScalar *rsy; // Temporary vector in the storage ordering
+
   // The M-matrix
   ParOptScalar *M, *M_factor;
   int *mfpiv; // The pivot array for the M-factorization
@@ -162,7 +218,22 @@ class ParOptLSR1 : public ParOptCompactQuasiNewton {
   // Get the maximum size of the limited-memory BFGS
   int getMaxLimitedMemorySize();
 
+  // Store and restore the state of the approximation
+  void getStateSize( int *nvals, int *nvecs );
+  void getState( ParOptScalar *vals, ParOptVec **vecs );
+  int setState( const ParOptScalar *vals, ParOptVec **vecs );
+
+  // Compress/expand the stored vectors with the active set index map
+  int compressVectors( ParOptActiveSet *active );
+  int expandVectors( ParOptActiveSet *active, const ParOptScalar *zeros );
+
  protected:
+  // Form and factor the M-matrix from the stored components
+  void factorCompactMat();
+
+  // Recompute the inner products of the stored S/Y pairs
+  void computeInnerProducts();
+
   // The size of the BFGS subspace
   int msub, msub_max;
 
@@ -177,6 +248,9 @@ class ParOptLSR1 : public ParOptCompactQuasiNewton {
   ParOptVec **S, **Y;
   ParOptScalar b0; // The diagonal scalar
 
+  // Contiguous storage for the S/Y pairs and the Z vectors
+  ParOptMultiVec *SYvecs, *Zvecs;
+
   // The M-matrix
   ParOptScalar *M, *M_factor;
   int *mfpiv; // The pivot array for the M-factorization
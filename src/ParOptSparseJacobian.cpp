@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <string.h>
+#include "ParOptSparseJacobian.h"
+
+/**
+  Create the sparse Jacobian with the given block non-zero pattern
+
+  @param nrows the number of local sparse constraints
+  @param ncols the number of local design variables
+  @param rbsize the number of rows in each block
+  @param cbsize the number of columns in each block
+  @param rowp pointer into cols for each block row
+  @param cols the block column indices
+  @param vals the initial values of the blocks (may be NULL)
+*/
+ParOptSparseJacobian::ParOptSparseJacobian( int _nrows, int _ncols,
+                                            int _rbsize, int _cbsize,
+                                            const int *_rowp,
+                                            const int *_cols,
+                                            const ParOptScalar *_vals ){
+  nrows = _nrows;
+  ncols = _ncols;
+  rbsize = (_rbsize > 0 ? _rbsize : 1);
+  cbsize = (_cbsize > 0 ? _cbsize : 1);
+  nbrows = nrows/rbsize;
+  nbcols = ncols/cbsize;
+
+  if (nrows % rbsize != 0 || ncols % cbsize != 0){
+    fprintf(stderr, "ParOptSparseJacobian: Matrix dimensions %d x %d "
+            "are not divisible by the block size %d x %d\n",
+            nrows, ncols, rbsize, cbsize);
+  }
+
+  // Copy the non-zero pattern
+  rowp = new int[ nbrows+1 ];
+  memcpy(rowp, _rowp, (nbrows+1)*sizeof(int));
+  int nnz = rowp[nbrows];
+  cols = new int[ nnz ];
+  memcpy(cols, _cols, nnz*sizeof(int));
+
+  // Sort the column indices within each block row, recording the
+  // permutation only if the input was not already sorted
+  perm = NULL;
+  for ( int i = 0; i < nbrows; i++ ){
+    for ( int jp = rowp[i]+1; jp < rowp[i+1]; jp++ ){
+      if (cols[jp] < cols[jp-1]){
+        perm = new int[ nnz ];
+        break;
+      }
+    }
+    if (perm){
+      break;
+    }
+  }
+
+  if (perm){
+    for ( int k = 0; k < nnz; k++ ){
+      perm[k] = k;
+    }
+    for ( int i = 0; i < nbrows; i++ ){
+      for ( int jp = rowp[i]+1; jp < rowp[i+1]; jp++ ){
+        int col = cols[jp];
+        int p = perm[jp];
+        int kp = jp;
+        while (kp > rowp[i] && cols[kp-1] > col){
+          cols[kp] = cols[kp-1];
+          perm[kp] = perm[kp-1];
+          kp--;
+        }
+        cols[kp] = col;
+        perm[kp] = p;
+      }
+    }
+  }
+
+  // Check the column indices
+  for ( int k = 0; k < nnz; k++ ){
+    if (cols[k] < 0 || cols[k] >= nbcols){
+      fprintf(stderr, "ParOptSparseJacobian: Column index %d out of range\n",
+              cols[k]);
+      cols[k] = 0;
+    }
+  }
+
+  // Form the transpose non-zero pattern so that the transpose product
+  // can be computed one block column at a time
+  colp = new int[ nbcols+1 ];
+  memset(colp, 0, (nbcols+1)*sizeof(int));
+  for ( int k = 0; k < nnz; k++ ){
+    colp[cols[k]+1]++;
+  }
+  for ( int j = 0; j < nbcols; j++ ){
+    colp[j+1] += colp[j];
+  }
+  rows = new int[ nnz ];
+  tblock = new int[ nnz ];
+  for ( int i = 0; i < nbrows; i++ ){
+    for ( int jp = rowp[i]; jp < rowp[i+1]; jp++ ){
+      int j = cols[jp];
+      rows[colp[j]] = i;
+      tblock[colp[j]] = jp;
+      colp[j]++;
+    }
+  }
+  for ( int j = nbcols; j > 0; j-- ){
+    colp[j] = colp[j-1];
+  }
+  colp[0] = 0;
+
+  // Allocate the values
+  int bsize = rbsize*cbsize;
+  vals = new ParOptScalar[ bsize*nnz ];
+  memset(vals, 0, bsize*nnz*sizeof(ParOptScalar));
+  if (_vals){
+    setValues(_vals);
+  }
+}
+
+/**
+  Free the data associated with the matrix
+*/
+ParOptSparseJacobian::~ParOptSparseJacobian(){
+  delete [] rowp;
+  delete [] cols;
+  if (perm){
+    delete [] perm;
+  }
+  delete [] colp;
+  delete [] rows;
+  delete [] tblock;
+  delete [] vals;
+}
+
+/**
+  Get the number of rows and columns of the matrix
+
+  @param nrows the number of local sparse constraints
+  @param ncols the number of local design variables
+*/
+void ParOptSparseJacobian::getSize( int *_nrows, int *_ncols ){
+  if (_nrows){ *_nrows = nrows; }
+  if (_ncols){ *_ncols = ncols; }
+}
+
+/**
+  Get the dimensions of the blocks
+
+  @param rbsize the number of rows in each block
+  @param cbsize the number of columns in each block
+*/
+void ParOptSparseJacobian::getBlockSize( int *_rbsize, int *_cbsize ){
+  if (_rbsize){ *_rbsize = rbsize; }
+  if (_cbsize){ *_cbsize = cbsize; }
+}
+
+/**
+  Set the values of the blocks in the ordering of the input pattern
+
+  @param vals the block values
+*/
+void ParOptSparseJacobian::setValues( const ParOptScalar *_vals ){
+  int nnz = rowp[nbrows];
+  int bsize = rbsize*cbsize;
+  if (perm){
+    for ( int k = 0; k < nnz; k++ ){
+      memcpy(&vals[bsize*k], &_vals[bsize*perm[k]],
+             bsize*sizeof(ParOptScalar));
+    }
+  }
+  else {
+    memcpy(vals, _vals, bsize*nnz*sizeof(ParOptScalar));
+  }
+}
+
+/**
+  Get the values of the blocks in the sorted ordering
+
+  @param vals the block values
+  @return the number of scalar entries in the array
+*/
+int ParOptSparseJacobian::getValues( ParOptScalar **_vals ){
+  if (_vals){ *_vals = vals; }
+  return rbsize*cbsize*rowp[nbrows];
+}
+
+/**
+  Compute y <- y + alpha*J*x
+
+  @param alpha the scalar multiple
+  @param x the input vector of length ncols
+  @param y the output vector of length nrows
+*/
+void ParOptSparseJacobian::multAdd( ParOptScalar alpha,
+                                    const ParOptScalar *x,
+                                    ParOptScalar *y ){
+  const int bsize = rbsize*cbsize;
+
+  PAROPT_OMP_FOR
+  for ( int i = 0; i < nbrows; i++ ){
+    ParOptScalar *yi = &y[rbsize*i];
+    for ( int jp = rowp[i]; jp < rowp[i+1]; jp++ ){
+      const ParOptScalar *v = &vals[bsize*jp];
+      const ParOptScalar *xj = &x[cbsize*cols[jp]];
+      for ( int ii = 0; ii < rbsize; ii++, v += cbsize ){
+        ParOptScalar t = 0.0;
+        for ( int jj = 0; jj < cbsize; jj++ ){
+          t += v[jj]*xj[jj];
+        }
+        yi[ii] += alpha*t;
+      }
+    }
+  }
+}
+
+/**
+  Compute y <- y + alpha*J^{T}*x
+
+  The product is computed one block column at a time using the
+  transpose non-zero pattern so that each entry of y is written by a
+  single thread.
+
+  @param alpha the scalar multiple
+  @param x the input vector of length nrows
+  @param y the output vector of length ncols
+*/
+void ParOptSparseJacobian::multTransposeAdd( ParOptScalar alpha,
+                                             const ParOptScalar *x,
+                                             ParOptScalar *y ){
+  const int bsize = rbsize*cbsize;
+
+  PAROPT_OMP_FOR
+  for ( int j = 0; j < nbcols; j++ ){
+    ParOptScalar *yj = &y[cbsize*j];
+    for ( int ip = colp[j]; ip < colp[j+1]; ip++ ){
+      const ParOptScalar *v = &vals[bsize*tblock[ip]];
+      const ParOptScalar *xi = &x[rbsize*rows[ip]];
+      for ( int ii = 0; ii < rbsize; ii++, v += cbsize ){
+        ParOptScalar t = alpha*xi[ii];
+        for ( int jj = 0; jj < cbsize; jj++ ){
+          yj[jj] += t*v[jj];
+        }
+      }
+    }
+  }
+}
+
+/**
+  Add the product A <- A + alpha*J*diag(c)*J^{T} to the diagonal
+  blocks of size nwblock stored in packed upper triangular format.
+
+  When the row block size is equal to nwblock, each diagonal block is
+  the sum of dense products over a single block row. When the row
+  block size is 1, the entries are computed by merging the sorted
+  rows within each diagonal block.
+
+  @param nwblock the size of the diagonal blocks
+  @param alpha the scalar multiple
+  @param c the diagonal entries of length ncols
+  @param A the packed diagonal blocks
+  @return 0 on success, 1 if the block sizes are incompatible
+*/
+int ParOptSparseJacobian::addInnerProduct( int nwblock,
+                                           ParOptScalar alpha,
+                                           const ParOptScalar *c,
+                                           ParOptScalar *A ){
+  const int bsize = rbsize*cbsize;
+  const int incr = (nwblock*(nwblock+1))/2;
+
+  if (rbsize == nwblock){
+    PAROPT_OMP_FOR
+    for ( int i = 0; i < nbrows; i++ ){
+      ParOptScalar *Ai = &A[incr*i];
+      for ( int jp = rowp[i]; jp < rowp[i+1]; jp++ ){
+        const ParOptScalar *v = &vals[bsize*jp];
+        const ParOptScalar *cj = &c[cbsize*cols[jp]];
+        for ( int s = 0; s < nwblock; s++ ){
+          const ParOptScalar *vs = &v[cbsize*s];
+          for ( int r = 0; r <= s; r++ ){
+            const ParOptScalar *vr = &v[cbsize*r];
+            ParOptScalar t = 0.0;
+            for ( int jj = 0; jj < cbsize; jj++ ){
+              t += vr[jj]*cj[jj]*vs[jj];
+            }
+            Ai[r + (s*(s+1))/2] += alpha*t;
+          }
+        }
+      }
+    }
+  }
+  else if (rbsize == 1){
+    const int nblocks = nrows/nwblock;
+
+    PAROPT_OMP_FOR
+    for ( int b = 0; b < nblocks; b++ ){
+      ParOptScalar *Ab = &A[incr*b];
+      for ( int s = 0; s < nwblock; s++ ){
+        const int is = nwblock*b + s;
+        for ( int r = 0; r <= s; r++ ){
+          const int ir = nwblock*b + r;
+
+          // Merge the sorted block rows ir and is
+          ParOptScalar t = 0.0;
+          int kr = rowp[ir], ks = rowp[is];
+          while (kr < rowp[ir+1] && ks < rowp[is+1]){
+            if (cols[kr] < cols[ks]){
+              kr++;
+            }
+            else if (cols[ks] < cols[kr]){
+              ks++;
+            }
+            else {
+              const ParOptScalar *vr = &vals[cbsize*kr];
+              const ParOptScalar *vs = &vals[cbsize*ks];
+              const ParOptScalar *cj = &c[cbsize*cols[kr]];
+              for ( int jj = 0; jj < cbsize; jj++ ){
+                t += vr[jj]*cj[jj]*vs[jj];
+              }
+              kr++;
+              ks++;
+            }
+          }
+          Ab[r + (s*(s+1))/2] += alpha*t;
+        }
+      }
+    }
+  }
+  else {
+    fprintf(stderr, "ParOptSparseJacobian: Row block size %d is not "
+            "compatible with the constraint block size %d\n",
+            rbsize, nwblock);
+    return 1;
+  }
+
+  return 0;
+}
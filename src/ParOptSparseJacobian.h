@@ -0,0 +1,78 @@
+#ifndef PAR_OPT_SPARSE_JACOBIAN_H
+#define PAR_OPT_SPARSE_JACOBIAN_H
+
+#include "ParOptVec.h"
+
+/*
+  A block compressed sparse row (BSR) matrix for the Jacobian of the
+  sparse constraints.
+
+  The matrix has nrows local constraints and ncols local design
+  variables. The entries are stored in dense blocks of size
+  rbsize x cbsize in row-major order, and rowp/cols give the
+  standard block CSR non-zero pattern. A scalar CSR matrix is the
+  special case rbsize = cbsize = 1.
+
+  The non-zero pattern is fixed when the object is created, while the
+  values may be updated every iteration using setValues() or by
+  writing directly to the array returned by getValues(). The column
+  indices of each block row are sorted on creation so that the blocks
+  in the array returned by getValues() are in the sorted order.
+
+  The inner products J*C*J^{T} required by the interior point method
+  are computed directly in the packed block-diagonal format used to
+  store the Cw matrix. This requires that the row block size is either
+  1 or equal to the sparse constraint block size nwblock.
+*/
+class ParOptSparseJacobian : public ParOptBase {
+ public:
+  ParOptSparseJacobian( int _nrows, int _ncols,
+                        int _rbsize, int _cbsize,
+                        const int *_rowp, const int *_cols,
+                        const ParOptScalar *_vals=NULL );
+  ~ParOptSparseJacobian();
+
+  // Get the dimensions of the matrix
+  void getSize( int *_nrows, int *_ncols );
+  void getBlockSize( int *_rbsize, int *_cbsize );
+
+  // Set or retrieve the values of the non-zero blocks
+  void setValues( const ParOptScalar *_vals );
+  int getValues( ParOptScalar **_vals );
+
+  // Compute y <- y + alpha*J*x
+  void multAdd( ParOptScalar alpha, const ParOptScalar *x,
+                ParOptScalar *y );
+
+  // Compute y <- y + alpha*J^{T}*x
+  void multTransposeAdd( ParOptScalar alpha, const ParOptScalar *x,
+                         ParOptScalar *y );
+
+  // Add A <- A + alpha*J*diag(c)*J^{T} to the packed diagonal blocks
+  int addInnerProduct( int nwblock, ParOptScalar alpha,
+                       const ParOptScalar *c, ParOptScalar *A );
+
+ private:
+  // The dimensions of the matrix and the blocks
+  int nrows, ncols;
+  int rbsize, cbsize;
+
+  // The number of block rows and block columns
+  int nbrows, nbcols;
+
+  // The block non-zero pattern
+  int *rowp, *cols;
+
+  // The permutation from the input ordering of the blocks to the
+  // sorted ordering (NULL if the input was already sorted)
+  int *perm;
+
+  // The transpose non-zero pattern: for each block column, the block
+  // rows and the index of the corresponding block in vals
+  int *colp, *rows, *tblock;
+
+  // The values of the blocks
+  ParOptScalar *vals;
+};
+
+#endif // PAR_OPT_SPARSE_JACOBIAN_H
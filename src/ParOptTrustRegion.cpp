@@ -2,10 +2,16 @@
 #include "ParOptTrustRegion.h"
 #include "ParOptComplexStep.h"
 
+// The fields in the binary history file
+static const int TR_HISTORY_NUM_FIELDS = 13;
+static const char *tr_history_fields[] =
+  {"iter", "fobj", "infeas", "l1", "linfty", "|x - xk|", "tr",
+   "rho", "mod red.", "avg z", "max z", "avg pen.", "max pen."};
+
 /*
   Summary of the different trust region algorithm options
 */
-static const int NUM_TRUST_REGION_PARAMS = 10;
+static const int NUM_TRUST_REGION_PARAMS = 12;
 static const char *trust_regions_parameter_help[][2] = {
   {"tr_size",
    "Float: Initial trust region radius size"},
@@ -28,6 +34,12 @@ static const char *trust_regions_parameter_help[][2] = {
   {"max_tr_iterations",
    "Integer: Maximum number of trust region radius steps"},
 
+  {"num_trial_steps",
+   "Integer: Number of trust region radii solved and evaluated together"},
+
+  {"warm_start_subproblem",
+   "Boolean: Warm-start each subproblem from the previous solution"},
+
   {"l1_tol",
    "Float: Convergence tolerance for the optimality error in the l1 norm"},
 
@@ -117,6 +129,18 @@ ParOptQuadraticSubproblem::ParOptQuadraticSubproblem( ParOptProblem *_prob,
   t->incref();
   xtemp = prob->createDesignVec();
   xtemp->incref();
+
+  // Start the subproblem from the center of the trust region
+  start_step = NULL;
+
+  // The batch data is allocated when it is first needed
+  max_batch_size = batch_size = 0;
+  batch_x = NULL;
+  batch_fobj = NULL;
+  batch_cons = NULL;
+
+  // No profiler until one is set by the trust region method
+  profiler = NULL;
 }
 
 ParOptQuadraticSubproblem::~ParOptQuadraticSubproblem(){
@@ -142,6 +166,22 @@ ParOptQuadraticSubproblem::~ParOptQuadraticSubproblem(){
 
   t->decref();
   xtemp->decref();
+  if (start_step){
+    start_step->decref();
+  }
+
+  if (batch_x){
+    for ( int i = 0; i < max_batch_size; i++ ){
+      batch_x[i]->decref();
+    }
+    delete [] batch_x;
+    delete [] batch_fobj;
+    delete [] batch_cons;
+  }
+
+  if (profiler){
+    profiler->decref();
+  }
 }
 
 /*
@@ -162,8 +202,14 @@ void ParOptQuadraticSubproblem::initModelAndBounds( double tr_size ){
   setTrustRegionBounds(tr_size);
 
   // Evaluate objective constraints and gradients
+  if (profiler){ profiler->start(PAROPT_PROFILE_EVAL_OBJ_CON); }
   prob->evalObjCon(xk, &fk, ck);
+  if (profiler){
+    profiler->stop(PAROPT_PROFILE_EVAL_OBJ_CON);
+    profiler->start(PAROPT_PROFILE_EVAL_GRADIENT);
+  }
   prob->evalObjConGradient(xk, gk, Ak);
+  if (profiler){ profiler->stop(PAROPT_PROFILE_EVAL_GRADIENT); }
 }
 
 /*
@@ -193,8 +239,15 @@ int ParOptQuadraticSubproblem::evalTrialStepAndUpdate( ParOptVec *step,
                                                        ParOptScalar *cons ){
   xtemp->copyValues(xk);
   xtemp->axpy(1.0, step);
+  if (profiler){ profiler->start(PAROPT_PROFILE_EVAL_OBJ_CON); }
   int fail = prob->evalObjCon(xtemp, &ft, ct);
+  if (profiler){
+    profiler->stop(PAROPT_PROFILE_EVAL_OBJ_CON);
+    profiler->start(PAROPT_PROFILE_EVAL_GRADIENT);
+  }
   fail = fail || prob->evalObjConGradient(xtemp, gt, At);
+  if (profiler){ profiler->stop(PAROPT_PROFILE_EVAL_GRADIENT); }
+  updateQuasiNewton(step, z, zw);
 
   // Copy the values of the objective and constraints
   *fobj = ft;
@@ -202,8 +255,122 @@ int ParOptQuadraticSubproblem::evalTrialStepAndUpdate( ParOptVec *step,
     cons[i] = ct[i];
   }
 
+  return fail;
+}
+
+/*
+  Evaluate the objective and constraints at the trial points
+  xk + steps[i] using the batched evaluation in the problem
+*/
+int ParOptQuadraticSubproblem::evalTrialStepBatch( int nsteps,
+                                                   ParOptVec **steps,
+                                                   ParOptScalar *fobj,
+                                                   ParOptScalar *cons,
+                                                   int *fail ){
+  if (nsteps > max_batch_size){
+    if (batch_x){
+      for ( int i = 0; i < max_batch_size; i++ ){
+        batch_x[i]->decref();
+      }
+      delete [] batch_x;
+      delete [] batch_fobj;
+      delete [] batch_cons;
+    }
+    max_batch_size = nsteps;
+    batch_x = new ParOptVec*[ nsteps ];
+    for ( int i = 0; i < nsteps; i++ ){
+      batch_x[i] = prob->createDesignVec();
+      batch_x[i]->incref();
+    }
+    batch_fobj = new ParOptScalar[ nsteps ];
+    batch_cons = new ParOptScalar[ nsteps*m ];
+  }
+
+  batch_size = nsteps;
+  for ( int i = 0; i < nsteps; i++ ){
+    batch_x[i]->copyValues(xk);
+    batch_x[i]->axpy(1.0, steps[i]);
+    fail[i] = 0;
+  }
+
+  if (profiler){ profiler->start(PAROPT_PROFILE_EVAL_OBJ_CON); }
+  int batch_fail = prob->evalObjConBatch(nsteps, batch_x, batch_fobj,
+                                         batch_cons, fail);
+  if (profiler){ profiler->stop(PAROPT_PROFILE_EVAL_OBJ_CON); }
+
+  for ( int i = 0; i < nsteps; i++ ){
+    if (batch_fail){
+      fail[i] = batch_fail;
+    }
+    fobj[i] = batch_fobj[i];
+    for ( int j = 0; j < m; j++ ){
+      cons[m*i + j] = batch_cons[m*i + j];
+    }
+  }
+
+  return batch_fail;
+}
+
+/*
+  Update the model with one of the steps from the last batch. The
+  function values are always taken from the batch. However, the
+  problem may only assume that the gradient is evaluated at the last
+  point in the batch (see ParOptProblem::evalObjConBatch()), so the
+  functions are re-evaluated at any other point only to put the
+  problem in the right state for evalObjConGradient().
+*/
+int ParOptQuadraticSubproblem::updateFromTrialStepBatch( int index,
+                                                         ParOptVec *step,
+                                                         const ParOptScalar *z,
+                                                         ParOptVec *zw,
+                                                         ParOptScalar *fobj,
+                                                         ParOptScalar *cons ){
+  if (index < 0 || index >= batch_size){
+    return 1;
+  }
+
+  xtemp->copyValues(xk);
+  xtemp->axpy(1.0, step);
+
+  ft = batch_fobj[index];
+  for ( int i = 0; i < m; i++ ){
+    ct[i] = batch_cons[m*index + i];
+  }
+
+  int fail = 0;
+  if (index != batch_size-1){
+    // The batch values for this point are no longer needed, so they
+    // are overwritten by the re-evaluation
+    ParOptScalar fobj_eval;
+    if (profiler){ profiler->start(PAROPT_PROFILE_EVAL_OBJ_CON); }
+    fail = prob->evalObjCon(xtemp, &fobj_eval, &batch_cons[m*index]);
+    if (profiler){ profiler->stop(PAROPT_PROFILE_EVAL_OBJ_CON); }
+  }
+
+  if (profiler){ profiler->start(PAROPT_PROFILE_EVAL_GRADIENT); }
+  fail = fail || prob->evalObjConGradient(xtemp, gt, At);
+  if (profiler){ profiler->stop(PAROPT_PROFILE_EVAL_GRADIENT); }
+  updateQuasiNewton(step, z, zw);
+
+  *fobj = ft;
+  for ( int i = 0; i < m; i++ ){
+    cons[i] = ct[i];
+  }
+
+  return fail;
+}
+
+/*
+  Update the quasi-Newton model using the gradient values stored at
+  the trial point xtemp = xk + step
+*/
+void ParOptQuadraticSubproblem::updateQuasiNewton( ParOptVec *step,
+                                                   const ParOptScalar *z,
+                                                   ParOptVec *zw ){
   // If we're using a quasi-Newton Hessian approximation
   if (qn){
+    if (profiler){ profiler->start(PAROPT_PROFILE_QN_UPDATE); }
+
     // Compute the difference between the gradient of the
     // Lagrangian between the current point and the previous point
     t->copyValues(gt);
@@ -225,9 +392,9 @@ int ParOptQuadraticSubproblem::evalTrialStepAndUpdate( ParOptVec *step,
     // Perform an update of the quasi-Newton approximation
     prob->computeQuasiNewtonUpdateCorrection(step, t);
     qn_update_type = qn->update(xk, z, zw, step, t);
-  }
 
-  return fail;
+    if (profiler){ profiler->stop(PAROPT_PROFILE_QN_UPDATE); }
+  }
 }
 
 int ParOptQuadraticSubproblem::acceptTrialStep( ParOptVec *step,
@@ -257,6 +424,19 @@ int ParOptQuadraticSubproblem::getQuasiNewtonUpdateType(){
   return qn_update_type;
 }
 
+/*
+  Set the profiler used to time the function evaluations
+*/
+void ParOptQuadraticSubproblem::setProfiler( ParOptProfiler *_profiler ){
+  if (_profiler){
+    _profiler->incref();
+  }
+  if (profiler){
+    profiler->decref();
+  }
+  profiler = _profiler;
+}
+
 /*
   Create a design vector
 */
@@ -297,11 +477,41 @@ int ParOptQuadraticSubproblem::useUpperBounds(){
   return 1;
 }
 
+/*
+  Set the starting step for the next subproblem solution
+*/
+void ParOptQuadraticSubproblem::setStartingStep( ParOptVec *step ){
+  if (step){
+    if (!start_step){
+      start_step = prob->createDesignVec();
+      start_step->incref();
+    }
+    start_step->copyValues(step);
+  }
+  else if (start_step){
+    start_step->decref();
+    start_step = NULL;
+  }
+}
+
 // Get the variables and bounds from the problem
 void ParOptQuadraticSubproblem::getVarsAndBounds( ParOptVec *step,
                                                   ParOptVec *l,
                                                   ParOptVec *u ){
-  step->zeroEntries();
+  if (start_step){
+    // Project the starting step onto the trust region bounds
+    ParOptScalar *svals, *s0vals, *lvals, *uvals;
+    int size = step->getArray(&svals);
+    start_step->getArray(&s0vals);
+    lk->getArray(&lvals);
+    uk->getArray(&uvals);
+    for ( int i = 0; i < size; i++ ){
+      svals[i] = max2(lvals[i], min2(uvals[i], s0vals[i]));
+    }
+  }
+  else {
+    step->zeroEntries();
+  }
   l->copyValues(lk);
   u->copyValues(uk);
 }
@@ -486,24 +696,53 @@ ParOptTrustRegion::ParOptTrustRegion( ParOptTrustRegionSubproblem *_subproblem,
   fp = NULL;
   print_level = 0;
 
+  // No binary history by default
+  history = NULL;
+
+  // Warm-start the subproblems by default
+  warm_start_subproblem = 1;
+
+  // Solve the subproblem for a single radius at each iteration
+  num_trial_steps = 1;
+  trial_steps = NULL;
+  trial_zw = NULL;
+  trial_z = NULL;
+  trial_radius = NULL;
+  trial_fobj = NULL;
+  trial_cons = NULL;
+  trial_fail = NULL;
+
   // Create a temporary vector
   t = subproblem->createDesignVec();
   t->incref();
+
+  // Create the profiler and share it with the subproblem so that
+  // the function evaluations are recorded
+  profiler = new ParOptProfiler();
+  profiler->incref();
+  profile_output = 0;
+  subproblem->setProfiler(profiler);
 }
 
 /**
   Delete the trust region object
 */
 ParOptTrustRegion::~ParOptTrustRegion(){
+  // Free the trial step data (if allocated)
+  setNumTrialSteps(1);
   subproblem->decref();
 
   delete [] penalty_gamma;
   t->decref();
+  profiler->decref();
 
   // Close the file when we quit
   if (fp){
     fclose(fp);
   }
+  if (history){
+    history->decref();
+  }
 }
 
 /**
@@ -540,6 +779,49 @@ void ParOptTrustRegion::setPrintLevel( int _print_level ){
   print_level = _print_level;
 }
 
+/*
+  Create the history object with the trust region record schema
+*/
+ParOptHistory* ParOptTrustRegion::createHistory(){
+  if (!history){
+    history = new ParOptHistory(subproblem->getMPIComm(),
+                                TR_HISTORY_NUM_FIELDS, tr_history_fields);
+    history->incref();
+  }
+  return history;
+}
+
+/**
+  Write the binary iteration history to the given file (only on the
+  root proc). The records contain the same fields as the output file.
+
+  @param filename the history file name (NULL closes the file)
+*/
+void ParOptTrustRegion::setHistoryFile( const char *filename ){
+  if (createHistory()->openHistoryFile(filename)){
+    fprintf(stderr, "ParOptTrustRegion: History file %s creation failed\n",
+            filename);
+  }
+}
+
+/**
+  Write a snapshot of the design variables every freq iterations
+
+  @param filename the design history file name (NULL closes the file)
+  @param freq the number of iterations between snapshots
+*/
+void ParOptTrustRegion::setDesignHistoryFile( const char *filename,
+                                              int freq ){
+  if (createHistory()->openDesignHistoryFile(filename, n, freq)){
+    int rank;
+    MPI_Comm_rank(subproblem->getMPIComm(), &rank);
+    if (rank == 0){
+      fprintf(stderr, "ParOptTrustRegion: Design history file %s "
+              "creation failed\n", filename);
+    }
+  }
+}
+
 /**
   Get the optimized point from the subproblem class
 
@@ -573,13 +855,27 @@ void ParOptTrustRegion::printOptionSummary( FILE *fp ){
     fprintf(fp, "%-30s %15g\n", "bound_relax", bound_relax);
     fprintf(fp, "%-30s %15d\n", "adaptive_gamma_update", adaptive_gamma_update);
     fprintf(fp, "%-30s %15d\n", "max_tr_iterations", max_tr_iterations);
+    fprintf(fp, "%-30s %15d\n", "num_trial_steps", num_trial_steps);
+    fprintf(fp, "%-30s %15d\n", "warm_start_subproblem",
+            warm_start_subproblem);
     fprintf(fp, "%-30s %15g\n", "l1_tol", l1_tol);
     fprintf(fp, "%-30s %15g\n", "linfty_tol", linfty_tol);
     fprintf(fp, "%-30s %15g\n", "infeas_tol", infeas_tol);
     fprintf(fp, "%-30s %15g\n", "gamma_max", penalty_gamma_max);
+    fprintf(fp, "%-30s %15d\n", "profile_output", profile_output);
   }
 }
 
+/**
+  Print the time spent in each phase of the optimization after each
+  iteration and a summary at the end of the optimization
+
+  @param truth flag to print the profile
+*/
+void ParOptTrustRegion::setProfileOutput( int truth ){
+  profile_output = truth;
+}
+
 /**
   Set whether or not to adaptively update the penalty parameters
 
@@ -669,6 +965,86 @@ void ParOptTrustRegion::setOutputFrequency( int _write_output_frequency ){
   write_output_frequency = _write_output_frequency;
 }
 
+/**
+  Set whether to warm-start the subproblems.
+
+  When set, every subproblem solution after the first starts from the
+  primal-dual point of the previous subproblem solution using the
+  warm start in ParOptInteriorPoint.
+
+  @param truth flag to indicate whether to warm-start the subproblems
+*/
+void ParOptTrustRegion::setWarmStartSubproblem( int truth ){
+  warm_start_subproblem = truth;
+}
+
+/**
+  Set the number of trust region radii used at each iteration.
+
+  When ntrial is greater than one, the subproblem is solved for the
+  current radius and for up to ntrial-1 successively smaller radii,
+  each reduced by the same factor applied when a step is rejected.
+  Each solution is started from the step for the previous radius. The
+  trial steps are then evaluated together through
+  ParOptProblem::evalObjConBatch() and the step with the largest
+  actual reduction in the merit function that passes the acceptance
+  test is selected. This replaces a sequence of rejected steps by a
+  single batch of function evaluations.
+
+  @param ntrial the maximum number of trial steps per iteration
+*/
+void ParOptTrustRegion::setNumTrialSteps( int ntrial ){
+  if (ntrial < 1){
+    ntrial = 1;
+  }
+  if (ntrial == num_trial_steps){
+    return;
+  }
+
+  if (trial_steps){
+    for ( int i = 0; i < num_trial_steps; i++ ){
+      trial_steps[i]->decref();
+      if (trial_zw[i]){
+        trial_zw[i]->decref();
+      }
+    }
+    delete [] trial_steps;
+    delete [] trial_zw;
+    delete [] trial_z;
+    delete [] trial_radius;
+    delete [] trial_fobj;
+    delete [] trial_cons;
+    delete [] trial_fail;
+    trial_steps = NULL;
+    trial_zw = NULL;
+    trial_z = NULL;
+    trial_radius = NULL;
+    trial_fobj = NULL;
+    trial_cons = NULL;
+    trial_fail = NULL;
+  }
+
+  num_trial_steps = ntrial;
+  if (ntrial > 1){
+    trial_steps = new ParOptVec*[ ntrial ];
+    trial_zw = new ParOptVec*[ ntrial ];
+    for ( int i = 0; i < ntrial; i++ ){
+      trial_steps[i] = subproblem->createDesignVec();
+      trial_steps[i]->incref();
+      trial_zw[i] = NULL;
+      if (nwcon > 0){
+        trial_zw[i] = subproblem->createConstraintVec();
+        trial_zw[i]->incref();
+      }
+    }
+    trial_z = new ParOptScalar[ ntrial*m ];
+    trial_radius = new double[ ntrial ];
+    trial_fobj = new ParOptScalar[ ntrial ];
+    trial_cons = new ParOptScalar[ ntrial*m ];
+    trial_fail = new int[ ntrial ];
+  }
+}
+
 /**
   Initialize the problem
 */
@@ -699,6 +1075,21 @@ void ParOptTrustRegion::update( ParOptVec *step,
                                 double *infeas,
                                 double *l1,
                                 double *linfty ){
+  updateStep(step, z, zw, -1, infeas, l1, linfty);
+}
+
+/*
+  Update the trust region problem using the step. The trial_index
+  is the index of the step within the last batch of trial steps, or
+  negative if the step has not been evaluated.
+*/
+void ParOptTrustRegion::updateStep( ParOptVec *step,
+                                    const ParOptScalar *z,
+                                    ParOptVec *zw,
+                                    int trial_index,
+                                    double *infeas,
+                                    double *l1,
+                                    double *linfty ){
   // Get the mpi rank for printing
   int mpi_rank;
   MPI_Comm_rank(subproblem->getMPIComm(), &mpi_rank);
@@ -732,7 +1123,12 @@ void ParOptTrustRegion::update( ParOptVec *step,
 
   // Evaluate the model at the trial point and update the trust region model
   // Hessian and bounds. Note that here, we're re-using the ft/ct memory.
-  subproblem->evalTrialStepAndUpdate(step, z, zw, &ft, ct);
+  if (trial_index >= 0){
+    subproblem->updateFromTrialStepBatch(trial_index, step, z, zw, &ft, ct);
+  }
+  else {
+    subproblem->evalTrialStepAndUpdate(step, z, zw, &ft, ct);
+  }
 
   // Compute the infeasibilities of the last two iterations
   ParOptScalar infeas_t = 0.0;
@@ -868,13 +1264,214 @@ void ParOptTrustRegion::update( ParOptVec *step,
             iter_count, ParOptRealPart(fk), *infeas, *l1, *linfty, smax, tr_size,
             ParOptRealPart(rho), ParOptRealPart(model_reduc),
             zav/m, zmax, gav/m, gmax, info);
+    if (profile_output){
+      profiler->printIteration(outfp);
+    }
     fflush(outfp);
+
+    if (history && history->isOpen()){
+      double values[TR_HISTORY_NUM_FIELDS] = {
+        1.0*iter_count, ParOptRealPart(fk), *infeas, *l1, *linfty, smax,
+        tr_size, ParOptRealPart(rho), ParOptRealPart(model_reduc),
+        zav/m, zmax, gav/m, gmax};
+      history->writeRecord(values);
+    }
+  }
+
+  // Write the current design point to the design history
+  if (history && history->isDesignDue(iter_count)){
+    ParOptVec *xk;
+    subproblem->getLinearModel(&xk);
+    if (history->writeDesign(iter_count, xk)){
+      fprintf(stderr, "ParOptTrustRegion: Design history write failed\n");
+    }
   }
 
   // Update the iteration counter
   iter_count++;
 }
 
+/*
+  Compute the ratio of the actual to the predicted reduction in the
+  l1 penalty function for a trial step with the objective and
+  constraint values ft and ct
+*/
+ParOptScalar ParOptTrustRegion::computeReductionRatio( ParOptVec *step,
+                                                       ParOptScalar ft,
+                                                       const ParOptScalar *ct,
+                                                       ParOptScalar *_actual_reduc ){
+  ParOptScalar fk, fmodel;
+  ParOptScalar *ck = new ParOptScalar[ m ];
+  ParOptScalar *cmodel = new ParOptScalar[ m ];
+  subproblem->evalObjCon(NULL, &fk, ck);
+  subproblem->evalObjCon(step, &fmodel, cmodel);
+
+  ParOptScalar infeas_k = 0.0, infeas_model = 0.0, infeas_t = 0.0;
+  for ( int i = 0; i < m; i++ ){
+    infeas_k += penalty_gamma[i]*max2(0.0, -ck[i]);
+    infeas_model += penalty_gamma[i]*max2(0.0, -cmodel[i]);
+    infeas_t += penalty_gamma[i]*max2(0.0, -ct[i]);
+  }
+
+  ParOptScalar actual_reduc = (fk - ft + (infeas_k - infeas_t));
+  ParOptScalar model_reduc = (fk - fmodel + (infeas_k - infeas_model));
+
+  delete [] ck;
+  delete [] cmodel;
+
+  ParOptScalar rho = 1.0;
+  if (fabs(ParOptRealPart(model_reduc)) <= function_precision &&
+      fabs(ParOptRealPart(actual_reduc)) <= function_precision){
+    rho = 1.0;
+  }
+  else {
+    rho = actual_reduc/model_reduc;
+  }
+
+  if (_actual_reduc){
+    *_actual_reduc = actual_reduc;
+  }
+
+  return rho;
+}
+
+/*
+  Solve the subproblem for the current trust region radius and a
+  sequence of smaller radii, then evaluate all the trial steps
+  together and select the step to use.
+
+  The steps are stored with the largest radius last, since this is the
+  step that is most often accepted and the batch evaluation may then
+  be re-used for the gradient evaluation. On return, the trust region
+  radius is set to the radius of the selected step.
+
+  @param optimizer the interior-point optimizer for the subproblem
+  @param step the selected step
+  @param z the dense constraint multipliers for the selected step
+  @param zw the sparse constraint multipliers for the selected step
+  @return the index of the step within the batch, or -1 if the trial
+  steps could not be evaluated as a batch
+*/
+int ParOptTrustRegion::solveTrialSteps( ParOptInteriorPoint *optimizer,
+                                        ParOptVec **step,
+                                        ParOptScalar **z,
+                                        ParOptVec **zw ){
+  // Set the sequence of radii, stopping at the minimum radius
+  int nt = 0;
+  double radius = tr_size;
+  for ( ; nt < num_trial_steps; nt++ ){
+    trial_radius[nt] = radius;
+    if (radius <= tr_min_size){
+      nt++;
+      break;
+    }
+    radius = ParOptRealPart(max2(0.25*radius, tr_min_size));
+  }
+
+  // Reverse the order so that the largest radius is last
+  for ( int k = 0; k < nt/2; k++ ){
+    double tmp = trial_radius[k];
+    trial_radius[k] = trial_radius[nt-1-k];
+    trial_radius[nt-1-k] = tmp;
+  }
+
+  // Solve the subproblems from the largest to the smallest radius
+  int total_iters = 0;
+  for ( int k = nt-1; k >= 0; k-- ){
+    subproblem->setTrustRegionBounds(trial_radius[k]);
+    if (k < nt-1){
+      subproblem->setStartingStep(trial_steps[k+1]);
+    }
+
+    // Initialize the barrier parameter
+    optimizer->setInitBarrierParameter(10.0);
+    optimizer->resetDesignAndBounds();
+
+    // Optimize the subproblem
+    profiler->start(PAROPT_PROFILE_SUBPROBLEM);
+    optimizer->optimize();
+    profiler->stop(PAROPT_PROFILE_SUBPROBLEM);
+
+    ParOptVec *s, *sw;
+    ParOptScalar *sz;
+    optimizer->getOptimizedPoint(&s, &sz, &sw, NULL, NULL);
+    trial_steps[k]->copyValues(s);
+    for ( int i = 0; i < m; i++ ){
+      trial_z[m*k + i] = sz[i];
+    }
+    if (nwcon > 0){
+      trial_zw[k]->copyValues(sw);
+    }
+
+    int iters;
+    optimizer->getIterationCounters(&iters);
+    total_iters += iters;
+  }
+  subproblem->setStartingStep(NULL);
+  subproblem_iters = total_iters;
+
+  // Evaluate the objective and constraints at all the trial points
+  int fail = subproblem->evalTrialStepBatch(nt, trial_steps, trial_fobj,
+                                            trial_cons, trial_fail);
+
+  int index = nt-1;
+  if (!fail){
+    // Select the acceptable step with the largest actual reduction.
+    // If no step is acceptable, use the step with the smallest radius.
+    int mpi_rank;
+    MPI_Comm_rank(subproblem->getMPIComm(), &mpi_rank);
+    FILE *outfp = stdout;
+    if (fp){
+      outfp = fp;
+    }
+    if (mpi_rank == 0 && print_level > 0){
+      fprintf(outfp, "%-12s %2s %12s %12s %12s\n",
+              "Trial steps", "i", "tr", "rho", "ared");
+    }
+
+    int best = -1;
+    ParOptScalar best_reduc = 0.0;
+    for ( int k = nt-1; k >= 0; k-- ){
+      if (trial_fail[k]){
+        continue;
+      }
+      ParOptScalar reduc;
+      ParOptScalar rho = computeReductionRatio(trial_steps[k], trial_fobj[k],
+                                               &trial_cons[m*k], &reduc);
+      if (mpi_rank == 0 && print_level > 0){
+        fprintf(outfp, "%12s %2d %12.5e %12.5e %12.5e\n", " ", k,
+                trial_radius[k], ParOptRealPart(rho), ParOptRealPart(reduc));
+      }
+      if (ParOptRealPart(rho) >= eta || trial_radius[k] <= tr_min_size){
+        if (best < 0 || ParOptRealPart(reduc) > ParOptRealPart(best_reduc)){
+          best = k;
+          best_reduc = reduc;
+        }
+      }
+    }
+
+    if (best >= 0){
+      index = best;
+    }
+    else {
+      index = 0;
+    }
+  }
+
+  // Set the trust region radius for the selected step
+  tr_size = trial_radius[index];
+  subproblem->setTrustRegionBounds(tr_size);
+
+  *step = trial_steps[index];
+  *z = &trial_z[m*index];
+  *zw = trial_zw[index];
+
+  if (fail){
+    return -1;
+  }
+  return index;
+}
+
 /**
   Perform the optimization
 
@@ -919,11 +1516,22 @@ void ParOptTrustRegion::optimize( ParOptInteriorPoint *optimizer ){
   int mpi_rank;
   MPI_Comm_rank(subproblem->getMPIComm(), &mpi_rank);
 
+  // Reset the timers and counters
+  profiler->reset();
+  profiler->start(PAROPT_PROFILE_TOTAL);
+
   // Initialize the trust region problem for the first iteration
   initialize();
 
+  // The first subproblem is solved from a cold start
+  optimizer->setUseWarmStart(0);
+
   // Iterate over the trust region subproblem until convergence
   for ( int i = 0; i < max_tr_iterations; i++ ){
+    if (i > 0){
+      optimizer->setUseWarmStart(warm_start_subproblem);
+    }
+
     if (adaptive_gamma_update){
       // Set the penalty parameter to a large value
       double gamma = 1e6;
@@ -937,7 +1545,9 @@ void ParOptTrustRegion::optimize( ParOptInteriorPoint *optimizer ){
       optimizer->resetDesignAndBounds();
 
       // Optimize the subproblem
+      profiler->start(PAROPT_PROFILE_SUBPROBLEM);
       optimizer->optimize();
+      profiler->stop(PAROPT_PROFILE_SUBPROBLEM);
 
       // Get the design variables
       ParOptVec *step, *zw;
@@ -964,25 +1574,37 @@ void ParOptTrustRegion::optimize( ParOptInteriorPoint *optimizer ){
     // Print out the current solution progress using the
     // hook in the problem definition
     if (i % write_output_frequency == 0){
+      profiler->start(PAROPT_PROFILE_OUTPUT);
       ParOptVec *xk;
       subproblem->getLinearModel(&xk);
       subproblem->writeOutput(i, xk);
+      profiler->stop(PAROPT_PROFILE_OUTPUT);
     }
 
-    // Initialize the barrier parameter
-    optimizer->setInitBarrierParameter(10.0);
-    optimizer->resetDesignAndBounds();
-
-    // Optimize the subproblem
-    optimizer->optimize();
-
     // Get the design variables
     ParOptVec *step, *zw;
     ParOptScalar *z;
-    optimizer->getOptimizedPoint(&step, &z, &zw, NULL, NULL);
+    int trial_index = -1;
+
+    if (num_trial_steps > 1){
+      // Solve the subproblem for several radii and select a step
+      trial_index = solveTrialSteps(optimizer, &step, &z, &zw);
+    }
+    else {
+      // Initialize the barrier parameter
+      optimizer->setInitBarrierParameter(10.0);
+      optimizer->resetDesignAndBounds();
+
+      // Optimize the subproblem
+      profiler->start(PAROPT_PROFILE_SUBPROBLEM);
+      optimizer->optimize();
+      profiler->stop(PAROPT_PROFILE_SUBPROBLEM);
 
-    // Get the number of subproblem iterations
-    optimizer->getIterationCounters(&subproblem_iters);
+      optimizer->getOptimizedPoint(&step, &z, &zw, NULL, NULL);
+
+      // Get the number of subproblem iterations
+      optimizer->getIterationCounters(&subproblem_iters);
+    }
 
     if (adaptive_gamma_update){
       // Find the infeasibility at the origin x = xk
@@ -1001,7 +1623,7 @@ void ParOptTrustRegion::optimize( ParOptInteriorPoint *optimizer ){
     // Update the trust region based on the performance at the new
     // point.
     double infeas, l1, linfty;
-    update(step, z, zw, &infeas, &l1, &linfty);
+    updateStep(step, z, zw, trial_index, &infeas, &l1, &linfty);
 
     // Check for convergence of the trust region problem
     if (infeas < infeas_tol){
@@ -1080,6 +1702,16 @@ void ParOptTrustRegion::optimize( ParOptInteriorPoint *optimizer ){
     delete [] model_con_infeas;
     delete [] best_con_infeas;
   }
+
+  profiler->stop(PAROPT_PROFILE_TOTAL);
+  if (profile_output && mpi_rank == 0){
+    FILE *outfp = stdout;
+    if (fp){
+      outfp = fp;
+    }
+    profiler->printSummary(outfp);
+    fflush(outfp);
+  }
 }
 
 /**
@@ -1146,8 +1778,8 @@ void ParOptTrustRegion::computeKKTError( const ParOptScalar *z,
   }
 
   // All-reduce the norms across all processors
-  MPI_Allreduce(&l1_norm, l1, 1, MPI_DOUBLE,
+  ParOptAllreduce(&l1_norm, l1, 1, MPI_DOUBLE,
                 MPI_SUM, subproblem->getMPIComm());
-  MPI_Allreduce(&infty_norm, linfty, 1, MPI_DOUBLE,
+  ParOptAllreduce(&infty_norm, linfty, 1, MPI_DOUBLE,
                 MPI_MAX, subproblem->getMPIComm());
 }
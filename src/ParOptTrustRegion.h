@@ -71,6 +71,57 @@ class ParOptTrustRegionSubproblem : public ParOptProblem {
   */
   virtual void rejectTrialStep() = 0;
 
+  /**
+    Evaluate the objective and constraints at several trial points
+    without updating the model.
+
+    This is used when the trust region method solves the subproblem
+    for more than one radius and evaluates the trial steps together.
+    The default implementation does not support batched trial steps.
+
+    @param nsteps The number of trial steps
+    @param steps The trial steps
+    @param fobj The objective values at the trial points
+    @param cons The dense constraint values: cons[m*i + j]
+    @param fail The fail flag for each trial point
+    @return Non-zero if batched trial steps are not supported or failed
+  */
+  virtual int evalTrialStepBatch( int nsteps, ParOptVec **steps,
+                                  ParOptScalar *fobj, ParOptScalar *cons,
+                                  int *fail ){
+    return 1;
+  }
+
+  /**
+    Update the model using one of the trial steps from the last call
+    to evalTrialStepBatch(). This takes the place of
+    evalTrialStepAndUpdate() for the selected step.
+
+    @param index The index of the step in the batch
+    @param step The trial step
+    @param z The multipliers for the dense constraints
+    @param zw The multipliers for the sparse constraints
+    @param fobj The objective value at the trial point
+    @param cons The dense constraint values at the trial point
+    @return Flag indicating whether the evaluation failed
+  */
+  virtual int updateFromTrialStepBatch( int index, ParOptVec *step,
+                                        const ParOptScalar *z,
+                                        ParOptVec *zw,
+                                        ParOptScalar *fobj,
+                                        ParOptScalar *cons ){
+    return 1;
+  }
+
+  /**
+    Set the starting point for the next subproblem solution. The step
+    is projected onto the trust region bounds. Passing NULL restores
+    the default starting point at the center of the trust region.
+
+    @param step The starting step (may be NULL)
+  */
+  virtual void setStartingStep( ParOptVec *step ){}
+
   /**
     Get the Hessian update type from the most recent update
 
@@ -80,6 +131,14 @@ class ParOptTrustRegionSubproblem : public ParOptProblem {
     return 0;
   }
 
+  /**
+    Set the profiler used to record the time spent evaluating the
+    problem functions and updating the model
+
+    @param profiler The profiler object
+  */
+  virtual void setProfiler( ParOptProfiler *profiler ){}
+
   /**
     Get access to a linearization of the model
 
@@ -111,7 +170,15 @@ class ParOptQuadraticSubproblem : public ParOptTrustRegionSubproblem {
                               ParOptScalar *fobj, ParOptScalar *cons );
   int acceptTrialStep( ParOptVec *xt, const ParOptScalar *z, ParOptVec *zw );
   void rejectTrialStep();
+  int evalTrialStepBatch( int nsteps, ParOptVec **steps,
+                          ParOptScalar *fobj, ParOptScalar *cons,
+                          int *fail );
+  int updateFromTrialStepBatch( int index, ParOptVec *step,
+                                const ParOptScalar *z, ParOptVec *zw,
+                                ParOptScalar *fobj, ParOptScalar *cons );
+  void setStartingStep( ParOptVec *step );
   int getQuasiNewtonUpdateType();
+  void setProfiler( ParOptProfiler *_profiler );
 
   // Create the design vectors
   ParOptVec *createDesignVec();
@@ -174,6 +241,10 @@ class ParOptQuadraticSubproblem : public ParOptTrustRegionSubproblem {
                       ParOptVec **_lb=NULL, ParOptVec **_ub=NULL );
 
  private:
+  // Update the quasi-Newton model from the gradients at xtemp
+  void updateQuasiNewton( ParOptVec *step, const ParOptScalar *z,
+                          ParOptVec *zw );
+
   // Pointer to the optimization problem
   ParOptProblem *prob;
 
@@ -206,6 +277,17 @@ class ParOptQuadraticSubproblem : public ParOptTrustRegionSubproblem {
 
   // Temporary vectors
   ParOptVec *t, *xtemp;
+
+  // The starting step for the subproblem (may be NULL)
+  ParOptVec *start_step;
+
+  // The trial points and function values from the last batch
+  int max_batch_size, batch_size;
+  ParOptVec **batch_x;
+  ParOptScalar *batch_fobj, *batch_cons;
+
+  // The profiler for the function evaluations (may be NULL)
+  ParOptProfiler *profiler;
 };
 
 /*
@@ -237,6 +319,8 @@ class ParOptTrustRegion : public ParOptBase {
   int getPenaltyGamma( const double **gamma );
   void setPenaltyGammaMax( double _gamma_max );
   void setOutputFrequency( int _write_output_frequency );
+  void setNumTrialSteps( int ntrial );
+  void setWarmStartSubproblem( int truth );
 
   // Optimization loop using the trust region subproblem
   void optimize( ParOptInteriorPoint *optimize );
@@ -245,9 +329,17 @@ class ParOptTrustRegion : public ParOptBase {
   void setOutputFile( const char *filename );
   void setPrintLevel( int _print_level );
 
+  // Write the binary iteration and design history
+  void setHistoryFile( const char *filename );
+  void setDesignHistoryFile( const char *filename, int freq );
+
   // Get the optimized point
   void getOptimizedPoint( ParOptVec **_x );
 
+  // Get the profiler and print the profile to the output file
+  ParOptProfiler *getProfiler(){ return profiler; }
+  void setProfileOutput( int truth );
+
  protected:
   ParOptTrustRegionSubproblem *subproblem;
 
@@ -259,6 +351,22 @@ class ParOptTrustRegion : public ParOptBase {
   // Print the options summary
   void printOptionSummary( FILE *fp );
 
+  // Update the trust region using the given step. If trial_index is
+  // non-negative, the step is from the last batch of trial steps.
+  void updateStep( ParOptVec *step, const ParOptScalar *z, ParOptVec *zw,
+                   int trial_index, double *infeas,
+                   double *l1, double *linfty );
+
+  // Solve the subproblem for several radii and evaluate the trial
+  // steps together. Returns the index of the selected trial step.
+  int solveTrialSteps( ParOptInteriorPoint *optimizer, ParOptVec **step,
+                       ParOptScalar **z, ParOptVec **zw );
+
+  // Compute the ratio of the actual to the predicted reduction
+  ParOptScalar computeReductionRatio( ParOptVec *step, ParOptScalar ft,
+                                      const ParOptScalar *ct,
+                                      ParOptScalar *actual_reduc );
+
   // File pointer for the summary file - depending on the settings
   FILE *fp;
   int iter_count; // Iteration counter
@@ -266,6 +374,14 @@ class ParOptTrustRegion : public ParOptBase {
   int adaptive_subprolem_iters; // Subproblem iteration counter
   int print_level; // Print level for the file
 
+  // The binary iteration and design history (may be NULL)
+  ParOptHistory *history;
+  ParOptHistory *createHistory();
+
+  // The timers and counters for each phase of the optimization
+  ParOptProfiler *profiler;
+  int profile_output;
+
   int n; // The number of design variables (local)
   int m; // The number of dense constraints (global)
   int nwcon; // The number of sparse constraints
@@ -288,11 +404,22 @@ class ParOptTrustRegion : public ParOptBase {
   // Set the output parameters
   int write_output_frequency;
 
+  // Warm-start each subproblem from the previous solution
+  int warm_start_subproblem;
+
   // Set the trust region solution parameters
   int max_tr_iterations;
   double l1_tol, linfty_tol;
   double infeas_tol;
 
+  // Data for solving the subproblem with several trust region radii
+  int num_trial_steps;
+  ParOptVec **trial_steps, **trial_zw;
+  ParOptScalar *trial_z;
+  double *trial_radius;
+  ParOptScalar *trial_fobj, *trial_cons;
+  int *trial_fail;
+
   // Temporary vectors
   ParOptVec *t;
 };
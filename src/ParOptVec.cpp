@@ -1,217 +1,1655 @@
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 #include "ParOptComplexStep.h"
 #include "ParOptBlasLapack.h"
 #include "ParOptVec.h"
+#include "ParOptProfiler.h"
+#include "ParOptActiveSet.h"
 
 /**
-  Create a parallel vector for optimization
+  Compute: self <- alpha*x + beta*self
 
-  @param comm the communicator for this vector
-  @param n the number of vector components on this processor
+  This default implementation is composed of the scale/axpy/copyValues
+  operations and makes more than one pass through the data.
+
+  @param alpha the scalar multiplying x
+  @param beta the scalar multiplying this vector
+  @param x the input vector
 */
-ParOptBasicVec::ParOptBasicVec( MPI_Comm _comm, int n ){
-  comm = _comm;
-  size = n;
-  x = new ParOptScalar[ size ];
-  memset(x, 0, size*sizeof(ParOptScalar));
+void ParOptVec::axpby( ParOptScalar alpha, ParOptScalar beta,
+                       ParOptVec *x ){
+  if (x == this){
+    scale(alpha + beta);
+  }
+  else if (beta == 0.0){
+    copyValues(x);
+    scale(alpha);
+  }
+  else {
+    scale(beta);
+    axpy(alpha, x);
+  }
 }
 
 /**
-  Free the internally stored data
+  Compute: self <- alpha*x + y
+
+  This default implementation is composed of the scale/axpy/copyValues
+  operations and makes more than one pass through the data.
+
+  @param alpha the scalar multiplying x
+  @param x the first input vector
+  @param y the second input vector
 */
-ParOptBasicVec::~ParOptBasicVec(){
-  delete [] x;
+void ParOptVec::waxpy( ParOptScalar alpha, ParOptVec *x, ParOptVec *y ){
+  if (x == this && y == this){
+    scale(alpha + 1.0);
+  }
+  else if (x == this){
+    scale(alpha);
+    axpy(1.0, y);
+  }
+  else {
+    if (y != this){
+      copyValues(y);
+    }
+    axpy(alpha, x);
+  }
 }
 
 /**
-  Set the vector value
+  Compute the component-wise product and quotient: self <- a.*x./b
 
-  @param alpha the scalar value to set in all components
+  @param a the first vector in the product
+  @param x the second vector in the product
+  @param b the vector of divisors
 */
-void ParOptBasicVec::set( ParOptScalar alpha ){
+void ParOptVec::pointwiseMultDiv( ParOptVec *a, ParOptVec *x, ParOptVec *b ){
+  ParOptScalar *y, *avals, *xvals, *bvals;
+  int size = getArray(&y);
+  a->getArray(&avals);
+  x->getArray(&xvals);
+  b->getArray(&bvals);
+
   for ( int i = 0; i < size; i++ ){
-    x[i] = alpha;
+    y[i] = avals[i]*xvals[i]/bvals[i];
   }
 }
 
 /**
-  Zero the entries of the vector
+  Compute the sum of the squares of the locally owned components
+
+  @return the local contribution to the squared l2 norm
 */
-void ParOptBasicVec::zeroEntries(){
-  memset(x, 0, size*sizeof(ParOptScalar));
+double ParOptVec::localNormSquared(){
+  ParOptScalar *x;
+  int size = getArray(&x);
+
+  double res = 0.0;
+  for ( int i = 0; i < size; i++ ){
+    res += (ParOptRealPart(x[i])*ParOptRealPart(x[i]) +
+            ParOptImagPart(x[i])*ParOptImagPart(x[i]));
+  }
+
+  return res;
 }
 
 /**
-  Copy the values from the given vector
+  Compute the maximum absolute value of the locally owned components
 
-  @param pvec copy the values from pvec to this vector
+  @return the local contribution to the l-infinity norm
 */
-void ParOptBasicVec::copyValues( ParOptVec *pvec ){
-  ParOptBasicVec *vec = dynamic_cast<ParOptBasicVec*>(pvec);
+double ParOptVec::localMaxAbs(){
+  ParOptScalar *x;
+  int size = getArray(&x);
 
-  if (vec){
-    memcpy(x, vec->x, size*sizeof(ParOptScalar));
+  double res = 0.0;
+  for ( int i = 0; i < size; i++ ){
+    if (fabs(ParOptRealPart(x[i])) > res){
+      res = fabs(ParOptRealPart(x[i]));
+    }
   }
+
+  return res;
 }
 
 /**
-  Compute the l2 norm of the vector
+  Compute the sum of the absolute values of the locally owned components
 
-  @return the l2 norm of the vector
+  @return the local contribution to the l1 norm
 */
-double ParOptBasicVec::norm(){
+double ParOptVec::localL1Norm(){
+  ParOptScalar *x;
+  int size = getArray(&x);
+
   double res = 0.0;
-#ifdef PAROPT_USE_COMPLEX
   for ( int i = 0; i < size; i++ ){
-    res += (ParOptRealPart(x[i])*ParOptRealPart(x[i]) +
-            ParOptImagPart(x[i])*ParOptImagPart(x[i]));
+    res += fabs(ParOptRealPart(x[i]));
   }
-#else
-  int one = 1;
-  res = BLASdnrm2(&size, x, &one);
-  res *= res;
-#endif
-
-  double sum = 0.0;
-  MPI_Allreduce(&res, &sum, 1, MPI_DOUBLE, MPI_SUM, comm);
 
-  return sqrt(sum);
+  return res;
 }
 
 /**
-  Compute the l-infinity norm of the vector
+  Compute the dot product of the locally owned components
 
-  @return the l-infinity norm of the vector
+  @param vec the other vector in the dot product
+  @return the local contribution to the dot product
 */
-double ParOptBasicVec::maxabs(){
-  double res = 0.0;
+ParOptScalar ParOptVec::localDot( ParOptVec *vec ){
+  ParOptScalar *x, *y;
+  int size = getArray(&x);
+  vec->getArray(&y);
+
+  ParOptScalar res = 0.0;
   for ( int i = 0; i < size; i++ ){
-    if (fabs(ParOptRealPart(x[i])) > res){
-      res = fabs(ParOptRealPart(x[i]));
+    res += x[i]*y[i];
+  }
+
+  return res;
+}
+
+/**
+  Set xvals = x0vals + alpha*pvals and make sure that the result lies
+  strictly within the bounds lb + design_precision <= x and
+  x <= ub - design_precision. Note that x0vals may be the same as
+  xvals.
+
+  @param n the number of entries
+  @param xvals the output values
+  @param x0vals the initial values
+  @param alpha the step length
+  @param pvals the step direction
+  @param lbvals the lower bounds (may be NULL)
+  @param lower_value the scalar lower bound used if lbvals is NULL
+  @param ubvals the upper bounds (may be NULL)
+  @param upper_value the scalar upper bound used if ubvals is NULL
+  @param design_precision the minimum distance to the bounds
+*/
+void ParOptComputeBoundedStep( int n, ParOptScalar *xvals,
+                               const ParOptScalar *x0vals,
+                               ParOptScalar alpha,
+                               const ParOptScalar *pvals,
+                               const ParOptScalar *lbvals,
+                               const ParOptScalar *lower_value,
+                               const ParOptScalar *ubvals,
+                               const ParOptScalar *upper_value,
+                               double design_precision ){
+  // Set the bound values used when only a scalar bound is provided
+  double lbval = 0.0, ubval = 0.0;
+  if (lower_value){
+    lbval = ParOptRealPart(*lower_value);
+  }
+  if (upper_value){
+    ubval = ParOptRealPart(*upper_value);
+  }
+
+  for ( int i = 0; i < n; i++ ){
+    ParOptScalar xval = x0vals[i] + alpha*pvals[i];
+
+    if (lbvals){
+      if (ParOptRealPart(xval) <=
+          ParOptRealPart(lbvals[i]) + design_precision){
+        xval = lbvals[i] + design_precision;
+      }
+    }
+    else if (lower_value){
+      if (ParOptRealPart(xval) <= lbval + design_precision){
+        xval = lbval + design_precision;
+      }
+    }
+
+    if (ubvals){
+      if (ParOptRealPart(xval) + design_precision >=
+          ParOptRealPart(ubvals[i])){
+        xval = ubvals[i] - design_precision;
+      }
+    }
+    else if (upper_value){
+      if (ParOptRealPart(xval) + design_precision >= ubval){
+        xval = ubval - design_precision;
+      }
     }
+
+    xvals[i] = xval;
   }
+}
 
-  double infty_norm = 0.0;
-  MPI_Allreduce(&res, &infty_norm, 1, MPI_DOUBLE, MPI_MAX, comm);
+/**
+  Compute: self <- x0 + alpha*p, adjusted so that the result lies
+  strictly within the bounds
 
-  return infty_norm;
+  @param x0 the initial point (may be this vector)
+  @param alpha the step length
+  @param p the step direction
+  @param lb the lower bound vector (may be NULL)
+  @param lower_value the scalar lower bound used if lb is NULL
+  @param ub the upper bound vector (may be NULL)
+  @param upper_value the scalar upper bound used if ub is NULL
+  @param design_precision the minimum distance to the bounds
+*/
+void ParOptVec::computeBoundedStep( ParOptVec *x0, ParOptScalar alpha,
+                                    ParOptVec *p,
+                                    ParOptVec *lb,
+                                    const ParOptScalar *lower_value,
+                                    ParOptVec *ub,
+                                    const ParOptScalar *upper_value,
+                                    double design_precision ){
+  ParOptScalar *xvals, *x0vals, *pvals;
+  ParOptScalar *lbvals = NULL, *ubvals = NULL;
+  int size = getArray(&xvals);
+  x0->getArray(&x0vals);
+  p->getArray(&pvals);
+  if (lb){
+    lb->getArray(&lbvals);
+  }
+  if (ub){
+    ub->getArray(&ubvals);
+  }
+
+  ParOptComputeBoundedStep(size, xvals, x0vals, alpha, pvals,
+                           lbvals, lower_value, ubvals, upper_value,
+                           design_precision);
 }
 
 /**
-  Compute the l1 norm of the vector
+  Compute the maximum step length along p that keeps the locally owned
+  components positive, given the fraction to the boundary tau
 
-  @return the l1 norm of the vector
+  @param tau the fraction to the boundary
+  @param p the step direction
+  @param max_step the initial maximum step length
+  @return the local maximum step length
 */
-double ParOptBasicVec::l1norm(){
-  double res = 0.0;
+double ParOptVec::localMaxStep( double tau, ParOptVec *p, double max_step ){
+  ParOptScalar *xvals, *pvals;
+  int size = getArray(&xvals);
+  p->getArray(&pvals);
+
+  PAROPT_PRAGMA(omp parallel for schedule(static) reduction(min:max_step))
   for ( int i = 0; i < size; i++ ){
-    res += fabs(ParOptRealPart(x[i]));
+    if (ParOptRealPart(pvals[i]) < 0.0){
+      double numer = ParOptRealPart(xvals[i]);
+      double alpha = -tau*numer/ParOptRealPart(pvals[i]);
+      if (alpha < max_step){
+        max_step = alpha;
+      }
+    }
   }
 
-  double l1_norm = 0.0;
-  MPI_Allreduce(&res, &l1_norm, 1, MPI_DOUBLE, MPI_SUM, comm);
-
-  return l1_norm;
+  return max_step;
 }
 
 /**
-  Compute the dot-product of two vectors and return the result.
+  Compute the maximum step length along p that keeps the locally owned
+  components within the bounds, given the fraction to the boundary tau
 
-  @param pvec the other vector in the dot product
-  @return the dot product of the two vectors
+  @param tau the fraction to the boundary
+  @param p the step direction
+  @param lb the lower bounds (NULL if not used)
+  @param ub the upper bounds (NULL if not used)
+  @param max_step the initial maximum step length
+  @return the local maximum step length
 */
-ParOptScalar ParOptBasicVec::dot( ParOptVec *pvec ){
-  ParOptBasicVec *vec = dynamic_cast<ParOptBasicVec*>(pvec);
+double ParOptVec::localMaxBoundStep( double tau, ParOptVec *p,
+                                     ParOptVec *lb, ParOptVec *ub,
+                                     double max_step ){
+  ParOptScalar *xvals, *pvals;
+  int size = getArray(&xvals);
+  p->getArray(&pvals);
 
-  ParOptScalar sum = 0.0;
-  if (vec){
-    ParOptScalar res = 0.0;
-#ifdef PAROPT_USE_COMPLEX
+  if (lb){
+    ParOptScalar *lbvals;
+    lb->getArray(&lbvals);
+
+    PAROPT_PRAGMA(omp parallel for schedule(static) reduction(min:max_step))
     for ( int i = 0; i < size; i++ ){
-      res += x[i]*vec->x[i];
+      if (ParOptRealPart(pvals[i]) < 0.0){
+        double numer = ParOptRealPart(xvals[i] - lbvals[i]);
+        double alpha = -tau*numer/ParOptRealPart(pvals[i]);
+        if (alpha < max_step){
+          max_step = alpha;
+        }
+      }
     }
-#else
-    int one = 1;
-    res = BLASddot(&size, x, &one, vec->x, &one);
-#endif
+  }
 
-    MPI_Allreduce(&res, &sum, 1, PAROPT_MPI_TYPE, MPI_SUM, comm);
+  if (ub){
+    ParOptScalar *ubvals;
+    ub->getArray(&ubvals);
+
+    PAROPT_PRAGMA(omp parallel for schedule(static) reduction(min:max_step))
+    for ( int i = 0; i < size; i++ ){
+      if (ParOptRealPart(pvals[i]) > 0.0){
+        double numer = ParOptRealPart(ubvals[i] - xvals[i]);
+        double alpha = tau*numer/ParOptRealPart(pvals[i]);
+        if (alpha < max_step){
+          max_step = alpha;
+        }
+      }
+    }
   }
 
-  return sum;
+  return max_step;
 }
 
 /**
-  Compute multiple dot-products simultaneously. This reduces the
-  parallel communication overhead.
+  Add the local contributions to the bound complementarity at the
+  point x + alpha_x*px with multipliers z + alpha_z*pz. Only the
+  components with finite bounds contribute and each one adds 1 to the
+  count. When px is NULL, the complementarity is evaluated at the
+  current point.
 
-  @param pvecs an array of vectors
-  @param output an array of the dot product results
+  @param alpha_x the step length in the design variables
+  @param px the design variable step (may be NULL)
+  @param alpha_z the step length in the multipliers
+  @param lb the lower bounds (NULL if not used)
+  @param zl the lower bound multipliers
+  @param pzl the lower bound multiplier step
+  @param ub the upper bounds (NULL if not used)
+  @param zu the upper bound multipliers
+  @param pzu the upper bound multiplier step
+  @param max_bound_val bounds with a magnitude above this are inactive
+  @param product the complementarity product to add to
+  @param count the number of terms to add to
 */
-void ParOptBasicVec::mdot( ParOptVec **pvecs, int nvecs, ParOptScalar *output ){
-  for ( int i = 0; i < nvecs; i++ ){
-    output[i] = 0.0;
-    ParOptBasicVec *vec = dynamic_cast<ParOptBasicVec*>(pvecs[i]);
+void ParOptVec::localBoundComp( double alpha_x, ParOptVec *px,
+                                double alpha_z,
+                                ParOptVec *lb, ParOptVec *zl, ParOptVec *pzl,
+                                ParOptVec *ub, ParOptVec *zu, ParOptVec *pzu,
+                                double max_bound_val,
+                                ParOptScalar *product, ParOptScalar *count ){
+  ParOptScalar *xvals, *pxvals = NULL;
+  int size = getArray(&xvals);
+  if (px){
+    px->getArray(&pxvals);
+  }
 
-    if (vec){
-#ifdef PAROPT_USE_COMPLEX
-      for ( int j = 0; j < size; j++ ){
-        output[i] += x[j]*vec->x[j];
+  ParOptScalar prod = *product, sum = *count;
+
+  if (lb){
+    ParOptScalar *lbvals, *zlvals, *pzlvals;
+    lb->getArray(&lbvals);
+    zl->getArray(&zlvals);
+    if (pxvals){
+      pzl->getArray(&pzlvals);
+      for ( int i = 0; i < size; i++ ){
+        if (ParOptRealPart(lbvals[i]) > -max_bound_val){
+          ParOptScalar xnew = xvals[i] + alpha_x*pxvals[i];
+          prod += (zlvals[i] + alpha_z*pzlvals[i])*(xnew - lbvals[i]);
+          sum += 1.0;
+        }
+      }
+    }
+    else {
+      for ( int i = 0; i < size; i++ ){
+        if (ParOptRealPart(lbvals[i]) > -max_bound_val){
+          prod += zlvals[i]*(xvals[i] - lbvals[i]);
+          sum += 1.0;
+        }
+      }
+    }
+  }
+
+  if (ub){
+    ParOptScalar *ubvals, *zuvals, *pzuvals;
+    ub->getArray(&ubvals);
+    zu->getArray(&zuvals);
+    if (pxvals){
+      pzu->getArray(&pzuvals);
+      for ( int i = 0; i < size; i++ ){
+        if (ParOptRealPart(ubvals[i]) < max_bound_val){
+          ParOptScalar xnew = xvals[i] + alpha_x*pxvals[i];
+          prod += (zuvals[i] + alpha_z*pzuvals[i])*(ubvals[i] - xnew);
+          sum += 1.0;
+        }
+      }
+    }
+    else {
+      for ( int i = 0; i < size; i++ ){
+        if (ParOptRealPart(ubvals[i]) < max_bound_val){
+          prod += zuvals[i]*(ubvals[i] - xvals[i]);
+          sum += 1.0;
+        }
       }
-#else
-      int one = 1;
-      output[i] = BLASddot(&size, x, &one, vec->x, &one);
-#endif
     }
   }
 
-  MPI_Allreduce(MPI_IN_PLACE, output, nvecs, PAROPT_MPI_TYPE, MPI_SUM, comm);
+  *product = prod;
+  *count = sum;
 }
 
 /**
-  Scale the components of the vector
-  
-  @param alpha the scalar factor
+  Compute the inverse of the diagonal of the barrier Hessian:
+
+  self <- 1/(b + sigma + zl/(x - lb) + zu/(ub - x))
+
+  where b is either the entries of h or the scalar b0. Only the bounds
+  that are finite contribute.
+
+  @param b0 the diagonal used when h is NULL
+  @param h the diagonal Hessian entries (may be NULL)
+  @param sigma the diagonal shift
+  @param x the design variables
+  @param lb the lower bounds (NULL if not used)
+  @param zl the lower bound multipliers
+  @param ub the upper bounds (NULL if not used)
+  @param zu the upper bound multipliers
+  @param max_bound_val bounds with a magnitude above this are inactive
 */
-void ParOptBasicVec::scale( ParOptScalar alpha ){
-#ifdef PAROPT_USE_COMPLEX
-  for ( int i = 0; i < size; i++ ){
-    x[i] *= alpha;
+void ParOptVec::computeBarrierDiag( ParOptScalar b0, ParOptVec *h,
+                                    ParOptScalar sigma, ParOptVec *x,
+                                    ParOptVec *lb, ParOptVec *zl,
+                                    ParOptVec *ub, ParOptVec *zu,
+                                    double max_bound_val ){
+  ParOptScalar *cvals, *hvals = NULL, *xvals;
+  ParOptScalar *lbvals = NULL, *zlvals = NULL;
+  ParOptScalar *ubvals = NULL, *zuvals = NULL;
+  int size = getArray(&cvals);
+  x->getArray(&xvals);
+  if (h){
+    h->getArray(&hvals);
   }
-#else
-  int one = 1;
-  BLASdscal(&size, &alpha, x, &one);
-#endif
+  if (lb){
+    lb->getArray(&lbvals);
+    zl->getArray(&zlvals);
+  }
+  if (ub){
+    ub->getArray(&ubvals);
+    zu->getArray(&zuvals);
+  }
+
+  if (lbvals && ubvals){
+    PAROPT_OMP_FOR
+    for ( int i = 0; i < size; i++ ){
+      ParOptScalar bi = b0;
+      if (hvals){ bi = hvals[i]; }
+      if (ParOptRealPart(lbvals[i]) > -max_bound_val &&
+          ParOptRealPart(ubvals[i]) < max_bound_val){
+        cvals[i] = 1.0/(bi + sigma +
+                        zlvals[i]/(xvals[i] - lbvals[i]) +
+                        zuvals[i]/(ubvals[i] - xvals[i]));
+      }
+      else if (ParOptRealPart(lbvals[i]) > -max_bound_val){
+        cvals[i] = 1.0/(bi + sigma + zlvals[i]/(xvals[i] - lbvals[i]));
+      }
+      else if (ParOptRealPart(ubvals[i]) < max_bound_val){
+        cvals[i] = 1.0/(bi + sigma + zuvals[i]/(ubvals[i] - xvals[i]));
+      }
+      else {
+        cvals[i] = 1.0/(bi + sigma);
+      }
+    }
+  }
+  else if (lbvals){
+    PAROPT_OMP_FOR
+    for ( int i = 0; i < size; i++ ){
+      ParOptScalar bi = b0;
+      if (hvals){ bi = hvals[i]; }
+      if (ParOptRealPart(lbvals[i]) > -max_bound_val){
+        cvals[i] = 1.0/(bi + sigma + zlvals[i]/(xvals[i] - lbvals[i]));
+      }
+      else {
+        cvals[i] = 1.0/(bi + sigma);
+      }
+    }
+  }
+  else if (ubvals){
+    PAROPT_OMP_FOR
+    for ( int i = 0; i < size; i++ ){
+      ParOptScalar bi = b0;
+      if (hvals){ bi = hvals[i]; }
+      if (ParOptRealPart(ubvals[i]) < max_bound_val){
+        cvals[i] = 1.0/(bi + sigma + zuvals[i]/(ubvals[i] - xvals[i]));
+      }
+      else {
+        cvals[i] = 1.0/(bi + sigma);
+      }
+    }
+  }
+  else {
+    PAROPT_OMP_FOR
+    for ( int i = 0; i < size; i++ ){
+      ParOptScalar bi = b0;
+      if (hvals){ bi = hvals[i]; }
+      cvals[i] = 1.0/(bi + sigma);
+    }
+  }
+}
+
+#ifdef PAROPT_USE_OPENMP
+/*
+  The threaded reductions are computed over fixed-size blocks of the
+  local array. The partial results for each block are then summed in
+  order, so that the result does not depend on the number of threads.
+*/
+static const int PAROPT_OMP_BLOCK_SIZE = 4096;
+
+static inline int ParOptNumBlocks( int size ){
+  return (size + PAROPT_OMP_BLOCK_SIZE - 1)/PAROPT_OMP_BLOCK_SIZE;
 }
+#endif // PAROPT_USE_OPENMP
+
+/*
+  The vector storage allocated on this processor
+*/
+static double paropt_vec_bytes = 0.0;
+static double paropt_vec_peak_bytes = 0.0;
 
 /**
-  Compute: self <- self + alpha*x
+  Allocate storage aligned to PAROPT_VEC_ALIGNMENT bytes.
+
+  When compiled with OpenMP, the memory is first touched by the
+  threads that will operate on it so that the pages are placed on the
+  local NUMA domain. If the entries are not zeroed, the caller is
+  responsible for the first touch.
+
+  @param size the number of entries
+  @param zero_entries flag indicating whether to zero the entries
+  @return the array (NULL if the size is zero)
 */
-void ParOptBasicVec::axpy( ParOptScalar alpha, ParOptVec *pvec ){
-  ParOptBasicVec *vec = dynamic_cast<ParOptBasicVec*>(pvec);
+ParOptScalar *ParOptAllocAligned( int size, int zero_entries ){
+  if (size <= 0){
+    return NULL;
+  }
 
-  if (vec){
-#ifdef PAROPT_USE_COMPLEX
+  // Round the allocation up to a multiple of the alignment
+  size_t bytes = size*sizeof(ParOptScalar);
+  bytes = PAROPT_VEC_ALIGNMENT*((bytes + PAROPT_VEC_ALIGNMENT - 1)/
+                                PAROPT_VEC_ALIGNMENT);
+  void *ptr = NULL;
+  if (posix_memalign(&ptr, PAROPT_VEC_ALIGNMENT, bytes) != 0){
+    fprintf(stderr, "ParOpt: Failed to allocate %zu bytes\n", bytes);
+    return NULL;
+  }
+
+  ParOptScalar *x = (ParOptScalar*)ptr;
+  if (zero_entries){
+#ifdef PAROPT_USE_OPENMP
+    PAROPT_OMP_FOR
     for ( int i = 0; i < size; i++ ){
-      x[i] = x[i] + alpha*vec->x[i];
+      x[i] = 0.0;
     }
 #else
-    int one = 1;
-    BLASdaxpy(&size, &alpha, vec->x, &one, x, &one);
-#endif
+    memset(x, 0, size*sizeof(ParOptScalar));
+#endif // PAROPT_USE_OPENMP
+  }
+
+  paropt_vec_bytes += bytes;
+  if (paropt_vec_bytes > paropt_vec_peak_bytes){
+    paropt_vec_peak_bytes = paropt_vec_bytes;
   }
+
+  return x;
 }
 
 /**
-  Retrieve the locally stored values from the array
+  Free storage allocated with ParOptAllocAligned
 
-  @param array pointer assigned to the memory location of the 
-  local vector components
+  @param array the array
+  @param size the number of entries used for the allocation
 */
-int ParOptBasicVec::getArray( ParOptScalar **array ){
+void ParOptFreeAligned( ParOptScalar *array, int size ){
   if (array){
-    *array = x;
+    size_t bytes = size*sizeof(ParOptScalar);
+    bytes = PAROPT_VEC_ALIGNMENT*((bytes + PAROPT_VEC_ALIGNMENT - 1)/
+                                  PAROPT_VEC_ALIGNMENT);
+    paropt_vec_bytes -= bytes;
+    free(array);
   }
-  return size;
+}
+
+/**
+  Get the vector storage currently allocated on this processor and
+  the peak allocation
+
+  @param current the number of bytes currently allocated
+  @param peak the peak number of bytes allocated
+*/
+void ParOptGetVecMemoryStats( double *current, double *peak ){
+  if (current){ *current = paropt_vec_bytes; }
+  if (peak){ *peak = paropt_vec_peak_bytes; }
+}
+
+/**
+  Create a parallel vector for optimization
+
+  @param comm the communicator for this vector
+  @param n the number of vector components on this processor
+*/
+ParOptBasicVec::ParOptBasicVec( MPI_Comm _comm, int n ){
+  comm = _comm;
+  size = full_size = n;
+  owns_data = 1;
+  pool = NULL;
+  x = ParOptAllocAligned(size);
+  work_size = 0;
+  work = NULL;
+}
+
+/**
+  Create a parallel vector that uses externally allocated storage.
+
+  The array is not freed when the vector is deleted, and must remain
+  allocated for the lifetime of the vector. This is used to create
+  views of the columns of a ParOptMultiVec.
+
+  @param comm the communicator for this vector
+  @param n the number of vector components on this processor
+  @param array the storage for the local vector components
+*/
+ParOptBasicVec::ParOptBasicVec( MPI_Comm _comm, int n,
+                                ParOptScalar *array ){
+  comm = _comm;
+  size = full_size = n;
+  owns_data = 0;
+  pool = NULL;
+  x = array;
+  work_size = 0;
+  work = NULL;
+}
+
+/**
+  Create a parallel vector with storage taken from the pool. The
+  storage is returned to the pool when the vector is deleted.
+
+  @param pool the pool of vector storage
+*/
+ParOptBasicVec::ParOptBasicVec( ParOptVecPool *_pool ){
+  pool = _pool;
+  pool->incref();
+  comm = pool->getMPIComm();
+  size = full_size = pool->getSize();
+  owns_data = 1;
+  x = pool->getArray();
+  work_size = 0;
+  work = NULL;
+}
+
+/**
+  Free the internally stored data
+*/
+ParOptBasicVec::~ParOptBasicVec(){
+  if (pool){
+    pool->returnArray(x);
+    pool->decref();
+  }
+  else if (owns_data){
+    ParOptFreeAligned(x, full_size);
+  }
+  if (work){
+    delete [] work;
+  }
+}
+
+/*
+  Get the storage for the partial sums of a threaded reduction. The
+  storage is only re-allocated when more entries are required.
+*/
+ParOptScalar *ParOptBasicVec::getReduceWork( int n ){
+  if (n > work_size){
+    if (work){
+      delete [] work;
+    }
+    work_size = n;
+    work = new ParOptScalar[ work_size ];
+  }
+  return work;
+}
+
+/**
+  Set the vector value
+
+  @param alpha the scalar value to set in all components
+*/
+void ParOptBasicVec::set( ParOptScalar alpha ){
+  PAROPT_OMP_FOR
+  for ( int i = 0; i < size; i++ ){
+    x[i] = alpha;
+  }
+}
+
+/**
+  Zero the entries of the vector
+*/
+void ParOptBasicVec::zeroEntries(){
+#ifdef PAROPT_USE_OPENMP
+  PAROPT_OMP_FOR
+  for ( int i = 0; i < size; i++ ){
+    x[i] = 0.0;
+  }
+#else
+  memset(x, 0, size*sizeof(ParOptScalar));
+#endif // PAROPT_USE_OPENMP
+}
+
+/**
+  Copy the values from the given vector
+
+  @param pvec copy the values from pvec to this vector
+*/
+void ParOptBasicVec::copyValues( ParOptVec *pvec ){
+  ParOptBasicVec *vec = dynamic_cast<ParOptBasicVec*>(pvec);
+
+  if (vec){
+#ifdef PAROPT_USE_OPENMP
+    const ParOptScalar *xvals = vec->x;
+    PAROPT_OMP_FOR
+    for ( int i = 0; i < size; i++ ){
+      x[i] = xvals[i];
+    }
+#else
+    memcpy(x, vec->x, size*sizeof(ParOptScalar));
+#endif // PAROPT_USE_OPENMP
+  }
+}
+
+/**
+  Compute the sum of the squares of the locally owned components
+
+  @return the local contribution to the squared l2 norm
+*/
+double ParOptBasicVec::localNormSquared(){
+  double res = 0.0;
+#ifdef PAROPT_USE_OPENMP
+  int nblocks = ParOptNumBlocks(size);
+  ParOptScalar *partial = getReduceWork(nblocks);
+
+  PAROPT_OMP_FOR
+  for ( int k = 0; k < nblocks; k++ ){
+    int end = (k+1)*PAROPT_OMP_BLOCK_SIZE;
+    if (end > size){ end = size; }
+
+    double sum = 0.0;
+    for ( int i = k*PAROPT_OMP_BLOCK_SIZE; i < end; i++ ){
+      sum += (ParOptRealPart(x[i])*ParOptRealPart(x[i]) +
+              ParOptImagPart(x[i])*ParOptImagPart(x[i]));
+    }
+    partial[k] = sum;
+  }
+
+  for ( int k = 0; k < nblocks; k++ ){
+    res += ParOptRealPart(partial[k]);
+  }
+#elif defined(PAROPT_USE_COMPLEX)
+  for ( int i = 0; i < size; i++ ){
+    res += (ParOptRealPart(x[i])*ParOptRealPart(x[i]) +
+            ParOptImagPart(x[i])*ParOptImagPart(x[i]));
+  }
+#else
+  int one = 1;
+  res = BLASdnrm2(&size, x, &one);
+  res *= res;
+#endif
+
+  return res;
+}
+
+/**
+  Compute the maximum absolute value of the locally owned components
+
+  @return the local contribution to the l-infinity norm
+*/
+double ParOptBasicVec::localMaxAbs(){
+  double res = 0.0;
+  PAROPT_PRAGMA(omp parallel for schedule(static) reduction(max:res))
+  for ( int i = 0; i < size; i++ ){
+    if (fabs(ParOptRealPart(x[i])) > res){
+      res = fabs(ParOptRealPart(x[i]));
+    }
+  }
+
+  return res;
+}
+
+/**
+  Compute the sum of the absolute values of the locally owned components
+
+  @return the local contribution to the l1 norm
+*/
+double ParOptBasicVec::localL1Norm(){
+  double res = 0.0;
+#ifdef PAROPT_USE_OPENMP
+  int nblocks = ParOptNumBlocks(size);
+  ParOptScalar *partial = getReduceWork(nblocks);
+
+  PAROPT_OMP_FOR
+  for ( int k = 0; k < nblocks; k++ ){
+    int end = (k+1)*PAROPT_OMP_BLOCK_SIZE;
+    if (end > size){ end = size; }
+
+    double sum = 0.0;
+    for ( int i = k*PAROPT_OMP_BLOCK_SIZE; i < end; i++ ){
+      sum += fabs(ParOptRealPart(x[i]));
+    }
+    partial[k] = sum;
+  }
+
+  for ( int k = 0; k < nblocks; k++ ){
+    res += ParOptRealPart(partial[k]);
+  }
+#else
+  for ( int i = 0; i < size; i++ ){
+    res += fabs(ParOptRealPart(x[i]));
+  }
+#endif // PAROPT_USE_OPENMP
+
+  return res;
+}
+
+/**
+  Compute the dot product of the locally owned components
+
+  @param pvec the other vector in the dot product
+  @return the local contribution to the dot product
+*/
+ParOptScalar ParOptBasicVec::localDot( ParOptVec *pvec ){
+  ParOptBasicVec *vec = dynamic_cast<ParOptBasicVec*>(pvec);
+
+  ParOptScalar res = 0.0;
+  if (vec){
+#ifdef PAROPT_USE_OPENMP
+    const ParOptScalar *y = vec->x;
+    int nblocks = ParOptNumBlocks(size);
+    ParOptScalar *partial = getReduceWork(nblocks);
+
+    PAROPT_OMP_FOR
+    for ( int k = 0; k < nblocks; k++ ){
+      int end = (k+1)*PAROPT_OMP_BLOCK_SIZE;
+      if (end > size){ end = size; }
+
+      ParOptScalar sum = 0.0;
+      for ( int i = k*PAROPT_OMP_BLOCK_SIZE; i < end; i++ ){
+        sum += x[i]*y[i];
+      }
+      partial[k] = sum;
+    }
+
+    for ( int k = 0; k < nblocks; k++ ){
+      res += partial[k];
+    }
+#elif defined(PAROPT_USE_COMPLEX)
+    for ( int i = 0; i < size; i++ ){
+      res += x[i]*vec->x[i];
+    }
+#else
+    int one = 1;
+    res = BLASddot(&size, x, &one, vec->x, &one);
+#endif
+  }
+
+  return res;
+}
+
+/**
+  Compute the l2 norm of the vector
+
+  @return the l2 norm of the vector
+*/
+double ParOptBasicVec::norm(){
+  double res = localNormSquared();
+
+  double sum = 0.0;
+  ParOptAllreduce(&res, &sum, 1, MPI_DOUBLE, MPI_SUM, comm);
+
+  return sqrt(sum);
+}
+
+/**
+  Compute the l-infinity norm of the vector
+
+  @return the l-infinity norm of the vector
+*/
+double ParOptBasicVec::maxabs(){
+  double res = localMaxAbs();
+
+  double infty_norm = 0.0;
+  ParOptAllreduce(&res, &infty_norm, 1, MPI_DOUBLE, MPI_MAX, comm);
+
+  return infty_norm;
+}
+
+/**
+  Compute the l1 norm of the vector
+
+  @return the l1 norm of the vector
+*/
+double ParOptBasicVec::l1norm(){
+  double res = localL1Norm();
+
+  double l1_norm = 0.0;
+  ParOptAllreduce(&res, &l1_norm, 1, MPI_DOUBLE, MPI_SUM, comm);
+
+  return l1_norm;
+}
+
+/**
+  Compute the dot-product of two vectors and return the result.
+
+  @param pvec the other vector in the dot product
+  @return the dot product of the two vectors
+*/
+ParOptScalar ParOptBasicVec::dot( ParOptVec *pvec ){
+  ParOptBasicVec *vec = dynamic_cast<ParOptBasicVec*>(pvec);
+
+  ParOptScalar sum = 0.0;
+  if (vec){
+    ParOptScalar res = localDot(vec);
+    ParOptAllreduce(&res, &sum, 1, PAROPT_MPI_TYPE, MPI_SUM, comm);
+  }
+
+  return sum;
+}
+
+/**
+  Compute multiple dot-products simultaneously. This reduces the
+  parallel communication overhead.
+
+  @param pvecs an array of vectors
+  @param output an array of the dot product results
+*/
+void ParOptBasicVec::mdot( ParOptVec **pvecs, int nvecs, ParOptScalar *output ){
+#ifdef PAROPT_USE_OPENMP
+  // Compute all the dot products for each block while it is in cache
+  int nblocks = ParOptNumBlocks(size);
+  ParOptScalar *partial = getReduceWork(nblocks*nvecs);
+
+  PAROPT_OMP_FOR
+  for ( int k = 0; k < nblocks; k++ ){
+    int start = k*PAROPT_OMP_BLOCK_SIZE;
+    int end = start + PAROPT_OMP_BLOCK_SIZE;
+    if (end > size){ end = size; }
+
+    for ( int j = 0; j < nvecs; j++ ){
+      ParOptScalar sum = 0.0;
+      ParOptBasicVec *vec = dynamic_cast<ParOptBasicVec*>(pvecs[j]);
+      if (vec){
+        const ParOptScalar *y = vec->x;
+        for ( int i = start; i < end; i++ ){
+          sum += x[i]*y[i];
+        }
+      }
+      partial[j + k*nvecs] = sum;
+    }
+  }
+
+  for ( int j = 0; j < nvecs; j++ ){
+    output[j] = 0.0;
+  }
+  for ( int k = 0; k < nblocks; k++ ){
+    for ( int j = 0; j < nvecs; j++ ){
+      output[j] += partial[j + k*nvecs];
+    }
+  }
+#else
+  for ( int i = 0; i < nvecs; i++ ){
+    output[i] = 0.0;
+    ParOptBasicVec *vec = dynamic_cast<ParOptBasicVec*>(pvecs[i]);
+
+    if (vec){
+#ifdef PAROPT_USE_COMPLEX
+      for ( int j = 0; j < size; j++ ){
+        output[i] += x[j]*vec->x[j];
+      }
+#else
+      int one = 1;
+      output[i] = BLASddot(&size, x, &one, vec->x, &one);
+#endif
+    }
+  }
+#endif // PAROPT_USE_OPENMP
+
+  ParOptAllreduce(MPI_IN_PLACE, output, nvecs, PAROPT_MPI_TYPE, MPI_SUM, comm);
+}
+
+/**
+  Scale the components of the vector
+
+  @param alpha the scalar factor
+*/
+void ParOptBasicVec::scale( ParOptScalar alpha ){
+#if defined(PAROPT_USE_COMPLEX) || defined(PAROPT_USE_OPENMP)
+  PAROPT_OMP_FOR
+  for ( int i = 0; i < size; i++ ){
+    x[i] *= alpha;
+  }
+#else
+  int one = 1;
+  BLASdscal(&size, &alpha, x, &one);
+#endif
+}
+
+/**
+  Compute: self <- self + alpha*x
+*/
+void ParOptBasicVec::axpy( ParOptScalar alpha, ParOptVec *pvec ){
+  ParOptBasicVec *vec = dynamic_cast<ParOptBasicVec*>(pvec);
+
+  if (vec){
+#if defined(PAROPT_USE_COMPLEX) || defined(PAROPT_USE_OPENMP)
+    const ParOptScalar *xvals = vec->x;
+    PAROPT_OMP_FOR
+    for ( int i = 0; i < size; i++ ){
+      x[i] = x[i] + alpha*xvals[i];
+    }
+#else
+    int one = 1;
+    BLASdaxpy(&size, &alpha, vec->x, &one, x, &one);
+#endif
+  }
+}
+
+/**
+  Retrieve the locally stored values from the array
+
+  @param array pointer assigned to the memory location of the
+  local vector components
+*/
+int ParOptBasicVec::getArray( ParOptScalar **array ){
+  if (array){
+    *array = x;
+  }
+  return size;
+}
+
+/**
+  Compute: self <- alpha*x + beta*self in a single pass
+
+  When beta is zero, the existing values are not read.
+
+  @param alpha the scalar multiplying x
+  @param beta the scalar multiplying this vector
+  @param pvec the input vector
+*/
+void ParOptBasicVec::axpby( ParOptScalar alpha, ParOptScalar beta,
+                            ParOptVec *pvec ){
+  ParOptBasicVec *vec = dynamic_cast<ParOptBasicVec*>(pvec);
+
+  if (vec){
+    const ParOptScalar *xvals = vec->x;
+    if (beta == 0.0){
+      PAROPT_OMP_FOR
+      for ( int i = 0; i < size; i++ ){
+        x[i] = alpha*xvals[i];
+      }
+    }
+    else {
+      PAROPT_OMP_FOR
+      for ( int i = 0; i < size; i++ ){
+        x[i] = alpha*xvals[i] + beta*x[i];
+      }
+    }
+  }
+}
+
+/**
+  Compute: self <- alpha*x + y in a single pass
+
+  This replaces the sequence copyValues(y), axpy(alpha, x). Each entry
+  is read before it is written, so x and y may both alias this vector.
+
+  @param alpha the scalar multiplying x
+  @param pxvec the first input vector
+  @param pyvec the second input vector
+*/
+void ParOptBasicVec::waxpy( ParOptScalar alpha, ParOptVec *pxvec,
+                            ParOptVec *pyvec ){
+  ParOptBasicVec *xvec = dynamic_cast<ParOptBasicVec*>(pxvec);
+  ParOptBasicVec *yvec = dynamic_cast<ParOptBasicVec*>(pyvec);
+
+  if (xvec && yvec){
+    const ParOptScalar *xvals = xvec->x;
+    const ParOptScalar *yvals = yvec->x;
+    PAROPT_OMP_FOR
+    for ( int i = 0; i < size; i++ ){
+      x[i] = alpha*xvals[i] + yvals[i];
+    }
+  }
+}
+
+/**
+  Compute the component-wise product and quotient: self <- a.*x./b
+
+  @param pavec the first vector in the product
+  @param pxvec the second vector in the product
+  @param pbvec the vector of divisors
+*/
+void ParOptBasicVec::pointwiseMultDiv( ParOptVec *pavec, ParOptVec *pxvec,
+                                       ParOptVec *pbvec ){
+  ParOptBasicVec *avec = dynamic_cast<ParOptBasicVec*>(pavec);
+  ParOptBasicVec *xvec = dynamic_cast<ParOptBasicVec*>(pxvec);
+  ParOptBasicVec *bvec = dynamic_cast<ParOptBasicVec*>(pbvec);
+
+  if (avec && xvec && bvec){
+    const ParOptScalar *avals = avec->x;
+    const ParOptScalar *xvals = xvec->x;
+    const ParOptScalar *bvals = bvec->x;
+    PAROPT_OMP_FOR
+    for ( int i = 0; i < size; i++ ){
+      x[i] = avals[i]*xvals[i]/bvals[i];
+    }
+  }
+}
+
+/**
+  Compress the vector in place to the free variables of the active
+  set. After compression, all operations act only on the free
+  entries.
+
+  @param active the active set index map
+  @return non-zero if the vector is already compressed
+*/
+int ParOptBasicVec::compressEntries( ParOptActiveSet *active ){
+  if (size != full_size || active->getNumVars() != full_size){
+    return 1;
+  }
+  active->compress(x);
+  size = active->getNumFree();
+  return 0;
+}
+
+/**
+  Expand the compressed vector in place to the full set of variables
+
+  @param active the active set index map used to compress the vector
+  @param fixed_values values for the fixed entries (may be NULL)
+  @return non-zero if the vector is not compressed with this map
+*/
+int ParOptBasicVec::expandEntries( ParOptActiveSet *active,
+                                   const ParOptScalar *fixed_values ){
+  if (active->getNumVars() != full_size ||
+      active->getNumFree() != size){
+    return 1;
+  }
+  active->expand(x, fixed_values);
+  size = full_size;
+  return 0;
+}
+
+// The types of entries stored in the reduction context
+enum ParOptReductionType { PAROPT_REDUCE_SUM,
+                           PAROPT_REDUCE_NORM,
+                           PAROPT_REDUCE_MAX };
+
+// The collective used to reduce the queued entries
+enum ParOptReductionMode { PAROPT_REDUCE_SUM_ONLY,
+                           PAROPT_REDUCE_MAX_ONLY,
+                           PAROPT_REDUCE_MIXED };
+
+/**
+  Create a context for batching global reductions
+
+  @param comm the communicator over which the reductions are performed
+*/
+ParOptReductionContext::ParOptReductionContext( MPI_Comm _comm ){
+  comm = _comm;
+  nentries = 0;
+  max_entries = 16;
+  types = new int[ max_entries ];
+  values = new ParOptScalar[ max_entries ];
+  max_buffer = 0;
+  buffer = NULL;
+  reduce_mode = PAROPT_REDUCE_SUM_ONLY;
+  packed_size = 0;
+  request = MPI_REQUEST_NULL;
+  packed_type_size = 0;
+  packed_type = MPI_DATATYPE_NULL;
+  packed_op = MPI_OP_NULL;
+}
+
+/**
+  Free the data associated with the reduction context
+*/
+ParOptReductionContext::~ParOptReductionContext(){
+  delete [] types;
+  delete [] values;
+  if (buffer){
+    delete [] buffer;
+  }
+  if (packed_type != MPI_DATATYPE_NULL){
+    MPI_Type_free(&packed_type);
+  }
+  if (packed_op != MPI_OP_NULL){
+    MPI_Op_free(&packed_op);
+  }
+}
+
+/**
+  Clear the queued entries
+*/
+void ParOptReductionContext::reset(){
+  nentries = 0;
+}
+
+/**
+  Add an entry to the context, extending the storage if required
+
+  @param type the type of reduction
+  @param value the local contribution
+  @return the handle for the entry
+*/
+int ParOptReductionContext::addEntry( int type, ParOptScalar value ){
+  if (nentries >= max_entries){
+    max_entries = 2*max_entries;
+    int *new_types = new int[ max_entries ];
+    ParOptScalar *new_values = new ParOptScalar[ max_entries ];
+    memcpy(new_types, types, nentries*sizeof(int));
+    memcpy(new_values, values, nentries*sizeof(ParOptScalar));
+    delete [] types;
+    delete [] values;
+    types = new_types;
+    values = new_values;
+  }
+
+  types[nentries] = type;
+  values[nentries] = value;
+  nentries++;
+
+  return nentries-1;
+}
+
+/**
+  Queue the l2 norm of the vector
+
+  @param x the vector
+  @return the handle for the result
+*/
+int ParOptReductionContext::addNorm( ParOptVec *x ){
+  return addEntry(PAROPT_REDUCE_NORM, x->localNormSquared());
+}
+
+/**
+  Queue the l1 norm of the vector
+
+  @param x the vector
+  @return the handle for the result
+*/
+int ParOptReductionContext::addL1Norm( ParOptVec *x ){
+  return addEntry(PAROPT_REDUCE_SUM, x->localL1Norm());
+}
+
+/**
+  Queue the l-infinity norm of the vector
+
+  @param x the vector
+  @return the handle for the result
+*/
+int ParOptReductionContext::addMaxAbs( ParOptVec *x ){
+  return addEntry(PAROPT_REDUCE_MAX, x->localMaxAbs());
+}
+
+/**
+  Queue the dot product of two vectors
+
+  @param x the first vector
+  @param y the second vector
+  @return the handle for the result
+*/
+int ParOptReductionContext::addDot( ParOptVec *x, ParOptVec *y ){
+  return addEntry(PAROPT_REDUCE_SUM, x->localDot(y));
+}
+
+/**
+  Queue a locally computed value that is summed across all processors
+
+  @param value the local contribution to the sum
+  @return the handle for the result
+*/
+int ParOptReductionContext::addSum( ParOptScalar value ){
+  return addEntry(PAROPT_REDUCE_SUM, value);
+}
+
+/**
+  Queue a locally computed value whose maximum is found across all
+  processors
+
+  @param value the local contribution
+  @return the handle for the result
+*/
+int ParOptReductionContext::addMax( double value ){
+  return addEntry(PAROPT_REDUCE_MAX, value);
+}
+
+/*
+  Combine the packed reduction buffers. Each element of the datatype
+  is an entire packed buffer: the first entry stores the number of
+  doubles that are summed, the remaining entries are reduced with a
+  maximum.
+*/
+void ParOptReductionContext::sumMaxOp( void *_in, void *_inout,
+                                       int *len, MPI_Datatype *dtype ){
+  int type_size = 0;
+  MPI_Type_size(*dtype, &type_size);
+  int size = type_size/sizeof(double);
+
+  for ( int k = 0; k < *len; k++ ){
+    double *in = &((double*)_in)[k*size];
+    double *inout = &((double*)_inout)[k*size];
+
+    int nsum = (int)in[0];
+    for ( int i = 1; i <= nsum; i++ ){
+      inout[i] += in[i];
+    }
+    for ( int i = nsum+1; i < size; i++ ){
+      if (in[i] > inout[i]){
+        inout[i] = in[i];
+      }
+    }
+  }
+}
+
+/**
+  Pack the queued entries for the reduction. The values are reduced
+  in place when only sums are queued, otherwise the entries are
+  packed into the buffer. When both sums and maxima are queued, the
+  packed buffer is reduced as a single element of a contiguous
+  datatype so that it is never split by the MPI implementation.
+*/
+void ParOptReductionContext::packEntries(){
+  int nsum = 0, nmax = 0;
+  for ( int i = 0; i < nentries; i++ ){
+    if (types[i] == PAROPT_REDUCE_MAX){
+      nmax++;
+    }
+    else {
+      nsum++;
+    }
+  }
+
+  int nscalar = sizeof(ParOptScalar)/sizeof(double);
+  if (nmax == 0){
+    // Only sums are required: reduce the scalar values in place
+    reduce_mode = PAROPT_REDUCE_SUM_ONLY;
+    return;
+  }
+  else if (nsum == 0){
+    reduce_mode = PAROPT_REDUCE_MAX_ONLY;
+    packed_size = nmax;
+  }
+  else {
+    reduce_mode = PAROPT_REDUCE_MIXED;
+    packed_size = 1 + nscalar*nsum + nmax;
+  }
+
+  if (packed_size > max_buffer){
+    if (buffer){
+      delete [] buffer;
+    }
+    max_buffer = packed_size;
+    buffer = new double[ max_buffer ];
+  }
+
+  if (reduce_mode == PAROPT_REDUCE_MAX_ONLY){
+    // Only the maximum values are required
+    for ( int i = 0; i < nentries; i++ ){
+      buffer[i] = ParOptRealPart(values[i]);
+    }
+  }
+  else {
+    // Pack the summed values (as doubles) followed by the maxima
+    buffer[0] = nscalar*nsum;
+    double *sum_buf = &buffer[1];
+    double *max_buf = &buffer[1 + nscalar*nsum];
+    for ( int i = 0; i < nentries; i++ ){
+      if (types[i] == PAROPT_REDUCE_MAX){
+        max_buf[0] = ParOptRealPart(values[i]);
+        max_buf++;
+      }
+      else {
+        memcpy(sum_buf, &values[i], sizeof(ParOptScalar));
+        sum_buf += nscalar;
+      }
+    }
+
+    // Create the datatype and operation only when required
+    if (packed_type_size != packed_size){
+      if (packed_type != MPI_DATATYPE_NULL){
+        MPI_Type_free(&packed_type);
+      }
+      MPI_Type_contiguous(packed_size, MPI_DOUBLE, &packed_type);
+      MPI_Type_commit(&packed_type);
+      packed_type_size = packed_size;
+    }
+    if (packed_op == MPI_OP_NULL){
+      MPI_Op_create(sumMaxOp, 1, &packed_op);
+    }
+  }
+}
+
+/**
+  Unpack the reduced entries and complete the computation of the
+  norms
+*/
+void ParOptReductionContext::unpackEntries(){
+  if (reduce_mode == PAROPT_REDUCE_MAX_ONLY){
+    for ( int i = 0; i < nentries; i++ ){
+      values[i] = buffer[i];
+    }
+  }
+  else if (reduce_mode == PAROPT_REDUCE_MIXED){
+    // Unpack the results
+    int nscalar = sizeof(ParOptScalar)/sizeof(double);
+    int nsum = (int)buffer[0]/nscalar;
+    double *sum_buf = &buffer[1];
+    double *max_buf = &buffer[1 + nscalar*nsum];
+    for ( int i = 0; i < nentries; i++ ){
+      if (types[i] == PAROPT_REDUCE_MAX){
+        values[i] = max_buf[0];
+        max_buf++;
+      }
+      else {
+        memcpy(&values[i], sum_buf, sizeof(ParOptScalar));
+        sum_buf += nscalar;
+      }
+    }
+  }
+
+  // Complete the computation of the norms
+  for ( int i = 0; i < nentries; i++ ){
+    if (types[i] == PAROPT_REDUCE_NORM){
+      values[i] = sqrt(ParOptRealPart(values[i]));
+    }
+  }
+}
+
+/**
+  Complete all of the queued reductions using a single collective
+  call. This must be called on all processors in the communicator
+  with the same sequence of queued entries.
+*/
+void ParOptReductionContext::reduce(){
+  if (nentries == 0){
+    return;
+  }
+
+  packEntries();
+  if (reduce_mode == PAROPT_REDUCE_SUM_ONLY){
+    ParOptAllreduce(MPI_IN_PLACE, values, nentries, PAROPT_MPI_TYPE,
+                  MPI_SUM, comm);
+  }
+  else if (reduce_mode == PAROPT_REDUCE_MAX_ONLY){
+    ParOptAllreduce(MPI_IN_PLACE, buffer, packed_size, MPI_DOUBLE,
+                  MPI_MAX, comm);
+  }
+  else {
+    ParOptAllreduce(MPI_IN_PLACE, buffer, 1, packed_type, packed_op, comm);
+  }
+  unpackEntries();
+}
+
+/**
+  Start all of the queued reductions using a single non-blocking
+  collective call. Computations that do not depend on the results
+  may be performed before the matching call to endReduce(). No
+  entries may be added and no results retrieved until endReduce()
+  has been called.
+*/
+void ParOptReductionContext::beginReduce(){
+  request = MPI_REQUEST_NULL;
+  if (nentries == 0){
+    return;
+  }
+
+  packEntries();
+  if (reduce_mode == PAROPT_REDUCE_SUM_ONLY){
+    ParOptIallreduce(MPI_IN_PLACE, values, nentries, PAROPT_MPI_TYPE,
+                   MPI_SUM, comm, &request);
+  }
+  else if (reduce_mode == PAROPT_REDUCE_MAX_ONLY){
+    ParOptIallreduce(MPI_IN_PLACE, buffer, packed_size, MPI_DOUBLE,
+                   MPI_MAX, comm, &request);
+  }
+  else {
+    ParOptIallreduce(MPI_IN_PLACE, buffer, 1, packed_type, packed_op,
+                   comm, &request);
+  }
+}
+
+/**
+  Wait for the reduction started by beginReduce() to complete
+*/
+void ParOptReductionContext::endReduce(){
+  if (request == MPI_REQUEST_NULL){
+    return;
+  }
+
+  MPI_Wait(&request, MPI_STATUS_IGNORE);
+  unpackEntries();
+}
+
+/**
+  Get the real part of the result of a reduction
+
+  @param handle the handle returned when the entry was queued
+  @return the reduced value
+*/
+double ParOptReductionContext::getValue( int handle ){
+  if (handle >= 0 && handle < nentries){
+    return ParOptRealPart(values[handle]);
+  }
+  return 0.0;
+}
+
+/**
+  Get the scalar result of a reduction
+
+  @param handle the handle returned when the entry was queued
+  @return the reduced value
+*/
+ParOptScalar ParOptReductionContext::getScalar( int handle ){
+  if (handle >= 0 && handle < nentries){
+    return values[handle];
+  }
+  return 0.0;
+}
+
+/**
+  Create a pool of vector storage with the given layout
+
+  @param comm the communicator for the vectors
+  @param size the number of local components of each vector
+*/
+ParOptVecPool::ParOptVecPool( MPI_Comm _comm, int _size ){
+  comm = _comm;
+  size = _size;
+  num_free = 0;
+  max_free = 0;
+  free_arrays = NULL;
+  in_use = 0;
+  peak_use = 0;
+}
+
+/**
+  Free the storage in the pool. All of the vectors created by the
+  pool hold a reference to it, so no arrays are in use at this point.
+*/
+ParOptVecPool::~ParOptVecPool(){
+  clear();
+  if (free_arrays){
+    delete [] free_arrays;
+  }
+}
+
+/**
+  Create a vector that uses storage from the pool
+
+  @return a new vector with zeroed entries
+*/
+ParOptBasicVec *ParOptVecPool::createVec(){
+  return new ParOptBasicVec(this);
+}
+
+/**
+  Get zeroed storage for a vector, reusing a returned array if one is
+  available
+
+  @return the array
+*/
+ParOptScalar *ParOptVecPool::getArray(){
+  ParOptScalar *x = NULL;
+  if (num_free > 0){
+    num_free--;
+    x = free_arrays[num_free];
+    PAROPT_OMP_FOR
+    for ( int i = 0; i < size; i++ ){
+      x[i] = 0.0;
+    }
+  }
+  else {
+    x = ParOptAllocAligned(size);
+  }
+
+  in_use++;
+  if (in_use > peak_use){
+    peak_use = in_use;
+  }
+
+  return x;
+}
+
+/**
+  Return the storage for a vector to the pool
+
+  @param array the array obtained from getArray()
+*/
+void ParOptVecPool::returnArray( ParOptScalar *array ){
+  in_use--;
+  if (!array){
+    return;
+  }
+  if (num_free >= max_free){
+    max_free = 2*max_free + 8;
+    ParOptScalar **tmp = new ParOptScalar*[ max_free ];
+    if (free_arrays){
+      memcpy(tmp, free_arrays, num_free*sizeof(ParOptScalar*));
+      delete [] free_arrays;
+    }
+    free_arrays = tmp;
+  }
+  free_arrays[num_free] = array;
+  num_free++;
+}
+
+/**
+  Free the arrays in the pool that are not currently in use
+*/
+void ParOptVecPool::clear(){
+  for ( int i = 0; i < num_free; i++ ){
+    ParOptFreeAligned(free_arrays[i], size);
+  }
+  num_free = 0;
+}
+
+/**
+  Get the usage statistics for the pool
+
+  @param in_use the number of arrays currently in use
+  @param peak the peak number of arrays in use
+  @param num_free the number of arrays available for reuse
+*/
+void ParOptVecPool::getStats( int *_in_use, int *_peak, int *_num_free ){
+  if (_in_use){ *_in_use = in_use; }
+  if (_peak){ *_peak = peak_use; }
+  if (_num_free){ *_num_free = num_free; }
 }
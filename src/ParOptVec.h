@@ -16,11 +16,36 @@ typedef std::complex<double> ParOptComplex;
 #ifdef PAROPT_USE_COMPLEX
 #define PAROPT_MPI_TYPE MPI_DOUBLE_COMPLEX
 typedef std::complex<double> ParOptScalar;
+typedef std::complex<float> ParOptLowScalar;
 #else
 #define PAROPT_MPI_TYPE MPI_DOUBLE
 typedef double ParOptScalar;
+typedef float ParOptLowScalar;
 #endif // PAROPT_USE_COMPLEX
 
+// Get the MPI data type for problems that are templated on the
+// scalar type, such as those that implement evalObjConComplex()
+template <typename T> inline MPI_Datatype ParOptMPIType();
+template <> inline MPI_Datatype ParOptMPIType<double>(){
+  return MPI_DOUBLE;
+}
+template <> inline MPI_Datatype ParOptMPIType<ParOptComplex>(){
+  return MPI_DOUBLE_COMPLEX;
+}
+
+// Set the OpenMP directives used to thread the loops over the locally
+// owned components. These are only active when ParOpt is compiled
+// with PAROPT_USE_OPENMP defined and the compiler's OpenMP flag.
+#ifdef PAROPT_USE_OPENMP
+#define PAROPT_PRAGMA(x) _Pragma(#x)
+#else
+#define PAROPT_PRAGMA(x)
+#endif // PAROPT_USE_OPENMP
+#define PAROPT_OMP_FOR PAROPT_PRAGMA(omp parallel for schedule(static))
+
+// The alignment in bytes of the storage allocated for the vectors
+#define PAROPT_VEC_ALIGNMENT 64
+
 /**
   ParOpt base class for reference counting
 */
@@ -49,6 +74,18 @@ class ParOptBase {
   int ref_count;
 };
 
+/*
+  Allocate and free the aligned storage used by the vectors. The
+  storage is zeroed unless zero_entries is false. The number of bytes
+  currently allocated and the peak are recorded on each processor.
+*/
+ParOptScalar *ParOptAllocAligned( int size, int zero_entries=1 );
+void ParOptFreeAligned( ParOptScalar *array, int size );
+void ParOptGetVecMemoryStats( double *current, double *peak );
+
+class ParOptVecPool;
+class ParOptActiveSet;
+
 /*
   This vector class defines the basic linear algebra operations and
   member functions required for design optimization.
@@ -70,14 +107,85 @@ class ParOptVec : public ParOptBase {
   virtual void scale( ParOptScalar alpha ) = 0;
   virtual void axpy( ParOptScalar alpha, ParOptVec *x ) = 0;
   virtual int getArray( ParOptScalar **array ) = 0;
+
+  // Fused operations that complete in a single pass over memory. The
+  // default implementations are composed from the operations above,
+  // but implementations should override them when possible.
+  // -------------------------------------------------------
+  virtual void axpby( ParOptScalar alpha, ParOptScalar beta, ParOptVec *x );
+  virtual void waxpy( ParOptScalar alpha, ParOptVec *x, ParOptVec *y );
+  virtual void pointwiseMultDiv( ParOptVec *a, ParOptVec *x, ParOptVec *b );
+
+  // Contributions from the locally owned components only. These do
+  // not perform any communication and are used to batch reductions.
+  // -------------------------------------------------------
+  virtual double localNormSquared();
+  virtual double localMaxAbs();
+  virtual double localL1Norm();
+  virtual ParOptScalar localDot( ParOptVec *vec );
+
+  // Component-wise kernels used by the interior point method. The
+  // default implementations operate on the array from getArray().
+  // Implementations that store their entries in device memory should
+  // override these so that the entries remain on the device.
+  // -------------------------------------------------------
+  virtual void computeBoundedStep( ParOptVec *x0, ParOptScalar alpha,
+                                   ParOptVec *p,
+                                   ParOptVec *lb,
+                                   const ParOptScalar *lower_value,
+                                   ParOptVec *ub,
+                                   const ParOptScalar *upper_value,
+                                   double design_precision );
+  virtual double localMaxStep( double tau, ParOptVec *p, double max_step );
+  virtual double localMaxBoundStep( double tau, ParOptVec *p,
+                                    ParOptVec *lb, ParOptVec *ub,
+                                    double max_step );
+  virtual void localBoundComp( double alpha_x, ParOptVec *px,
+                               double alpha_z,
+                               ParOptVec *lb, ParOptVec *zl, ParOptVec *pzl,
+                               ParOptVec *ub, ParOptVec *zu, ParOptVec *pzu,
+                               double max_bound_val,
+                               ParOptScalar *product, ParOptScalar *count );
+  virtual void computeBarrierDiag( ParOptScalar b0, ParOptVec *h,
+                                   ParOptScalar sigma, ParOptVec *x,
+                                   ParOptVec *lb, ParOptVec *zl,
+                                   ParOptVec *ub, ParOptVec *zu,
+                                   double max_bound_val );
+
+  // Compress the vector to the free variables of the active set, or
+  // expand it back to the full set of variables. The default
+  // implementations do not support compression and return non-zero.
+  // -------------------------------------------------------
+  virtual int compressEntries( ParOptActiveSet *active ){ return 1; }
+  virtual int expandEntries( ParOptActiveSet *active,
+                             const ParOptScalar *fixed_values=NULL ){
+    return 1;
+  }
 };
 
+/*
+  Set xvals = x0vals + alpha*pvals, adjusted so that the result lies
+  strictly within the bounds. The bounds are given either as arrays or
+  as scalar values (either may be NULL).
+*/
+void ParOptComputeBoundedStep( int n, ParOptScalar *xvals,
+                               const ParOptScalar *x0vals,
+                               ParOptScalar alpha,
+                               const ParOptScalar *pvals,
+                               const ParOptScalar *lbvals,
+                               const ParOptScalar *lower_value,
+                               const ParOptScalar *ubvals,
+                               const ParOptScalar *upper_value,
+                               double design_precision );
+
 /*
   A basic ParOptVec implementation
 */
 class ParOptBasicVec : public ParOptVec {
  public:
   ParOptBasicVec( MPI_Comm _comm, int n );
+  ParOptBasicVec( MPI_Comm _comm, int n, ParOptScalar *array );
+  ParOptBasicVec( ParOptVecPool *_pool );
   ~ParOptBasicVec();
 
   // Perform standard operations required for linear algebra
@@ -94,10 +202,164 @@ class ParOptBasicVec : public ParOptVec {
   void axpy( ParOptScalar alpha, ParOptVec *x );
   int getArray( ParOptScalar **array );
 
+  // Fused operations
+  // ----------------
+  void axpby( ParOptScalar alpha, ParOptScalar beta, ParOptVec *x );
+  void waxpy( ParOptScalar alpha, ParOptVec *x, ParOptVec *y );
+  void pointwiseMultDiv( ParOptVec *a, ParOptVec *x, ParOptVec *b );
+
+  // Local contributions without communication
+  // -----------------------------------------
+  double localNormSquared();
+  double localMaxAbs();
+  double localL1Norm();
+  ParOptScalar localDot( ParOptVec *vec );
+
+  // Compression to the free variables of an active set
+  // --------------------------------------------------
+  int compressEntries( ParOptActiveSet *active );
+  int expandEntries( ParOptActiveSet *active,
+                     const ParOptScalar *fixed_values=NULL );
+
  private:
   MPI_Comm comm;
   int size;
+  int full_size; // The allocated size (size < full_size if compressed)
   ParOptScalar *x;
+  int owns_data; // Flag indicating whether x is freed by this object
+  ParOptVecPool *pool; // The pool that x is returned to (may be NULL)
+
+  // Storage for the block partial sums of the threaded reductions,
+  // allocated on first use and kept for the lifetime of the vector
+  ParOptScalar *getReduceWork( int n );
+  int work_size;
+  ParOptScalar *work;
+};
+
+/*
+  A pool of vector storage with a fixed parallel layout.
+
+  The storage for vectors created by the pool is returned to the pool
+  when the vector is deleted and reused for the next vector, rather
+  than being freed. This avoids repeated large allocations when
+  optimizers and subproblems are created and destroyed with the same
+  problem. The pool is reference counted by each vector it creates so
+  that it remains valid until all of its vectors are deleted.
+*/
+class ParOptVecPool : public ParOptBase {
+ public:
+  ParOptVecPool( MPI_Comm _comm, int _size );
+  ~ParOptVecPool();
+
+  // Create a new vector with storage taken from the pool
+  ParOptBasicVec *createVec();
+
+  // Get the layout of the vectors
+  MPI_Comm getMPIComm(){ return comm; }
+  int getSize(){ return size; }
+
+  // Get or return zeroed storage for one vector
+  ParOptScalar *getArray();
+  void returnArray( ParOptScalar *array );
+
+  // Free the storage that is not currently in use
+  void clear();
+
+  // Get the number of arrays in use, the peak and the number free
+  void getStats( int *in_use, int *peak, int *num_free );
+
+ private:
+  MPI_Comm comm;
+  int size;
+
+  // The arrays that are available for reuse
+  int num_free, max_free;
+  ParOptScalar **free_arrays;
+
+  // The number of arrays in use and the peak number
+  int in_use, peak_use;
+};
+
+/*
+  Batch several global reductions into a single collective operation.
+
+  Norms, dot products and locally computed partial sums or maxima are
+  queued with the add*() functions, each of which returns a handle.
+  The reduce() call completes all queued reductions with a single
+  MPI_Allreduce, after which the results are retrieved by handle.
+  Alternatively, beginReduce() starts the same reduction with
+  MPI_Iallreduce so that it can be overlapped with other work, and
+  endReduce() waits for the results.
+
+  For example:
+
+  ParOptReductionContext ctx(comm);
+  int h1 = ctx.addNorm(x);
+  int h2 = ctx.addDot(x, y);
+  ctx.reduce();
+  double xnorm = ctx.getValue(h1);
+  ParOptScalar xTy = ctx.getScalar(h2);
+*/
+class ParOptReductionContext {
+ public:
+  ParOptReductionContext( MPI_Comm _comm );
+  ~ParOptReductionContext();
+
+  // Clear all queued entries so the object can be reused
+  void reset();
+
+  // Queue the reductions
+  int addNorm( ParOptVec *x );
+  int addL1Norm( ParOptVec *x );
+  int addMaxAbs( ParOptVec *x );
+  int addDot( ParOptVec *x, ParOptVec *y );
+  int addSum( ParOptScalar value );
+  int addMax( double value );
+
+  // Perform all of the queued reductions with one collective
+  void reduce();
+
+  // Start the queued reductions with one non-blocking collective and
+  // wait for completion
+  void beginReduce();
+  void endReduce();
+
+  // Retrieve the results after reduce() has been called
+  double getValue( int handle );
+  ParOptScalar getScalar( int handle );
+
+ private:
+  // Add an entry of the given type
+  int addEntry( int type, ParOptScalar value );
+
+  // Pack/unpack the entries before/after the collective
+  void packEntries();
+  void unpackEntries();
+
+  // The reduction operation used when both sums and maxima are queued
+  static void sumMaxOp( void *in, void *inout, int *len, MPI_Datatype *dtype );
+
+  MPI_Comm comm;
+
+  // The number of queued entries and the allocated size
+  int nentries, max_entries;
+  int *types;
+  ParOptScalar *values;
+
+  // Buffer used to pack the entries for the reduction
+  int max_buffer;
+  double *buffer;
+
+  // Data for the collective in progress
+  int reduce_mode, packed_size;
+  MPI_Request request;
+
+  // The datatype and operation for mixed reductions. These are created
+  // when first needed and kept until the context is destroyed. The
+  // datatype is only re-created when the packed size changes.
+  int packed_type_size;
+  MPI_Datatype packed_type;
+  MPI_Op packed_op;
 };
 
 #endif // PAR_OPT_VEC_H